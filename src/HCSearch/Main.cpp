@@ -42,6 +42,16 @@ int main(int argc, char* argv[])
 	HCSearch::Global::settings->paths->OUTPUT_TEMP_FOLDER_NAME = po.tempFolderName;
 
 	HCSearch::Global::settings->USE_EDGE_WEIGHTS = po.useEdgeWeights;
+	HCSearch::Global::settings->CHECK_FOR_DUPLICATES = po.checkForDuplicates;
+	HCSearch::Global::settings->TIME_BUDGET_MS = po.timeBudgetMs;
+	HCSearch::Global::settings->TRANSPOSITION_TABLE_SIZE = po.transpositionTableSize;
+	HCSearch::Global::settings->TRANSPOSITION_TABLE_FEATURES = po.transpositionTableFeatures;
+	HCSearch::Global::settings->DATASET_CACHE_MB = po.datasetCacheMB;
+	HCSearch::Global::settings->NUM_THREADS = po.numThreads;
+	HCSearch::Global::settings->PARALLEL_IMAGES = po.parallelImages;
+	HCSearch::Global::settings->DYNAMIC_SCHEDULING = po.dynamicSchedule;
+	HCSearch::Global::settings->RANK_PAIR_SAMPLING = po.rankPairSampling;
+	HCSearch::Global::settings->RANK_PAIRS_PER_POSITIVE = po.rankPairsPerPositive;
 
 	HCSearch::Setup::configure(po.inputDir, po.outputDir, po.baseDir);
 	if (po.verboseMode)
@@ -126,6 +136,10 @@ HCSearch::SearchSpace* setupSearchSpace(MyProgramOptions::ProgramOptions po)
 		LOG() << "dense CRF features" << endl;
 		heuristicFeatFunc = new HCSearch::DenseCRFFeatures();
 		break;
+	case MyProgramOptions::ProgramOptions::DENSE_CRF_FAST:
+		LOG() << "fast dense CRF features" << endl;
+		heuristicFeatFunc = new HCSearch::FastDenseCRFFeatures();
+		break;
 	default:
 		LOG(ERROR) << "undefined feature mode.";
 	}
@@ -133,49 +147,62 @@ HCSearch::SearchSpace* setupSearchSpace(MyProgramOptions::ProgramOptions po)
 	// select cost feature function
 	LOG() << "Cost feature function: ";
 	HCSearch::IFeatureFunction* costFeatFunc = NULL;
-	switch (po.heuristicFeaturesMode)
+	if (po.costFeaturesMode == po.heuristicFeaturesMode)
 	{
-	case MyProgramOptions::ProgramOptions::STANDARD:
-		LOG() << "standard CRF features" << endl;
-		LOG() << "\tlambda1=" << po.lambda1 << endl;
-		LOG() << "\tlambda2=" << po.lambda2 << endl;
-		LOG() << "\tlambda3=" << po.lambda3 << endl;
-		costFeatFunc = new HCSearch::StandardFeatures(po.lambda1, po.lambda2, po.lambda3);
-		break;
-	case MyProgramOptions::ProgramOptions::STANDARD_CONTEXT:
-		LOG() << "standard context CRF features" << endl;
-		costFeatFunc = new HCSearch::StandardContextFeatures();
-		break;
-	case MyProgramOptions::ProgramOptions::STANDARD_ALT:
-		LOG() << "standard 2 CRF features" << endl;
-		costFeatFunc = new HCSearch::StandardAltFeatures();
-		break;
-	case MyProgramOptions::ProgramOptions::STANDARD_CONF:
-		LOG() << "standard 3 CRF features" << endl;
-		costFeatFunc = new HCSearch::StandardConfFeatures();
-		break;
-	case MyProgramOptions::ProgramOptions::UNARY:
-		LOG() << "unary CRF features" << endl;
-		costFeatFunc = new HCSearch::UnaryFeatures();
-		break;
-	case MyProgramOptions::ProgramOptions::UNARY_CONF:
-		LOG() << "unary confidences CRF features" << endl;
-		costFeatFunc = new HCSearch::UnaryConfFeatures();
-		break;
-	case MyProgramOptions::ProgramOptions::STANDARD_PAIR_COUNTS:
-		LOG() << "pairwise bigram CRF features" << endl;
-		costFeatFunc = new HCSearch::StandardPairwiseCountsFeatures();
-		break;
-	case MyProgramOptions::ProgramOptions::STANDARD_CONF_PAIR_COUNTS:
-		LOG() << "pairwise bigram confidences CRF features" << endl;
-		costFeatFunc = new HCSearch::StandardConfPairwiseCountsFeatures();
-		break;
-	case MyProgramOptions::ProgramOptions::DENSE_CRF:
-		LOG() << "dense CRF features" << endl;
-		costFeatFunc = new HCSearch::DenseCRFFeatures();
-		break;
-	default:
-		LOG(ERROR) << "undefined feature mode.";
+		// same features are computed once and scored by both models
+		LOG() << "same as heuristic feature function" << endl;
+		costFeatFunc = heuristicFeatFunc;
+	}
+	else
+	{
+		switch (po.costFeaturesMode)
+		{
+		case MyProgramOptions::ProgramOptions::STANDARD:
+			LOG() << "standard CRF features" << endl;
+			LOG() << "\tlambda1=" << po.lambda1 << endl;
+			LOG() << "\tlambda2=" << po.lambda2 << endl;
+			LOG() << "\tlambda3=" << po.lambda3 << endl;
+			costFeatFunc = new HCSearch::StandardFeatures(po.lambda1, po.lambda2, po.lambda3);
+			break;
+		case MyProgramOptions::ProgramOptions::STANDARD_CONTEXT:
+			LOG() << "standard context CRF features" << endl;
+			costFeatFunc = new HCSearch::StandardContextFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::STANDARD_ALT:
+			LOG() << "standard 2 CRF features" << endl;
+			costFeatFunc = new HCSearch::StandardAltFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::STANDARD_CONF:
+			LOG() << "standard 3 CRF features" << endl;
+			costFeatFunc = new HCSearch::StandardConfFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::UNARY:
+			LOG() << "unary CRF features" << endl;
+			costFeatFunc = new HCSearch::UnaryFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::UNARY_CONF:
+			LOG() << "unary confidences CRF features" << endl;
+			costFeatFunc = new HCSearch::UnaryConfFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::STANDARD_PAIR_COUNTS:
+			LOG() << "pairwise bigram CRF features" << endl;
+			costFeatFunc = new HCSearch::StandardPairwiseCountsFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::STANDARD_CONF_PAIR_COUNTS:
+			LOG() << "pairwise bigram confidences CRF features" << endl;
+			costFeatFunc = new HCSearch::StandardConfPairwiseCountsFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::DENSE_CRF:
+			LOG() << "dense CRF features" << endl;
+			costFeatFunc = new HCSearch::DenseCRFFeatures();
+			break;
+		case MyProgramOptions::ProgramOptions::DENSE_CRF_FAST:
+			LOG() << "fast dense CRF features" << endl;
+			costFeatFunc = new HCSearch::FastDenseCRFFeatures();
+			break;
+		default:
+			LOG(ERROR) << "undefined feature mode.";
+		}
 	}
 
 	// select prune feature function
@@ -222,6 +249,10 @@ HCSearch::SearchSpace* setupSearchSpace(MyProgramOptions::ProgramOptions po)
 		LOG() << "dense CRF features" << endl;
 		pruneFeatFunc = new HCSearch::DenseCRFFeatures();
 		break;
+	case MyProgramOptions::ProgramOptions::DENSE_CRF_FAST:
+		LOG() << "fast dense CRF features" << endl;
+		pruneFeatFunc = new HCSearch::FastDenseCRFFeatures();
+		break;
 	case MyProgramOptions::ProgramOptions::STANDARD_PRUNE:
 		LOG() << "standard prune features" << endl;
 		pruneFeatFunc = new HCSearch::StandardPruneFeatures();
@@ -426,6 +457,18 @@ void run(MyProgramOptions::ProgramOptions po)
 	vector< HCSearch::ImgFeatures* > XTest;
 	vector< HCSearch::ImgLabeling* > YTest;
 
+	// convert dataset to binary format if requested
+	if (po.convertBinary)
+	{
+		if (HCSearch::Global::settings->RANK == 0)
+			HCSearch::Dataset::convertDataset();
+
+#ifdef USE_MPI
+		MPI::Synchronize::masterWait("CONVERTSTART");
+		MPI::Synchronize::slavesWait("CONVERTEND");
+#endif
+	}
+
 	// load dataset
 	HCSearch::Dataset::loadDataset(XTrain, YTrain, XValidation, YValidation, XTest, YTest);
 
@@ -648,11 +691,10 @@ void run(MyProgramOptions::ProgramOptions po)
 			LOG() << "=== Inference LL ===" << endl;
 
 			// run LL search on test examples
-			int start, end;
-			HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTest.size(), 
-				HCSearch::Global::settings->NUM_PROCESSES, start, end);
-			for (int i = start; i < end; i++)
+			HCSearch::Dataset::scheduleImages(XTest, true, [&](int i)
 			{
+				HCSearch::Dataset::acquireImage(XTest[i], YTest[i]);
+
 				for (int iter = 0; iter < po.numTestIterations; iter++)
 				{
 					if (po.numTestIterations == 1)
@@ -691,13 +733,16 @@ void run(MyProgramOptions::ProgramOptions po)
 							<< "_time" << timeBound 
 								<< "_fold" << meta.iter 
 								<< "_" << meta.exampleName << ".txt";
+						HCSearch::Dataset::acquireSegments(XTest[i]);
 						HCSearch::SavePrediction::saveLabelMask(*XTest[i], YPred, ssPredictSegments.str());
 					}
 
 					if (po.numTestIterations == 1)
 						break;
 				}
-			}
+
+				HCSearch::Dataset::releaseImage(XTest[i]);
+			});
 
 #ifdef USE_MPI
 		MPI::Synchronize::masterWait("INFERLLSTART");
@@ -713,11 +758,10 @@ void run(MyProgramOptions::ProgramOptions po)
 			// load heuristic, run HL search on test examples
 			HCSearch::IRankModel* heuristicModel = HCSearch::Model::loadModel(heuristicModelPath, rankerType);
 
-			int start, end;
-			HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTest.size(), 
-				HCSearch::Global::settings->NUM_PROCESSES, start, end);
-			for (int i = start; i < end; i++)
+			HCSearch::Dataset::scheduleImages(XTest, true, [&](int i)
 			{
+				HCSearch::Dataset::acquireImage(XTest[i], YTest[i]);
+
 				for (int iter = 0; iter < po.numTestIterations; iter++)
 				{
 					if (po.numTestIterations == 1)
@@ -756,13 +800,16 @@ void run(MyProgramOptions::ProgramOptions po)
 							<< "_time" << timeBound 
 								<< "_fold" << meta.iter 
 								<< "_" << meta.exampleName << ".txt";
+						HCSearch::Dataset::acquireSegments(XTest[i]);
 						HCSearch::SavePrediction::saveLabelMask(*XTest[i], YPred, ssPredictSegments.str());
 					}
 
 					if (po.numTestIterations == 1)
 						break;
 				}
-			}
+
+				HCSearch::Dataset::releaseImage(XTest[i]);
+			});
 
 			delete heuristicModel;
 			
@@ -780,11 +827,10 @@ void run(MyProgramOptions::ProgramOptions po)
 			// load cost oracle H, run LC search on test examples
 			HCSearch::IRankModel* costModel = HCSearch::Model::loadModel(costOracleHModelPath, rankerType);
 
-			int start, end;
-			HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTest.size(), 
-				HCSearch::Global::settings->NUM_PROCESSES, start, end);
-			for (int i = start; i < end; i++)
+			HCSearch::Dataset::scheduleImages(XTest, true, [&](int i)
 			{
+				HCSearch::Dataset::acquireImage(XTest[i], YTest[i]);
+
 				for (int iter = 0; iter < po.numTestIterations; iter++)
 				{
 					if (po.numTestIterations == 1)
@@ -823,13 +869,16 @@ void run(MyProgramOptions::ProgramOptions po)
 							<< "_time" << timeBound 
 								<< "_fold" << meta.iter 
 								<< "_" << meta.exampleName << ".txt";
+						HCSearch::Dataset::acquireSegments(XTest[i]);
 						HCSearch::SavePrediction::saveLabelMask(*XTest[i], YPred, ssPredictSegments.str());
 					}
 
 					if (po.numTestIterations == 1)
 						break;
 				}
-			}
+
+				HCSearch::Dataset::releaseImage(XTest[i]);
+			});
 
 			delete costModel;
 
@@ -848,11 +897,10 @@ void run(MyProgramOptions::ProgramOptions po)
 			HCSearch::IRankModel* heuristicModel = HCSearch::Model::loadModel(heuristicModelPath, rankerType);
 			HCSearch::IRankModel* costModel = HCSearch::Model::loadModel(costModelPath, rankerType);
 
-			int start, end;
-			HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTest.size(), 
-				HCSearch::Global::settings->NUM_PROCESSES, start, end);
-			for (int i = start; i < end; i++)
+			HCSearch::Dataset::scheduleImages(XTest, true, [&](int i)
 			{
+				HCSearch::Dataset::acquireImage(XTest[i], YTest[i]);
+
 				for (int iter = 0; iter < po.numTestIterations; iter++)
 				{
 					if (po.numTestIterations == 1)
@@ -891,13 +939,16 @@ void run(MyProgramOptions::ProgramOptions po)
 							<< "_time" << timeBound 
 								<< "_fold" << meta.iter 
 								<< "_" << meta.exampleName << ".txt";
+						HCSearch::Dataset::acquireSegments(XTest[i]);
 						HCSearch::SavePrediction::saveLabelMask(*XTest[i], YPred, ssPredictSegments.str());
 					}
 
 					if (po.numTestIterations == 1)
 						break;
 				}
-			}
+
+				HCSearch::Dataset::releaseImage(XTest[i]);
+			});
 
 			delete heuristicModel;
 			delete costModel;
@@ -944,12 +995,20 @@ void printInfo(MyProgramOptions::ProgramOptions po)
 	{
 		LOG() << "=== Program Options ===" << endl;
 		LOG() << "Rank learner: " << HCSearch::RankerTypeStrings[po.rankLearnerType] << endl;
+		if (po.rankPairsPerPositive > 0)
+		{
+			LOG() << "Rank pairs: " << HCSearch::RankPairSamplingStrings[po.rankPairSampling] << " " << po.rankPairsPerPositive << " per better example" << endl;
+		}
 		LOG() << "Num training iterations: " << po.numTrainIterations << endl;
 		LOG() << "Num testing iterations: " << po.numTestIterations << endl;
 		if (po.numTestIterations == 1)
 		{
 			LOG() << "\tUnique iteration ID: " << po.uniqueIterId << endl;
 		}
+		if (po.timeBudgetMs > 0)
+		{
+			LOG() << "Time budget per search (ms): " << po.timeBudgetMs << endl;
+		}
 		LOG() << "Save anytime predictions: " << po.saveAnytimePredictions << endl;
 		LOG() << "Save features files: " << po.saveFeaturesFiles << endl;
 		LOG() << "Save output label masks: " << po.saveOutputMask << endl;
@@ -27,6 +27,7 @@ namespace MyProgramOptions
 		// time bound
 
 		timeBound = 0;
+		timeBudgetMs = 0;
 
 		// schedule or demo
 
@@ -51,6 +52,8 @@ namespace MyProgramOptions
 
 		saveAnytimePredictions = true;
 		rankLearnerType = HCSearch::SVM_RANK;
+		rankPairSampling = HCSearch::ALL_PAIRS;
+		rankPairsPerPositive = 0;
 		saveFeaturesFiles = false;
 		numTrainIterations = 1;
 		numTestIterations = 1;
@@ -60,6 +63,14 @@ namespace MyProgramOptions
 		pruneRatio = 0.5;
 		badPruneRatio = 1.0;
 		useEdgeWeights = false;
+		checkForDuplicates = false;
+		convertBinary = false;
+		datasetCacheMB = 0;
+		transpositionTableSize = 0;
+		transpositionTableFeatures = true;
+		numThreads = 1;
+		parallelImages = false;
+		dynamicSchedule = false;
 
 		nodeClamp = false;
 		edgeClamp = false;
@@ -264,6 +275,27 @@ namespace MyProgramOptions
 						po.rankLearnerType = HCSearch::SVM_RANK;
 					else if (strcmp(argv[i+1], "vw") == 0)
 						po.rankLearnerType = HCSearch::VW_RANK;
+					else if (strcmp(argv[i+1], "online") == 0)
+						po.rankLearnerType = HCSearch::ONLINE_RANK;
+				}
+			}
+			else if (strcmp(argv[i], "--rank-pairs") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "all") == 0)
+						po.rankPairSampling = HCSearch::ALL_PAIRS;
+					else if (strcmp(argv[i+1], "hardest") == 0)
+						po.rankPairSampling = HCSearch::HARDEST_PAIRS;
+					else if (strcmp(argv[i+1], "random") == 0)
+						po.rankPairSampling = HCSearch::RANDOM_PAIRS;
+				}
+			}
+			else if (strcmp(argv[i], "--rank-pairs-k") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.rankPairsPerPositive = atoi(argv[i+1]);
 				}
 			}
 			else if (strcmp(argv[i], "--search") == 0)
@@ -338,6 +370,61 @@ namespace MyProgramOptions
 					po.cutParam = atof(argv[i+1]);
 				}
 			}
+			else if (strcmp(argv[i], "--dynamic-schedule") == 0)
+			{
+				po.dynamicSchedule = true;
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "false") == 0)
+						po.dynamicSchedule = false;
+				}
+			}
+			else if (strcmp(argv[i], "--parallel-images") == 0)
+			{
+				po.parallelImages = true;
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "false") == 0)
+						po.parallelImages = false;
+				}
+			}
+			else if (strcmp(argv[i], "--num-threads") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.numThreads = atoi(argv[i+1]);
+				}
+			}
+			else if (strcmp(argv[i], "--dataset-cache-mb") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.datasetCacheMB = atoi(argv[i+1]);
+				}
+			}
+			else if (strcmp(argv[i], "--transposition-table-size") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.transpositionTableSize = atoi(argv[i+1]);
+				}
+			}
+			else if (strcmp(argv[i], "--transposition-table-features") == 0)
+			{
+				po.transpositionTableFeatures = true;
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "false") == 0)
+						po.transpositionTableFeatures = false;
+				}
+			}
+			else if (strcmp(argv[i], "--time-budget-ms") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.timeBudgetMs = atoi(argv[i+1]);
+				}
+			}
 			else if (strcmp(argv[i], "--anytime") == 0)
 			{
 				po.saveAnytimePredictions = true;
@@ -434,6 +521,8 @@ namespace MyProgramOptions
 						po.heuristicFeaturesMode = STANDARD_CONF;
 					else if (strcmp(argv[i+1], "dense-crf") == 0)
 						po.heuristicFeaturesMode = DENSE_CRF;
+					else if (strcmp(argv[i+1], "dense-crf-fast") == 0)
+						po.heuristicFeaturesMode = DENSE_CRF_FAST;
 					else if (strcmp(argv[i+1], "unary") == 0)
 						po.heuristicFeaturesMode = UNARY;
 					else if (strcmp(argv[i+1], "unary-conf") == 0)
@@ -458,6 +547,8 @@ namespace MyProgramOptions
 						po.costFeaturesMode = STANDARD_CONF;
 					else if (strcmp(argv[i+1], "dense-crf") == 0)
 						po.costFeaturesMode = DENSE_CRF;
+					else if (strcmp(argv[i+1], "dense-crf-fast") == 0)
+						po.costFeaturesMode = DENSE_CRF_FAST;
 					else if (strcmp(argv[i+1], "unary") == 0)
 						po.costFeaturesMode = UNARY;
 					else if (strcmp(argv[i+1], "unary-conf") == 0)
@@ -482,6 +573,8 @@ namespace MyProgramOptions
 						po.pruneFeaturesMode = STANDARD_CONF;
 					else if (strcmp(argv[i+1], "dense-crf") == 0)
 						po.pruneFeaturesMode = DENSE_CRF;
+					else if (strcmp(argv[i+1], "dense-crf-fast") == 0)
+						po.pruneFeaturesMode = DENSE_CRF_FAST;
 					else if (strcmp(argv[i+1], "unary") == 0)
 						po.pruneFeaturesMode = UNARY;
 					else if (strcmp(argv[i+1], "unary-conf") == 0)
@@ -650,6 +743,24 @@ namespace MyProgramOptions
 						po.useEdgeWeights = false;
 				}
 			}
+			else if (strcmp(argv[i], "--convert-binary") == 0)
+			{
+				po.convertBinary = true;
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "false") == 0)
+						po.convertBinary = false;
+				}
+			}
+			else if (strcmp(argv[i], "--check-duplicates") == 0)
+			{
+				po.checkForDuplicates = true;
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "false") == 0)
+						po.checkForDuplicates = false;
+				}
+			}
 			else
 			{
 				string argvi = argv[i];
@@ -696,19 +807,24 @@ namespace MyProgramOptions
 		cerr << "\t--anytime arg\t\t\t" << ": turn on saving anytime predictions if true" << endl;
 		cerr << "\t--base-path arg\t\t\t" << ": path to this program (default is pwd)" << endl;
 		cerr << "\t--beam-size arg\t\t\t" << ": beam size for beam search" << endl;
+		cerr << "\t--check-duplicates arg\t\t" << ": skip states already visited during search if true" << endl;
+		cerr << "\t--convert-binary arg\t\t" << ": convert dataset to binary files before loading if true" << endl;
 		cerr << "\t--cut-mode arg\t\t\t" << ": edges|state (cut edges by edges independently or by state)" << endl;
 		cerr << "\t--cut-param arg\t\t\t" << ": temperature parameter for stochastic cuts" << endl;
+		cerr << "\t--dataset-cache-mb arg\t\t" << ": load images lazily within this memory budget in MB (0 loads all up front)" << endl;
+		cerr << "\t--dynamic-schedule arg\t\t" << ": with MPI, master hands out images (largest first) to free processes if true" << endl;
 		cerr << "\t--edge-clamp arg\t" << ": clamp edges if true" << endl;
 		cerr << "\t--edge-clamp-positive-threshold arg\t" << ": edge clamp positive threshold" << endl;
 		cerr << "\t--edge-clamp-negative-threshold arg\t" << ": edge clamp negative threshold" << endl;
 		cerr << "\t--edges-path arg\t" << ": edges folder name" << endl;
 		cerr << "\t--edge-features-path arg\t" << ": edge features folder name" << endl;
 		cerr << "\t--hfeatures arg\t\t\t" << ": standard|standard-context|standard-conf|unary|unary-conf|"
-			"standard-pair-counts|standard-conf-pair-counts|dense-crf" << endl;
+			"standard-pair-counts|standard-conf-pair-counts|dense-crf|dense-crf-fast" << endl;
 		cerr << "\t--cfeatures arg\t\t\t" << ": standard|standard-context|standard-conf|unary|unary-conf|"
-			"standard-pair-counts|standard-conf-pair-counts|dense-crf" << endl;
+			"standard-pair-counts|standard-conf-pair-counts|dense-crf|dense-crf-fast" << endl;
+		cerr << "\t--parallel-images arg\t\t" << ": run images on the --num-threads threads instead of successors if true" << endl;
 		cerr << "\t--pfeatures arg\t\t" << ": standard|standard-context|standard-conf|unary|unary-conf|"
-			"standard-pair-counts|standard-conf-pair-counts|dense-crf|standard-prune" << endl;
+			"standard-pair-counts|standard-conf-pair-counts|dense-crf|dense-crf-fast|standard-prune" << endl;
 		cerr << "\t--logs-path arg\t" << ": logs folder name" << endl;
 		cerr << "\t--max-cutting-threshold arg\t" << ": maximum threshold for deciding to cut edges" << endl;
 		cerr << "\t--min-cutting-threshold arg\t" << ": minimum threshold for deciding to cut edges" << endl;
@@ -717,8 +833,11 @@ namespace MyProgramOptions
 		cerr << "\t--node-clamp-threshold arg\t" << ": node clamp threshold" << endl;
 		cerr << "\t--nodes-path arg\t" << ": nodes folder name" << endl;
 		cerr << "\t--num-test-iters arg\t" << ": number of test iterations" << endl;
+		cerr << "\t--num-threads arg\t\t" << ": number of threads for evaluating successors in each search step (or images, see --parallel-images)" << endl;
 		cerr << "\t--num-train-iters arg\t" << ": number of training iterations" << endl;
-		cerr << "\t--ranker arg\t\t\t" << ": svmrank|vw" << endl;
+		cerr << "\t--rank-pairs arg\t\t" << ": all|hardest|random (worse examples paired with each better example for rank learning)" << endl;
+		cerr << "\t--rank-pairs-k arg\t\t" << ": number of worse examples per better example for hardest|random (0 uses all pairs)" << endl;
+		cerr << "\t--ranker arg\t\t\t" << ": svmrank|vw|online" << endl;
 		cerr << "\t--loss arg\t\t\t\t" << ": hamming|pixel-hamming" << endl;
 		cerr << "\t--prune arg\t\t" << ": none|ranker|oracle|simulated" << endl;
 		cerr << "\t--prune-ratio arg\t\t" << ": fraction of candidates to prune" << endl;
@@ -736,6 +855,9 @@ namespace MyProgramOptions
 			<< "cut-schedule|cut-schedule-neighbors|cut-schedule-confidences-neighbors"
 			<< "stochastic-schedule|stochastic-schedule-neighbors|stochastic-schedule-confidences-neighbors|stochastic-constrained" << endl;
 		cerr << "\t--temp-path arg\t" << ": temp folder name" << endl;
+		cerr << "\t--time-budget-ms arg\t\t" << ": stop each search after this many milliseconds of wall-clock time (0 uses only the time bound)" << endl;
+		cerr << "\t--transposition-table-size arg\t" << ": memoize up to this many labelings per image during search (0 disables)" << endl;
+		cerr << "\t--transposition-table-features arg\t" << ": also memoize the features of labelings if true" << endl;
 		cerr << "\t--use-edge-weights arg\t\t" << ": use edge weights if true (must provide --edges-path)" << endl;
 		cerr << "\t--unique-iter arg\t\t" << ": unique iteration ID (num-test-iters needs to be 1)" << endl;
 		cerr << "\t--verbose arg\t\t\t" << ": turn on verbose output if true" << endl;
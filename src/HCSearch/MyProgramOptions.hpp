@@ -16,7 +16,7 @@ namespace MyProgramOptions
 		// constants
 
 		enum SearchProcedureMode { GREEDY, BREADTH_BEAM, BEST_BEAM };
-		enum FeaturesMode { STANDARD, STANDARD_CONTEXT, STANDARD_ALT, STANDARD_CONF, DENSE_CRF, UNARY, UNARY_CONF, STANDARD_PAIR_COUNTS, STANDARD_CONF_PAIR_COUNTS, STANDARD_PRUNE };
+		enum FeaturesMode { STANDARD, STANDARD_CONTEXT, STANDARD_ALT, STANDARD_CONF, DENSE_CRF, DENSE_CRF_FAST, UNARY, UNARY_CONF, STANDARD_PAIR_COUNTS, STANDARD_CONF_PAIR_COUNTS, STANDARD_PRUNE };
 		enum InitialFunctionMode { LOG_REG };
 		enum SuccessorsMode { FLIPBIT, FLIPBIT_NEIGHBORS, FLIPBIT_CONFIDENCES_NEIGHBORS, 
 			STOCHASTIC, STOCHASTIC_NEIGHBORS, STOCHASTIC_CONFIDENCES_NEIGHBORS, 
@@ -49,6 +49,7 @@ namespace MyProgramOptions
 		// time bound
 
 		int timeBound;
+		int timeBudgetMs;
 
 		// schedule or demo
 
@@ -74,6 +75,8 @@ namespace MyProgramOptions
 
 		bool saveAnytimePredictions;
 		HCSearch::RankerType rankLearnerType;
+		HCSearch::RankPairSampling rankPairSampling;
+		int rankPairsPerPositive;
 		bool saveFeaturesFiles;
 		int numTrainIterations;
 		int numTestIterations;
@@ -83,6 +86,14 @@ namespace MyProgramOptions
 		double pruneRatio;
 		double badPruneRatio;
 		bool useEdgeWeights;
+		bool checkForDuplicates;
+		bool convertBinary;
+		int datasetCacheMB;
+		int transpositionTableSize;
+		bool transpositionTableFeatures;
+		int numThreads;
+		bool parallelImages;
+		bool dynamicSchedule;
 
 		bool nodeClamp;
 		bool edgeClamp;
@@ -1,6 +1,8 @@
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <limits>
 #ifndef USE_WINDOWS
 #include <unistd.h>
 #endif
@@ -27,15 +29,202 @@ namespace HCSearch
 
 	/**************** Graphs ****************/
 
-	int IGraph::getNumEdges()
+	CompressedAdjacency::CompressedAdjacency()
+	{
+		this->offsets.push_back(0);
+	}
+
+	CompressedAdjacency::CompressedAdjacency(const AdjList_t& adjList, int numNodes)
+	{
+		// rows for every node, including any listed beyond numNodes
+		int numRows = numNodes;
+		if (!adjList.empty())
+			numRows = max(numRows, adjList.rbegin()->first + 1);
+
+		this->offsets.resize(numRows+1, 0);
+		for (AdjList_t::const_iterator it = adjList.begin(); it != adjList.end(); ++it)
+		{
+			if (it->first >= 0)
+				this->offsets[it->first+1] = it->second.size();
+		}
+		for (int node = 0; node < numRows; node++)
+		{
+			this->offsets[node+1] += this->offsets[node];
+		}
+
+		this->neighbors.resize(this->offsets[numRows]);
+		for (AdjList_t::const_iterator it = adjList.begin(); it != adjList.end(); ++it)
+		{
+			if (it->first >= 0)
+				copy(it->second.begin(), it->second.end(), this->neighbors.begin() + this->offsets[it->first]);
+		}
+
+		this->weights.resize(this->neighbors.size(), 1.0);
+	}
+
+	CompressedAdjacency::CompressedAdjacency(int numNodes, const int* offsets, const int* neighbors, const double* weights)
+	{
+		this->offsets.assign(offsets, offsets + numNodes + 1);
+		this->neighbors.assign(neighbors, neighbors + offsets[numNodes]);
+		this->weights.assign(weights, weights + offsets[numNodes]);
+	}
+
+	CompressedAdjacency::~CompressedAdjacency()
+	{
+	}
+
+	int CompressedAdjacency::getNumNodes() const
+	{
+		return this->offsets.size() - 1;
+	}
+
+	int CompressedAdjacency::getNumEdges() const
+	{
+		return this->neighbors.size();
+	}
+
+	int CompressedAdjacency::getNumNeighbors(int node) const
+	{
+		if (node < 0 || node >= getNumNodes())
+			return 0;
+
+		return this->offsets[node+1] - this->offsets[node];
+	}
+
+	CompressedAdjacency::NeighborIterator CompressedAdjacency::neighborsBegin(int node) const
+	{
+		if (node < 0 || node >= getNumNodes())
+			return NULL;
+
+		return this->neighbors.data() + this->offsets[node];
+	}
+
+	CompressedAdjacency::NeighborIterator CompressedAdjacency::neighborsEnd(int node) const
+	{
+		if (node < 0 || node >= getNumNodes())
+			return NULL;
+
+		return this->neighbors.data() + this->offsets[node+1];
+	}
+
+	int CompressedAdjacency::getEdgeIndex(NeighborIterator it) const
+	{
+		return it - this->neighbors.data();
+	}
+
+	int CompressedAdjacency::getEdgeIndex(int node1, int node2) const
+	{
+		NeighborIterator begin = neighborsBegin(node1);
+		NeighborIterator end = neighborsEnd(node1);
+		NeighborIterator it = lower_bound(begin, end, node2);
+		if (it == end || *it != node2)
+			return -1;
+
+		return getEdgeIndex(it);
+	}
+
+	bool CompressedAdjacency::hasEdge(int node1, int node2) const
+	{
+		return getEdgeIndex(node1, node2) >= 0;
+	}
+
+	double CompressedAdjacency::getEdgeWeight(int edgeIndex) const
+	{
+		return this->weights[edgeIndex];
+	}
+
+	void CompressedAdjacency::setEdgeWeight(int edgeIndex, double weight)
+	{
+		this->weights[edgeIndex] = weight;
+	}
+
+	VectorXd CompressedAdjacency::getEdgeFeatures(int edgeIndex) const
+	{
+		return this->features.row(edgeIndex);
+	}
+
+	void CompressedAdjacency::setEdgeFeatures(const MatrixXd& features)
+	{
+		if (features.rows() != getNumEdges())
+		{
+			LOG(ERROR) << "number of edge feature rows does not match number of edges.";
+			abort();
+		}
+
+		this->features = features;
+	}
+
+	size_t CompressedAdjacency::getMemoryBytes() const
+	{
+		return sizeof(int)*(this->offsets.size() + this->neighbors.size()) 
+			+ sizeof(double)*(this->weights.size() + this->features.size());
+	}
+
+	NodeFeatureMatrix::NodeFeatureMatrix() : Map<MatrixXd>(NULL, 0, 0)
+	{
+	}
+
+	NodeFeatureMatrix::NodeFeatureMatrix(const NodeFeatureMatrix& other) : Map<MatrixXd>(NULL, 0, 0)
+	{
+		*this = other;
+	}
+
+	NodeFeatureMatrix::~NodeFeatureMatrix()
 	{
-		int numEdges = 0;
-		for (AdjList_t::iterator it = this->adjList.begin(); it != this->adjList.end(); ++it)
+	}
+
+	NodeFeatureMatrix& NodeFeatureMatrix::operator=(const NodeFeatureMatrix& other)
+	{
+		if (this == &other)
+			return *this;
+
+		if (other.isView())
 		{
-			NeighborSet_t neighbors = it->second;
-			numEdges += neighbors.size();
+			// share the mapping
+			this->storage = MatrixXd();
+			this->mapping = other.mapping;
+			reseat(other.data(), other.rows(), other.cols());
 		}
-		return numEdges;
+		else
+		{
+			this->storage = other.storage;
+			this->mapping.reset();
+			reseat(this->storage.data(), this->storage.rows(), this->storage.cols());
+		}
+
+		return *this;
+	}
+
+	NodeFeatureMatrix& NodeFeatureMatrix::operator=(const MatrixXd& features)
+	{
+		this->storage = features;
+		this->mapping.reset();
+		reseat(this->storage.data(), this->storage.rows(), this->storage.cols());
+
+		return *this;
+	}
+
+	void NodeFeatureMatrix::view(shared_ptr<MyFileSystem::MappedFile> mapping, const double* features, int rows, int cols)
+	{
+		this->storage = MatrixXd();
+		this->mapping = mapping;
+		reseat(features, rows, cols);
+	}
+
+	bool NodeFeatureMatrix::isView() const
+	{
+		return this->mapping != NULL;
+	}
+
+	void NodeFeatureMatrix::reseat(const double* features, int rows, int cols)
+	{
+		// placement new is how Eigen points a Map at other data
+		new (static_cast< Map<MatrixXd>* >(this)) Map<MatrixXd>(const_cast<double*>(features), rows, cols);
+	}
+
+	int IGraph::getNumEdges()
+	{
+		return this->adjacency->getNumEdges();
 	}
 
 	/**************** Features and Labelings ****************/
@@ -45,6 +234,7 @@ namespace HCSearch
 		this->filename = "";
 		this->segmentsAvailable = false;
 		this->nodeLocationsAvailable = false;
+		this->edgeDivergencesAvailable = false;
 	}
 
 	ImgFeatures::~ImgFeatures()
@@ -66,6 +256,42 @@ namespace HCSearch
 		return this->graph.getNumEdges();
 	}
 
+	void ImgFeatures::computeEdgeDivergences()
+	{
+		const CompressedAdjacency& adjacency = *this->graph.adjacency;
+		const int numRows = adjacency.getNumNodes();
+		this->edgeDivergences = VectorXd::Zero(adjacency.getNumEdges());
+
+		// one column per node so the features of a node are contiguous
+		const MatrixXd features = this->graph.nodesData.transpose();
+		for (int node1 = 0; node1 < numRows; node1++)
+		{
+			const ArrayXd p = features.col(node1);
+			for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node1); 
+				it != adjacency.neighborsEnd(node1); ++it)
+			{
+				const ArrayXd q = features.col(*it);
+
+				// p log(p/q) + q log(q/p) over components where both are non-zero
+				ArrayXd logRatio = (p != 0 && q != 0).select(p / q, 1.0).log();
+				this->edgeDivergences(adjacency.getEdgeIndex(it)) = ((p - q) * logRatio).sum();
+			}
+		}
+
+		this->edgeDivergencesAvailable = true;
+	}
+
+	VectorXd ImgFeatures::getCutWeights(double T) const
+	{
+		if (!this->edgeDivergencesAvailable)
+		{
+			LOG(ERROR) << "edge divergences not computed for image: " << this->filename;
+			abort();
+		}
+
+		return (-this->edgeDivergences.array()*T/2).exp().matrix();
+	}
+
 	double ImgFeatures::getFeature(int node, int featIndex)
 	{
 		return this->graph.nodesData(node, featIndex);
@@ -124,31 +350,49 @@ namespace HCSearch
 		return this->graph.nodesData(node);
 	}
 
+	Fingerprint_t ImgLabeling::getFingerprint()
+	{
+		Fingerprint_t fingerprint = 0;
+		const int numNodes = getNumNodes();
+		for (int node = 0; node < numNodes; node++)
+		{
+			fingerprint ^= nodeFingerprint(node, this->graph.nodesData(node));
+		}
+		return fingerprint;
+	}
+
+	Fingerprint_t ImgLabeling::nodeFingerprint(int node, int label)
+	{
+		// splitmix64 finalizer over the packed (node, label) pair
+		Fingerprint_t key = (static_cast<Fingerprint_t>(static_cast<unsigned int>(node)) << 32) 
+			| static_cast<unsigned int>(label);
+		key += 0x9E3779B97F4A7C15ULL;
+		key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+		return key ^ (key >> 31);
+	}
+
 	set<int> ImgLabeling::getNeighborLabels(int node)
 	{
 		set<int> labels;
-		if (hasNeighbors(node))
+		const CompressedAdjacency& adjacency = *this->graph.adjacency;
+		for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node); 
+			it != adjacency.neighborsEnd(node); ++it)
 		{
-			for (set<int>::iterator it = this->graph.adjList[node].begin();
-				it != this->graph.adjList[node].end(); ++it)
-			{
-				labels.insert(getLabel(*it));
-			}
+			labels.insert(getLabel(*it));
 		}
 		return labels;
 	}
 
 	set<int> ImgLabeling::getNeighbors(int node)
 	{
-		if (hasNeighbors(node))
-			return this->graph.adjList[node];
-		else
-			return set<int>();
+		const CompressedAdjacency& adjacency = *this->graph.adjacency;
+		return set<int>(adjacency.neighborsBegin(node), adjacency.neighborsEnd(node));
 	}
 
 	bool ImgLabeling::hasNeighbors(int node)
 	{
-		return this->graph.adjList.count(node) != 0;
+		return this->graph.adjacency->getNumNeighbors(node) != 0;
 	}
 
 	set<int> ImgLabeling::getTopConfidentLabels(int node, int K)
@@ -161,10 +405,11 @@ namespace HCSearch
 		}
 
 		// bad cases
-		const int numLabels = this->confidences.cols();
+		const int numLabels = this->confidences->cols();
 		if (K > numLabels)
 		{
-			return HCSearch::Global::settings->CLASSES.getLabels();
+			const vector<int>& classIndices = HCSearch::Global::settings->CLASSES.getClassIndices();
+			return set<int>(classIndices.begin(), classIndices.end());
 		}
 		else if (K == 0)
 		{
@@ -182,8 +427,8 @@ namespace HCSearch
 		LabelConfidencePQ sortedByConfidence;
 		for (int i = 0; i < numLabels; i++)
 		{
-			int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-			double confidence = this->confidences(node, i);
+			int label = i;
+			double confidence = this->confidences->coeff(node, i);
 			sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
 		}
 		for (int i = 0; i < K; i++)
@@ -205,15 +450,15 @@ namespace HCSearch
 			abort();
 		}
 
-		const int numLabels = this->confidences.cols();
+		const int numLabels = this->confidences->cols();
 		vector<int> labels;
 
 		// get top K confident labels
 		LabelConfidencePQ sortedByConfidence;
 		for (int i = 0; i < numLabels; i++)
 		{
-			int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-			double confidence = this->confidences(node, i);
+			int label = i;
+			double confidence = this->confidences->coeff(node, i);
 			sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
 		}
 		for (int i = 0; i < numLabels; i++)
@@ -235,15 +480,15 @@ namespace HCSearch
 			abort();
 		}
 
-		const int numLabels = this->confidences.cols();
+		const int numLabels = this->confidences->cols();
 		vector<int> labels;
 
 		// get top K confident labels
 		LabelConfidencePQ sortedByConfidence;
 		for (int i = 0; i < numLabels; i++)
 		{
-			int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-			double confidence = this->confidences(node, i);
+			int label = i;
+			double confidence = this->confidences->coeff(node, i);
 			sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
 		}
 		for (int i = 0; i < numLabels; i++)
@@ -265,178 +510,637 @@ namespace HCSearch
 			abort();
 		}
 
-		int classIndex = Global::settings->CLASSES.getClassIndex(label);
-		return confidences(node, classIndex);
+		return this->confidences->coeff(node, label);
 	}
 
-	/**************** Classify/Rank Features ****************/
-
-	GenericFeatures::GenericFeatures()
+	void ImgCandidateDelta::apply(ImgLabeling& Y) const
 	{
+		vector<int>::const_iterator labelIt = this->labels.begin();
+		for (set<int>::const_iterator it = this->action.begin(); it != this->action.end(); ++it, ++labelIt)
+			Y.graph.nodesData(*it) = *labelIt;
 	}
 
-	GenericFeatures::GenericFeatures(VectorXd features)
+	void ImgCandidateDelta::revert(ImgLabeling& Y, const ImgLabeling& YTemplate) const
 	{
-		this->data = features;
+		for (set<int>::const_iterator it = this->action.begin(); it != this->action.end(); ++it)
+			Y.graph.nodesData(*it) = YTemplate.graph.nodesData(*it);
 	}
 
-	GenericFeatures::~GenericFeatures()
+	ImgCandidate ImgCandidateDelta::materialize(const ImgLabeling& YTemplate) const
 	{
+		ImgCandidate YCandidate;
+		YCandidate.labeling = YTemplate;
+		apply(YCandidate.labeling);
+		YCandidate.action = this->action;
+		return YCandidate;
 	}
 
-	/**************** SVM-Rank Model ****************/
+	/**************** Mutex Constraints ****************/
 
-	SVMRankModel::SVMRankModel()
+	MutexTable::MutexTable()
 	{
-		this->initialized = false;
-		this->learningMode = false;
+		this->numClasses = 0;
 	}
 
-	SVMRankModel::SVMRankModel(string fileName)
+	MutexTable::MutexTable(map<string, int>& pairwiseConstraints)
 	{
-		load(fileName);
+		this->numClasses = Global::settings->CLASSES.numClasses();
+		this->counts = VectorXi::Zero(this->numClasses*this->numClasses*4);
+
+		set<int> labels = Global::settings->CLASSES.getLabels();
+		for (map<string, int>::iterator it = pairwiseConstraints.begin(); it != pairwiseConstraints.end(); ++it)
+		{
+			// parse "class1 class2 config"
+			stringstream ss(it->first);
+			int label1, label2;
+			string configString;
+			ss >> label1 >> label2 >> configString;
+
+			if (labels.count(label1) == 0 || labels.count(label2) == 0)
+				continue;
+
+			MutexConfiguration config;
+			if (configString.compare("L") == 0)
+				config = MUTEX_LEFT;
+			else if (configString.compare("R") == 0)
+				config = MUTEX_RIGHT;
+			else if (configString.compare("U") == 0)
+				config = MUTEX_UP;
+			else if (configString.compare("D") == 0)
+				config = MUTEX_DOWN;
+			else
+				continue;
+
+			int classIndex1 = Global::settings->CLASSES.getClassIndex(label1);
+			int classIndex2 = Global::settings->CLASSES.getClassIndex(label2);
+			this->counts((classIndex1*this->numClasses + classIndex2)*4 + config) = it->second;
+		}
 	}
 
-	double SVMRankModel::rank(RankFeatures features)
+	MutexTable::~MutexTable()
 	{
-		if (!this->initialized)
-		{
-			LOG(WARNING) << "svm ranker not initialized for ranking but returning 0 anyway";
-			//LOG(ERROR) << "svm ranker not initialized for ranking";
-			//abort();
-		}
+	}
 
-		if (!this->initialized)
+	int MutexTable::getCount(int classIndex1, int classIndex2, MutexConfiguration config)
+	{
+		if (this->numClasses == 0)
 			return 0;
-		else
-			return vectorDot(getWeights(), features.data);
+
+		return this->counts((classIndex1*this->numClasses + classIndex2)*4 + config);
 	}
 
-	vector<double> SVMRankModel::rank(vector<RankFeatures> featuresList)
+	ClassLocationExtents::ClassLocationExtents(ImgFeatures& X, ImgLabeling& Y)
 	{
-		if (!this->initialized)
+		const int numNodes = X.getNumNodes();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+
+		this->xCoords.resize(numClasses);
+		this->yCoords.resize(numClasses);
+		for (int node = 0; node < numNodes; node++)
 		{
-			LOG(WARNING) << "svm ranker not initialized for ranking but returning 0 anyway";
-			//LOG(ERROR) << "svm ranker not initialized for ranking";
-			//abort();
+			int classIndex = Y.getLabel(node);
+			this->xCoords[classIndex].insert(X.getNodeLocationX(node));
+			this->yCoords[classIndex].insert(X.getNodeLocationY(node));
 		}
+	}
 
-		int numExamples = featuresList.size();
-		vector<double> ranks;
-		for (int i = 0; i < numExamples; i++)
-		{
-			if (!this->initialized)
-				ranks.push_back(0);
-			else
-				ranks.push_back(vectorDot(getWeights(), featuresList[i].data));
+	ClassLocationExtents::~ClassLocationExtents()
+	{
+	}
+
+	bool ClassLocationExtents::hasNodes(int classIndex)
+	{
+		return !this->xCoords[classIndex].empty();
+	}
+
+	bool ClassLocationExtents::hasNodeInConfiguration(int classIndex, MutexConfiguration config, double x, double y)
+	{
+		if (!hasNodes(classIndex))
+			return false;
+
+		switch (config)
+		{
+		case MUTEX_LEFT:
+			return x < *this->xCoords[classIndex].rbegin();
+		case MUTEX_RIGHT:
+			return x > *this->xCoords[classIndex].begin();
+		case MUTEX_UP:
+			return y < *this->yCoords[classIndex].rbegin();
+		case MUTEX_DOWN:
+			return y > *this->yCoords[classIndex].begin();
+		default:
+			return false;
 		}
-		return ranks;
 	}
 
-	RankerType SVMRankModel::rankerType()
+	void ClassLocationExtents::moveNode(double x, double y, int fromClassIndex, int toClassIndex)
 	{
-		return SVM_RANK;
+		this->xCoords[fromClassIndex].erase(this->xCoords[fromClassIndex].find(x));
+		this->yCoords[fromClassIndex].erase(this->yCoords[fromClassIndex].find(y));
+		this->xCoords[toClassIndex].insert(x);
+		this->yCoords[toClassIndex].insert(y);
 	}
 
-	void SVMRankModel::load(string fileName)
+	ClassLocationBounds::ClassLocationBounds(ImgFeatures& X, ImgLabeling& Y)
 	{
-		if (!MyFileSystem::FileSystem::checkFileExists(fileName))
-		{
-			LOG(WARNING) << "SVM model file does not exist for loading! Ignoring load function...";
-			return;
+		const int numNodes = X.getNumNodes();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+
+		this->minX = VectorXd::Constant(numClasses, numeric_limits<double>::infinity());
+		this->maxX = VectorXd::Constant(numClasses, -numeric_limits<double>::infinity());
+		this->minY = VectorXd::Constant(numClasses, numeric_limits<double>::infinity());
+		this->maxY = VectorXd::Constant(numClasses, -numeric_limits<double>::infinity());
+		this->numNodes = VectorXi::Zero(numClasses);
+		for (int node = 0; node < numNodes; node++)
+		{
+			int classIndex = Y.getLabel(node);
+			double x = X.getNodeLocationX(node);
+			double y = X.getNodeLocationY(node);
+			this->minX(classIndex) = min(this->minX(classIndex), x);
+			this->maxX(classIndex) = max(this->maxX(classIndex), x);
+			this->minY(classIndex) = min(this->minY(classIndex), y);
+			this->maxY(classIndex) = max(this->maxY(classIndex), y);
+			this->numNodes(classIndex)++;
 		}
+	}
 
-		this->modelFileName = fileName;
-		this->weights = parseModelFile(fileName);
-		this->initialized = true;
+	ClassLocationBounds::~ClassLocationBounds()
+	{
 	}
 
-	void SVMRankModel::save(string fileName)
+	bool ClassLocationBounds::hasNodes(int classIndex)
 	{
-		MyFileSystem::FileSystem::copyFile(this->modelFileName, fileName);
+		return this->numNodes(classIndex) > 0;
 	}
 
-	VectorXd SVMRankModel::getWeights()
+	bool ClassLocationBounds::hasNodeInConfiguration(int classIndex, MutexConfiguration config, double x, double y)
 	{
-		if (!this->initialized)
-		{
-			LOG(ERROR) << "svm ranker not initialized for getting weights";
-			abort();
+		if (!hasNodes(classIndex))
+			return false;
+
+		switch (config)
+		{
+		case MUTEX_LEFT:
+			return x < this->maxX(classIndex);
+		case MUTEX_RIGHT:
+			return x > this->minX(classIndex);
+		case MUTEX_UP:
+			return y < this->maxY(classIndex);
+		case MUTEX_DOWN:
+			return y > this->minY(classIndex);
+		default:
+			return false;
 		}
-
-		return this->weights;
 	}
 
-	void SVMRankModel::startTraining(string featuresFileName)
+	/**************** Classify/Rank Features ****************/
+
+	GenericFeatures::GenericFeatures()
 	{
-		if (this->learningMode == true)
-			cancelTraining();
+	}
 
-		this->learningMode = true;
-		this->qid = 1;
-		this->rankingFile = new ofstream(featuresFileName.c_str());
-		this->rankingFileName = featuresFileName;
+	GenericFeatures::GenericFeatures(VectorXd features)
+	{
+		this->data = features;
 	}
 
-	void SVMRankModel::addTrainingExample(RankFeatures betterFeature, RankFeatures worseFeature)
+	GenericFeatures::~GenericFeatures()
 	{
-		(*this->rankingFile) << vector2svmrank(betterFeature, 1, this->qid) << endl;
-		(*this->rankingFile) << vector2svmrank(worseFeature, 2, this->qid) << endl;
-		this->qid++;
 	}
 
-	void SVMRankModel::addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet)
+	/**************** Rank Model ****************/
+
+	MatrixXd IRankModel::stackFeatures(const vector<RankFeatures>& featuresList)
 	{
-		int betterSetSize = betterSet.size();
-		int worseSetSize = worseSet.size();
+		int numExamples = featuresList.size();
+		int featureDim = 0;
+		for (int i = 0; i < numExamples; i++)
+			featureDim = max(featureDim, static_cast<int>(featuresList[i].data.size()));
 
-		if (betterSetSize == 0 || worseSetSize == 0)
+		MatrixXd featuresMatrix = MatrixXd::Zero(numExamples, featureDim);
+		for (int i = 0; i < numExamples; i++)
 		{
-			LOG() << "Got " << betterSetSize << " best examples and " << worseSetSize << " worst examples for training. Skipping training..." << endl;
-			return;
+			const VectorXd& features = featuresList[i].data;
+			featuresMatrix.row(i).head(features.size()) = features.transpose();
 		}
+		return featuresMatrix;
+	}
 
-		LOG() << "Training with " << betterSetSize << " best examples and " << worseSetSize << " worst examples..." << endl;
+	vector< vector<int> > IRankModel::sampleRankingPairs(const vector<double>& betterLosses, const vector<double>& worseLosses)
+	{
+		const int numBetter = betterLosses.size();
+		const int numWorse = worseLosses.size();
+		const int k = Global::settings->RANK_PAIRS_PER_POSITIVE;
 
-		// good examples
-		for (vector< RankFeatures >::iterator it = betterSet.begin(); it != betterSet.end(); ++it)
+		RankPairSampling sampling = Global::settings->RANK_PAIR_SAMPLING;
+		if (k <= 0 || k >= numWorse)
+			sampling = ALL_PAIRS;
+
+		vector<int> allWorse(numWorse);
+		for (int j = 0; j < numWorse; j++)
+			allWorse[j] = j;
+
+		vector< vector<int> > pairs(numBetter);
+		if (sampling == ALL_PAIRS)
+		{
+			for (int i = 0; i < numBetter; i++)
+				pairs[i] = allWorse;
+		}
+		else if (sampling == HARDEST_PAIRS)
 		{
-			RankFeatures better = *it;
-			(*this->rankingFile) << vector2svmrank(better, 1, this->qid) << endl;
+			// hardest worse examples have the lowest loss, i.e. are closest to the better ones
+			vector< pair<double, int> > byLoss(numWorse);
+			for (int j = 0; j < numWorse; j++)
+				byLoss[j] = make_pair(worseLosses[j], j);
+			partial_sort(byLoss.begin(), byLoss.begin() + k, byLoss.end());
 
-			// bad examples
-			for (vector< RankFeatures >::iterator it2 = worseSet.begin(); it2 != worseSet.end(); ++it2)
+			vector<int> hardest(k);
+			for (int j = 0; j < k; j++)
+				hardest[j] = byLoss[j].second;
+			sort(hardest.begin(), hardest.end());
+
+			for (int i = 0; i < numBetter; i++)
+				pairs[i] = hardest;
+		}
+		else if (sampling == RANDOM_PAIRS)
+		{
+			// partial shuffle to draw k distinct worse examples for each better example
+			vector<int> order = allWorse;
+			for (int i = 0; i < numBetter; i++)
 			{
-				RankFeatures worse = *it2;
-				(*this->rankingFile) << vector2svmrank(worse, 2, this->qid) << endl;
+				for (int j = 0; j < k; j++)
+				{
+					int r = min(numWorse-1, j + static_cast<int>(Rand::unifDist() * (numWorse-j)));
+					swap(order[j], order[r]);
+				}
+				pairs[i].assign(order.begin(), order.begin() + k);
+				sort(pairs[i].begin(), pairs[i].end());
 			}
-
-			// increment qid
-			this->qid++;
 		}
+
+		return pairs;
 	}
 
-	void SVMRankModel::finishTraining(string modelFileName, SearchType searchType)
+	/**************** Ranking Example Log ****************/
+
+	const string RankingExampleLog::FILE_EXTENSION = ".bin";
+	const int RankingExampleLog::BUFFER_SIZE = 1 << 20;
+
+	RankingExampleLog::RankingExampleLog(string fileName, bool append)
 	{
-		if (searchType != LEARN_H && searchType != LEARN_C && searchType != LEARN_C_ORACLE_H && searchType != LEARN_PRUNE)
+		ios_base::openmode mode = ios_base::out | ios_base::binary;
+		if (append)
+			mode |= ios_base::app;
+
+		this->fileName = fileName;
+		this->file = new ofstream(fileName.c_str(), mode);
+		if (!this->file->is_open())
 		{
-			LOG(ERROR) << "invalid search type for training.";
+			LOG(ERROR) << "cannot open ranking example log for writing: " << fileName;
 			abort();
 		}
+		this->buffer.reserve(BUFFER_SIZE);
+		this->numExamples = 0;
+	}
 
-		// close ranking file
-		this->rankingFile->close();
-		delete this->rankingFile;
+	RankingExampleLog::~RankingExampleLog()
+	{
+		close();
+	}
 
-#ifdef USE_MPI
-		string STARTMSG;
-		string ENDMSG;
-		string featuresFileBase;
-		if (searchType == LEARN_H)
+	void RankingExampleLog::addExample(const VectorXd& features, int target, int qid, double loss)
+	{
+		int numNonZero = 0;
+		for (int i = 0; i < features.size(); i++)
 		{
-			STARTMSG = "MERGEHSTART";
-			ENDMSG = "MERGEHEND";
-			featuresFileBase = Global::settings->paths->OUTPUT_HEURISTIC_FEATURES_FILE_BASE;
+			if (features(i) != 0)
+				numNonZero++;
+		}
+
+		write<int>(target);
+		write<int>(qid);
+		write<double>(loss);
+		write<int>(static_cast<int>(features.size()));
+		write<int>(numNonZero);
+		for (int i = 0; i < features.size(); i++)
+		{
+			if (features(i) != 0)
+				write<int>(i);
+		}
+		for (int i = 0; i < features.size(); i++)
+		{
+			if (features(i) != 0)
+				write<float>(static_cast<float>(features(i)));
+		}
+
+		this->numExamples++;
+		if (static_cast<int>(this->buffer.size()) >= BUFFER_SIZE)
+			flush();
+	}
+
+	void RankingExampleLog::addExample(const RankingExample& example)
+	{
+		int numNonZero = example.indices.size();
+
+		write<int>(example.target);
+		write<int>(example.qid);
+		write<double>(example.loss);
+		write<int>(example.featureDim);
+		write<int>(numNonZero);
+		for (int i = 0; i < numNonZero; i++)
+			write<int>(example.indices[i]);
+		for (int i = 0; i < numNonZero; i++)
+			write<float>(example.values[i]);
+
+		this->numExamples++;
+		if (static_cast<int>(this->buffer.size()) >= BUFFER_SIZE)
+			flush();
+	}
+
+	void RankingExampleLog::close()
+	{
+		if (this->file == NULL)
+			return;
+
+		flush();
+		this->file->close();
+		delete this->file;
+		this->file = NULL;
+	}
+
+	int RankingExampleLog::getNumExamples()
+	{
+		return this->numExamples;
+	}
+
+	string RankingExampleLog::getFileName()
+	{
+		return this->fileName;
+	}
+
+	void RankingExampleLog::flush()
+	{
+		if (this->buffer.empty())
+			return;
+
+		this->file->write(&this->buffer[0], this->buffer.size());
+		this->buffer.clear();
+	}
+
+	bool RankingExampleLog::readExample(ifstream& fh, RankingExample& example)
+	{
+		int numNonZero;
+		fh.read(reinterpret_cast<char*>(&example.target), sizeof(int));
+		fh.read(reinterpret_cast<char*>(&example.qid), sizeof(int));
+		fh.read(reinterpret_cast<char*>(&example.loss), sizeof(double));
+		fh.read(reinterpret_cast<char*>(&example.featureDim), sizeof(int));
+		fh.read(reinterpret_cast<char*>(&numNonZero), sizeof(int));
+		if (!fh.good())
+			return false;
+
+		// check counts before allocating
+		if (example.featureDim < 0 || numNonZero < 0 || numNonZero > example.featureDim)
+		{
+			LOG(ERROR) << "corrupt record in ranking example log: " << numNonZero 
+				<< " non-zero features of dimension " << example.featureDim;
+			return false;
+		}
+
+		example.indices.resize(numNonZero);
+		example.values.resize(numNonZero);
+		if (numNonZero > 0)
+		{
+			fh.read(reinterpret_cast<char*>(&example.indices[0]), numNonZero*sizeof(int));
+			fh.read(reinterpret_cast<char*>(&example.values[0]), numNonZero*sizeof(float));
+		}
+		if (!fh.good())
+		{
+			LOG(ERROR) << "truncated record in ranking example log!";
+			return false;
+		}
+
+		for (int i = 0; i < numNonZero; i++)
+		{
+			if (example.indices[i] < 0 || example.indices[i] >= example.featureDim)
+			{
+				LOG(ERROR) << "corrupt record in ranking example log: feature index " << example.indices[i] 
+					<< " out of dimension " << example.featureDim;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void RankingExampleLog::exportSVMRank(string logFileName, string textFileName)
+	{
+		ifstream fh(logFileName.c_str(), ios_base::in | ios_base::binary);
+		ofstream ofh(textFileName.c_str());
+		if (!fh.is_open() || !ofh.is_open())
+		{
+			LOG(ERROR) << "cannot export ranking example log '" << logFileName << "' to SVM-Rank format!";
+			abort();
+		}
+
+		RankingExample example;
+		while (readExample(fh, example))
+		{
+			ofh << example.target << " qid:" << example.qid << " ";
+			for (int i = 0; i < static_cast<int>(example.indices.size()); i++)
+				ofh << example.indices[i]+1 << ":" << example.values[i] << " ";
+			ofh << endl;
+		}
+
+		fh.close();
+		ofh.close();
+	}
+
+	void RankingExampleLog::exportVW(string logFileName, string textFileName)
+	{
+		ifstream fh(logFileName.c_str(), ios_base::in | ios_base::binary);
+		ofstream ofh(textFileName.c_str());
+		if (!fh.is_open() || !ofh.is_open())
+		{
+			LOG(ERROR) << "cannot export ranking example log '" << logFileName << "' to VW format!";
+			abort();
+		}
+
+		RankingExample example;
+		while (readExample(fh, example))
+		{
+			ofh << example.target << " " << example.loss << " | ";
+			for (int i = 0; i < static_cast<int>(example.indices.size()); i++)
+				ofh << example.indices[i]+1 << ":" << example.values[i] << " ";
+			ofh << endl;
+		}
+
+		fh.close();
+		ofh.close();
+	}
+
+	/**************** SVM-Rank Model ****************/
+
+	SVMRankModel::SVMRankModel()
+	{
+		this->initialized = false;
+		this->learningMode = false;
+	}
+
+	SVMRankModel::SVMRankModel(string fileName)
+	{
+		load(fileName);
+	}
+
+	double SVMRankModel::rank(RankFeatures features)
+	{
+		if (!this->initialized)
+		{
+			LOG(WARNING) << "svm ranker not initialized for ranking but returning 0 anyway";
+			//LOG(ERROR) << "svm ranker not initialized for ranking";
+			//abort();
+		}
+
+		if (!this->initialized)
+			return 0;
+		else
+			return vectorDot(this->weights, features.data);
+	}
+
+	vector<double> SVMRankModel::rank(const vector<RankFeatures>& featuresList)
+	{
+		VectorXd ranks = rankBatch(stackFeatures(featuresList));
+		return vector<double>(ranks.data(), ranks.data() + ranks.size());
+	}
+
+	VectorXd SVMRankModel::rankBatch(const MatrixXd& featuresMatrix)
+	{
+		if (!this->initialized)
+		{
+			LOG(WARNING) << "svm ranker not initialized for ranking but returning 0 anyway";
+			return VectorXd::Zero(featuresMatrix.rows());
+		}
+
+		return matrixVectorDot(featuresMatrix, this->weights);
+	}
+
+	RankerType SVMRankModel::rankerType()
+	{
+		return SVM_RANK;
+	}
+
+	void SVMRankModel::load(string fileName)
+	{
+		if (!MyFileSystem::FileSystem::checkFileExists(fileName))
+		{
+			LOG(WARNING) << "SVM model file does not exist for loading! Ignoring load function...";
+			return;
+		}
+
+		this->modelFileName = fileName;
+		this->weights = parseModelFile(fileName);
+		this->initialized = true;
+	}
+
+	void SVMRankModel::save(string fileName)
+	{
+		MyFileSystem::FileSystem::copyFile(this->modelFileName, fileName);
+	}
+
+	VectorXd SVMRankModel::getWeights()
+	{
+		if (!this->initialized)
+		{
+			LOG(ERROR) << "svm ranker not initialized for getting weights";
+			abort();
+		}
+
+		return this->weights;
+	}
+
+	void SVMRankModel::startTraining(string featuresFileName)
+	{
+		if (this->learningMode == true)
+			cancelTraining();
+
+		this->learningMode = true;
+		this->qid = 1;
+		this->exampleLog = new RankingExampleLog(featuresFileName + RankingExampleLog::FILE_EXTENSION, false);
+		this->rankingFileName = featuresFileName;
+	}
+
+	void SVMRankModel::addTrainingExample(RankFeatures betterFeature, RankFeatures worseFeature)
+	{
+		lock_guard<std::mutex> guard(this->trainingLock);
+		this->exampleLog->addExample(betterFeature.data, 1, this->qid, 0);
+		this->exampleLog->addExample(worseFeature.data, 2, this->qid, 0);
+		this->qid++;
+	}
+
+	void SVMRankModel::addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet, vector< double >& betterLosses, vector< double >& worstLosses)
+	{
+		int betterSetSize = betterSet.size();
+		int worseSetSize = worseSet.size();
+
+		if (betterSetSize == 0 || worseSetSize == 0)
+		{
+			LOG() << "Got " << betterSetSize << " best examples and " << worseSetSize << " worst examples for training. Skipping training..." << endl;
+			return;
+		}
+
+		LOG() << "Training with " << betterSetSize << " best examples and " << worseSetSize << " worst examples..." << endl;
+
+		vector< vector<int> > pairs = sampleRankingPairs(betterLosses, worstLosses);
+
+		lock_guard<std::mutex> guard(this->trainingLock);
+
+		// SVM-Rank pairs every target 1 with every target 2 example of a query, 
+		// so better examples with the same worse examples go into one query
+		vector<bool> written(betterSetSize, false);
+		for (int i = 0; i < betterSetSize; i++)
+		{
+			if (written[i])
+				continue;
+
+			// good examples
+			for (int i2 = i; i2 < betterSetSize; i2++)
+			{
+				if (!written[i2] && pairs[i2] == pairs[i])
+				{
+					this->exampleLog->addExample(betterSet[i2].data, 1, this->qid, 0);
+					written[i2] = true;
+				}
+			}
+
+			// bad examples
+			for (vector<int>::iterator it = pairs[i].begin(); it != pairs[i].end(); ++it)
+				this->exampleLog->addExample(worseSet[*it].data, 2, this->qid, 0);
+
+			// increment qid
+			this->qid++;
+		}
+	}
+
+	void SVMRankModel::finishTraining(string modelFileName, SearchType searchType)
+	{
+		if (searchType != LEARN_H && searchType != LEARN_C && searchType != LEARN_C_ORACLE_H && searchType != LEARN_PRUNE)
+		{
+			LOG(ERROR) << "invalid search type for training.";
+			abort();
+		}
+
+		// close example log
+		this->exampleLog->close();
+		delete this->exampleLog;
+
+#ifdef USE_MPI
+		string STARTMSG;
+		string ENDMSG;
+		string featuresFileBase;
+		if (searchType == LEARN_H)
+		{
+			STARTMSG = "MERGEHSTART";
+			ENDMSG = "MERGEHEND";
+			featuresFileBase = Global::settings->paths->OUTPUT_HEURISTIC_FEATURES_FILE_BASE;
 		}
 		else if (searchType == LEARN_C)
 		{
@@ -466,6 +1170,14 @@ namespace HCSearch
 		}
 #endif
 
+		// write SVM-Rank features file from example log
+		if (Global::settings->RANK == 0)
+		{
+			string logFileName = this->rankingFileName + RankingExampleLog::FILE_EXTENSION;
+			RankingExampleLog::exportSVMRank(logFileName, this->rankingFileName);
+			MyFileSystem::FileSystem::deleteFile(logFileName);
+		}
+
 		if (this->qid <= 1)
 		{
 			LOG(ERROR) << "no training data available for learning!";
@@ -510,9 +1222,9 @@ namespace HCSearch
 
 	void SVMRankModel::cancelTraining()
 	{
-		// close ranking file
-		this->rankingFile->close();
-		delete this->rankingFile;
+		// close example log
+		this->exampleLog->close();
+		delete this->exampleLog;
 
 		// no longer learning
 		this->learningMode = false;
@@ -585,27 +1297,6 @@ namespace HCSearch
 		return weights;
 	}
 
-	string SVMRankModel::vector2svmrank(RankFeatures features, int target, int qid)
-	{
-		stringstream ss("");
-		stringstream sparse("");
-
-		VectorXd vector = features.data;
-
-		int nonZeroCounts = 0;
-		for (int i = 0; i < vector.size(); i++)
-		{
-			if (vector(i) != 0)
-			{
-				ss << i+1 << ":" << vector(i) << " ";
-				nonZeroCounts++;
-			}
-		}
-		sparse << target << " qid:" << qid << " " << ss.str();
-
-		return sparse.str();
-	}
-
 	void SVMRankModel::writeModelFile(string fileName, const VectorXd& weights)
 	{
 		ofstream fh(fileName.c_str());
@@ -651,89 +1342,49 @@ namespace HCSearch
 
 		int currentQID = totalMasterQID-1;
 
-		ofstream ofh;
-		ofh.open(FEATURES_FILE.c_str(), std::ios_base::app);
-
-		if (ofh.is_open())
+		RankingExampleLog masterLog(FEATURES_FILE + RankingExampleLog::FILE_EXTENSION, true);
+		for (int i = 1; i < numProcesses; i++)
 		{
-			//ofh << endl; // add extra line
-			for (int i = 1; i < numProcesses; i++)
-			{
-				// open file from process i
-				FEATURES_FILE = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, fileNameBase, i);
-
-				if (!MyFileSystem::FileSystem::checkFileExists(FEATURES_FILE))
-				{
-					continue;
-				}
+			// open log from process i
+			string LOG_FILE = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, fileNameBase, i)
+				+ RankingExampleLog::FILE_EXTENSION;
 
-				ifstream fh;
-				fh.open(FEATURES_FILE.c_str());
+			if (!MyFileSystem::FileSystem::checkFileExists(LOG_FILE))
+			{
+				continue;
+			}
 
-				string line;
-				if (fh.is_open())
+			ifstream fh(LOG_FILE.c_str(), ios_base::in | ios_base::binary);
+			if (fh.is_open())
+			{
+				// loop over examples from process i
+				// and append to the master log
+				int prevSlaveQID = -1;
+				RankingExample example;
+				while (RankingExampleLog::readExample(fh, example))
 				{
-					// loop over lines in file from process i
-					// and append to the master file
-					int prevSlaveQID = -1;
-					while (fh.good())
+					// adjust qid accordingly
+					if (prevSlaveQID != example.qid)
 					{
-						// get line and split into parts
-						getline(fh, line);
-						if (line.empty())
-							continue;
-
-						stringstream ssLine(line);
-
-						string sRanking;
-						string sQID;
-						string sFeatures;
-
-						getline(ssLine, sRanking, ' ');
-						getline(ssLine, sQID, ' ');
-						getline(ssLine, sFeatures, ';'); // grab all the way to the end of the line
-
-						stringstream ssQID(sQID);
-
-						string sQIDToken;
-						string sQIDValue;
-
-						getline(ssQID, sQIDToken, ':');
-						getline(ssQID, sQIDValue, ' ');
-
-						int currentSlaveQID = atoi(sQIDValue.c_str());
-
-						// adjust qid accordingly
-						if (prevSlaveQID != currentSlaveQID)
-						{
-							currentQID++;
-							prevSlaveQID = currentSlaveQID;
-						}
-
-						// append to master file
-						ofh << sRanking << " " << "qid:" << currentQID << " " << sFeatures << endl;
+						currentQID++;
+						prevSlaveQID = example.qid;
 					}
 
-					fh.close();
-
-					// delete the slave feature file
-					ostringstream ossRemoveRankingFeatureCmd;
-					ossRemoveRankingFeatureCmd << Global::settings->cmds->SYSTEM_RM_CMD
-						<< " \"" << FEATURES_FILE << "\"";
-					MyFileSystem::Executable::execute(ossRemoveRankingFeatureCmd.str());
-				}
-				else
-				{
-					LOG(ERROR) << "master process could not open ranking file from a process: " << i;
+					example.qid = currentQID;
+					masterLog.addExample(example);
 				}
-			}
 
-			ofh.close();
-		}
-		else
-		{
-			LOG(ERROR) << "master process could not open ranking file!";
+				fh.close();
+
+				// delete the slave log
+				MyFileSystem::FileSystem::deleteFile(LOG_FILE);
+			}
+			else
+			{
+				LOG(ERROR) << "master process could not open ranking file from a process: " << i;
+			}
 		}
+		masterLog.close();
 
 		return currentQID;
 	}
@@ -765,28 +1416,24 @@ namespace HCSearch
 		if (!this->initialized)
 			return 0;
 		else
-			return vectorDot(getWeights(), features.data);
+			return vectorDot(this->weights, features.data);
+	}
+
+	vector<double> VWRankModel::rank(const vector<RankFeatures>& featuresList)
+	{
+		VectorXd ranks = rankBatch(stackFeatures(featuresList));
+		return vector<double>(ranks.data(), ranks.data() + ranks.size());
 	}
 
-	vector<double> VWRankModel::rank(vector<RankFeatures> featuresList)
+	VectorXd VWRankModel::rankBatch(const MatrixXd& featuresMatrix)
 	{
 		if (!this->initialized)
 		{
 			LOG(WARNING) << "VW ranker not initialized for ranking but returning 0 anyway";
-			//LOG(ERROR) << "VW ranker not initialized for ranking";
-			//abort();
+			return VectorXd::Zero(featuresMatrix.rows());
 		}
 
-		int numExamples = featuresList.size();
-		vector<double> ranks;
-		for (int i = 0; i < numExamples; i++)
-		{
-			if (!this->initialized)
-				ranks.push_back(0);
-			else
-				ranks.push_back(vectorDot(getWeights(), featuresList[i].data));
-		}
-		return ranks;
+		return matrixVectorDot(featuresMatrix, this->weights);
 	}
 
 	RankerType VWRankModel::rankerType()
@@ -829,14 +1476,15 @@ namespace HCSearch
 			cancelTraining();
 
 		this->learningMode = true;
-		this->rankingFile = new ofstream(featuresFileName.c_str());
+		this->exampleLog = new RankingExampleLog(featuresFileName + RankingExampleLog::FILE_EXTENSION, false);
 		this->rankingFileName = featuresFileName;
 	}
 
 	void VWRankModel::addTrainingExample(RankFeatures better, RankFeatures worse, double betterLoss, double worstLoss)
 	{
+		lock_guard<std::mutex> guard(this->trainingLock);
 		double loss = abs(betterLoss - worstLoss);
-		(*this->rankingFile) << vector2vwformat(better, worse, loss) << endl;
+		logVWExample(better, worse, loss);
 	}
 
 	void VWRankModel::addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet, vector< double >& betterLosses, vector< double >& worstLosses)
@@ -852,20 +1500,20 @@ namespace HCSearch
 
 		LOG() << "Training with " << betterSetSize << " best examples and " << worseSetSize << " worst examples..." << endl;
 
+		vector< vector<int> > pairs = sampleRankingPairs(betterLosses, worstLosses);
+
+		lock_guard<std::mutex> guard(this->trainingLock);
+
 		// good examples
 		for (int i = 0; i < betterSetSize; i++)
 		{
-			RankFeatures better = betterSet[i];
 			double betterLoss = betterLosses[i];
 
 			// bad examples
-			for (int j = 0; j < worseSetSize; j++)
+			for (vector<int>::iterator it = pairs[i].begin(); it != pairs[i].end(); ++it)
 			{
-				RankFeatures worse = worseSet[j];
-				double worseLoss = worstLosses[j];
-
-				double loss = abs(betterLoss - worseLoss);
-				(*this->rankingFile) << vector2vwformat(better, worse, loss) << endl;
+				double loss = abs(betterLoss - worstLosses[*it]);
+				logVWExample(betterSet[i], worseSet[*it], loss);
 			}
 		}
 	}
@@ -879,9 +1527,9 @@ namespace HCSearch
 			abort();
 		}
 
-		// close ranking file
-		this->rankingFile->close();
-		delete this->rankingFile;
+		// close example log
+		this->exampleLog->close();
+		delete this->exampleLog;
 
 		string featuresFileBase;
 		if (searchType == LEARN_H)
@@ -992,6 +1640,14 @@ namespace HCSearch
 
 				string FEATURES_FILE = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, featuresFileBase, processID);
 
+				// write VW features file from example log
+				string LOG_FILE = FEATURES_FILE + RankingExampleLog::FILE_EXTENSION;
+				if (MyFileSystem::FileSystem::checkFileExists(LOG_FILE))
+				{
+					RankingExampleLog::exportVW(LOG_FILE, FEATURES_FILE);
+					MyFileSystem::FileSystem::deleteFile(LOG_FILE);
+				}
+
 				// just in case, delete cache file if present
 				if (MyFileSystem::FileSystem::checkFileExists(FEATURES_FILE + ".cache"))
 				{
@@ -1084,9 +1740,9 @@ namespace HCSearch
 
 	void VWRankModel::cancelTraining()
 	{
-		// close ranking file
-		this->rankingFile->close();
-		delete this->rankingFile;
+		// close example log
+		this->exampleLog->close();
+		delete this->exampleLog;
 
 		// no longer learning
 		this->learningMode = false;
@@ -1156,36 +1812,16 @@ namespace HCSearch
 		return weights;
 	}
 
-	string VWRankModel::vector2vwformat(RankFeatures bestfeature, RankFeatures worstfeature, double loss)
+	void VWRankModel::logVWExample(RankFeatures& bestfeature, RankFeatures& worstfeature, double loss)
 	{
-		stringstream ss("");
-		stringstream sparse("");
-
-		int label;
-		VectorXd vector;
 		if (Rand::unifDist() < 0.5)
 		{
-			label = -1;
-			vector = bestfeature.data - worstfeature.data;
+			this->exampleLog->addExample(bestfeature.data - worstfeature.data, -1, 0, loss);
 		}
 		else
 		{
-			label = 1;
-			vector = worstfeature.data - bestfeature.data;
+			this->exampleLog->addExample(worstfeature.data - bestfeature.data, 1, 0, loss);
 		}
-
-		int nonZeroCounts = 0;
-		for (int i = 0; i < vector.size(); i++)
-		{
-			if (vector(i) != 0)
-			{
-				ss << i+1 << ":" << vector(i) << " ";
-				nonZeroCounts++;
-			}
-		}
-		sparse << label << " " << loss << " | " << ss.str();
-
-		return sparse.str();
 	}
 
 	void VWRankModel::writeModelFile(string fileName, const VectorXd& weights)
@@ -1228,59 +1864,479 @@ namespace HCSearch
 		string FEATURES_FILE = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, fileNameBase, 0);
 		LOG() << "Merging to main feature file: " << FEATURES_FILE << endl;
 
-		ofstream ofh;
-		ofh.open(FEATURES_FILE.c_str(), std::ios_base::app);
-
-		if (ofh.is_open())
+		RankingExampleLog masterLog(FEATURES_FILE + RankingExampleLog::FILE_EXTENSION, true);
+		for (int i = 1; i < numProcesses; i++)
 		{
-			//ofh << endl; // add extra line
-			for (int i = 1; i < numProcesses; i++)
+			// open log from process i
+			string LOG_FILE = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, fileNameBase, i)
+				+ RankingExampleLog::FILE_EXTENSION;
+
+			if (!MyFileSystem::FileSystem::checkFileExists(LOG_FILE))
 			{
-				// open file from process i
-				FEATURES_FILE = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, fileNameBase, i);
+				continue;
+			}
 
-				if (!MyFileSystem::FileSystem::checkFileExists(FEATURES_FILE))
+			ifstream fh(LOG_FILE.c_str(), ios_base::in | ios_base::binary);
+			if (fh.is_open())
+			{
+				// append examples from process i to the master log
+				RankingExample example;
+				while (RankingExampleLog::readExample(fh, example))
 				{
-					continue;
+					masterLog.addExample(example);
 				}
 
-				ifstream fh;
-				fh.open(FEATURES_FILE.c_str());
+				fh.close();
 
-				string line;
-				if (fh.is_open())
-				{
-					// loop over lines in file from process i
-					// and append to the master file
-					while (fh.good())
-					{
-						// get line and split into parts
-						getline(fh, line);
-						if (line.empty())
-							continue;
+				// delete the slave log
+				MyFileSystem::FileSystem::deleteFile(LOG_FILE);
+			}
+			else
+			{
+				LOG(ERROR) << "master process could not open ranking file from a process: " << i;
+			}
+		}
+		masterLog.close();
+	}
 
-						ofh << line << endl;
-					}
+	/**************** Online Rank Model ****************/
 
-					fh.close();
+	const int OnlineRankModel::DEFAULT_NUM_PASSES = 10;
+	const double OnlineRankModel::DEFAULT_LEARNING_RATE = 0.1;
+	const double OnlineRankModel::DEFAULT_REGULARIZATION = 0.0001;
 
-					// delete the slave feature file
-					ostringstream ossRemoveRankingFeatureCmd;
-					ossRemoveRankingFeatureCmd << Global::settings->cmds->SYSTEM_RM_CMD
-						<< " \"" << FEATURES_FILE << "\"";
-					MyFileSystem::Executable::execute(ossRemoveRankingFeatureCmd.str());
+	OnlineRankModel::OnlineRankModel()
+	{
+		this->initialized = false;
+		this->learningMode = false;
+		this->numUpdates = 0;
+		this->numPasses = DEFAULT_NUM_PASSES;
+		this->learningRate = DEFAULT_LEARNING_RATE;
+		this->regularization = DEFAULT_REGULARIZATION;
+	}
+
+	OnlineRankModel::OnlineRankModel(int numPasses, double learningRate, double regularization)
+	{
+		this->initialized = false;
+		this->learningMode = false;
+		this->numUpdates = 0;
+		this->numPasses = numPasses;
+		this->learningRate = learningRate;
+		this->regularization = regularization;
+	}
+
+	OnlineRankModel::OnlineRankModel(string fileName)
+	{
+		this->initialized = false;
+		this->learningMode = false;
+		this->numUpdates = 0;
+		this->numPasses = DEFAULT_NUM_PASSES;
+		this->learningRate = DEFAULT_LEARNING_RATE;
+		this->regularization = DEFAULT_REGULARIZATION;
+		load(fileName);
+	}
+
+	double OnlineRankModel::rank(RankFeatures features)
+	{
+		if (!this->initialized)
+		{
+			LOG(WARNING) << "online ranker not initialized for ranking but returning 0 anyway";
+		}
+
+		if (!this->initialized)
+			return 0;
+		else
+			return vectorDot(this->averagedWeights, features.data);
+	}
+
+	vector<double> OnlineRankModel::rank(const vector<RankFeatures>& featuresList)
+	{
+		VectorXd ranks = rankBatch(stackFeatures(featuresList));
+		return vector<double>(ranks.data(), ranks.data() + ranks.size());
+	}
+
+	VectorXd OnlineRankModel::rankBatch(const MatrixXd& featuresMatrix)
+	{
+		if (!this->initialized)
+		{
+			LOG(WARNING) << "online ranker not initialized for ranking but returning 0 anyway";
+			return VectorXd::Zero(featuresMatrix.rows());
+		}
+
+		return matrixVectorDot(featuresMatrix, this->averagedWeights);
+	}
+
+	RankerType OnlineRankModel::rankerType()
+	{
+		return ONLINE_RANK;
+	}
+
+	void OnlineRankModel::load(string fileName)
+	{
+		if (!MyFileSystem::FileSystem::checkFileExists(fileName))
+		{
+			LOG(WARNING) << "online model file does not exist for loading! Ignoring load function...";
+			return;
+		}
+
+		VectorXd weights = parseModelFile(fileName);
+		if (weights.size() == 0)
+		{
+			LOG(ERROR) << "online model file has no weights (no training data?): " << fileName;
+			return;
+		}
+
+		this->averagedWeights = weights;
+		this->weights = this->averagedWeights;
+		this->initialized = true;
+	}
+
+	void OnlineRankModel::save(string fileName)
+	{
+		if (!this->initialized)
+		{
+			LOG(ERROR) << "online ranker not initialized for saving";
+			return;
+		}
+
+		writeModelFile(fileName, this->averagedWeights);
+	}
+
+	VectorXd OnlineRankModel::getWeights()
+	{
+		if (!this->initialized)
+		{
+			LOG(ERROR) << "online ranker not initialized for getting weights";
+			abort();
+		}
+
+		return this->averagedWeights;
+	}
+
+	void OnlineRankModel::startTraining()
+	{
+		if (this->learningMode == true)
+			cancelTraining();
+
+		this->learningMode = true;
+	}
+
+	void OnlineRankModel::addTrainingExample(RankFeatures betterFeature, RankFeatures worseFeature)
+	{
+		lock_guard<std::mutex> guard(this->trainingLock);
+		int betterIndex = this->exampleFeatures.size();
+		this->exampleFeatures.push_back(betterFeature.data);
+		this->exampleFeatures.push_back(worseFeature.data);
+		this->examplePairs.push_back(MyPrimitives::Pair<int, int>(betterIndex, betterIndex+1));
+	}
+
+	void OnlineRankModel::addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet, vector< double >& betterLosses, vector< double >& worstLosses)
+	{
+		int betterSetSize = betterSet.size();
+		int worseSetSize = worseSet.size();
+
+		if (betterSetSize == 0 || worseSetSize == 0)
+		{
+			LOG() << "Got " << betterSetSize << " best examples and " << worseSetSize << " worst examples for training. Skipping training..." << endl;
+			return;
+		}
+
+		LOG() << "Training with " << betterSetSize << " best examples and " << worseSetSize << " worst examples..." << endl;
+
+		vector< vector<int> > pairs = sampleRankingPairs(betterLosses, worstLosses);
+
+		lock_guard<std::mutex> guard(this->trainingLock);
+
+		// store each paired feature vector once and pair by index
+		int betterStart = this->exampleFeatures.size();
+		for (int i = 0; i < betterSetSize; i++)
+			this->exampleFeatures.push_back(betterSet[i].data);
+
+		vector<int> worseIndices(worseSetSize, -1);
+		for (int i = 0; i < betterSetSize; i++)
+		{
+			for (vector<int>::iterator it = pairs[i].begin(); it != pairs[i].end(); ++it)
+			{
+				if (worseIndices[*it] < 0)
+				{
+					worseIndices[*it] = this->exampleFeatures.size();
+					this->exampleFeatures.push_back(worseSet[*it].data);
 				}
-				else
+				this->examplePairs.push_back(MyPrimitives::Pair<int, int>(betterStart+i, worseIndices[*it]));
+			}
+		}
+	}
+
+	void OnlineRankModel::finishTraining(string modelFileName, SearchType searchType)
+	{
+		if (searchType != LEARN_H && searchType != LEARN_C && searchType != LEARN_C_ORACLE_H && searchType != LEARN_PRUNE)
+		{
+			LOG(ERROR) << "invalid search type for training.";
+			abort();
+		}
+
+		clock_t tic = clock();
+
+		if (this->examplePairs.empty())
+		{
+			LOG(WARNING) << "no training data available for learning on this process!";
+		}
+		else
+		{
+			learnPairs();
+			this->initialized = true;
+		}
+
+#ifdef USE_MPI
+		string STARTMSG;
+		string ENDMSG;
+		string featuresFileBase;
+		if (searchType == LEARN_H)
+		{
+			STARTMSG = "MERGEHSTART";
+			ENDMSG = "MERGEHEND";
+			featuresFileBase = Global::settings->paths->OUTPUT_HEURISTIC_FEATURES_FILE_BASE;
+		}
+		else if (searchType == LEARN_C)
+		{
+			STARTMSG = "MERGECSTART";
+			ENDMSG = "MERGECEND";
+			featuresFileBase = Global::settings->paths->OUTPUT_COST_H_FEATURES_FILE_BASE;
+		}
+		else if (searchType == LEARN_C_ORACLE_H)
+		{
+			STARTMSG = "MERGECOHSTART";
+			ENDMSG = "MERGECOHEND";
+			featuresFileBase = Global::settings->paths->OUTPUT_COST_ORACLE_H_FEATURES_FILE_BASE;
+		}
+		else if (searchType == LEARN_PRUNE)
+		{
+			STARTMSG = "MERGEPSTART";
+			ENDMSG = "MERGEPEND";
+			featuresFileBase = Global::settings->paths->OUTPUT_PRUNE_FEATURES_FILE_BASE;
+		}
+
+		// each process writes its weights for averaging (parameter mixing)
+		string weightsFile = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, featuresFileBase, Global::settings->RANK);
+		writeModelFile(weightsFile, this->initialized ? this->averagedWeights : VectorXd());
+
+		MPI::Synchronize::masterWait(STARTMSG);
+
+		if (Global::settings->RANK == 0)
+		{
+			writeModelFile(modelFileName, mergeModelFiles(featuresFileBase, Global::settings->NUM_PROCESSES));
+		}
+
+		MPI::Synchronize::slavesWait(ENDMSG);
+
+		load(modelFileName);
+#else
+		if (this->initialized)
+			writeModelFile(modelFileName, this->averagedWeights);
+#endif
+
+		clock_t toc = clock();
+		LOG() << "total online ranker training time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
+
+		// no longer learning
+		cancelTraining();
+
+		LOG() << endl;
+	}
+
+	void OnlineRankModel::cancelTraining()
+	{
+		this->exampleFeatures.clear();
+		this->examplePairs.clear();
+
+		// no longer learning
+		this->learningMode = false;
+	}
+
+	void OnlineRankModel::learnPairs()
+	{
+		const int numPairs = this->examplePairs.size();
+		LOG() << "Learning online ranker on " << numPairs << " pairs for " << this->numPasses << " passes..." << endl;
+
+		int dim = max(this->weights.size(), this->averagedWeights.size());
+		for (vector< VectorXd >::iterator it = this->exampleFeatures.begin(); it != this->exampleFeatures.end(); ++it)
+			dim = max(dim, static_cast<int>(it->size()));
+		resizeWeights(dim);
+
+		vector<int> order(numPairs);
+		for (int i = 0; i < numPairs; i++)
+			order[i] = i;
+
+		VectorXd diff(dim);
+		for (int pass = 0; pass < this->numPasses; pass++)
+		{
+			// shuffle pairs for each pass
+			for (int i = numPairs-1; i > 0; i--)
+			{
+				int j = min(i, static_cast<int>(Rand::unifDist() * (i+1)));
+				swap(order[i], order[j]);
+			}
+
+			for (int k = 0; k < numPairs; k++)
+			{
+				const MyPrimitives::Pair<int, int>& pair = this->examplePairs[order[k]];
+				const VectorXd& better = this->exampleFeatures[pair.first];
+				const VectorXd& worse = this->exampleFeatures[pair.second];
+
+				// lower rank is better, so want weights.(worse - better) >= 1
+				diff.setZero();
+				diff.head(worse.size()) += worse;
+				diff.head(better.size()) -= better;
+
+				this->numUpdates++;
+				double eta = this->learningRate / (1 + this->learningRate * this->regularization * this->numUpdates);
+				double margin = this->weights.dot(diff);
+
+				this->weights *= 1 - eta * this->regularization;
+				if (margin < 1)
+					this->weights += eta * diff;
+
+				// running average of weights over all updates
+				this->averagedWeights += (this->weights - this->averagedWeights) / static_cast<double>(this->numUpdates);
+			}
+		}
+	}
+
+	void OnlineRankModel::resizeWeights(int dim)
+	{
+		int oldDim = this->weights.size();
+		if (oldDim < dim)
+		{
+			this->weights.conservativeResize(dim);
+			this->weights.tail(dim - oldDim).setZero();
+		}
+
+		oldDim = this->averagedWeights.size();
+		if (oldDim < dim)
+		{
+			this->averagedWeights.conservativeResize(dim);
+			this->averagedWeights.tail(dim - oldDim).setZero();
+		}
+	}
+
+	VectorXd OnlineRankModel::parseModelFile(string fileName)
+	{
+		string line;
+		vector<int> indices;
+		vector<double> values;
+
+		ifstream fh(fileName.c_str());
+		if (fh.is_open())
+		{
+			// skip header
+			getline(fh, line);
+
+			// weights line
+			getline(fh, line);
+			istringstream iss(line);
+
+			string token;
+			while (getline(iss, token, ' '))
+			{
+				if (token.find(':') == std::string::npos)
+					continue;
+
+				istringstream isstoken(token);
+				string sIndex;
+				string sValue;
+				getline(isstoken, sIndex, ':');
+				getline(isstoken, sValue, ':');
+
+				indices.push_back(atoi(sIndex.c_str()));
+				values.push_back(atof(sValue.c_str()));
+			}
+			fh.close();
+		}
+		else
+		{
+			LOG(ERROR) << "cannot open model file for reading weights!!";
+			abort();
+		}
+
+		int valuesSize = values.size();
+		VectorXd weights = VectorXd::Zero(valuesSize == 0 ? 0 : indices.back());
+		for (int i = 0; i < valuesSize; i++)
+		{
+			weights(indices[i]-1) = values[i];
+		}
+
+		return weights;
+	}
+
+	void OnlineRankModel::writeModelFile(string fileName, const VectorXd& weights)
+	{
+		ofstream fh(fileName.c_str());
+		if (fh.is_open())
+		{
+			fh << "Online rank model - generated from HC-Search" << endl;
+
+			// write weights to file
+			fh.precision(17);
+			const int weightsLength = weights.size();
+			for (int i = 0; i < weightsLength; i++)
+			{
+				double val = weights(i);
+				if (val != 0)
 				{
-					LOG(ERROR) << "master process could not open ranking file from a process: " << i;
+					int ind = i+1;
+					fh << ind << ":" << val << " ";
 				}
 			}
+			fh << endl;
 
-			ofh.close();
+			fh.close();
 		}
 		else
 		{
-			LOG(ERROR) << "master process could not open ranking file!";
+			LOG(ERROR) << "cannot open online model file for writing weights!!";
+			abort();
+		}
+	}
+
+	VectorXd OnlineRankModel::averageWeights(const vector< VectorXd >& weightsList)
+	{
+		VectorXd sum;
+		int numModels = 0;
+		for (vector< VectorXd >::const_iterator it = weightsList.begin(); it != weightsList.end(); ++it)
+		{
+			const VectorXd& weights = *it;
+			if (weights.size() == 0)
+				continue;
+
+			if (sum.size() < weights.size())
+			{
+				int oldDim = sum.size();
+				sum.conservativeResize(weights.size());
+				sum.tail(weights.size() - oldDim).setZero();
+			}
+			sum.head(weights.size()) += weights;
+			numModels++;
+		}
+
+		if (numModels == 0)
+		{
+			LOG(ERROR) << "no model had weights to average for the online ranker!";
+			return VectorXd();
 		}
+
+		return sum / numModels;
+	}
+
+	VectorXd OnlineRankModel::mergeModelFiles(string fileNameBase, int numProcesses)
+	{
+		vector< VectorXd > weightsList;
+		for (int processID = 0; processID < numProcesses; processID++)
+		{
+			string WEIGHTS_FILE = Global::settings->updateRankIDHelper(Global::settings->paths->OUTPUT_TEMP_DIR, fileNameBase, processID);
+			weightsList.push_back(parseModelFile(WEIGHTS_FILE));
+			MyFileSystem::FileSystem::deleteFile(WEIGHTS_FILE);
+		}
+
+		return averageWeights(weightsList);
 	}
 }
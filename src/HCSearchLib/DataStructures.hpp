@@ -12,6 +12,11 @@
 using namespace Eigen;
 using namespace std;
 
+namespace MyFileSystem
+{
+	class MappedFile;
+}
+
 namespace HCSearch
 {
 	/**************** Constants ****************/
@@ -22,6 +27,7 @@ namespace HCSearch
 		LEARN_PRUNE, DISCOVER_PAIRWISE };
 	enum DatasetType { TEST=0, TRAIN, VALIDATION };
 	enum StochasticCutMode { STATE, EDGES };
+	enum MutexConfiguration { MUTEX_LEFT=0, MUTEX_RIGHT, MUTEX_UP, MUTEX_DOWN };
 
 	const extern string SearchTypeStrings[];
 	const extern string DatasetTypeStrings[];
@@ -49,16 +55,165 @@ namespace HCSearch
 	 */
 	typedef map< int, NeighborSet_t > AdjList_t;
 
+	/*!
+	 * Flag per edge of a CompressedAdjacency. 
+	 * Indexed by edge index.
+	 */
+	typedef vector< bool > EdgeMask_t;
+
+	/*!
+	 * 64-bit fingerprint of a labeling.
+	 */
+	typedef unsigned long long Fingerprint_t;
+
+	/*!
+	 * @brief Compressed sparse row adjacency with per-edge data.
+	 * 
+	 * The neighbors of a node are stored contiguously in increasing order. 
+	 * Each stored (node, neighbor) pair has an edge index, and the edge weights 
+	 * and edge features are arrays indexed by it. Built once when an image is 
+	 * loaded; read-only afterwards. Check ImgFeatures::edgeWeightsAvailable and 
+	 * ImgFeatures::edgeFeaturesAvailable before using the edge data of an image.
+	 */
+	class CompressedAdjacency
+	{
+		/*!
+		 * Neighbors of node i are neighbors[offsets[i]] ... neighbors[offsets[i+1]-1].
+		 */
+		vector<int> offsets;
+		vector<int> neighbors;
+
+		/*!
+		 * Edge weights, parallel to neighbors.
+		 */
+		vector<double> weights;
+
+		/*!
+		 * Edge features, rows parallel to neighbors. Empty if not available.
+		 */
+		MatrixXd features;
+
+	public:
+		typedef const int* NeighborIterator;
+
+		CompressedAdjacency();
+
+		/*!
+		 * @brief Construct from an adjacency list. All edge weights are 1.
+		 */
+		CompressedAdjacency(const AdjList_t& adjList, int numNodes);
+
+		/*!
+		 * @brief Construct from CSR arrays (numNodes+1 offsets) with edge weights.
+		 */
+		CompressedAdjacency(int numNodes, const int* offsets, const int* neighbors, const double* weights);
+
+		~CompressedAdjacency();
+
+		/*!
+		 * @brief Get the number of nodes with rows (possibly empty).
+		 */
+		int getNumNodes() const;
+
+		/*!
+		 * @brief Get the number of stored (node, neighbor) pairs.
+		 */
+		int getNumEdges() const;
+
+		/*!
+		 * @brief Get the number of neighbors of a node.
+		 */
+		int getNumNeighbors(int node) const;
+
+		/*!
+		 * @brief Iterators over the neighbors of a node.
+		 */
+		NeighborIterator neighborsBegin(int node) const;
+		NeighborIterator neighborsEnd(int node) const;
+
+		/*!
+		 * @brief Get the edge index of the neighbor an iterator points to.
+		 */
+		int getEdgeIndex(NeighborIterator it) const;
+
+		/*!
+		 * @brief Get the edge index of (node1, node2), or -1 if there is no such edge.
+		 */
+		int getEdgeIndex(int node1, int node2) const;
+
+		/*!
+		 * @brief Returns true if (node1, node2) is an edge.
+		 */
+		bool hasEdge(int node1, int node2) const;
+
+		double getEdgeWeight(int edgeIndex) const;
+		void setEdgeWeight(int edgeIndex, double weight);
+
+		/*!
+		 * @brief Get the features of an edge. Edge features must be available.
+		 */
+		VectorXd getEdgeFeatures(int edgeIndex) const;
+
+		/*!
+		 * @brief Set the edge features, one row per edge index.
+		 */
+		void setEdgeFeatures(const MatrixXd& features);
+
+		/*!
+		 * @brief Approximate memory footprint in bytes.
+		 */
+		size_t getMemoryBytes() const;
+	};
+
+	/*!
+	 * @brief Matrix of node features that either owns its data or views a mapped file.
+	 * 
+	 * Reads like a MatrixXd. Assigning a matrix copies it into owned storage. 
+	 * A view points into the features section of a mapped binary image file, 
+	 * which stays mapped while any copy of the view exists. Views are read-only.
+	 */
+	class NodeFeatureMatrix : public Map<MatrixXd>
+	{
+		MatrixXd storage; //!< Owned features; empty for views
+		shared_ptr<MyFileSystem::MappedFile> mapping; //!< Mapped file viewed; null if owned
+
+	public:
+		NodeFeatureMatrix();
+		NodeFeatureMatrix(const NodeFeatureMatrix& other);
+		~NodeFeatureMatrix();
+
+		NodeFeatureMatrix& operator=(const NodeFeatureMatrix& other);
+
+		/*!
+		 * @brief Copy features into owned storage.
+		 */
+		NodeFeatureMatrix& operator=(const MatrixXd& features);
+
+		/*!
+		 * @brief View column-major rows x cols features inside a mapped file.
+		 */
+		void view(shared_ptr<MyFileSystem::MappedFile> mapping, const double* features, int rows, int cols);
+
+		/*!
+		 * @brief Returns true if the features are a view of a mapped file.
+		 */
+		bool isView() const;
+
+	private:
+		void reseat(const double* features, int rows, int cols);
+	};
+
 	/*!
 	 * @brief Anstract graph implementation to avoid redundancy.
 	 */
 	struct IGraph
 	{
 		/*!
-		 * Adjacency list of the graph.
-		 * Node -> set of neighbor nodes
+		 * Adjacency of the graph in CSR form.
+		 * Shared between copies of the graph (and between an image and its labelings); 
+		 * use adjacency.edit() to modify.
 		 */
-		AdjList_t adjList;
+		MyPrimitives::CopyOnWrite< CompressedAdjacency > adjacency;
 
 		/*!
 		 * Get the number of edges in the graph.
@@ -78,7 +233,7 @@ namespace HCSearch
 		 * Node data stores features at nodes.
 		 * Rows = nodes, cols = feature data
 		 */
-		MatrixXd nodesData;
+		NodeFeatureMatrix nodesData;
 	};
 
 	/*!
@@ -133,21 +288,18 @@ namespace HCSearch
 		MatrixXd nodeLocations;
 
 		/*!
-		 * Edge weights.
-		 * Indexed by (node 1, node 2)
+		 * Symmetric KL divergence KL(p,q)+KL(q,p) between the node features of each edge, 
+		 * indexed by graph.adjacency edge index. Computed when the image is loaded (or read from 
+		 * the binary dataset) and not modified during search.
+		 * Make sure to check if they are available using ImgFeatures::edgeDivergencesAvailable.
 		 */
-		map< MyPrimitives::Pair<int, int>, double > edgeWeights;
-
-		/*!
-		 * Edge features.
-		 * Indexed by (node 1, node 2)
-		 */
-		map< MyPrimitives::Pair<int, int>, VectorXd > edgeFeatures;
+		VectorXd edgeDivergences;
 
 		bool segmentsAvailable;
 		bool nodeLocationsAvailable;
 		bool edgeWeightsAvailable;
 		bool edgeFeaturesAvailable;
+		bool edgeDivergencesAvailable;
 
 	public:
 		ImgFeatures();
@@ -171,6 +323,20 @@ namespace HCSearch
 		 */
 		int getNumEdges();
 
+		/*!
+		 * Compute ImgFeatures::edgeDivergences from the node features.
+		 * Called by the dataset loaders; call it after building graph.adjacency by hand.
+		 */
+		void computeEdgeDivergences();
+
+		/*!
+		 * Get the KL-based stochastic cut weights exp(-divergence*T/2) of all edges.
+		 * Only reads the edge divergences, so threads may call it on a shared image.
+		 * @param[in] T Temperature
+		 * @return Returns the cut weights indexed by graph.adjacency edge index
+		 */
+		VectorXd getCutWeights(double T) const;
+
 		/*!
 		 * Convenience function to get a feature component at a node.
 		 * @param[in] node Node index
@@ -205,8 +371,8 @@ namespace HCSearch
 	 * 
 	 * This stores a graph where nodes hold label data. 
 	 * Usually the nodes correspond to pixels, superpixels or patches. 
-	 * Each pixel, superpixel or patch has an integer label usually corresponding 
-	 * to a class.
+	 * Each pixel, superpixel or patch has an integer label holding the 
+	 * class index (see ClassMap), not the class label of the dataset.
 	 */
 	class ImgLabeling
 	{
@@ -220,15 +386,17 @@ namespace HCSearch
 		 * Class confidences of nodes from initial prediction. 
 		 * rows = nodes, cols = label probabilities (sorted by class index)
 		 * Make sure to check if they are available using ImgLabeling::confidencesAvailable.
+		 * Shared between successors of the same labeling; use confidences.edit() to modify.
 		 */
-		MatrixXd confidences;
+		MyPrimitives::CopyOnWrite< MatrixXd > confidences;
 
 		/*!
-		 * Adjacency list of edges that survived stochastic cuts.  
-		 * node -> set of neighbor nodes
+		 * Edges that survived stochastic cuts.  
+		 * True for each kept edge, indexed by graph.adjacency edge index
 		 * Make sure to check if they are available using ImgLabeling::stochasticCutsAvailable.
+		 * Shared between successors of the same labeling; use stochasticCuts.edit() to modify.
 		 */
-		map< int, set<int> > stochasticCuts;
+		MyPrimitives::CopyOnWrite< EdgeMask_t > stochasticCuts;
 
 		/*!
 		 * Node weights.
@@ -258,10 +426,27 @@ namespace HCSearch
 		/*!
 		 * Convenience function to get a node's label.
 		 * @param[in] node Node index
-		 * @return Returns the label of the node
+		 * @return Returns the label (class index) of the node
 		 */
 		int getLabel(int node);
 
+		/*!
+		 * @brief Compute the fingerprint of the labels.
+		 * 
+		 * The fingerprint is the XOR of the keys of all (node, label) pairs, 
+		 * so relabeling a node only requires XOR-ing out its old key and in its new key.
+		 * @return Returns the 64-bit fingerprint of the labeling
+		 */
+		Fingerprint_t getFingerprint();
+
+		/*!
+		 * @brief Get the fingerprint key of a node with a label.
+		 * @param[in] node Node index
+		 * @param[in] label Label of node
+		 * @return Returns the 64-bit key of the (node, label) pair
+		 */
+		static Fingerprint_t nodeFingerprint(int node, int label);
+
 		/*!
 		 * Convenience function to get labels of the node's neighbors.
 		 * @param[in] node Node index
@@ -317,6 +502,136 @@ namespace HCSearch
 		set<int> action;
 	};
 
+	/*!
+	 * @brief Successor candidate stored as its label changes to a template labeling.
+	 * 
+	 * Lets candidates be scored without copying a full labeling for each one; 
+	 * only candidates that are kept need to be materialized.
+	 */
+	class ImgCandidateDelta
+	{
+	public:
+		/*!
+		 * Set of nodes that changed.
+		 */
+		set<int> action;
+
+		/*!
+		 * New labels of the action nodes (in the order of the action set).
+		 */
+		vector<int> labels;
+
+		/*!
+		 * Write the new labels of the action nodes into a labeling.
+		 * @param[in,out] Y Labeling to change
+		 */
+		void apply(ImgLabeling& Y) const;
+
+		/*!
+		 * Restore the labels of the action nodes from the template labeling.
+		 * @param[in,out] Y Labeling to restore
+		 * @param[in] YTemplate Template labeling the delta was generated against
+		 */
+		void revert(ImgLabeling& Y, const ImgLabeling& YTemplate) const;
+
+		/*!
+		 * Build the full candidate.
+		 * @param[in] YTemplate Template labeling the delta was generated against
+		 * @return Returns the candidate with its own labeling
+		 */
+		ImgCandidate materialize(const ImgLabeling& YTemplate) const;
+	};
+
+	/**************** Mutex Constraints ****************/
+
+	/*!
+	 * @brief Dense table of pairwise class constraint counts.
+	 * 
+	 * Indexed by (class index 1, class index 2, configuration), where the configuration 
+	 * says where a node of class 1 is relative to a node of class 2. Built from the 
+	 * "class1 class2 config" map of Learning::discoverPairwiseClassConstraints.
+	 */
+	class MutexTable
+	{
+		int numClasses;
+		VectorXi counts;
+
+	public:
+		MutexTable();
+		MutexTable(map<string, int>& pairwiseConstraints);
+		~MutexTable();
+
+		/*!
+		 * @brief Get the number of times the configuration was observed in training.
+		 * 
+		 * An empty table has a count of 0 for everything.
+		 */
+		int getCount(int classIndex1, int classIndex2, MutexConfiguration config);
+	};
+
+	/*!
+	 * @brief Per-class sorted node coordinates of a labeling.
+	 * 
+	 * Answers whether any node of a class lies in a given direction 
+	 * from a location in O(1) and supports relabeling nodes in O(log N).
+	 */
+	class ClassLocationExtents
+	{
+		vector< multiset<double> > xCoords;
+		vector< multiset<double> > yCoords;
+
+	public:
+		ClassLocationExtents(ImgFeatures& X, ImgLabeling& Y);
+		~ClassLocationExtents();
+
+		/*!
+		 * @brief Returns true if the class has any nodes.
+		 */
+		bool hasNodes(int classIndex);
+
+		/*!
+		 * @brief Returns true if some node of the class is such that 
+		 * a node at (x, y) would be in the configuration relative to it.
+		 */
+		bool hasNodeInConfiguration(int classIndex, MutexConfiguration config, double x, double y);
+
+		/*!
+		 * @brief Move a node at (x, y) from one class to another.
+		 */
+		void moveNode(double x, double y, int fromClassIndex, int toClassIndex);
+	};
+
+	/*!
+	 * @brief Per-class bounding box of node coordinates of a labeling.
+	 * 
+	 * Computed in one pass over the nodes without allocating per node. 
+	 * Answers the same configuration queries as ClassLocationExtents 
+	 * for labelings that are not relabeled afterwards.
+	 */
+	class ClassLocationBounds
+	{
+		VectorXd minX;
+		VectorXd maxX;
+		VectorXd minY;
+		VectorXd maxY;
+		VectorXi numNodes;
+
+	public:
+		ClassLocationBounds(ImgFeatures& X, ImgLabeling& Y);
+		~ClassLocationBounds();
+
+		/*!
+		 * @brief Returns true if the class has any nodes.
+		 */
+		bool hasNodes(int classIndex);
+
+		/*!
+		 * @brief Returns true if some node of the class is such that 
+		 * a node at (x, y) would be in the configuration relative to it.
+		 */
+		bool hasNodeInConfiguration(int classIndex, MutexConfiguration config, double x, double y);
+	};
+
 	/**************** Classify/Rank Features ****************/
 
 	/*!
@@ -359,6 +674,7 @@ namespace HCSearch
 	{
 	protected:
 		bool initialized;
+		std::mutex trainingLock; //!< Guards training examples added from parallel searches
 
 	public:
 		virtual ~IRankModel() {}
@@ -375,7 +691,29 @@ namespace HCSearch
 		 * @param[in] featuresList List of features for ranking
 		 * @return Returns the list of ranking values of the features
 		 */
-		virtual vector<double> rank(vector<RankFeatures> featuresList)=0;
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList)=0;
+
+		/*!
+		 * Use the model to rank a batch of features with one matrix-vector product.
+		 * @param[in] featuresMatrix Features for ranking (rows = examples, cols = feature dims)
+		 * @return Returns the ranking values of the rows
+		 */
+		virtual VectorXd rankBatch(const MatrixXd& featuresMatrix)=0;
+
+		/*!
+		 * Stack a list of features into the rows of a matrix for batch ranking. 
+		 * Shorter feature vectors are zero-padded to the longest one.
+		 */
+		static MatrixXd stackFeatures(const vector<RankFeatures>& featuresList);
+
+		/*!
+		 * Choose the worse examples to pair with each better example 
+		 * according to Settings::RANK_PAIR_SAMPLING.
+		 * @param[in] betterLosses Losses of the better examples
+		 * @param[in] worseLosses Losses of the worse examples
+		 * @return Returns the sorted indices of the paired worse examples for each better example
+		 */
+		static vector< vector<int> > sampleRankingPairs(const vector<double>& betterLosses, const vector<double>& worseLosses);
 
 		/*!
 		 * Get the ranker type.
@@ -398,7 +736,7 @@ namespace HCSearch
 		 * Used to correct a mysterious problem with Eigen's implementation.
 		 */
 		template <class TVector>
-		static double vectorDot(TVector v1, TVector v2)
+		static double vectorDot(const TVector& v1, const TVector& v2)
 		{
 			double result = 0;
 			for (int i = 0; i < v1.size(); i++)
@@ -410,6 +748,137 @@ namespace HCSearch
 			}
 			return result;
 		}
+
+		/*!
+		 * Batched version of vectorDot: product of the matrix rows 
+		 * with the weights over the dimensions both have.
+		 */
+		static VectorXd matrixVectorDot(const MatrixXd& featuresMatrix, const VectorXd& weights)
+		{
+			int dim = min(static_cast<int>(featuresMatrix.cols()), static_cast<int>(weights.size()));
+			return featuresMatrix.leftCols(dim) * weights.head(dim);
+		}
+	};
+
+	/**************** Ranking Example Log ****************/
+
+	/*!
+	 * @brief Single ranking training example read back from a RankingExampleLog.
+	 */
+	struct RankingExample
+	{
+		int target; //!< SVM-Rank target or VW label
+		int qid; //!< SVM-Rank query id (unused by VW)
+		double loss; //!< VW importance weight (unused by SVM-Rank)
+		int featureDim; //!< Dimension of the dense feature vector
+		vector<int> indices; //!< 0-based indices of non-zero features
+		vector<float> values; //!< Values of non-zero features
+	};
+
+	/*!
+	 * @brief Buffered binary log of ranking training examples.
+	 * 
+	 * Each example is a sparse float record with its target/qid/loss metadata 
+	 * and feature dimension. 
+	 * Records are buffered in memory and written in chunks; the text formats 
+	 * of SVM-Rank and Vowpal Wabbit are only produced by the exporters 
+	 * right before those programs are called.
+	 */
+	class RankingExampleLog
+	{
+	public:
+		/*!
+		 * Extension appended to the text features file name for the binary log.
+		 */
+		static const string FILE_EXTENSION;
+
+	private:
+		/*!
+		 * Number of buffered bytes before writing to disk
+		 */
+		static const int BUFFER_SIZE;
+
+		/*!
+		 * Output stream to binary log
+		 */
+		ofstream* file;
+
+		/*!
+		 * Binary log file name
+		 */
+		string fileName;
+
+		/*!
+		 * Records not yet written to disk
+		 */
+		vector<char> buffer;
+
+		/*!
+		 * Number of examples added
+		 */
+		int numExamples;
+
+	public:
+		/*!
+		 * Open a log for writing. 
+		 * @param[in] fileName Binary log file name
+		 * @param[in] append Append to an existing log instead of truncating
+		 */
+		RankingExampleLog(string fileName, bool append);
+		~RankingExampleLog();
+
+		/*!
+		 * Add an example. Only non-zero features are stored.
+		 */
+		void addExample(const VectorXd& features, int target, int qid, double loss);
+
+		/*!
+		 * Add an example read from another log.
+		 */
+		void addExample(const RankingExample& example);
+
+		/*!
+		 * Write buffered records and close the log.
+		 */
+		void close();
+
+		/*!
+		 * Get number of examples added.
+		 */
+		int getNumExamples();
+
+		/*!
+		 * Get binary log file name.
+		 */
+		string getFileName();
+
+		/*!
+		 * Read the next example from an open binary log.
+		 * @return Returns false at end of file or on a corrupt record
+		 */
+		static bool readExample(ifstream& fh, RankingExample& example);
+
+		/*!
+		 * Convert a binary log to an SVM-Rank features file.
+		 * Lines are "target qid:N index:value ...".
+		 */
+		static void exportSVMRank(string logFileName, string textFileName);
+
+		/*!
+		 * Convert a binary log to a Vowpal Wabbit features file.
+		 * Lines are "label loss | index:value ...".
+		 */
+		static void exportVW(string logFileName, string textFileName);
+
+	private:
+		void flush();
+
+		template <class T>
+		void write(const T& value)
+		{
+			const char* bytes = reinterpret_cast<const char*>(&value);
+			this->buffer.insert(this->buffer.end(), bytes, bytes + sizeof(T));
+		}
 	};
 
 	/**************** SVM-Rank Model ****************/
@@ -428,9 +897,9 @@ namespace HCSearch
 		VectorXd weights;
 
 		/*!
-		 * Output stream to training file for learning
+		 * Binary log of training examples for learning
 		 */
-		ofstream* rankingFile;
+		RankingExampleLog* exampleLog;
 
 		/*!
 		 * Training file name
@@ -462,7 +931,8 @@ namespace HCSearch
 		
 		virtual double rank(RankFeatures features);
 		virtual RankerType rankerType();
-		virtual vector<double> rank(vector<RankFeatures> featuresList);
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList);
+		virtual VectorXd rankBatch(const MatrixXd& featuresMatrix);
 		virtual void load(string fileName);
 		virtual void save(string fileName);
 
@@ -482,9 +952,11 @@ namespace HCSearch
 		void addTrainingExample(RankFeatures betterFeature, RankFeatures worseFeature);
 
 		/*!
-		 * Add training examples.
+		 * Add training examples for the sampled (better, worse) pairs. 
+		 * Better examples paired with the same worse examples share one query, 
+		 * so each feature vector is written once per query.
 		 */
-		void addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet);
+		void addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet, vector< double >& betterLosses, vector< double >& worstLosses);
 
 		/*!
 		 * End learning.
@@ -506,11 +978,6 @@ namespace HCSearch
 		 */
 		static VectorXd parseModelFile(string fileName);
 
-		/*!
-		 * Convert vector into SVM-Rank line.
-		 */
-		static string vector2svmrank(RankFeatures features, int target, int qid);
-
 		/*!
 		 * Write weights to file.
 		 * 
@@ -521,7 +988,8 @@ namespace HCSearch
 		static void writeModelFile(string fileName, const VectorXd& weights);
 
 		/*!
-		 * Merge SVM-Rank feature files when using MPI.
+		 * Merge SVM-Rank example logs when using MPI. 
+		 * Slave logs are appended to the master log with their qids renumbered.
 		 */
 		static int mergeRankingFiles(string fileNameBase, int numProcesses, int totalMasterQID);
 	};
@@ -542,9 +1010,9 @@ namespace HCSearch
 		VectorXd weights;
 
 		/*!
-		 * Output stream to training file for learning
+		 * Binary log of training examples for learning
 		 */
-		ofstream* rankingFile;
+		RankingExampleLog* exampleLog;
 
 		/*!
 		 * Training file name
@@ -573,7 +1041,8 @@ namespace HCSearch
 		
 		virtual double rank(RankFeatures features);
 		virtual RankerType rankerType();
-		virtual vector<double> rank(vector<RankFeatures> featuresList);
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList);
+		virtual VectorXd rankBatch(const MatrixXd& featuresMatrix);
 		virtual void load(string fileName);
 		virtual void save(string fileName);
 
@@ -593,7 +1062,7 @@ namespace HCSearch
 		void addTrainingExample(RankFeatures better, RankFeatures worse, double betterLoss, double worstLoss);
 
 		/*!
-		 * Add training examples.
+		 * Add training examples for the sampled (better, worse) pairs.
 		 */
 		void addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet, vector< double >& betterLosses, vector< double >& worstLosses);
 
@@ -618,9 +1087,9 @@ namespace HCSearch
 		static VectorXd parseModelFile(string fileName);
 
 		/*!
-		 * Convert vector difference to VW format line.
+		 * Log vector difference as a VW example with a random label sign.
 		 */
-		static string vector2vwformat(RankFeatures bestfeature, RankFeatures worstfeature, double loss);
+		void logVWExample(RankFeatures& bestfeature, RankFeatures& worstfeature, double loss);
 
 		/*!
 		 * Write weights to file.
@@ -632,10 +1101,164 @@ namespace HCSearch
 		static void writeModelFile(string fileName, const VectorXd& weights);
 
 		/*!
-		 * Merge feature files when using MPI.
+		 * Merge example logs when using MPI.
 		 */
 		static void mergeRankingFiles(string fileNameBase, int numProcesses);
 	};
+
+	/**************** Online Rank Model ****************/
+
+	/*!
+	 * @brief Rank model learned in-process with online pairwise hinge loss.
+	 * 
+	 * Pairwise examples are buffered in memory and learned with averaged 
+	 * stochastic gradient descent when training finishes. 
+	 * Weights continue from the previous training round.
+	 */
+	class OnlineRankModel : public IRankModel
+	{
+	public:
+		static const int DEFAULT_NUM_PASSES;
+		static const double DEFAULT_LEARNING_RATE;
+		static const double DEFAULT_REGULARIZATION;
+
+	private:
+		/*!
+		 * Current SGD weights
+		 */
+		VectorXd weights;
+
+		/*!
+		 * Averaged weights used for ranking
+		 */
+		VectorXd averagedWeights;
+
+		/*!
+		 * Buffered feature vectors of training examples
+		 */
+		vector< VectorXd > exampleFeatures;
+
+		/*!
+		 * Buffered pairs of (better, worse) indices into exampleFeatures
+		 */
+		vector< MyPrimitives::Pair<int, int> > examplePairs;
+
+		/*!
+		 * Number of SGD updates so far
+		 */
+		long long numUpdates;
+
+		/*!
+		 * Number of passes over the buffer per training round
+		 */
+		int numPasses;
+
+		/*!
+		 * Learning rate
+		 */
+		double learningRate;
+
+		/*!
+		 * L2 regularization
+		 */
+		double regularization;
+
+		/*!
+		 * True if currently used for learning
+		 */
+		bool learningMode;
+
+	public:
+		OnlineRankModel();
+
+		/*!
+		 * Construct with number of passes, learning rate and regularization.
+		 */
+		OnlineRankModel(int numPasses, double learningRate, double regularization);
+
+		/*!
+		 * Construct with weights from model file.
+		 */
+		OnlineRankModel(string fileName);
+		
+		virtual double rank(RankFeatures features);
+		virtual RankerType rankerType();
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList);
+		virtual VectorXd rankBatch(const MatrixXd& featuresMatrix);
+		virtual void load(string fileName);
+		virtual void save(string fileName);
+
+		/*!
+		 * Get weights.
+		 */
+		VectorXd getWeights();
+
+		/*!
+		 * Initialize learning. Clears the example buffer.
+		 */
+		void startTraining();
+
+		/*!
+		 * Add training example.
+		 */
+		void addTrainingExample(RankFeatures betterFeature, RankFeatures worseFeature);
+
+		/*!
+		 * Add training examples for the sampled (better, worse) pairs. 
+		 * Each feature vector is stored once and pairs refer to it by index.
+		 */
+		void addTrainingExamples(vector< RankFeatures >& betterSet, vector< RankFeatures >& worseSet, vector< double >& betterLosses, vector< double >& worstLosses);
+
+		/*!
+		 * End learning.
+		 *
+		 * Runs SGD passes over the buffered examples and writes the model.
+		 */
+		void finishTraining(string modelFileName, SearchType searchType);
+
+		/*!
+		 * Cancel learning. Clears the example buffer.
+		 */
+		void cancelTraining();
+
+		/*!
+		 * Average weights of several models (parameter mixing). 
+		 * Shorter weights are padded with zeros and empty weights (no training data) are skipped.
+		 * @return Returns empty weights if no model has weights
+		 */
+		static VectorXd averageWeights(const vector< VectorXd >& weightsList);
+
+	private:
+		/*!
+		 * Run SGD passes over the buffered pairs.
+		 */
+		void learnPairs();
+
+		/*!
+		 * Grow weights with zeros to the dimension.
+		 */
+		void resizeWeights(int dim);
+
+		/*!
+		 * Load weights from file. 
+		 * File format is the same as writeModelFile.
+		 */
+		static VectorXd parseModelFile(string fileName);
+
+		/*!
+		 * Write weights to file.
+		 * 
+		 * File format:
+		 *     line 1: header
+		 *     line 2: 1:val 2:val ...
+		 */
+		static void writeModelFile(string fileName, const VectorXd& weights);
+
+		/*!
+		 * Average weights files of all processes when using MPI.
+		 */
+		static VectorXd mergeModelFiles(string fileNameBase, int numProcesses);
+	};
 }
 
 #endif
\ No newline at end of file
@@ -12,6 +12,149 @@ namespace HCSearch
 		return computeFeatures(X, Y, action).data.size();
 	}
 
+	void IFeatureFunction::computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+		RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features)
+	{
+		// Not all feature functions decompose over nodes and edges
+		// Override for feature functions that do
+		features = computeFeatures(X, Y, action);
+	}
+
+	bool IFeatureFunction::sameFeatures(IFeatureFunction& other)
+	{
+		return typeid(*this) == typeid(other);
+	}
+
+	/**************** Class Aggregation Kernel ****************/
+
+	const VectorXi& ClassAggregation::computeClassIndices(ImgLabeling& Y)
+	{
+		// labelings already hold class indices
+		return Y.graph.nodesData;
+	}
+
+	int ClassAggregation::computeClassPairIndex(int classIndex1, int classIndex2, int numClasses)
+	{
+		int i = min(classIndex1, classIndex2);
+		int j = max(classIndex1, classIndex2);
+
+		return (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+	}
+
+	MatrixXi ClassAggregation::computeClassPairSlots(int numClasses)
+	{
+		MatrixXi classPairSlots(numClasses, numClasses);
+		for (int i = 0; i < numClasses; i++)
+		{
+			for (int j = 0; j < numClasses; j++)
+			{
+				classPairSlots(i, j) = computeClassPairIndex(i, j, numClasses);
+			}
+		}
+
+		return classPairSlots;
+	}
+
+	VectorXd ClassAggregation::computeUnarySums(ImgFeatures& X, const VectorXi& classIndices, int numClasses)
+	{
+		const int numNodes = X.getNumNodes();
+		const int featureDim = X.getFeatureDim();
+		const int unaryFeatDim = 1+featureDim;
+		const NodeFeatureMatrix& nodeFeatures = X.graph.nodesData;
+
+		VectorXd phi = VectorXd::Zero(numClasses*unaryFeatDim);
+
+		// bias: class counts
+		for (int node = 0; node < numNodes; node++)
+		{
+			phi(classIndices(node)*unaryFeatDim) += 1;
+		}
+
+		// one-hot(classes)^T * features, one feature column at a time (node features are column-major)
+		for (int feature = 0; feature < featureDim; feature++)
+		{
+			const double* column = nodeFeatures.data() + feature*nodeFeatures.rows();
+			for (int node = 0; node < numNodes; node++)
+			{
+				phi(classIndices(node)*unaryFeatDim+1+feature) += column[node];
+			}
+		}
+
+		return phi;
+	}
+
+	VectorXd ClassAggregation::computeUnaryConfidenceSums(ImgLabeling& Y, const VectorXi& classIndices, int numClasses)
+	{
+		const int numNodes = Y.getNumNodes();
+		const MatrixXd& confidences = *Y.confidences;
+
+		VectorXd phi = VectorXd::Zero(numClasses);
+		for (int node = 0; node < numNodes; node++)
+		{
+			int classIndex = classIndices(node);
+			phi(classIndex) += 1-confidences(node, classIndex);
+		}
+
+		return phi;
+	}
+
+	VectorXd ClassAggregation::computePairwiseSums(ImgFeatures& X, const VectorXi& classIndices,
+		const MatrixXi& classPairSlots, int numSlots)
+	{
+		const int numNodes = X.getNumNodes();
+		const int featureDim = X.getFeatureDim();
+
+		VectorXd phi = VectorXd::Zero(numSlots*featureDim);
+
+		// one feature column at a time (node features are column-major), 
+		// so neither the features nor an edge buffer are copied
+		for (int feature = 0; feature < featureDim; feature++)
+		{
+			const double* column = X.graph.nodesData.data() + feature*X.graph.nodesData.rows();
+			for (int node1 = 0; node1 < numNodes; node1++)
+			{
+				const int classIndex1 = classIndices(node1);
+
+				CompressedAdjacency::NeighborIterator neighborsEnd = X.graph.adjacency->neighborsEnd(node1);
+				for (CompressedAdjacency::NeighborIterator it = X.graph.adjacency->neighborsBegin(node1); it != neighborsEnd; ++it)
+				{
+					int node2 = *it;
+					const int classIndex2 = classIndices(node2);
+
+					// contrast sensitive pairwise potential
+					double difference = column[node1] - column[node2];
+					double edgeFeature = exp(-difference*difference);
+					if (classIndex1 == classIndex2)
+						edgeFeature = 1 - edgeFeature;
+
+					phi(classPairSlots(classIndex1, classIndex2)*featureDim+feature) += edgeFeature;
+				}
+			}
+		}
+
+		return phi;
+	}
+
+	VectorXd ClassAggregation::computePairwiseCounts(ImgFeatures& X, const VectorXi& classIndices,
+		const MatrixXi& classPairSlots, int numSlots)
+	{
+		const int numNodes = X.getNumNodes();
+
+		VectorXd phi = VectorXd::Zero(numSlots);
+		for (int node1 = 0; node1 < numNodes; node1++)
+		{
+			const int classIndex1 = classIndices(node1);
+
+			CompressedAdjacency::NeighborIterator neighborsEnd = X.graph.adjacency->neighborsEnd(node1);
+			for (CompressedAdjacency::NeighborIterator it = X.graph.adjacency->neighborsBegin(node1); it != neighborsEnd; ++it)
+			{
+				phi(classPairSlots(classIndex1, classIndices(*it))) += 1;
+			}
+		}
+
+		return phi;
+	}
+
 	/**************** Feature Functions ****************/
 
 	/**************** Standard Features ****************/
@@ -34,9 +177,18 @@ namespace HCSearch
 	{
 	}
 
+	bool StandardFeatures::sameFeatures(IFeatureFunction& other)
+	{
+		if (!IFeatureFunction::sameFeatures(other))
+			return false;
+
+		StandardFeatures& otherStandard = dynamic_cast<StandardFeatures&>(other);
+		return this->lambda1 == otherStandard.lambda1 && this->lambda2 == otherStandard.lambda2 
+			&& this->lambda3 == otherStandard.lambda3;
+	}
+
 	RankFeatures StandardFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
@@ -55,9 +207,69 @@ namespace HCSearch
 		return RankFeatures(phi);
 	}
 
+	void StandardFeatures::computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+		RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features)
+	{
+		// no parent features or no action to apply: compute from scratch
+		if (action.empty() || parentFeatures.data.size() != featureSize(X, Y, action))
+		{
+			features = computeFeatures(X, Y, action);
+			return;
+		}
+
+		const int numNodes = X.getNumNodes();
+		const int featureDim = X.getFeatureDim();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int unaryFeatDim = 1+featureDim;
+		const int pairwiseOffset = numClasses*unaryFeatDim;
+
+		// same normalization constants as computeUnaryTerm and computePairwiseTerm
+		const int numEdges = X.graph.adjacency->getNumEdges();
+		const double unaryScale = lambda1/numNodes;
+		const double pairwiseScale = lambda2/numEdges;
+
+		// start from the parent features in the storage of the result
+		features.data = parentFeatures.data;
+		VectorXd& phi = features.data;
+
+		for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
+		{
+			int node = *it;
+			int oldClassIndex = YParent.getLabel(node);
+			int newClassIndex = Y.getLabel(node);
+			if (oldClassIndex == newClassIndex)
+				continue;
+
+			// unary: move node from old class to new class
+			phi(oldClassIndex*unaryFeatDim) -= unaryScale;
+			phi.segment(oldClassIndex*unaryFeatDim+1, featureDim) -= unaryScale*X.graph.nodesData.row(node).transpose();
+			phi(newClassIndex*unaryFeatDim) += unaryScale;
+			phi.segment(newClassIndex*unaryFeatDim+1, featureDim) += unaryScale*X.graph.nodesData.row(node).transpose();
+
+			// pairwise: replace the contribution of every edge incident to node
+			CompressedAdjacency::NeighborIterator neighborsEnd = X.graph.adjacency->neighborsEnd(node);
+			for (CompressedAdjacency::NeighborIterator it2 = X.graph.adjacency->neighborsBegin(node); it2 != neighborsEnd; ++it2)
+			{
+				int neighbor = *it2;
+
+				// outgoing edge node -> neighbor
+				addPairwiseEdgeTerm(X, YParent, node, neighbor, -pairwiseScale, phi, pairwiseOffset);
+				addPairwiseEdgeTerm(X, Y, node, neighbor, pairwiseScale, phi, pairwiseOffset);
+
+				// incoming edge neighbor -> node (adjacency lists are symmetric); 
+				// if neighbor also changed, this edge is handled as its outgoing edge instead
+				bool neighborChanged = action.count(neighbor) != 0 && YParent.getLabel(neighbor) != Y.getLabel(neighbor);
+				if (!neighborChanged && neighbor < numNodes && X.graph.adjacency->hasEdge(neighbor, node))
+				{
+					addPairwiseEdgeTerm(X, YParent, neighbor, node, -pairwiseScale, phi, pairwiseOffset);
+					addPairwiseEdgeTerm(X, Y, neighbor, node, pairwiseScale, phi, pairwiseOffset);
+				}
+			}
+		}
+	}
+
 	int StandardFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1+featureDim;
 		int pairwiseFeatDim = featureDim;
@@ -71,104 +283,48 @@ namespace HCSearch
 	{
 		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int unaryFeatDim = 1+featureDim;
-		
-		VectorXd phi = VectorXd::Zero(numClasses*unaryFeatDim);
 
-		// unary potential
-		for (int node = 0; node < numNodes; node++)
-		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
-			int nodeLabel = Y.getLabel(node);
-
-			// map node label to indexing value in phi vector
-			int classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel);
-
-			// assignment: bias and unary feature
-			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
-		}
+		// unary potential: bias and unary feature per class
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		VectorXd phi = ClassAggregation::computeUnarySums(X, classIndices, numClasses);
 
-		phi = 1.0/X.getNumNodes() * phi;
+		phi = 1.0/numNodes * phi;
 
 		return phi;
 	}
 	
 	VectorXd StandardFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int pairwiseFeatDim = featureDim;
-		int numPairs = (numClasses*(numClasses+1))/2;
-		
-		VectorXd phi = VectorXd::Zero(numPairs*pairwiseFeatDim);
-
-		int numEdges = 0;
-		for (int node1 = 0; node1 < numNodes; node1++)
-		{
-			if (X.graph.adjList.count(node1) == 0)
-				continue;
-
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
-			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
-			{
-				int node2 = *it;
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				int nodeLabel1 = Y.getLabel(node1);
+		const int numPairs = (numClasses*(numClasses+1))/2;
 
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				int nodeLabel2 = Y.getLabel(node2);
+		// contrast sensitive pairwise potential per class pair
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		MatrixXi classPairSlots = ClassAggregation::computeClassPairSlots(numClasses);
+		VectorXd phi = ClassAggregation::computePairwiseSums(X, classIndices, classPairSlots, numPairs);
 
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
-				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
-			}
-		}
-
-		phi = 1.0/numEdges * phi;
+		phi = 1.0/X.graph.adjacency->getNumEdges() * phi;
 
 		return phi;
 	}
 
-	VectorXd StandardFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
+	void StandardFeatures::addPairwiseEdgeTerm(ImgFeatures& X, ImgLabeling& Y, int node1, int node2, 
+		double scale, VectorXd& phi, int offset)
 	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int pairwiseFeatDim = X.getFeatureDim();
 
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+		int classIndex1 = Y.getLabel(node1);
+		int classIndex2 = Y.getLabel(node2);
+		int classIndex = ClassAggregation::computeClassPairIndex(classIndex1, classIndex2, numClasses);
 
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
-
-			// assignment
-			return expnegdiffabs2;
-		}
+		// same contrast sensitive potential as ClassAggregation::computePairwiseSums, 
+		// accumulated without temporaries since this runs for every edge of every action node
+		Eigen::VectorBlock<VectorXd> segment = phi.segment(offset+classIndex*pairwiseFeatDim, pairwiseFeatDim);
+		if (classIndex1 == classIndex2)
+			segment.array() += scale*(1 - (-(X.graph.nodesData.row(node1) - X.graph.nodesData.row(node2)).array().square()).exp()).transpose();
 		else
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
-
-			// assignment
-			return expnegdiffabs2;
-		}
+			segment.array() += scale*(-(X.graph.nodesData.row(node1) - X.graph.nodesData.row(node2)).array().square()).exp().transpose();
 	}
 
 	/**************** Standard Context Features ****************/
@@ -183,7 +339,6 @@ namespace HCSearch
 
 	RankFeatures StandardContextFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
@@ -208,7 +363,6 @@ namespace HCSearch
 
 	int StandardContextFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1+featureDim;
 		int pairwiseFeatDim = featureDim;
@@ -223,106 +377,31 @@ namespace HCSearch
 	{
 		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int unaryFeatDim = 1+featureDim;
-		
-		VectorXd phi = VectorXd::Zero(numClasses*unaryFeatDim);
 
-		// unary potential
-		for (int node = 0; node < numNodes; node++)
-		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
-			int nodeLabel = Y.getLabel(node);
-
-			// map node label to indexing value in phi vector
-			int classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel);
-
-			// assignment: bias and unary feature
-			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
-		}
+		// unary potential: bias and unary feature per class
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		VectorXd phi = ClassAggregation::computeUnarySums(X, classIndices, numClasses);
 
-		phi = 1.0/X.getNumNodes() * phi;
+		phi = 1.0/numNodes * phi;
 
 		return phi;
 	}
 	
 	VectorXd StandardContextFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int pairwiseFeatDim = featureDim;
-		int numPairs = (numClasses*(numClasses+1))/2;
-		
-		VectorXd phi = VectorXd::Zero(numPairs*pairwiseFeatDim);
+		const int numPairs = (numClasses*(numClasses+1))/2;
 
-		int numEdges = 0;
-		for (int node1 = 0; node1 < numNodes; node1++)
-		{
-			if (X.graph.adjList.count(node1) == 0)
-				continue;
+		// contrast sensitive pairwise potential per class pair
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		MatrixXi classPairSlots = ClassAggregation::computeClassPairSlots(numClasses);
+		VectorXd phi = ClassAggregation::computePairwiseSums(X, classIndices, classPairSlots, numPairs);
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
-			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
-			{
-				int node2 = *it;
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
-				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
-			}
-		}
-
-		phi = 1.0/numEdges * phi;
+		phi = 1.0/X.graph.adjacency->getNumEdges() * phi;
 
 		return phi;
 	}
 
-	VectorXd StandardContextFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
-
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
-
-			// assignment
-			return expnegdiffabs2;
-		}
-		else
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
-
-			// assignment
-			return expnegdiffabs2;
-		}
-	}
-
 	VectorXd StandardContextFeatures::computeContextTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
 		const int numNodes = X.getNumNodes();
@@ -371,10 +450,8 @@ namespace HCSearch
 
 	VectorXd StandardContextFeatures::computeContextFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
 		double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
+		int node1ClassIndex, int node2ClassIndex, int& classIndex)
 	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
 		int numClasses = Global::settings->CLASSES.numClasses();
 
 		int i = min(node1ClassIndex, node2ClassIndex);
@@ -383,7 +460,7 @@ namespace HCSearch
 		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
 
 		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
+		if (node1ClassIndex != node2ClassIndex)
 		{
 			VectorXd potential = VectorXd::Zero(4);
 
@@ -426,7 +503,6 @@ namespace HCSearch
 
 	RankFeatures StandardAltFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
@@ -446,7 +522,6 @@ namespace HCSearch
 
 	int StandardAltFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1+featureDim;
 		int pairwiseFeatDim = featureDim;
@@ -457,94 +532,30 @@ namespace HCSearch
 
 	VectorXd StandardAltFeatures::computeUnaryTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int unaryFeatDim = 1+featureDim;
-		
-		VectorXd phi = VectorXd::Zero(numClasses*unaryFeatDim);
 
-		// unary potential
-		for (int node = 0; node < numNodes; node++)
-		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
-			int nodeLabel = Y.getLabel(node);
-
-			// map node label to indexing value in phi vector
-			int classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel);
-
-			// assignment: bias and unary feature
-			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
-		}
+		// unary potential: bias and unary feature per class
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		VectorXd phi = ClassAggregation::computeUnarySums(X, classIndices, numClasses);
 
 		return phi;
 	}
 	
 	VectorXd StandardAltFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int pairwiseFeatDim = featureDim;
-		
-		VectorXd phi = VectorXd::Zero((numClasses+1)*pairwiseFeatDim);
 
-		for (int node1 = 0; node1 < numNodes; node1++)
+		// same-class edges go to their class, all other edges share the last slot
+		MatrixXi classPairSlots = MatrixXi::Constant(numClasses, numClasses, numClasses);
+		for (int classIndex = 0; classIndex < numClasses; classIndex++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
-				continue;
-
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
-			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
-			{
-				int node2 = *it;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
-				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
-			}
-		}
-
-		return 0.5*phi;
-	}
-
-	VectorXd StandardAltFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
-			classIndex = Global::settings->CLASSES.numClasses(); // numClasses
-
-			// assignment
-			return expnegdiffabs2;
+			classPairSlots(classIndex, classIndex) = classIndex;
 		}
-		else
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
 
-			// map node label to indexing value in phi vector
-			classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		VectorXd phi = ClassAggregation::computePairwiseSums(X, classIndices, classPairSlots, numClasses+1);
 
-			// assignment
-			return expnegdiffabs2;
-		}
+		return 0.5*phi;
 	}
 
 	/**************** Standard Features With Unary Confidences and Raw Pairwise ****************/
@@ -559,7 +570,6 @@ namespace HCSearch
 
 	RankFeatures StandardConfFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
@@ -580,7 +590,6 @@ namespace HCSearch
 
 	int StandardConfFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1;
 		int pairwiseFeatDim = featureDim;
@@ -600,103 +609,29 @@ namespace HCSearch
 
 		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int unaryFeatDim = 1;
-		
-		VectorXd phi = VectorXd::Zero(numClasses*unaryFeatDim);
 
 		// unary potential
-		for (int node = 0; node < numNodes; node++)
-		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
-			int nodeLabel = Y.getLabel(node);
-
-			// map node label to indexing value in phi vector
-			int classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel);
-
-			// assignment
-			phi(classIndex*unaryFeatDim) += 1-Y.confidences(node, classIndex);
-		}
-
-		phi = 1.0/X.getNumNodes() * phi;
-
-		return phi;
-	}
-	
-	VectorXd StandardConfFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
-	{
-		const int numNodes = X.getNumNodes();
-		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int pairwiseFeatDim = featureDim;
-		int numPairs = (numClasses*(numClasses+1))/2;
-		
-		VectorXd phi = VectorXd::Zero(numPairs*pairwiseFeatDim);
-
-		int numEdges = 0;
-		for (int node1 = 0; node1 < numNodes; node1++)
-		{
-			if (X.graph.adjList.count(node1) == 0)
-				continue;
-
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
-			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
-			{
-				int node2 = *it;
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
-				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
-			}
-		}
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		VectorXd phi = ClassAggregation::computeUnaryConfidenceSums(Y, classIndices, numClasses);
 
-		phi = 1.0/numEdges * phi;
-
-		return phi;
-	}
-
-	VectorXd StandardConfFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
+		phi = 1.0/numNodes * phi;
 
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+		return phi;
+	}
+	
+	VectorXd StandardConfFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
+	{
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int numPairs = (numClasses*(numClasses+1))/2;
 
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
+		// contrast sensitive pairwise potential per class pair
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		MatrixXi classPairSlots = ClassAggregation::computeClassPairSlots(numClasses);
+		VectorXd phi = ClassAggregation::computePairwiseSums(X, classIndices, classPairSlots, numPairs);
 
-			// assignment
-			return expnegdiffabs2;
-		}
-		else
-		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
+		phi = 1.0/X.graph.adjacency->getNumEdges() * phi;
 
-			// assignment
-			return expnegdiffabs2;
-		}
+		return phi;
 	}
 
 	/**************** Unary Only Raw Features ****************/
@@ -711,12 +646,10 @@ namespace HCSearch
 
 	RankFeatures UnaryFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
 		int unaryFeatDim = 1+featureDim;
-		int pairwiseFeatDim = featureDim;
 
 		VectorXd phi = VectorXd::Zero(featureSize(X, Y, action));
 		
@@ -727,12 +660,16 @@ namespace HCSearch
 		return RankFeatures(phi);
 	}
 
+	void UnaryFeatures::computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+		RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features)
+	{
+		features = computeFeatures(X, Y, action);
+	}
+
 	int UnaryFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1+featureDim;
-		int pairwiseFeatDim = featureDim;
 		int numClasses = Global::settings->CLASSES.numClasses();
 
 		return numClasses*unaryFeatDim;
@@ -750,13 +687,9 @@ namespace HCSearch
 
 	RankFeatures UnaryConfFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
-		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
 		int unaryFeatDim = 1;
-		int pairwiseFeatDim = featureDim;
-		int numPairs = (numClasses*(numClasses+1))/2;
 
 		VectorXd phi = VectorXd::Zero(featureSize(X, Y, action));
 		
@@ -769,12 +702,8 @@ namespace HCSearch
 
 	int UnaryConfFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
-		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1;
-		int pairwiseFeatDim = featureDim;
 		int numClasses = Global::settings->CLASSES.numClasses();
-		int numPairs = (numClasses*(numClasses+1))/2;
 
 		return numClasses*unaryFeatDim;
 	}
@@ -791,7 +720,6 @@ namespace HCSearch
 
 	RankFeatures StandardPairwiseCountsFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
@@ -810,9 +738,14 @@ namespace HCSearch
 		return RankFeatures(phi);
 	}
 
+	void StandardPairwiseCountsFeatures::computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+		RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features)
+	{
+		features = computeFeatures(X, Y, action);
+	}
+
 	int StandardPairwiseCountsFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
 		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1+featureDim;
 		int pairwiseFeatDim = 1;
@@ -824,62 +757,19 @@ namespace HCSearch
 	
 	VectorXd StandardPairwiseCountsFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int pairwiseFeatDim = 1;
-		int numPairs = (numClasses*(numClasses+1))/2;
-		
-		VectorXd phi = VectorXd::Zero(numPairs*pairwiseFeatDim);
-
-		int numEdges = 0;
-		for (int node1 = 0; node1 < numNodes; node1++)
-		{
-			if (X.graph.adjList.count(node1) == 0)
-				continue;
-
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
-			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
-			{
-				int node2 = *it;
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				int nodeLabel2 = Y.getLabel(node2);
+		const int numPairs = (numClasses*(numClasses+1))/2;
 
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
-				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
-			}
-		}
+		// co-occurence counts per class pair
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		MatrixXi classPairSlots = ClassAggregation::computeClassPairSlots(numClasses);
+		VectorXd phi = ClassAggregation::computePairwiseCounts(X, classIndices, classPairSlots, numPairs);
 
-		phi = 1.0/numEdges * phi;
+		phi = 1.0/X.graph.adjacency->getNumEdges() * phi;
 
 		return phi;
 	}
 
-	VectorXd StandardPairwiseCountsFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
-
-		VectorXd one = VectorXd::Ones(1);
-		return one;
-	}
-
 	/**************** Standard Confidences Unary and Co-occurence Counts Pairwise Features ****************/
 
 	StandardConfPairwiseCountsFeatures::StandardConfPairwiseCountsFeatures()
@@ -892,8 +782,6 @@ namespace HCSearch
 
 	RankFeatures StandardConfPairwiseCountsFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
-		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 
 		int unaryFeatDim = 1;
@@ -913,8 +801,6 @@ namespace HCSearch
 
 	int StandardConfPairwiseCountsFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
-		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1;
 		int pairwiseFeatDim = 1;
 		int numClasses = Global::settings->CLASSES.numClasses();
@@ -925,64 +811,25 @@ namespace HCSearch
 	
 	VectorXd StandardConfPairwiseCountsFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int pairwiseFeatDim = 1;
-		int numPairs = (numClasses*(numClasses+1))/2;
-		
-		VectorXd phi = VectorXd::Zero(numPairs*pairwiseFeatDim);
-
-		int numEdges = 0;
-		for (int node1 = 0; node1 < numNodes; node1++)
-		{
-			if (X.graph.adjList.count(node1) == 0)
-				continue;
-
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
-			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
-			{
-				int node2 = *it;
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				int nodeLabel2 = Y.getLabel(node2);
+		const int numPairs = (numClasses*(numClasses+1))/2;
 
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
-				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
-			}
-		}
+		// co-occurence counts per class pair
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		MatrixXi classPairSlots = ClassAggregation::computeClassPairSlots(numClasses);
+		VectorXd phi = ClassAggregation::computePairwiseCounts(X, classIndices, classPairSlots, numPairs);
 
-		phi = 1.0/numEdges * phi;
+		phi = 1.0/X.graph.adjacency->getNumEdges() * phi;
 
 		return phi;
 	}
 
-	VectorXd StandardConfPairwiseCountsFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
-
-		VectorXd one = VectorXd::Ones(1);
-		return one;
-	}
-
 	/**************** Dense CRF Features ****************/
 
+	const double DenseCRFFeatures::THETA_ALPHA = 0.025;
+	const double DenseCRFFeatures::THETA_BETA = 0.025;
+	const double DenseCRFFeatures::THETA_GAMMA = 0.025;
+
 	DenseCRFFeatures::DenseCRFFeatures()
 	{
 	}
@@ -993,8 +840,6 @@ namespace HCSearch
 
 	RankFeatures DenseCRFFeatures::computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
-		int featureDim = X.getFeatureDim();
 		int numClasses = Global::settings->CLASSES.numClasses();
 		int numPairs = (numClasses*(numClasses+1))/2;
 
@@ -1014,8 +859,6 @@ namespace HCSearch
 
 	int DenseCRFFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		int numNodes = X.getNumNodes();
-		int featureDim = X.getFeatureDim();
 		int unaryFeatDim = 1;
 		int pairwiseFeatDim = 2;
 		int numClasses = Global::settings->CLASSES.numClasses();
@@ -1034,26 +877,12 @@ namespace HCSearch
 
 		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
-		const int unaryFeatDim = 1;
-		
-		VectorXd phi = VectorXd::Zero(numClasses*unaryFeatDim);
 
 		// unary potential
-		for (int node = 0; node < numNodes; node++)
-		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
-			int nodeLabel = Y.getLabel(node);
-
-			// map node label to indexing value in phi vector
-			int classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel);
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+		VectorXd phi = ClassAggregation::computeUnaryConfidenceSums(Y, classIndices, numClasses);
 
-			// assignment
-			phi(classIndex*unaryFeatDim) += 1-Y.confidences(node, classIndex);
-		}
-
-		phi = 1.0/X.getNumNodes() * phi;
+		phi = 1.0/numNodes * phi;
 
 		return phi;
 	}
@@ -1062,34 +891,36 @@ namespace HCSearch
 	{
 		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int featureDim = X.getFeatureDim();
 		const int pairwiseFeatDim = 2;
 		const int numPairs = (numClasses*(numClasses+1))/2;
 		
 		VectorXd phi = VectorXd::Zero(numPairs*pairwiseFeatDim);
 
+		const VectorXi& classIndices = ClassAggregation::computeClassIndices(Y);
+
 		int numEdges = 0;
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
+			// get node features and class of starting node
+			VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+			double nodeLocationX1 = X.getNodeLocationX(node1);
+			double nodeLocationY1 = X.getNodeLocationY(node1);
+			int classIndex1 = classIndices(node1);
+
 			for (int node2 = node1+1; node2 < numNodes; node2++)
 			{
 				numEdges++;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
+				// get node features and class
 				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				double nodeLocationX2 = X.getNodeLocationX(node2);
 				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
+				int classIndex2 = classIndices(node2);
 
 				int classIndex = -1;
 				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, 
 					nodeLocationX1, nodeLocationY1, nodeLocationX2, nodeLocationY2, 
-					nodeLabel1, nodeLabel2, classIndex);
+					classIndex1, classIndex2, classIndex);
 				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -1101,23 +932,12 @@ namespace HCSearch
 
 	VectorXd DenseCRFFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
 		double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
+		int classIndex1, int classIndex2, int& classIndex)
 	{
-		const double THETA_ALPHA = 0.025;
-		const double THETA_BETA = 0.025;
-		const double THETA_GAMMA = 0.025;
-
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+		classIndex = computeClassPairIndex(classIndex1, classIndex2);
 
 		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
+		if (classIndex1 != classIndex2)
 		{
 			VectorXd potential = VectorXd::Zero(2);
 
@@ -1151,13 +971,129 @@ namespace HCSearch
 		}
 	}
 
+	int DenseCRFFeatures::computeClassPairIndex(int classIndex1, int classIndex2)
+	{
+		return ClassAggregation::computeClassPairIndex(classIndex1, classIndex2, Global::settings->CLASSES.numClasses());
+	}
+
+	/**************** Fast Dense CRF Features ****************/
+
+	const double FastDenseCRFFeatures::KERNEL_EPSILON = 1e-9;
+
+	FastDenseCRFFeatures::FastDenseCRFFeatures()
+	{
+	}
+
+	FastDenseCRFFeatures::~FastDenseCRFFeatures()
+	{
+	}
+
+	VectorXd FastDenseCRFFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
+	{
+		const int numNodes = X.getNumNodes();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int pairwiseFeatDim = 2;
+		const int numPairs = (numClasses*(numClasses+1))/2;
+
+		// both kernels are at most the location Gaussian of the wider bandwidth
+		const double theta = max(THETA_ALPHA, THETA_GAMMA);
+		const double cutoff = theta*sqrt(-2*log(KERNEL_EPSILON));
+		const double cutoffSquared = cutoff*cutoff;
+
+		// bucket nodes into cutoff-sized cells over the normalized image
+		const int gridSize = max(1, static_cast<int>(ceil(1.0/cutoff)));
+		vector< vector<int> > cells(gridSize*gridSize);
+		VectorXi nodeCellX = VectorXi::Zero(numNodes);
+		VectorXi nodeCellY = VectorXi::Zero(numNodes);
+		const VectorXi& nodeClassIndex = ClassAggregation::computeClassIndices(Y);
+		VectorXd classCounts = VectorXd::Zero(numClasses);
+		for (int node = 0; node < numNodes; node++)
+		{
+			int cellX = static_cast<int>(floor(X.getNodeLocationX(node)/cutoff));
+			int cellY = static_cast<int>(floor(X.getNodeLocationY(node)/cutoff));
+			nodeCellX(node) = min(max(cellX, 0), gridSize-1);
+			nodeCellY(node) = min(max(cellY, 0), gridSize-1);
+			cells[nodeCellY(node)*gridSize + nodeCellX(node)].push_back(node);
+
+			classCounts(nodeClassIndex(node)) += 1;
+		}
+
+		// kernel sums over node pairs within the cutoff, per class pair
+		VectorXd kernelSums = VectorXd::Zero(numPairs*pairwiseFeatDim);
+		for (int node1 = 0; node1 < numNodes; node1++)
+		{
+			double nodeLocationX1 = X.getNodeLocationX(node1);
+			double nodeLocationY1 = X.getNodeLocationY(node1);
+
+			for (int cellY = max(nodeCellY(node1)-1, 0); cellY <= min(nodeCellY(node1)+1, gridSize-1); cellY++)
+			{
+				for (int cellX = max(nodeCellX(node1)-1, 0); cellX <= min(nodeCellX(node1)+1, gridSize-1); cellX++)
+				{
+					const vector<int>& cell = cells[cellY*gridSize + cellX];
+					for (vector<int>::const_iterator it = cell.begin(); it != cell.end(); ++it)
+					{
+						int node2 = *it;
+						if (node2 <= node1)
+							continue;
+
+						double locationDistance = pow(nodeLocationX1-X.getNodeLocationX(node2),2)
+							+ pow(nodeLocationY1-X.getNodeLocationY(node2),2);
+						if (locationDistance > cutoffSquared)
+							continue;
+
+						double featureDistance = (X.graph.nodesData.row(node1) - X.graph.nodesData.row(node2)).squaredNorm();
+
+						int classIndex = computeClassPairIndex(nodeClassIndex(node1), nodeClassIndex(node2));
+						kernelSums(classIndex*pairwiseFeatDim) += exp(-locationDistance/(2*pow(THETA_ALPHA,2)) - featureDistance/(2*pow(THETA_BETA,2)));
+						kernelSums(classIndex*pairwiseFeatDim+1) += exp(-locationDistance/(2*pow(THETA_GAMMA,2)));
+					}
+				}
+			}
+		}
+
+		// same-class pairs contribute 1-kernel, so subtract their sums from the pair counts
+		VectorXd phi = kernelSums;
+		for (int classIndex = 0; classIndex < numClasses; classIndex++)
+		{
+			int pairIndex = computeClassPairIndex(classIndex, classIndex);
+			double numSameClassPairs = classCounts(classIndex)*(classCounts(classIndex)-1)/2;
+			phi.segment(pairIndex*pairwiseFeatDim, pairwiseFeatDim) = 
+				numSameClassPairs*VectorXd::Ones(pairwiseFeatDim) - kernelSums.segment(pairIndex*pairwiseFeatDim, pairwiseFeatDim);
+		}
+
+		int numEdges = numNodes*(numNodes-1)/2;
+		phi = 1.0/numEdges * phi;
+
+		return phi;
+	}
+
 	/**************** Standard Prune Features ****************/
 
 	const int StandardPruneFeatures::MUTEX_THRESHOLD = 100;
 
+	// MANUALLY DEFINED FOR STANFORD DATASET
+	// constraint i: a node of label1 must not be in config relative to a node of label2
+	const int StandardPruneFeatures::MANUAL_MUTEX_LABELS1[NUM_MANUAL_MUTEX] = { 1, 3, 1, 4, 1, 5, 1, 7 };
+	const int StandardPruneFeatures::MANUAL_MUTEX_LABELS2[NUM_MANUAL_MUTEX] = { 3, 1, 4, 1, 5, 1, 7, 1 };
+	const MutexConfiguration StandardPruneFeatures::MANUAL_MUTEX_CONFIGS[NUM_MANUAL_MUTEX] = { MUTEX_DOWN, MUTEX_UP, MUTEX_DOWN, MUTEX_UP, 
+		MUTEX_DOWN, MUTEX_UP, MUTEX_DOWN, MUTEX_UP };
+
 	StandardPruneFeatures::StandardPruneFeatures()
 	{
 		this->initialized = false;
+
+		// resolve the manual constraint labels once
+		set<int> labels = Global::settings->CLASSES.getLabels();
+		this->manualMutexClassIndices1 = VectorXi::Constant(NUM_MANUAL_MUTEX, -1);
+		this->manualMutexClassIndices2 = VectorXi::Constant(NUM_MANUAL_MUTEX, -1);
+		for (int i = 0; i < NUM_MANUAL_MUTEX; i++)
+		{
+			if (labels.count(MANUAL_MUTEX_LABELS1[i]) == 0 || labels.count(MANUAL_MUTEX_LABELS2[i]) == 0)
+				continue;
+
+			this->manualMutexClassIndices1(i) = Global::settings->CLASSES.getClassIndex(MANUAL_MUTEX_LABELS1[i]);
+			this->manualMutexClassIndices2(i) = Global::settings->CLASSES.getClassIndex(MANUAL_MUTEX_LABELS2[i]);
+		}
 	}
 
 	StandardPruneFeatures::~StandardPruneFeatures()
@@ -1247,7 +1183,7 @@ namespace HCSearch
 
 		for (int node = 0; node < Y.getNumNodes(); node++)
 		{
-			int classIndex = Global::settings->CLASSES.getClassIndex(Y.getLabel(node));
+			int classIndex = Y.getLabel(node);
 			double xPos = X.getNodeLocationX(node);
 			double yPos = X.getNodeLocationY(node);
 
@@ -1273,7 +1209,7 @@ namespace HCSearch
 
 		for (int node = 0; node < Y.getNumNodes(); node++)
 		{
-			int classIndex = Global::settings->CLASSES.getClassIndex(Y.getLabel(node));
+			int classIndex = Y.getLabel(node);
 			if (unusable(classIndex) == 1)
 				continue;
 
@@ -1308,53 +1244,24 @@ namespace HCSearch
 
 	VectorXd StandardPruneFeatures::computeMutexTermManually(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		const int numNodes = X.getNumNodes();
-		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int numMutexConstraints = 8;
-		
-		VectorXd phi = VectorXd::Zero(numMutexConstraints);
+		VectorXd phi = VectorXd::Zero(NUM_MANUAL_MUTEX);
 
-		int numEdges = 0;
-		//for (int node1 = 0; node1 < numNodes; node1++)
+		ClassLocationBounds bounds(X, Y);
 		for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
 		{
 			int node1 = *it;
+			double nodeLocationX1 = X.getNodeLocationX(node1);
+			double nodeLocationY1 = X.getNodeLocationY(node1);
+			int node1ClassIndex = Y.getLabel(node1);
 
-			for (int node2 = 0; node2 < numNodes; node2++)
+			for (int i = 0; i < NUM_MANUAL_MUTEX; i++)
 			{
-				if (node1 == node2)
+				// constraints on labels missing from the dataset have class index -1
+				if (node1ClassIndex != this->manualMutexClassIndices1(i) || this->manualMutexClassIndices2(i) < 0)
 					continue;
 
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				double nodeLocationX2 = X.getNodeLocationX(node2);
-				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				// MANUALLY DEFINED FOR STANFORD DATASET
-				if (nodeLabel1 == 1 && nodeLabel2 == 3 && nodeLocationY1 > nodeLocationY2)
-					phi(0) = 1;
-				if (nodeLabel1 == 3 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(1) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 4 && nodeLocationY1 > nodeLocationY2)
-					phi(2) = 1;
-				if (nodeLabel1 == 4 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(3) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 5 && nodeLocationY1 > nodeLocationY2)
-					phi(4) = 1;
-				if (nodeLabel1 == 5 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(5) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 7 && nodeLocationY1 > nodeLocationY2)
-					phi(6) = 1;
-				if (nodeLabel1 == 7 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(7) = 1;
+				if (bounds.hasNodeInConfiguration(this->manualMutexClassIndices2(i), MANUAL_MUTEX_CONFIGS[i], nodeLocationX1, nodeLocationY1))
+					phi(i) = 1;
 			}
 		}
 		
@@ -1363,46 +1270,36 @@ namespace HCSearch
 
 	VectorXd StandardPruneFeatures::computeMutexTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
 		const int mutexFeatDim = 4;
 		const int numMutexPairs = (numClasses*(numClasses+1))/2;
 		
 		VectorXd phi = VectorXd::Zero(numMutexPairs*mutexFeatDim);
 
-		int numEdges = 0;
-		//for (int node1 = 0; node1 < numNodes; node1++)
+		ClassLocationBounds bounds(X, Y);
 		for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
 		{
 			int node1 = *it;
+			double nodeLocationX1 = X.getNodeLocationX(node1);
+			double nodeLocationY1 = X.getNodeLocationY(node1);
+			int node1ClassIndex = Y.getLabel(node1);
 
-			for (int node2 = 0; node2 < numNodes; node2++)
+			for (int node2ClassIndex = 0; node2ClassIndex < numClasses; node2ClassIndex++)
 			{
-				if (node1 == node2)
+				if (node2ClassIndex == node1ClassIndex)
 					continue;
 
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				double nodeLocationX2 = X.getNodeLocationX(node2);
-				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computeMutexFeatures(nodeFeatures1, nodeFeatures2, 
-					nodeLocationX1, nodeLocationY1, nodeLocationX2, nodeLocationY2, 
-					nodeLabel1, nodeLabel2, classIndex);
+				int i = min(node1ClassIndex, node2ClassIndex);
+				int j = max(node1ClassIndex, node2ClassIndex);
+				int classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
 
-				for (int i = 0; i < mutexFeatDim; i++)
+				// feature is on if node 1 is in a configuration rarely seen in training
+				for (int config = MUTEX_LEFT; config <= MUTEX_DOWN; config++)
 				{
-					if (edgeFeatureVector(i) != 0)
-						phi(classIndex*mutexFeatDim + i) = edgeFeatureVector(i);
+					MutexConfiguration mutexConfig = static_cast<MutexConfiguration>(config);
+					if (bounds.hasNodeInConfiguration(node2ClassIndex, mutexConfig, nodeLocationX1, nodeLocationY1)
+						&& this->mutexTable.getCount(node1ClassIndex, node2ClassIndex, mutexConfig) <= MUTEX_THRESHOLD)
+						phi(classIndex*mutexFeatDim + config) = 1;
 				}
 			}
 		}
@@ -1410,78 +1307,10 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardPruneFeatures::computeMutexFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
-
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd potential = VectorXd::Zero(4);
-
-			if (nodeLocationX1 < nodeLocationX2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "L");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(0) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(0) = 1;
-				else
-					potential(0) = 0;
-			}
-			else if (nodeLocationX1 > nodeLocationX2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "R");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(1) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(1) = 1;
-				else
-					potential(1) = 0;
-			}
-			
-			if (nodeLocationY1 < nodeLocationY2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "U");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(2) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(2) = 1;
-				else
-					potential(2) = 0;
-			}
-			else if (nodeLocationY1 > nodeLocationY2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "D");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(3) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(3) = 1;
-				else
-					potential(3) = 0;
-			}
-
-			return potential;
-		}
-		else
-		{
-			VectorXd potential = VectorXd::Zero(4);
-			return potential;
-		}
-	}
-
 	void StandardPruneFeatures::setMutex(map<string, int>& mutex)
 	{
 		this->mutex = mutex;
+		this->mutexTable = MutexTable(mutex);
 		this->initialized = true;
 	}
 
@@ -1489,11 +1318,4 @@ namespace HCSearch
 	{
 		return this->mutex;
 	}
-
-	string StandardPruneFeatures::mutexStringHelper(int class1, int class2, string config)
-	{
-		stringstream ss;
-		ss << class1 << " " << class2 << " " << config;
-		return ss.str();
-	}
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef FEATUREFUNCTION_HPP
 #define FEATUREFUNCTION_HPP
 
+#include <typeinfo>
 #include "../../external/Eigen/Eigen/Dense"
 #include "DataStructures.hpp"
 
@@ -21,10 +22,80 @@ namespace HCSearch
 		 */
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)=0;
 
+		/*!
+		 * @brief Compute features of a successor from the features of its parent.
+		 * 
+		 * The action must contain every node whose label differs between YParent and Y.
+		 * The result is written into features, reusing its storage if it already has the right size.
+		 * The default implementation recomputes the features from scratch.
+		 */
+		virtual void computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+			RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features);
+
 		/*!
 		 * @brief Get dimension of computed feature vector given structured features and labeling.
 		 */
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+
+		/*!
+		 * @brief Check if another feature function computes the same features. 
+		 * The default compares the types; override to compare parameters too.
+		 */
+		virtual bool sameFeatures(IFeatureFunction& other);
+	};
+
+	/**************** Class Aggregation Kernel ****************/
+
+	/*!
+	 * @brief Shared kernel for class-conditional sums over nodes and edges.
+	 *
+	 * Labelings already hold class indices, which are read in place. Unary sums 
+	 * are the product one-hot(classes)^T * [1, features], accumulated column by 
+	 * column without materializing the one-hot matrix. Pairwise sums run over the 
+	 * flat CSR edge array once per feature column and accumulate into class pair slots.
+	 */
+	class ClassAggregation
+	{
+	public:
+		/*!
+		 * @brief Class index of every node of a labeling (the labeling's own vector, not a copy).
+		 */
+		static const VectorXi& computeClassIndices(ImgLabeling& Y);
+
+		/*!
+		 * @brief Index of the (unordered) class pair into a pairwise segment.
+		 */
+		static int computeClassPairIndex(int classIndex1, int classIndex2, int numClasses);
+
+		/*!
+		 * @brief Slot of every ordered class pair using the (unordered) class pair index.
+		 */
+		static MatrixXi computeClassPairSlots(int numClasses);
+
+		/*!
+		 * @brief Per-class bias and feature sums, numClasses blocks of (1+featureDim).
+		 */
+		static VectorXd computeUnarySums(ImgFeatures& X, const VectorXi& classIndices, int numClasses);
+
+		/*!
+		 * @brief Per-class sums of 1-confidence of the assigned class.
+		 */
+		static VectorXd computeUnaryConfidenceSums(ImgLabeling& Y, const VectorXi& classIndices, int numClasses);
+
+		/*!
+		 * @brief Per-slot sums of the contrast sensitive edge features over all directed edges.
+		 *
+		 * An edge contributes exp(-(x1-x2)^2) if its classes differ and 1-exp(-(x1-x2)^2)
+		 * otherwise, into slot classPairSlots(class1, class2). Result has numSlots blocks of featureDim.
+		 */
+		static VectorXd computePairwiseSums(ImgFeatures& X, const VectorXi& classIndices,
+			const MatrixXi& classPairSlots, int numSlots);
+
+		/*!
+		 * @brief Per-slot counts of directed edges.
+		 */
+		static VectorXd computePairwiseCounts(ImgFeatures& X, const VectorXi& classIndices,
+			const MatrixXi& classPairSlots, int numSlots);
 	};
 
 	/**************** Feature Functions ****************/
@@ -45,7 +116,10 @@ namespace HCSearch
 		~StandardFeatures();
 
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+		virtual void computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+			RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+		virtual bool sameFeatures(IFeatureFunction& other);
 
 	protected:
 		/*!
@@ -59,10 +133,10 @@ namespace HCSearch
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
 
 		/*!
-		 * @brief Compute pairwise features.
+		 * @brief Add the (unnormalized) pairwise contribution of the directed edge node1 -> node2.
 		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
+		void addPairwiseEdgeTerm(ImgFeatures& X, ImgLabeling& Y, int node1, int node2, 
+			double scale, VectorXd& phi, int offset);
 	};
 
 	/*!
@@ -88,12 +162,6 @@ namespace HCSearch
 		 */
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
 
-		/*!
-		 * @brief Compute pairwise features.
-		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
-
 		/*!
 		 * @brief Compute context term.
 		 */
@@ -104,7 +172,7 @@ namespace HCSearch
 		 */
 		VectorXd computeContextFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
 			double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
+			int node1ClassIndex, int node2ClassIndex, int& classIndex);
 	};
 
 	/*!
@@ -130,12 +198,6 @@ namespace HCSearch
 		 * @brief Compute pairwise term.
 		 */
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
-
-		/*!
-		 * @brief Compute pairwise features.
-		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
 	/*!
@@ -160,12 +222,6 @@ namespace HCSearch
 		 * @brief Compute pairwise term.
 		 */
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
-
-		/*!
-		 * @brief Compute pairwise features.
-		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
 	/*!
@@ -178,6 +234,8 @@ namespace HCSearch
 		~UnaryFeatures();
 
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+		virtual void computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+			RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 	};
 
@@ -204,12 +262,12 @@ namespace HCSearch
 		~StandardPairwiseCountsFeatures();
 
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+		virtual void computeFeaturesIncremental(ImgFeatures& X, ImgLabeling& YParent, 
+			RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
 	protected:
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
 	/*!
@@ -226,8 +284,6 @@ namespace HCSearch
 
 	protected:
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
 	/*!
@@ -235,6 +291,15 @@ namespace HCSearch
 	 */
 	class DenseCRFFeatures : public IFeatureFunction
 	{
+	protected:
+		/*!
+		 * Bandwidths of the appearance (alpha: location, beta: features) 
+		 * and smoothness (gamma: location) Gaussian kernels.
+		 */
+		static const double THETA_ALPHA;
+		static const double THETA_BETA;
+		static const double THETA_GAMMA;
+
 	public:
 		DenseCRFFeatures();
 		~DenseCRFFeatures();
@@ -247,7 +312,37 @@ namespace HCSearch
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
 		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
 			double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
+			int classIndex1, int classIndex2, int& classIndex);
+
+		/*!
+		 * @brief Index of the (unordered) class pair into the pairwise segment.
+		 */
+		int computeClassPairIndex(int classIndex1, int classIndex2);
+	};
+
+	/*!
+	 * @brief Dense CRF features with a truncated pairwise term.
+	 * 
+	 * Both kernels are bounded by the location Gaussian, so only node pairs 
+	 * closer than a cutoff radius are evaluated. Nodes are bucketed into 
+	 * a grid of cutoff-sized cells and compared with the neighboring cells only. 
+	 * Same-class pairs are recovered from the class counts. Pairs beyond the cutoff 
+	 * contribute less than KERNEL_EPSILON each, which is the approximation error.
+	 */
+	class FastDenseCRFFeatures : public DenseCRFFeatures
+	{
+	protected:
+		/*!
+		 * Kernel values below this are treated as zero.
+		 */
+		static const double KERNEL_EPSILON;
+
+	public:
+		FastDenseCRFFeatures();
+		~FastDenseCRFFeatures();
+
+	protected:
+		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
 	};
 
 	/*!
@@ -343,10 +438,17 @@ namespace HCSearch
 	class StandardPruneFeatures : public IFeatureFunction
 	{
 		static const int MUTEX_THRESHOLD;
+		static const int NUM_MANUAL_MUTEX = 8;
+		static const int MANUAL_MUTEX_LABELS1[NUM_MANUAL_MUTEX];
+		static const int MANUAL_MUTEX_LABELS2[NUM_MANUAL_MUTEX];
+		static const MutexConfiguration MANUAL_MUTEX_CONFIGS[NUM_MANUAL_MUTEX];
 
 	protected:
 		map<string, int> mutex;
+		MutexTable mutexTable;
 		bool initialized;
+		VectorXi manualMutexClassIndices1; //!< Class index of each manual constraint's label1 (-1 if not a class)
+		VectorXi manualMutexClassIndices2; //!< Class index of each manual constraint's label2 (-1 if not a class)
 
 	public:
 		StandardPruneFeatures();
@@ -366,12 +468,6 @@ namespace HCSearch
 		VectorXd computeMutexTermManually(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
 		VectorXd computeMutexTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action);
-		VectorXd computeMutexFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
-
-	private:
-		string mutexStringHelper(int class1, int class2, string config);
 	};
 }
 
@@ -10,13 +10,14 @@ namespace HCSearch
 	namespace Global
 	{
 		Settings* settings = NULL;
+		MyPrimitives::ThreadPool* threadPool = NULL;
 	}
 
 	namespace Rand
 	{
 		unsigned long g_init[4] = {(int)time(NULL) % 9999, rand() % 9999, (int)time(NULL) % 8888, rand() % 9999};
 		unsigned long g_length = 4;
-		MTRand_closed unifDist(g_init, g_length);
+		SharedUniformRand unifDist(g_init, g_length);
 	}
 
 	/**************** Abort ****************/
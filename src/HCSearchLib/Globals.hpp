@@ -3,6 +3,7 @@
 
 #include "Settings.hpp"
 #include "MyLogger.hpp"
+#include "MyPrimitives.hpp"
 #include "mtrand.h"
 
 #ifdef USE_MPI
@@ -14,13 +15,32 @@ namespace HCSearch
 	/**************** Global ****************/
 
 	/*!
-	 * @brief %Global variables: settings and logging (for debugging)
+	 * @brief %Global variables: settings, logging (for debugging) and worker threads
 	 */
 	namespace Global
 	{
 		extern Settings* settings;
+		extern MyPrimitives::ThreadPool* threadPool;
 	}
 
+	/*!
+	 * @brief Uniform [0, 1] random number generator that is safe to share between threads
+	 */
+	class SharedUniformRand
+	{
+		MTRand_closed generator;
+		std::mutex lock;
+
+	public:
+		SharedUniformRand(const unsigned long* seed, int size) : generator(seed, size) {}
+
+		double operator()()
+		{
+			lock_guard<std::mutex> guard(this->lock);
+			return this->generator();
+		}
+	};
+
 	/*!
 	 * @brief Uniform [0, 1] random number generator
 	 */
@@ -28,7 +48,7 @@ namespace HCSearch
 	{
 		extern unsigned long g_init[4];
 		extern unsigned long g_length;
-		extern MTRand_closed unifDist;
+		extern SharedUniformRand unifDist;
 	}
 
 	/**************** Abort ****************/
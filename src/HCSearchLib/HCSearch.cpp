@@ -1,5 +1,7 @@
 #include <iostream>
 #include <ctime>
+#include <cstring>
+#include <algorithm>
 #include "HCSearch.hpp"
 #include "MyFileSystem.hpp"
 
@@ -60,6 +62,12 @@ namespace HCSearch
 
 		// set classes
 		setClasses();
+
+		// start worker threads
+		if (Global::threadPool != NULL)
+			delete Global::threadPool;
+		Global::threadPool = new MyPrimitives::ThreadPool(max(1, Global::settings->NUM_THREADS));
+		LOG() << "Number of threads: " << Global::threadPool->size() << endl << endl;
 	}
 
 	void Setup::finalize()
@@ -91,6 +99,12 @@ namespace HCSearch
 
 	void Setup::finalizeHelper()
 	{
+		if (Global::threadPool != NULL)
+		{
+			delete Global::threadPool;
+			Global::threadPool = NULL;
+		}
+
 		if (Global::settings != NULL)
 			delete Global::settings;
 
@@ -267,6 +281,11 @@ namespace HCSearch
 			delete object;
 		}
 		XTest.clear();
+
+		// forget lazily loaded images
+		cacheEntries.clear();
+		cacheOrder.clear();
+		cacheUsage = 0;
 	}
 
 	void Dataset::computeTaskRange(int rank, int numTasks, int numProcesses, int& start, int& end)
@@ -291,68 +310,680 @@ namespace HCSearch
 		}
 	}
 
+	void Dataset::forEachImage(int start, int end, bool allowThreads, const function<void(int)>& task)
+	{
+		const int numImages = max(0, end - start);
+		function<void(int)> imageTask = [&](int i)
+		{
+			task(start + i);
+		};
+
+		if (Global::settings->PARALLEL_IMAGES && Global::threadPool != NULL)
+		{
+			if (allowThreads)
+			{
+				Global::threadPool->parallelFor(numImages, imageTask);
+				return;
+			}
+			LOG(WARNING) << "task cannot run on images in parallel; running images one at a time";
+		}
+
+		for (int i = 0; i < numImages; i++)
+			imageTask(i);
+	}
+
+	void Dataset::scheduleImages(vector< ImgFeatures* >& XSet, bool allowThreads, const function<void(int)>& task)
+	{
+#ifdef USE_MPI
+		if (Global::settings->DYNAMIC_SCHEDULING && Global::settings->NUM_PROCESSES > 1)
+		{
+			if (Global::settings->PARALLEL_IMAGES)
+				LOG(WARNING) << "images are handed out one at a time with dynamic scheduling; ignoring parallel images";
+
+			// largest images first, so that the slowest ones do not come last
+			vector<int> order;
+			if (Global::settings->RANK == 0)
+			{
+				vector< MyPrimitives::Pair<int, int> > sizes;
+				for (int i = 0; i < XSet.size(); i++)
+					sizes.push_back(MyPrimitives::Pair<int, int>(-countImageNodes(XSet[i]), i));
+				stable_sort(sizes.begin(), sizes.end());
+
+				for (vector< MyPrimitives::Pair<int, int> >::iterator it = sizes.begin(); it != sizes.end(); ++it)
+					order.push_back(it->second);
+			}
+
+			MPI::Scheduler::dispatchTasks(order, task);
+			return;
+		}
+#endif
+
+		int start, end;
+		computeTaskRange(Global::settings->RANK, XSet.size(), Global::settings->NUM_PROCESSES, start, end);
+		forEachImage(start, end, allowThreads, task);
+	}
+
+	void Dataset::convertDataset()
+	{
+		LOG() << "=== Converting Dataset to Binary ===" << endl;
+
+		MyFileSystem::FileSystem::createFolder(Global::settings->paths->INPUT_BINARY_DIR);
+
+		vector<string> splitFiles;
+		splitFiles.push_back(Global::settings->paths->INPUT_SPLITS_TRAIN_FILE);
+		splitFiles.push_back(Global::settings->paths->INPUT_SPLITS_VALIDATION_FILE);
+		splitFiles.push_back(Global::settings->paths->INPUT_SPLITS_TEST_FILE);
+
+		for (vector<string>::iterator it = splitFiles.begin(); it != splitFiles.end(); ++it)
+		{
+			LOG() << endl << "Converting from " << *it << "..." << endl;
+			vector<string> files = readSplitsFile(*it);
+			for (vector<string>::iterator it2 = files.begin(); it2 != files.end(); ++it2)
+			{
+				string filename = *it2;
+				LOG() << "\tConverting " << filename << "..." << endl;
+
+				ImgFeatures X;
+				ImgLabeling Y;
+				readTextImage(filename, X, Y, true);
+				writeBinaryImage(Global::settings->paths->INPUT_BINARY_DIR + filename + ".bin", X, Y);
+			}
+		}
+
+		LOG() << endl;
+	}
+
+	map< ImgFeatures*, Dataset::CacheEntry > Dataset::cacheEntries;
+	list< ImgFeatures* > Dataset::cacheOrder;
+	size_t Dataset::cacheUsage = 0;
+	std::mutex Dataset::cacheLock;
+
 	void Dataset::loadDatasetHelper(vector<string>& files, vector< ImgFeatures* >& XSet, vector< ImgLabeling* >& YSet)
 	{
+		const bool lazy = Global::settings->DATASET_CACHE_MB > 0;
+
 		for (vector<string>::iterator it = files.begin(); it != files.end(); ++it)
 		{
 			string filename = *it;
-			LOG() << "\tLoading " << filename << "..." << endl;
 
-			// read meta file
+			ImgFeatures* X = new ImgFeatures();
+			ImgLabeling* Y = new ImgLabeling();
+
+			if (lazy)
+			{
+				// only register; data is loaded on first use
+				X->filename = filename;
+				CacheEntry entry;
+				entry.Y = Y;
+				entry.loaded = false;
+				entry.pins = 0;
+				entry.bytes = 0;
+				entry.position = cacheOrder.end();
+				cacheEntries[X] = entry;
+			}
+			else
+			{
+				LOG() << "\tLoading " << filename << "..." << endl;
+				readImage(filename, *X, *Y, true);
+			}
+			
+			// push into list
+			XSet.push_back(X);
+			YSet.push_back(Y);
+		}
+	}
+
+	void Dataset::readImage(string filename, ImgFeatures& X, ImgLabeling& Y, bool withSegments)
+	{
+		// prefer binary file if converted
+		string binaryFile = Global::settings->paths->INPUT_BINARY_DIR + filename + ".bin";
+		if (MyFileSystem::FileSystem::checkFileExists(binaryFile))
+			readBinaryImage(binaryFile, filename, X, Y, withSegments);
+		else
+			readTextImage(filename, X, Y, withSegments);
+	}
+
+	void Dataset::acquireImage(ImgFeatures* X, ImgLabeling* Y)
+	{
+		lock_guard<std::mutex> guard(cacheLock);
+
+		if (cacheEntries.count(X) == 0)
+			return;
+
+		CacheEntry& entry = cacheEntries[X];
+		entry.pins++;
+		if (entry.loaded)
+		{
+			// mark most recently used
+			cacheOrder.splice(cacheOrder.begin(), cacheOrder, entry.position);
+			return;
+		}
+
+		LOG() << "\tLoading " << X->getFileName() << "..." << endl;
+		readImage(X->getFileName(), *X, *Y, false);
+
+		entry.loaded = true;
+		entry.bytes = estimateImageBytes(*X, *Y);
+		cacheOrder.push_front(X);
+		entry.position = cacheOrder.begin();
+		cacheUsage += entry.bytes;
+
+		evictImages();
+	}
+
+	void Dataset::releaseImage(ImgFeatures* X)
+	{
+		lock_guard<std::mutex> guard(cacheLock);
+
+		if (cacheEntries.count(X) == 0)
+			return;
+
+		CacheEntry& entry = cacheEntries[X];
+		if (entry.pins > 0)
+			entry.pins--;
+
+		evictImages();
+	}
+
+	void Dataset::acquireSegments(ImgFeatures* X)
+	{
+		if (X->segmentsAvailable)
+			return;
+
+		string filename = X->getFileName();
+		string binaryFile = Global::settings->paths->INPUT_BINARY_DIR + filename + ".bin";
+		if (MyFileSystem::FileSystem::checkFileExists(binaryFile))
+		{
+			readBinarySegments(binaryFile, X->segments);
+		}
+		else
+		{
 			string metaFile = Global::settings->paths->INPUT_META_DIR + filename + ".txt";
 			int numNodes, numFeatures, height, width;
 			readMetaFile(metaFile, numNodes, numFeatures, height, width);
 
-			// read nodes file
-			string nodesFile = Global::settings->paths->INPUT_NODES_DIR + filename + ".txt";
-			VectorXi labels = VectorXi::Zero(numNodes);
-			MatrixXd features = MatrixXd::Zero(numNodes, numFeatures);
-			readNodesFile(nodesFile, labels, features);
-
-			// read node locations
-			string nodeLocationsFile = Global::settings->paths->INPUT_NODE_LOCATIONS_DIR + filename + ".txt";
-			MatrixXd nodeLocations = MatrixXd::Zero(numNodes, 2);
-			VectorXd nodeWeights = VectorXd::Zero(numNodes);
-			readNodeLocationsFile(nodeLocationsFile, nodeLocations, nodeWeights);
-
-			// read edges file
-			string edgesFile = Global::settings->paths->INPUT_EDGES_DIR + filename + ".txt";
-			AdjList_t edges;
-			map< MyPrimitives::Pair<int, int>, double > edgeWeights;
-			readEdgesFile(edgesFile, edges, edgeWeights);
-
-			// read segments file
 			string segmentsFile = Global::settings->paths->INPUT_SEGMENTS_DIR + filename + ".txt";
-			MatrixXi segments = MatrixXi::Zero(height, width);
+			X->segments = MatrixXi::Zero(height, width);
+			readSegmentsFile(segmentsFile, X->segments);
+		}
+		X->segmentsAvailable = true;
+
+		// count segments toward memory budget
+		lock_guard<std::mutex> guard(cacheLock);
+		if (cacheEntries.count(X) != 0 && cacheEntries[X].loaded)
+		{
+			size_t segmentsBytes = sizeof(int)*X->segments.size();
+			cacheEntries[X].bytes += segmentsBytes;
+			cacheUsage += segmentsBytes;
+			evictImages();
+		}
+	}
+
+	void Dataset::evictImages()
+	{
+		const size_t budget = static_cast<size_t>(Global::settings->DATASET_CACHE_MB) * 1024 * 1024;
+		list< ImgFeatures* >::iterator it = cacheOrder.end();
+		while (cacheUsage > budget && it != cacheOrder.begin())
+		{
+			--it;
+			ImgFeatures* X = *it;
+			CacheEntry& entry = cacheEntries[X];
+
+			// images in use stay loaded
+			if (entry.pins > 0)
+				continue;
+
+			it = cacheOrder.erase(it);
+			ImgLabeling* Y = entry.Y;
+			LOG() << "\tEvicting " << X->getFileName() << "..." << endl;
+
+			// release data but keep the objects
+			X->graph = FeatureGraph();
+			X->segments = MatrixXi();
+			X->segmentsAvailable = false;
+			X->nodeLocations = MatrixXd();
+			X->edgeDivergences = VectorXd();
+			X->edgeDivergencesAvailable = false;
+			Y->graph = LabelGraph();
+			Y->nodeWeights = VectorXd();
+
+			cacheUsage -= entry.bytes;
+			entry.loaded = false;
+			entry.bytes = 0;
+			entry.position = cacheOrder.end();
+		}
+	}
+
+	int Dataset::countImageNodes(ImgFeatures* X)
+	{
+		if (X->getNumNodes() > 0)
+			return X->getNumNodes();
+
+		string metaFile = Global::settings->paths->INPUT_META_DIR + X->getFileName() + ".txt";
+		if (!MyFileSystem::FileSystem::checkFileExists(metaFile))
+			return 0;
+
+		int numNodes, numFeatures, height, width;
+		readMetaFile(metaFile, numNodes, numFeatures, height, width);
+		return numNodes;
+	}
+
+	VectorXi Dataset::labelsToClassIndices(const VectorXi& labels)
+	{
+		const int numNodes = labels.size();
+
+		VectorXi classIndices(numNodes);
+		for (int node = 0; node < numNodes; node++)
+		{
+			classIndices(node) = Global::settings->CLASSES.getClassIndex(labels(node));
+		}
+
+		return classIndices;
+	}
+
+	VectorXi Dataset::classIndicesToLabels(const VectorXi& classIndices)
+	{
+		const int numNodes = classIndices.size();
+
+		VectorXi labels(numNodes);
+		for (int node = 0; node < numNodes; node++)
+		{
+			labels(node) = Global::settings->CLASSES.getClassLabel(classIndices(node));
+		}
+
+		return labels;
+	}
+
+	size_t Dataset::estimateImageBytes(ImgFeatures& X, ImgLabeling& Y)
+	{
+		size_t bytes = 0;
+		bytes += sizeof(double)*X.graph.nodesData.size();
+		bytes += sizeof(double)*X.nodeLocations.size();
+		bytes += sizeof(int)*X.segments.size();
+		bytes += X.graph.adjacency->getMemoryBytes();
+		bytes += sizeof(double)*X.edgeDivergences.size();
+		bytes += sizeof(int)*Y.graph.nodesData.size();
+		bytes += sizeof(double)*Y.nodeWeights.size();
+		return bytes;
+	}
+
+	void Dataset::readTextImage(string filename, ImgFeatures& X, ImgLabeling& Y, bool withSegments)
+	{
+		// read meta file
+		string metaFile = Global::settings->paths->INPUT_META_DIR + filename + ".txt";
+		int numNodes, numFeatures, height, width;
+		readMetaFile(metaFile, numNodes, numFeatures, height, width);
+
+		// read nodes file
+		string nodesFile = Global::settings->paths->INPUT_NODES_DIR + filename + ".txt";
+		VectorXi labels = VectorXi::Zero(numNodes);
+		MatrixXd features = MatrixXd::Zero(numNodes, numFeatures);
+		readNodesFile(nodesFile, labels, features);
+
+		// read node locations
+		string nodeLocationsFile = Global::settings->paths->INPUT_NODE_LOCATIONS_DIR + filename + ".txt";
+		MatrixXd nodeLocations = MatrixXd::Zero(numNodes, 2);
+		VectorXd nodeWeights = VectorXd::Zero(numNodes);
+		readNodeLocationsFile(nodeLocationsFile, nodeLocations, nodeWeights);
+
+		// read edges file
+		string edgesFile = Global::settings->paths->INPUT_EDGES_DIR + filename + ".txt";
+		AdjList_t edges;
+		map< MyPrimitives::Pair<int, int>, double > edgeWeights;
+		readEdgesFile(edgesFile, edges, edgeWeights);
+
+		// read segments file
+		MatrixXi segments;
+		if (withSegments)
+		{
+			string segmentsFile = Global::settings->paths->INPUT_SEGMENTS_DIR + filename + ".txt";
+			segments = MatrixXi::Zero(height, width);
 			readSegmentsFile(segmentsFile, segments);
+		}
 
-			// construct ImgFeatures
-			FeatureGraph featureGraph;
-			featureGraph.adjList = edges;
-			featureGraph.nodesData = features;
-			ImgFeatures* X = new ImgFeatures();
-			X->graph = featureGraph;
-			X->filename = filename;
-			X->segmentsAvailable = true;
-			X->segments = segments;
-			X->nodeLocationsAvailable = true;
-			X->nodeLocations = nodeLocations;
-			X->edgeWeightsAvailable = Global::settings->USE_EDGE_WEIGHTS;
-			X->edgeWeights = edgeWeights;
-
-			// construct ImgLabeling
-			LabelGraph labelGraph;
-			labelGraph.adjList = edges;
-			labelGraph.nodesData = labels;
-			ImgLabeling* Y = new ImgLabeling();
-			Y->graph = labelGraph;
-			Y->nodeWeightsAvailable = true;
-			Y->nodeWeights = nodeWeights;
-			
-			// push into list
-			XSet.push_back(X);
-			YSet.push_back(Y);
+		// CSR adjacency with edge weights
+		CompressedAdjacency adjacency = CompressedAdjacency(edges, numNodes);
+		int numUnknownEdges = 0;
+		for (map< MyPrimitives::Pair<int, int>, double >::iterator it = edgeWeights.begin(); it != edgeWeights.end(); ++it)
+		{
+			// weights of pairs that are not edges of the graph are ignored
+			int edgeIndex = adjacency.getEdgeIndex(it->first.first, it->first.second);
+			if (edgeIndex < 0)
+			{
+				numUnknownEdges++;
+				continue;
+			}
+
+			adjacency.setEdgeWeight(edgeIndex, it->second);
 		}
+		if (numUnknownEdges > 0)
+		{
+			LOG(WARNING) << "skipped " << numUnknownEdges << " edge weights of node pairs that are not edges: " << edgesFile;
+		}
+
+		// construct ImgFeatures
+		FeatureGraph featureGraph;
+		featureGraph.adjacency = adjacency;
+		featureGraph.nodesData = features;
+		X.graph = featureGraph;
+		X.filename = filename;
+		X.segmentsAvailable = withSegments;
+		X.segments = segments;
+		X.nodeLocationsAvailable = true;
+		X.nodeLocations = nodeLocations;
+		X.edgeWeightsAvailable = Global::settings->USE_EDGE_WEIGHTS;
+		X.computeEdgeDivergences();
+
+		// construct ImgLabeling
+		LabelGraph labelGraph;
+		labelGraph.adjacency = featureGraph.adjacency; // shared with features
+		labelGraph.nodesData = labelsToClassIndices(labels);
+		Y.graph = labelGraph;
+		Y.nodeWeightsAvailable = true;
+		Y.nodeWeights = nodeWeights;
+	}
+
+	/*!
+	 * Header of binary image file.
+	 */
+	struct BinaryImageHeader
+	{
+		char magic[4];
+		int version;
+		int numNodes;
+		int numFeatures;
+		int height;
+		int width;
+		int numEdges;
+		int flags;
+	};
+
+	static const char BINARY_IMAGE_MAGIC[4] = {'H', 'C', 'S', 'B'};
+	static const int BINARY_IMAGE_VERSION = 1;
+
+	// flag for optional section of edge divergences after the segments
+	static const int BINARY_IMAGE_EDGE_DIVERGENCES = 1;
+
+	// size of section rounded up to 8-byte alignment
+	static size_t binarySectionSize(size_t bytes)
+	{
+		return (bytes + 7) & ~static_cast<size_t>(7);
+	}
+
+	// whether a rows x cols section of elements fits in the file (without overflowing)
+	static bool binarySectionFits(int rows, int cols, size_t elementSize, size_t fileSize)
+	{
+		if (rows < 0 || cols < 0)
+			return false;
+		if (rows == 0 || cols == 0)
+			return true;
+		return static_cast<size_t>(rows) <= fileSize / elementSize / static_cast<size_t>(cols);
+	}
+
+	/*!
+	 * Byte offsets of the sections of a binary image file.
+	 */
+	struct BinaryImageLayout
+	{
+		size_t labels;
+		size_t features;
+		size_t locations;
+		size_t weights;
+		size_t offsets;
+		size_t neighbors;
+		size_t edgeWeights;
+		size_t segments;
+		size_t divergences;
+		size_t total;
+	};
+
+	// check header against file size and compute section offsets
+	static BinaryImageLayout binaryImageLayout(const BinaryImageHeader& header, size_t fileSize, string path)
+	{
+		if (memcmp(header.magic, BINARY_IMAGE_MAGIC, 4) != 0 || header.version != BINARY_IMAGE_VERSION)
+		{
+			LOG(ERROR) << "invalid binary image file (wrong magic or version): " << path;
+			abort();
+		}
+
+		const int numNodes = header.numNodes;
+		const int numFeatures = header.numFeatures;
+		const int numEdges = header.numEdges;
+		const int height = header.height;
+		const int width = header.width;
+
+		// check counts against file size before computing offsets or allocating
+		if (!binarySectionFits(numNodes, 1, sizeof(int), fileSize) 
+			|| !binarySectionFits(numNodes, numFeatures, sizeof(double), fileSize) 
+			|| !binarySectionFits(numEdges, 1, sizeof(int), fileSize) 
+			|| !binarySectionFits(height, width, sizeof(int), fileSize))
+		{
+			LOG(ERROR) << "invalid binary image file (header counts do not fit file size: " 
+				<< numNodes << " nodes, " << numFeatures << " features, " << numEdges << " edges, " 
+				<< height << "x" << width << " segments): " << path;
+			abort();
+		}
+
+		// section offsets
+		BinaryImageLayout layout;
+		layout.labels = binarySectionSize(sizeof(BinaryImageHeader));
+		layout.features = layout.labels + binarySectionSize(sizeof(int)*numNodes);
+		layout.locations = layout.features + binarySectionSize(sizeof(double)*numNodes*numFeatures);
+		layout.weights = layout.locations + binarySectionSize(sizeof(double)*numNodes*2);
+		layout.offsets = layout.weights + binarySectionSize(sizeof(double)*numNodes);
+		layout.neighbors = layout.offsets + binarySectionSize(sizeof(int)*(numNodes+1));
+		layout.edgeWeights = layout.neighbors + binarySectionSize(sizeof(int)*numEdges);
+		layout.segments = layout.edgeWeights + binarySectionSize(sizeof(double)*numEdges);
+		layout.divergences = layout.segments + binarySectionSize(sizeof(int)*height*width);
+		const bool hasDivergences = (header.flags & BINARY_IMAGE_EDGE_DIVERGENCES) != 0;
+		layout.total = layout.divergences + (hasDivergences ? binarySectionSize(sizeof(double)*numEdges) : 0);
+
+		if (fileSize < layout.total)
+		{
+			LOG(ERROR) << "binary image file is truncated: " << path;
+			abort();
+		}
+
+		return layout;
+	}
+
+	void Dataset::readBinaryImage(string path, string filename, ImgFeatures& X, ImgLabeling& Y, bool withSegments)
+	{
+		// kept mapped while the features view it
+		shared_ptr<MyFileSystem::MappedFile> file(new MyFileSystem::MappedFile(path));
+		if (!file->isOpen() || file->size() < sizeof(BinaryImageHeader))
+		{
+			LOG(ERROR) << "cannot open binary image file: " << path;
+			abort();
+		}
+
+		const char* ptr = file->data();
+		BinaryImageHeader header;
+		memcpy(&header, ptr, sizeof(BinaryImageHeader));
+		BinaryImageLayout layout = binaryImageLayout(header, file->size(), path);
+
+		const int numNodes = header.numNodes;
+		const int numFeatures = header.numFeatures;
+		const int numEdges = header.numEdges;
+		const int height = header.height;
+		const int width = header.width;
+		const bool hasDivergences = (header.flags & BINARY_IMAGE_EDGE_DIVERGENCES) != 0;
+
+		// views into mapped file
+		Map<const VectorXi> labels(reinterpret_cast<const int*>(ptr + layout.labels), numNodes);
+		Map<const MatrixXd> nodeLocations(reinterpret_cast<const double*>(ptr + layout.locations), numNodes, 2);
+		Map<const VectorXd> nodeWeights(reinterpret_cast<const double*>(ptr + layout.weights), numNodes);
+		const int* offsets = reinterpret_cast<const int*>(ptr + layout.offsets);
+		const int* neighbors = reinterpret_cast<const int*>(ptr + layout.neighbors);
+		const double* edgeWeightValues = reinterpret_cast<const double*>(ptr + layout.edgeWeights);
+		Map<const MatrixXi> segments(reinterpret_cast<const int*>(ptr + layout.segments), height, width);
+
+		// CSR offsets must stay within the neighbors section
+		bool offsetsValid = offsets[0] == 0 && offsets[numNodes] == numEdges;
+		for (int node1 = 0; node1 < numNodes && offsetsValid; node1++)
+			offsetsValid = offsets[node1] <= offsets[node1+1];
+		if (!offsetsValid)
+		{
+			LOG(ERROR) << "invalid binary image file (corrupt adjacency offsets): " << path;
+			abort();
+		}
+
+		// neighbors must be nodes of the image
+		bool neighborsValid = true;
+		for (int edgeIndex = 0; edgeIndex < numEdges && neighborsValid; edgeIndex++)
+			neighborsValid = neighbors[edgeIndex] >= 0 && neighbors[edgeIndex] < numNodes;
+		if (!neighborsValid)
+		{
+			LOG(ERROR) << "invalid binary image file (neighbor index out of range): " << path;
+			abort();
+		}
+
+		// construct ImgFeatures
+		X.graph = FeatureGraph();
+		X.graph.adjacency = CompressedAdjacency(numNodes, offsets, neighbors, edgeWeightValues);
+		X.graph.nodesData.view(file, reinterpret_cast<const double*>(ptr + layout.features), numNodes, numFeatures);
+		X.filename = filename;
+		X.segmentsAvailable = withSegments;
+		if (withSegments)
+			X.segments = segments;
+		X.nodeLocationsAvailable = true;
+		X.nodeLocations = nodeLocations;
+		X.edgeWeightsAvailable = Global::settings->USE_EDGE_WEIGHTS;
+		if (hasDivergences)
+		{
+			X.edgeDivergences = Map<const VectorXd>(reinterpret_cast<const double*>(ptr + layout.divergences), numEdges);
+			X.edgeDivergencesAvailable = true;
+		}
+		else
+			X.computeEdgeDivergences();
+
+		// construct ImgLabeling
+		Y.graph = LabelGraph();
+		Y.graph.adjacency = X.graph.adjacency; // shared with features
+		Y.graph.nodesData = labelsToClassIndices(labels);
+		Y.nodeWeightsAvailable = true;
+		Y.nodeWeights = nodeWeights;
+	}
+
+	void Dataset::readBinarySegments(string path, MatrixXi& segments)
+	{
+		ifstream fh(path.c_str(), ios::in | ios::binary);
+		if (!fh.is_open())
+		{
+			LOG(ERROR) << "cannot open binary image file: " << path;
+			abort();
+		}
+
+		fh.seekg(0, ios::end);
+		const size_t fileSize = static_cast<size_t>(fh.tellg());
+		fh.seekg(0, ios::beg);
+
+		BinaryImageHeader header;
+		fh.read(reinterpret_cast<char*>(&header), sizeof(BinaryImageHeader));
+		if (!fh.good())
+		{
+			LOG(ERROR) << "cannot open binary image file: " << path;
+			abort();
+		}
+		BinaryImageLayout layout = binaryImageLayout(header, fileSize, path);
+
+		// only the segments section is read
+		segments = MatrixXi(header.height, header.width);
+		fh.seekg(layout.segments, ios::beg);
+		fh.read(reinterpret_cast<char*>(segments.data()), sizeof(int)*segments.size());
+		if (!fh.good())
+		{
+			LOG(ERROR) << "cannot read segments from binary image file: " << path;
+			abort();
+		}
+	}
+
+	void Dataset::writeBinaryImage(string path, ImgFeatures& X, ImgLabeling& Y)
+	{
+		const int numNodes = X.getNumNodes();
+		const int numFeatures = X.getFeatureDim();
+
+		// CSR adjacency
+		const CompressedAdjacency& adjacency = *X.graph.adjacency;
+		vector<int> offsets(numNodes+1, 0);
+		vector<int> neighbors;
+		vector<double> edgeWeightValues;
+		for (int node1 = 0; node1 < numNodes; node1++)
+		{
+			offsets[node1] = neighbors.size();
+			for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node1); 
+				it != adjacency.neighborsEnd(node1); ++it)
+			{
+				neighbors.push_back(*it);
+				edgeWeightValues.push_back(adjacency.getEdgeWeight(adjacency.getEdgeIndex(it)));
+			}
+		}
+		offsets[numNodes] = neighbors.size();
+		const int numEdges = neighbors.size();
+
+		if (adjacency.getNumNodes() > numNodes)
+		{
+			LOG(WARNING) << "edges with node indices exceeding number of nodes are not written: " << path;
+		}
+
+		BinaryImageHeader header;
+		memcpy(header.magic, BINARY_IMAGE_MAGIC, 4);
+		header.version = BINARY_IMAGE_VERSION;
+		header.numNodes = numNodes;
+		header.numFeatures = numFeatures;
+		header.height = X.segments.rows();
+		header.width = X.segments.cols();
+		header.numEdges = numEdges;
+		header.flags = 0;
+
+		// divergences are only written if they match the edges written
+		const bool hasDivergences = X.edgeDivergencesAvailable && X.edgeDivergences.size() == numEdges;
+		if (hasDivergences)
+			header.flags |= BINARY_IMAGE_EDGE_DIVERGENCES;
+
+		VectorXi labels = classIndicesToLabels(Y.graph.nodesData);
+		MatrixXd nodeLocations = X.nodeLocationsAvailable ? X.nodeLocations : MatrixXd(MatrixXd::Zero(numNodes, 2));
+		VectorXd nodeWeights = Y.nodeWeightsAvailable ? Y.nodeWeights : VectorXd(VectorXd::Zero(numNodes));
+
+		ofstream fh(path.c_str(), ios::out | ios::binary);
+		if (!fh.is_open())
+		{
+			LOG(ERROR) << "cannot open binary image file for writing: " << path;
+			abort();
+		}
+
+		const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+		const char* sections[] = {
+			reinterpret_cast<const char*>(&header), 
+			reinterpret_cast<const char*>(labels.data()), 
+			reinterpret_cast<const char*>(X.graph.nodesData.data()), 
+			reinterpret_cast<const char*>(nodeLocations.data()), 
+			reinterpret_cast<const char*>(nodeWeights.data()), 
+			reinterpret_cast<const char*>(&offsets[0]), 
+			numEdges > 0 ? reinterpret_cast<const char*>(&neighbors[0]) : padding, 
+			numEdges > 0 ? reinterpret_cast<const char*>(&edgeWeightValues[0]) : padding, 
+			reinterpret_cast<const char*>(X.segments.data()), 
+			hasDivergences && numEdges > 0 ? reinterpret_cast<const char*>(X.edgeDivergences.data()) : padding
+		};
+		const size_t sectionBytes[] = {
+			sizeof(BinaryImageHeader), 
+			sizeof(int)*numNodes, 
+			sizeof(double)*numNodes*numFeatures, 
+			sizeof(double)*numNodes*2, 
+			sizeof(double)*numNodes, 
+			sizeof(int)*(numNodes+1), 
+			sizeof(int)*numEdges, 
+			sizeof(double)*numEdges, 
+			sizeof(int)*header.height*header.width, 
+			hasDivergences ? sizeof(double)*numEdges : 0
+		};
+
+		for (int i = 0; i < 10; i++)
+		{
+			fh.write(sections[i], sectionBytes[i]);
+			fh.write(padding, binarySectionSize(sectionBytes[i]) - sectionBytes[i]);
+		}
+		fh.close();
 	}
 
 	vector<string> Dataset::readSplitsFile(string filename)
@@ -648,9 +1279,9 @@ namespace HCSearch
 			model->load(fileName);
 			return model;
 		}
-		else if (rankerType == VW_RANK)
+		else if (rankerType == ONLINE_RANK)
 		{
-			VWRankModel* model = new VWRankModel();
+			OnlineRankModel* model = new OnlineRankModel();
 			model->load(fileName);
 			return model;
 		}
@@ -752,6 +1383,11 @@ namespace HCSearch
 			VWRankModel* modelCast = dynamic_cast<VWRankModel*>(model);
 			modelCast->save(fileName);
 		}
+		else if (rankerType == ONLINE_RANK)
+		{
+			OnlineRankModel* modelCast = dynamic_cast<OnlineRankModel*>(model);
+			modelCast->save(fileName);
+		}
 		else
 		{
 			LOG(ERROR) << "ranker type is invalid for saving model";
@@ -793,11 +1429,11 @@ namespace HCSearch
 		IRankModel* learningModel = Training::initializeLearning(rankerType, LEARN_H);
 
 		// Learn on each training example
-		int start, end;
-		HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTrain.size(), 
-			HCSearch::Global::settings->NUM_PROCESSES, start, end);
-		for (int i = start; i < end; i++)
+		// (VW trains after every image, so images must run one at a time)
+		Dataset::scheduleImages(XTrain, rankerType != VW_RANK, [&](int i)
 		{
+			Dataset::acquireImage(XTrain[i], YTrain[i]);
+
 			for (int iter = 0; iter < numIter; iter++)
 			{
 				LOG() << "Heuristic learning: (iter " << iter << ") beginning search on " << XTrain[i]->getFileName() << " (example " << i << ")..." << endl;
@@ -817,7 +1453,9 @@ namespace HCSearch
 				if (rankerType == VW_RANK)
 					Training::finishLearning(learningModel, LEARN_H);
 			}
-		}
+
+			Dataset::releaseImage(XTrain[i]);
+		});
 		
 		// Merge and learn step
 		if (rankerType != VW_RANK)
@@ -841,11 +1479,10 @@ namespace HCSearch
 		IRankModel* learningModel = Training::initializeLearning(rankerType, LEARN_C);
 
 		// Learn on each training example
-		int start, end;
-		HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTrain.size(), 
-			HCSearch::Global::settings->NUM_PROCESSES, start, end);
-		for (int i = start; i < end; i++)
+		Dataset::scheduleImages(XTrain, rankerType != VW_RANK, [&](int i)
 		{
+			Dataset::acquireImage(XTrain[i], YTrain[i]);
+
 			for (int iter = 0; iter < numIter; iter++)
 			{
 				LOG() << "Cost learning: (iter " << iter << ") beginning search on " << XTrain[i]->getFileName() << " (example " << i << ")..." << endl;
@@ -865,7 +1502,9 @@ namespace HCSearch
 				if (rankerType == VW_RANK)
 					Training::finishLearning(learningModel, LEARN_C);
 			}
-		}
+
+			Dataset::releaseImage(XTrain[i]);
+		});
 		
 		// Merge and learn step
 		if (rankerType != VW_RANK)
@@ -889,11 +1528,10 @@ namespace HCSearch
 		IRankModel* learningModel = Training::initializeLearning(rankerType, LEARN_C_ORACLE_H);
 
 		// Learn on each training example
-		int start, end;
-		HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTrain.size(), 
-			HCSearch::Global::settings->NUM_PROCESSES, start, end);
-		for (int i = start; i < end; i++)
+		Dataset::scheduleImages(XTrain, rankerType != VW_RANK, [&](int i)
 		{
+			Dataset::acquireImage(XTrain[i], YTrain[i]);
+
 			for (int iter = 0; iter < numIter; iter++)
 			{
 				LOG() << "Cost with oracle H learning: (iter " << iter << ") beginning search on " << XTrain[i]->getFileName() << " (example " << i << ")..." << endl;
@@ -913,7 +1551,9 @@ namespace HCSearch
 				if (rankerType == VW_RANK)
 					Training::finishLearning(learningModel, LEARN_C_ORACLE_H);
 			}
-		}
+
+			Dataset::releaseImage(XTrain[i]);
+		});
 		
 		// Merge and learn step
 		if (rankerType != VW_RANK)
@@ -937,11 +1577,10 @@ namespace HCSearch
 		IRankModel* learningModel = Training::initializeLearning(rankerType, LEARN_PRUNE);
 
 		// Learn on each training example
-		int start, end;
-		HCSearch::Dataset::computeTaskRange(HCSearch::Global::settings->RANK, XTrain.size(), 
-			HCSearch::Global::settings->NUM_PROCESSES, start, end);
-		for (int i = start; i < end; i++)
+		Dataset::scheduleImages(XTrain, rankerType != VW_RANK, [&](int i)
 		{
+			Dataset::acquireImage(XTrain[i], YTrain[i]);
+
 			for (int iter = 0; iter < numIter; iter++)
 			{
 				LOG() << "Prune learning: (iter " << iter << ") beginning search on " << XTrain[i]->getFileName() << " (example " << i << ")..." << endl;
@@ -961,7 +1600,9 @@ namespace HCSearch
 				if (rankerType == VW_RANK)
 					Training::finishLearning(learningModel, LEARN_PRUNE);
 			}
-		}
+
+			Dataset::releaseImage(XTrain[i]);
+		});
 		
 		// Merge and learn step
 		if (rankerType != VW_RANK)
@@ -987,6 +1628,8 @@ namespace HCSearch
 			HCSearch::Global::settings->NUM_PROCESSES, start, end);
 		for (int i = start; i < end; i++)
 		{
+			Dataset::acquireImage(XTrain[i], YTrain[i]);
+
 			LOG() << "Pairwise class constraint: processing on " << XTrain[i]->getFileName() << " (example " << i << ")..." << endl;
 
 			// do stuff
@@ -998,12 +1641,13 @@ namespace HCSearch
 			{
 				for (int node2 = 0; node2 < numNodes; node2++)
 				{
-					int node1Class = Y->getLabel(node1);
-					int node2Class = Y->getLabel(node2);
-
-					if (node1 == node2 || node1Class == node2Class)
+					if (node1 == node2 || Y->getLabel(node1) == Y->getLabel(node2))
 						continue;
 
+					// constraints are stored with class labels
+					int node1Class = Global::settings->CLASSES.getClassLabel(Y->getLabel(node1));
+					int node2Class = Global::settings->CLASSES.getClassLabel(Y->getLabel(node2));
+
 					double node1XCoord = X->getNodeLocationX(node1);
 					double node1YCoord = X->getNodeLocationY(node1);
 					double node2XCoord = X->getNodeLocationX(node2);
@@ -1056,6 +1700,8 @@ namespace HCSearch
 					}
 				}
 			}
+
+			Dataset::releaseImage(XTrain[i]);
 		}
 		
 		clock_t toc = clock();
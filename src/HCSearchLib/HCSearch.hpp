@@ -2,6 +2,8 @@
 #define HCSEARCH_HPP
 
 #include <vector>
+#include <list>
+#include <functional>
 
 #include "Settings.hpp"
 #include "MyLogger.hpp"
@@ -560,9 +562,161 @@ namespace HCSearch
 		 */
 		static void computeTaskRange(int rank, int numTasks, int numProcesses, int& start, int& end);
 
+		/*!
+		 * Run a task on each image index in a task range. 
+		 * If Settings::PARALLEL_IMAGES is set, worker threads take the next image 
+		 * as soon as they are done with one; otherwise images run in order on the calling thread.
+		 * @param[in] start starting range
+		 * @param[in] end ending range (exclusive)
+		 * @param[in] allowThreads False if the task cannot run on more than one image at a time
+		 * @param[in] task Task to run on an image index
+		 */
+		static void forEachImage(int start, int end, bool allowThreads, const function<void(int)>& task);
+
+		/*!
+		 * Run a task on the images of a set that belong to this process. 
+		 * With Settings::DYNAMIC_SCHEDULING and more than one process, 
+		 * rank 0 hands out image indices (largest images first) to ranks that are free; 
+		 * otherwise each rank takes its range from computeTaskRange and runs it with forEachImage.
+		 * Must be called by all processes.
+		 * @param[in] XSet Structured features of the image set
+		 * @param[in] allowThreads False if the task cannot run on more than one image at a time
+		 * @param[in] task Task to run on an image index
+		 */
+		static void scheduleImages(vector< ImgFeatures* >& XSet, bool allowThreads, const function<void(int)>& task);
+
+		/*!
+		 * Convert the text files of every image in the splits to the binary format. 
+		 * Binary files are written to the binary folder of the dataset 
+		 * and are preferred over the text files when loading. 
+		 * The KL divergences of the edges are precomputed and stored with them.
+		 * Must call Utility::configure() first to set up dataset path.
+		 */
+		static void convertDataset();
+
+		/*!
+		 * Make sure the image data is loaded before use. 
+		 * Only needed if images are loaded lazily (Settings::DATASET_CACHE_MB is positive), 
+		 * otherwise does nothing. May evict the least recently used images.
+		 * The image is kept in memory until releaseImage is called.
+		 * @param[in] X Structured features from loadDataset
+		 * @param[in] Y Groundtruth labeling from loadDataset
+		 */
+		static void acquireImage(ImgFeatures* X, ImgLabeling* Y);
+
+		/*!
+		 * Allow an image from acquireImage to be evicted again.
+		 * @param[in] X Structured features from loadDataset
+		 */
+		static void releaseImage(ImgFeatures* X);
+
+		/*!
+		 * Read the binary file of an image.
+		 * 
+		 * The file is memory-mapped and read without parsing. The node features stay 
+		 * a view of the mapping; the other sections are copied out of Eigen::Map views. 
+		 * Header counts, adjacency offsets and neighbor indices are checked first.
+		 * @param[in] path Path to binary file
+		 * @param[in] filename Image file name
+		 * @param[out] X Structured features of the image
+		 * @param[out] Y Groundtruth labeling of the image
+		 * @param[in] withSegments Whether to load the segments
+		 */
+		static void readBinaryImage(string path, string filename, ImgFeatures& X, ImgLabeling& Y, bool withSegments);
+
+		/*!
+		 * Write the binary file of an image.
+		 * 
+		 * File format (native byte order, sections aligned to 8 bytes):
+		 *     header: magic "HCSB", version, nodes, features, height, width, edges, flags (int32 each)
+		 *     labels (int32, nodes)
+		 *     features (double, nodes x features, column-major)
+		 *     node locations (double, nodes x 2, column-major)
+		 *     node weights (double, nodes)
+		 *     CSR adjacency offsets (int32, nodes+1) and neighbors (int32, edges)
+		 *     edge weights (double, edges)
+		 *     segments (int32, height x width, column-major)
+		 *     edge divergences (double, edges) if available; flagged in header
+		 * @param[in] path Path to binary file
+		 * @param[in] X Structured features of the image
+		 * @param[in] Y Groundtruth labeling of the image
+		 */
+		static void writeBinaryImage(string path, ImgFeatures& X, ImgLabeling& Y);
+
+		/*!
+		 * Make sure the segments of the image are loaded. 
+		 * Segments are only needed for label masks, so lazily loaded images skip them.
+		 * @param[in] X Structured features from loadDataset
+		 */
+		static void acquireSegments(ImgFeatures* X);
+
 	private:
+		/*!
+		 * @brief Entry of a lazily loaded image.
+		 */
+		struct CacheEntry
+		{
+			ImgLabeling* Y;
+			bool loaded;
+			int pins;
+			size_t bytes;
+			list< ImgFeatures* >::iterator position;
+		};
+
+		static map< ImgFeatures*, CacheEntry > cacheEntries; //!< Lazily loaded images
+		static list< ImgFeatures* > cacheOrder; //!< Loaded images, most recently used first
+		static size_t cacheUsage; //!< Estimated bytes of loaded images
+		static std::mutex cacheLock; //!< Guards the cache when images run on threads
+
 		static void loadDatasetHelper(vector<string>& files, vector< ImgFeatures* >& XSet, vector< ImgLabeling* >& YSet);
 
+		/*!
+		 * Load data of an image (binary file if converted, otherwise text files).
+		 */
+		static void readImage(string filename, ImgFeatures& X, ImgLabeling& Y, bool withSegments);
+
+		/*!
+		 * Evict least recently used images that are not in use until within the memory budget. 
+		 * Caller must hold cacheLock.
+		 */
+		static void evictImages();
+
+		/*!
+		 * Estimate the memory used by the data of an image.
+		 */
+		static size_t estimateImageBytes(ImgFeatures& X, ImgLabeling& Y);
+
+		/*!
+		 * Number of nodes of an image, read from the meta file if it is not loaded.
+		 */
+		static int countImageNodes(ImgFeatures* X);
+
+		/*!
+		 * Translate class labels read from a file to the class indices held by labelings.
+		 */
+		static VectorXi labelsToClassIndices(const VectorXi& labels);
+
+		/*!
+		 * Translate class indices held by labelings back to class labels for writing.
+		 */
+		static VectorXi classIndicesToLabels(const VectorXi& classIndices);
+
+		/*!
+		 * Read the text files (meta, nodes, node locations, edges, segments) of an image.
+		 * @param[in] filename Image file name
+		 * @param[out] X Structured features of the image
+		 * @param[out] Y Groundtruth labeling of the image
+		 * @param[in] withSegments Whether to load the segments
+		 */
+		static void readTextImage(string filename, ImgFeatures& X, ImgLabeling& Y, bool withSegments);
+
+		/*!
+		 * Read only the segments section of the binary file of an image.
+		 * @param[in] path Path to binary file
+		 * @param[out] segments Segments matrix of the image
+		 */
+		static void readBinarySegments(string path, MatrixXi& segments);
+
 		/*!
 		 * Read split file (Train.txt, Validation.txt, Test.txt).
 		 * @param[in] filename Path to split file
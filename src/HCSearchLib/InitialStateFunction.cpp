@@ -23,6 +23,8 @@ namespace HCSearch
 #ifdef USE_MPI
 		MPI::Synchronize::slavesWait("INITPREDEND");
 #endif
+
+		loadClassifier();
 	}
 
 	LogRegInit::~LogRegInit()
@@ -33,33 +35,23 @@ namespace HCSearch
 	{
 		string initStatePath = Global::settings->paths->INPUT_INITIAL_STATES_DIR + X.getFileName() + ".txt";
 
-		// if initial states file doesn't exist, generate prediction in temp folder
-		if (!MyFileSystem::FileSystem::checkFileExists(initStatePath))
-		{
-			LOG() << "Setting up initial state..." << endl;
-
-			// output features
-			imgfeatures2liblinear(X, Global::settings->paths->OUTPUT_INITFUNC_FEATURES_FILE);
-		
-			// perform IID SVM prediction on patches
-			stringstream ssPredictInitFuncCmd;
-			ssPredictInitFuncCmd << Global::settings->cmds->LIBLINEAR_PREDICT_CMD << " -b 1 " 
-				<< Global::settings->paths->OUTPUT_INITFUNC_FEATURES_FILE << " " + Global::settings->paths->OUTPUT_INITFUNC_MODEL_FILE 
-				<< " " << Global::settings->paths->OUTPUT_INITFUNC_PREDICT_FILE;
-
-			int retcode = MyFileSystem::Executable::executeRetriesFatal(ssPredictInitFuncCmd.str());
-
-			initStatePath = Global::settings->paths->OUTPUT_INITFUNC_PREDICT_FILE;
-		}
-
 		ImgLabeling Y = ImgLabeling();
 		Y.graph = LabelGraph();
-		Y.graph.adjList = X.graph.adjList;
-		Y.graph.nodesData = VectorXi::Ones(X.getNumNodes());
+		Y.graph.adjacency = X.graph.adjacency;
+		Y.graph.nodesData = VectorXi::Zero(X.getNumNodes());
 
 		// now need to get labels data and confidences...
-		// read in initial prediction
-		liblinear2imglabeling(Y, initStatePath);
+		if (MyFileSystem::FileSystem::checkFileExists(initStatePath))
+		{
+			// read in initial prediction
+			liblinear2imglabeling(Y, initStatePath);
+		}
+		else
+		{
+			// if initial states file doesn't exist, perform IID prediction on patches
+			LOG() << "Setting up initial state..." << endl;
+			predictClassifier(X, Y);
+		}
 
 		// eliminate 1-islands
 		eliminateIslands(Y);
@@ -75,13 +67,13 @@ namespace HCSearch
 		const int numNodes = Y.getNumNodes();
 		for (int node = 0; node < numNodes; node++)
 		{
-			if (!Global::settings->CLASSES.classLabelIsBackground(Y.getLabel(node)) && !hasForegroundNeighbors(Y, node))
+			if (!Global::settings->CLASSES.classIndexIsBackground(Y.getLabel(node)) && !hasForegroundNeighbors(Y, node))
 			{
-				int label = Y.getLabel(node);
-				double probEstimate = Y.confidences(node, Global::settings->CLASSES.getClassIndex(label));
+				int classIndex = Y.getLabel(node);
+				double probEstimate = Y.confidences->coeff(node, classIndex);
 				if (probEstimate < BINARY_CONFIDENCE_THRESHOLD)
 				{
-					Y.graph.nodesData(node) = Global::settings->CLASSES.getBackgroundLabel();
+					Y.graph.nodesData(node) = Global::settings->CLASSES.getBackgroundClassIndex();
 				}
 			}
 		}
@@ -116,33 +108,134 @@ namespace HCSearch
 		}
 	}
 
-	void LogRegInit::imgfeatures2liblinear(ImgFeatures& X, string filename)
+	void LogRegInit::loadClassifier()
 	{
-		const int numNodes = X.getNumNodes();
-		const int featureDim = X.getFeatureDim();
+		this->modelLoaded = false;
 
-		ofstream fh(filename.c_str());
-		if (fh.is_open())
+		string fileName = Global::settings->paths->OUTPUT_INITFUNC_MODEL_FILE;
+		ifstream fh(fileName.c_str());
+		if (!fh.is_open())
+		{
+			LOG(WARNING) << "initial function model not found; initial states files are required.";
+			return;
+		}
+
+		// parse header of LIBLINEAR model file
+		int numClasses = 0;
+		this->modelNumFeatures = 0;
+		this->modelBias = -1;
+		this->modelLabels.clear();
+
+		string token;
+		while (fh >> token)
 		{
-			for (int node = 0; node < numNodes; node++)
+			if (token.compare("nr_class") == 0)
 			{
-				fh << "1"; // dummy class for prediction
-				for (int feat = 0; feat < featureDim; feat++)
+				fh >> numClasses;
+			}
+			else if (token.compare("label") == 0)
+			{
+				for (int i = 0; i < numClasses; i++)
 				{
-					if (X.getFeature(node, feat) != 0)
-					{
-						fh << " " << feat+1 << ":" << X.getFeature(node, feat);
-					}
+					int label;
+					fh >> label;
+					this->modelLabels.push_back(label);
 				}
-				fh << endl;
 			}
+			else if (token.compare("nr_feature") == 0)
+			{
+				fh >> this->modelNumFeatures;
+			}
+			else if (token.compare("bias") == 0)
+			{
+				fh >> this->modelBias;
+			}
+			else if (token.compare("w") == 0)
+			{
+				break;
+			}
+		}
+
+		if (numClasses != Global::settings->CLASSES.numClasses() || static_cast<int>(this->modelLabels.size()) != numClasses)
+		{
+			LOG(ERROR) << "number of classes found in initial function model is not correct!" << endl
+				<< "\texpected: " << Global::settings->CLASSES.numClasses() << endl
+				<< "\tfound: " << numClasses;
 			fh.close();
+			abort();
 		}
-		else
+
+		// parse weights: one row per feature (and bias), one column per weight vector
+		// binary models only store the weight vector of the first label
+		const int numWeightVectors = numClasses == 2 ? 1 : numClasses;
+		const int numRows = this->modelBias >= 0 ? this->modelNumFeatures+1 : this->modelNumFeatures;
+		this->modelWeights = MatrixXd::Zero(numRows, numWeightVectors);
+		for (int row = 0; row < numRows; row++)
 		{
-			LOG(ERROR) << "cannot open file for writing LIBLINEAR/LIBSVM features!";
+			for (int col = 0; col < numWeightVectors; col++)
+			{
+				fh >> this->modelWeights(row, col);
+			}
+		}
+
+		if (fh.fail())
+		{
+			LOG(ERROR) << "parsing invalid initial function model file!";
+			fh.close();
 			abort();
 		}
+		fh.close();
+
+		this->modelLoaded = true;
+	}
+
+	void LogRegInit::predictClassifier(ImgFeatures& X, ImgLabeling& Y)
+	{
+		if (!this->modelLoaded)
+		{
+			LOG(ERROR) << "initial function model is not loaded!";
+			abort();
+		}
+
+		const int numNodes = X.getNumNodes();
+		const int numClasses = this->modelLabels.size();
+		const int numFeatures = min(X.getFeatureDim(), this->modelNumFeatures);
+
+		// decision values: nodes x weight vectors
+		MatrixXd decisions = X.graph.nodesData.leftCols(numFeatures) * this->modelWeights.topRows(numFeatures);
+		if (this->modelBias >= 0)
+			decisions.rowwise() += this->modelBias * this->modelWeights.row(this->modelNumFeatures);
+
+		Y.confidencesAvailable = true;
+		Y.confidences = MatrixXd::Zero(numNodes, numClasses);
+		MatrixXd& confidences = Y.confidences.edit();
+
+		VectorXd probabilities(numClasses);
+		for (int node = 0; node < numNodes; node++)
+		{
+			// same probability estimates as LIBLINEAR predict -b 1
+			if (numClasses == 2)
+			{
+				probabilities(0) = 1.0/(1.0+exp(-decisions(node, 0)));
+				probabilities(1) = 1.0-probabilities(0);
+			}
+			else
+			{
+				for (int i = 0; i < numClasses; i++)
+					probabilities(i) = 1.0/(1.0+exp(-decisions(node, i)));
+				probabilities /= probabilities.sum();
+			}
+
+			int bestIndex;
+			probabilities.maxCoeff(&bestIndex);
+			Y.graph.nodesData(node) = Global::settings->CLASSES.getClassIndex(this->modelLabels[bestIndex]);
+
+			for (int i = 0; i < numClasses; i++)
+			{
+				int classIndex = Global::settings->CLASSES.getClassIndex(this->modelLabels[i]);
+				confidences(node, classIndex) = probabilities(i);
+			}
+		}
 	}
 
 	void LogRegInit::liblinear2imglabeling(ImgLabeling& Y, string filename)
@@ -221,13 +314,13 @@ namespace HCSearch
 						if (columnIndex == 0)
 						{
 							int nodeIndex = lineIndex-1;
-							Y.graph.nodesData(nodeIndex) = atoi(token.c_str());
+							Y.graph.nodesData(nodeIndex) = Global::settings->CLASSES.getClassIndex(atoi(token.c_str()));
 						}
 						else if (Y.confidencesAvailable)
 						{
 							int nodeIndex = lineIndex-1;
 							int classIndex = Global::settings->CLASSES.getClassIndex(labelOrderFound[columnIndex-1]);
-							Y.confidences(nodeIndex, classIndex) = atof(token.c_str());
+							Y.confidences.edit()(nodeIndex, classIndex) = atof(token.c_str());
 						}
 						columnIndex++;
 					}
@@ -247,16 +340,15 @@ namespace HCSearch
 	bool LogRegInit::hasForegroundNeighbors(ImgLabeling& Y, int node)
 	{
 		int nodeLabel = Y.getLabel(node);
-		NeighborSet_t neighbors = Y.graph.adjList[node];
-
 		bool hasNeighbors = false;
 
-		for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+		for (CompressedAdjacency::NeighborIterator it = Y.graph.adjacency->neighborsBegin(node); 
+			it != Y.graph.adjacency->neighborsEnd(node); ++it)
 		{
 			int neighborNode = *it;
 			int neighborLabel = Y.getLabel(neighborNode);
 			
-			if (!Global::settings->CLASSES.classLabelIsBackground(neighborLabel))
+			if (!Global::settings->CLASSES.classIndexIsBackground(neighborLabel))
 			{
 				hasNeighbors = true;
 				break;
@@ -292,122 +384,32 @@ namespace HCSearch
 			const int numNodes = X.getNumNodes();
 			const int numClasses = Global::settings->CLASSES.numClasses();
 			VectorXi confidenceIndices = VectorXi::Zero(numNodes);
+			ClassLocationExtents extents(X, Y);
 
+			// relabel the first violating node to its next confident label until none are left
 			while (!satisfied)
 			{
 				satisfied = true;
-				for (int node1 = 0; node1 < numNodes && satisfied; node1++)
+				for (int node = 0; node < numNodes && satisfied; node++)
 				{
-					for (int node2 = 0; node2 < numNodes && satisfied; node2++)
-					{
-						if (node1 == node2)
-							continue;
+					if (confidenceIndices(node)+1 >= numClasses)
+						continue;
 
-						// get node features and label
-						VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-						double nodeLocationX1 = X.getNodeLocationX(node1);
-						double nodeLocationY1 = X.getNodeLocationY(node1);
-						int nodeLabel1 = Y.getLabel(node1);
+					double nodeLocationX = X.getNodeLocationX(node);
+					double nodeLocationY = X.getNodeLocationY(node);
+					int classIndex = Y.getLabel(node);
 
-						VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-						double nodeLocationX2 = X.getNodeLocationX(node2);
-						double nodeLocationY2 = X.getNodeLocationY(node2);
-						int nodeLabel2 = Y.getLabel(node2);
+					if (violatesMutex(classIndex, nodeLocationX, nodeLocationY, extents))
+					{
+						LOG(DEBUG) << "not satisfied: " << node;
+						satisfied = false;
 
-						vector<int> node1ConfidentLabels = Y.getLabelsByConfidence(node1);
+						vector<int> confidentLabels = Y.getLabelsByConfidence(node);
+						Y.graph.nodesData(node) = confidentLabels[confidenceIndices(node)+1];
+						confidenceIndices(node) += 1;
 
-						if (nodeLabel1 != nodeLabel2)
-						{
-							if (nodeLocationX1 < nodeLocationX2)
-							{
-								string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "L");
-								if (this->mutex.count(mutexKey) == 0)
-									satisfied = false;
-								else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-									satisfied = false;
-
-								if (!satisfied)
-								{
-									LOG(DEBUG) << "not satisfied: " << node1 << ", " << node2;
-									if (confidenceIndices(node1)+1 >= numClasses)
-									{
-										satisfied = true;
-									}
-									else
-									{
-										Y.graph.nodesData(node1) = node1ConfidentLabels[confidenceIndices(node1)+1];
-										confidenceIndices(node1) += 1;
-									}
-								}
-							}
-							else if (nodeLocationX1 > nodeLocationX2)
-							{
-								string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "R");
-								if (this->mutex.count(mutexKey) == 0)
-									satisfied = false;
-								else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-									satisfied = false;
-
-								if (!satisfied)
-								{
-									LOG(DEBUG) << "not satisfied: " << node1 << ", " << node2;
-									if (confidenceIndices(node1)+1 >= numClasses)
-									{
-										satisfied = true;
-									}
-									else
-									{
-										Y.graph.nodesData(node1) = node1ConfidentLabels[confidenceIndices(node1)+1];
-										confidenceIndices(node1) += 1;
-									}
-								}
-							}
-			
-							if (nodeLocationY1 < nodeLocationY2)
-							{
-								string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "U");
-								if (this->mutex.count(mutexKey) == 0)
-									satisfied = false;
-								else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-									satisfied = false;
-
-								if (!satisfied)
-								{
-									LOG(DEBUG) << "not satisfied: " << node1 << ", " << node2;
-									if (confidenceIndices(node1)+1 >= numClasses)
-									{
-										satisfied = true;
-									}
-									else
-									{
-										Y.graph.nodesData(node1) = node1ConfidentLabels[confidenceIndices(node1)+1];
-										confidenceIndices(node1) += 1;
-									}
-								}
-							}
-							else if (nodeLocationY1 > nodeLocationY2)
-							{
-								string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "D");
-								if (this->mutex.count(mutexKey) == 0)
-									satisfied = false;
-								else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-									satisfied = false;
-
-								if (!satisfied)
-								{
-									LOG(DEBUG) << "not satisfied: " << node1 << ", " << node2;
-									if (confidenceIndices(node1)+1 >= numClasses)
-									{
-										satisfied = true;
-									}
-									else
-									{
-										Y.graph.nodesData(node1) = node1ConfidentLabels[confidenceIndices(node1)+1];
-										confidenceIndices(node1) += 1;
-									}
-								}
-							}
-						}
+						int newClassIndex = Y.getLabel(node);
+						extents.moveNode(nodeLocationX, nodeLocationY, classIndex, newClassIndex);
 					}
 				}
 			}
@@ -419,6 +421,7 @@ namespace HCSearch
 	void MutexLogRegInit::setMutex(map<string, int>& mutex)
 	{
 		this->mutex = mutex;
+		this->mutexTable = MutexTable(mutex);
 		this->initialized = true;
 	}
 
@@ -427,10 +430,24 @@ namespace HCSearch
 		return this->mutex;
 	}
 
-	string MutexLogRegInit::mutexStringHelper(int class1, int class2, string config)
+	bool MutexLogRegInit::violatesMutex(int classIndex, double x, double y, ClassLocationExtents& extents)
 	{
-		stringstream ss;
-		ss << class1 << " " << class2 << " " << config;
-		return ss.str();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+
+		for (int otherClassIndex = 0; otherClassIndex < numClasses; otherClassIndex++)
+		{
+			if (otherClassIndex == classIndex)
+				continue;
+
+			for (int config = MUTEX_LEFT; config <= MUTEX_DOWN; config++)
+			{
+				MutexConfiguration mutexConfig = static_cast<MutexConfiguration>(config);
+				if (extents.hasNodeInConfiguration(otherClassIndex, mutexConfig, x, y)
+					&& this->mutexTable.getCount(classIndex, otherClassIndex, mutexConfig) <= MUTEX_THRESHOLD)
+					return true;
+			}
+		}
+
+		return false;
 	}
 }
\ No newline at end of file
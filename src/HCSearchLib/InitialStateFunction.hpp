@@ -32,6 +32,12 @@ namespace HCSearch
 		static const double DEFAULT_C;
 		static const double BINARY_CONFIDENCE_THRESHOLD;
 
+		MatrixXd modelWeights; //!< Model weights (features (+ bias) x weight vectors)
+		vector<int> modelLabels; //!< Class labels in model order
+		int modelNumFeatures; //!< Number of features in model
+		double modelBias; //!< Model bias term (negative if none)
+		bool modelLoaded; //!< Whether the model is loaded
+
 	public:
 		LogRegInit();
 		~LogRegInit();
@@ -43,8 +49,17 @@ namespace HCSearch
 		 */
 		void trainClassifier();
 
+		/*!
+		 * @brief Load trained logistic regression model into memory.
+		 */
+		void loadClassifier();
+
 	protected:
-		static void imgfeatures2liblinear(ImgFeatures& X, string filename);
+		/*!
+		 * @brief Predict labels and class probabilities of all nodes with the loaded model.
+		 */
+		void predictClassifier(ImgFeatures& X, ImgLabeling& Y);
+
 		static void liblinear2imglabeling(ImgLabeling& Y, string filename);
 		bool hasForegroundNeighbors(ImgLabeling& Y, int node);
 
@@ -60,6 +75,7 @@ namespace HCSearch
 
 	protected:
 		map<string, int> mutex;
+		MutexTable mutexTable;
 		bool initialized;
 
 	public:
@@ -72,7 +88,11 @@ namespace HCSearch
 		map<string, int> getMutex();
 
 	private:
-		string mutexStringHelper(int class1, int class2, string config);
+		/*!
+		 * @brief Returns true if the node's label breaks a mutex constraint 
+		 * with any node of another class.
+		 */
+		bool violatesMutex(int classIndex, double x, double y, ClassLocationExtents& extents);
 	};
 }
 
@@ -5,6 +5,11 @@
 #ifdef USE_MPI
 namespace MPI
 {
+	// message tags for the task scheduler (synchronize messages use tag 0)
+	const int TASK_REQUEST_TAG = 1;
+	const int TASK_ASSIGN_TAG = 2;
+	const int NO_MORE_TASKS = -1;
+
 	void Synchronize::masterWait(string slaveBroadcastMsg)
 	{
 		using namespace HCSearch;
@@ -155,5 +160,63 @@ namespace MPI
 		}
 	}
 
+	void Scheduler::dispatchTasks(const vector<int>& order, const function<void(int)>& task)
+	{
+		using namespace HCSearch;
+
+		const int numProcesses = Global::settings->NUM_PROCESSES;
+		const int rank = Global::settings->RANK;
+		if (rank == 0)
+		{
+			LOG() << "Master process [" << rank << "] is handing out " << order.size() << " tasks..." << endl;
+
+			// answer requests until every slave has been told there is nothing left
+			const int numTasks = order.size();
+			int nextTask = 0;
+			int numSlavesDone = 0;
+			while (numSlavesDone < numProcesses-1)
+			{
+				int request;
+				int ierr = MPI_Recv(&request, 1, MPI_INT, MPI_ANY_SOURCE, TASK_REQUEST_TAG, MPI_COMM_WORLD, Global::settings->MPI_STATUS);
+				int messageSource = (*Global::settings->MPI_STATUS).MPI_SOURCE;
+
+				int assignment = NO_MORE_TASKS;
+				if (nextTask < numTasks)
+				{
+					assignment = order[nextTask];
+					nextTask++;
+					LOG() << "Master is giving task " << assignment << " to process [" << messageSource << "] (" 
+						<< nextTask << "/" << numTasks << ")." << endl;
+				}
+				else
+				{
+					numSlavesDone++;
+				}
+
+				ierr = MPI_Send(&assignment, 1, MPI_INT, messageSource, TASK_ASSIGN_TAG, MPI_COMM_WORLD);
+			}
+
+			LOG() << "Master process [" << rank << "] has handed out all tasks." << endl;
+		}
+		else
+		{
+			while (true)
+			{
+				// ask master for the next task
+				int request = rank;
+				int ierr = MPI_Send(&request, 1, MPI_INT, 0, TASK_REQUEST_TAG, MPI_COMM_WORLD);
+
+				int assignment;
+				ierr = MPI_Recv(&assignment, 1, MPI_INT, 0, TASK_ASSIGN_TAG, MPI_COMM_WORLD, Global::settings->MPI_STATUS);
+				if (assignment == NO_MORE_TASKS)
+					break;
+
+				task(assignment);
+			}
+
+			LOG() << "Slave process [" << rank << "] has no tasks left." << endl;
+		}
+	}
+
 }
 #endif
\ No newline at end of file
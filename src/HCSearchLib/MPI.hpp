@@ -2,6 +2,8 @@
 #define MPI_HPP
 
 #include <string>
+#include <vector>
+#include <functional>
 
 using namespace std;
 
@@ -17,6 +19,14 @@ namespace MPI
 		// all slaves need to wait for master to get to this point
 		static void slavesWait(string masterBroadcastMsg);
 	};
+
+	class Scheduler
+	{
+	public:
+		// master hands out tasks in the given order to slaves that ask for one;
+		// slaves run the task on each index they get until there are none left
+		static void dispatchTasks(const vector<int>& order, const function<void(int)>& task);
+	};
 }
 #endif
 
@@ -1,6 +1,10 @@
 #ifndef USE_WINDOWS
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
+#include <fstream>
 #include "MyFileSystem.hpp"
 #include "Globals.hpp"
 
@@ -71,6 +75,67 @@ namespace MyFileSystem
 		}
 	}
 
+	/**************** Mapped File ****************/
+
+	MappedFile::MappedFile(string path)
+	{
+		this->fileData = NULL;
+		this->fileSize = 0;
+
+#ifndef USE_WINDOWS
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+		{
+			void* mapped = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped != MAP_FAILED)
+			{
+				this->fileData = static_cast<const char*>(mapped);
+				this->fileSize = fileStat.st_size;
+			}
+		}
+		close(fd);
+#else
+		ifstream fh(path.c_str(), ios::in | ios::binary | ios::ate);
+		if (!fh.is_open())
+			return;
+
+		this->fileSize = static_cast<size_t>(fh.tellg());
+		this->buffer.resize(this->fileSize);
+		fh.seekg(0, ios::beg);
+		if (this->fileSize > 0)
+			fh.read(&this->buffer[0], this->fileSize);
+		fh.close();
+		this->fileData = this->fileSize > 0 ? &this->buffer[0] : NULL;
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+#ifndef USE_WINDOWS
+		if (this->fileData != NULL)
+			munmap(const_cast<char*>(this->fileData), this->fileSize);
+#endif
+	}
+
+	bool MappedFile::isOpen()
+	{
+		return this->fileData != NULL;
+	}
+
+	const char* MappedFile::data()
+	{
+		return this->fileData;
+	}
+
+	size_t MappedFile::size()
+	{
+		return this->fileSize;
+	}
+
 	/**************** Executable ****************/
 
 	const int Executable::DEFAULT_NUM_RETRIES = 3;
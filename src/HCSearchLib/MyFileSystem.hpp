@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 #include <cstdlib>
+#include <vector>
 using namespace std;
 
 namespace MyFileSystem
@@ -35,6 +36,37 @@ namespace MyFileSystem
 		static bool checkFileExists(string path);
 	};
 
+	/**************** Mapped File ****************/
+
+	// Read-only view of a whole file
+	// Memory-mapped when supported, otherwise read into memory
+	class MappedFile
+	{
+	private:
+		const char* fileData;
+		size_t fileSize;
+		vector<char> buffer;
+
+	public:
+		// Open and map file at path
+		MappedFile(string path);
+		~MappedFile();
+
+		// Check if file was opened
+		bool isOpen();
+
+		// Pointer to start of file contents
+		const char* data();
+
+		// Size of file in bytes
+		size_t size();
+
+	private:
+		// Not copyable
+		MappedFile(const MappedFile& other);
+		MappedFile& operator=(const MappedFile& other);
+	};
+
 	/**************** Executable ****************/
 
 	// For executing command line
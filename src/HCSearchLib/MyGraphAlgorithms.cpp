@@ -62,6 +62,13 @@ namespace MyGraphAlgorithms
 		return r;
 	}
 
+	void DisjointSet::reset(int size)
+	{
+		if (this->data.size() != size)
+			this->data.resize(size);
+		this->data.setConstant(-1);
+	}
+
 	/**************** Connected Components ****************/
 
 	ConnectedComponent::ConnectedComponent()
@@ -127,7 +134,7 @@ namespace MyGraphAlgorithms
 	{
 		// check if confidences are available
 		HCSearch::ImgLabeling original = this->ccSet->getOriginalLabeling();
-		const int numLabels = original.confidences.cols();
+		const int numLabels = original.confidences->cols();
 		if (!original.confidencesAvailable)
 		{
 			LOG(WARNING) << "confidences not available to get top K confident labels.";
@@ -137,7 +144,8 @@ namespace MyGraphAlgorithms
 		// bad cases
 		if (K > numLabels)
 		{
-			return HCSearch::Global::settings->CLASSES.getLabels();
+			const vector<int>& classIndices = HCSearch::Global::settings->CLASSES.getClassIndices();
+			return set<int>(classIndices.begin(), classIndices.end());
 		}
 		else if (K == 0)
 		{
@@ -199,8 +207,8 @@ namespace MyGraphAlgorithms
 			HCSearch::LabelConfidencePQ sortedByConfidence;
 			for (int i = 0; i < numLabels; i++)
 			{
-				int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-				double confidence = original.confidences(node1, i);
+				int label = i;
+				double confidence = original.confidences->coeff(node1, i);
 				sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
 			}
 			for (int i = 0; i < K; i++)
@@ -219,27 +227,26 @@ namespace MyGraphAlgorithms
 	{
 		bool hasNeighbors = false;
 
-		HCSearch::ImgLabeling original = this->ccSet->getOriginalLabeling();
+		const HCSearch::CompressedAdjacency& adjacency = *this->ccSet->getOriginalLabeling().graph.adjacency;
 
 		// get nodes in connected component
 		for (set<int>::iterator it = nodes.begin(); it != nodes.end(); ++it)
 		{
 			int node1 = *it;
 			
-			// get neighbors
-			set<int> neighbors = original.graph.adjList[node1];
-			set<int> uniqueNeighbors;
-
-			// find left overs to see if "outside" neighbors of connected component exist
-			set_difference(neighbors.begin(), neighbors.end(), 
-				nodes.begin(), nodes.end(), 
-				inserter(uniqueNeighbors, uniqueNeighbors.end()));
-
-			if (!uniqueNeighbors.empty())
+			// find "outside" neighbors of connected component
+			for (HCSearch::CompressedAdjacency::NeighborIterator it2 = adjacency.neighborsBegin(node1); 
+				it2 != adjacency.neighborsEnd(node1); ++it2)
 			{
-				hasNeighbors = true;
-				break;
+				if (nodes.count(*it2) == 0)
+				{
+					hasNeighbors = true;
+					break;
+				}
 			}
+
+			if (hasNeighbors)
+				break;
 		}
 
 		return hasNeighbors;
@@ -255,6 +262,7 @@ namespace MyGraphAlgorithms
 	{
 		this->connectedComponents = vector< ConnectedComponent* >();
 		this->original = labeling;
+		this->labeling = &this->original;
 
 		const int numNodes = this->original.getNumNodes();
 
@@ -263,14 +271,12 @@ namespace MyGraphAlgorithms
 
 		// first pass: union-find
 		DisjointSet ds = DisjointSet(numNodes);
+		const HCSearch::CompressedAdjacency& adjacency = *this->original.graph.adjacency;
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (!this->original.hasNeighbors(node1))
-				continue;
-
 			// get neighbors (ending nodes) of starting node
-			set<int> neighbors = this->original.getNeighbors(node1);
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			for (HCSearch::CompressedAdjacency::NeighborIterator it2 = adjacency.neighborsBegin(node1); 
+				it2 != adjacency.neighborsEnd(node1); ++it2)
 			{
 				int node2 = *it2;
 
@@ -298,7 +304,7 @@ namespace MyGraphAlgorithms
 			{
 				ccs[index] = new ConnectedComponent(this);
 
-				if (!HCSearch::Global::settings->CLASSES.classLabelIsBackground(this->original.getLabel(node)))
+				if (!HCSearch::Global::settings->CLASSES.classIndexIsBackground(this->original.getLabel(node)))
 				{
 					numForeground++;
 					foregroundCC = ccs[index];
@@ -331,6 +337,7 @@ namespace MyGraphAlgorithms
 	{
 		this->connectedComponents = vector< ConnectedComponent* >();
 		this->original = subgraph->getOriginalLabeling();
+		this->labeling = &this->original;
 
 		const int numNodes = this->original.getNumNodes();
 
@@ -339,18 +346,16 @@ namespace MyGraphAlgorithms
 
 		// first pass: union-find
 		DisjointSet ds = DisjointSet(numNodes);
+		const HCSearch::CompressedAdjacency& adjacency = *this->original.graph.adjacency;
 		set<int> subNodes = subgraph->getNodes();
 		for (set<int>::iterator it = subNodes.begin(); it != subNodes.end(); ++it)
 		{
 			// only consider nodes in the subgraph
 			int node1 = *it;
 
-			if (!this->original.hasNeighbors(node1))
-				continue;
-
 			// get neighbors (ending nodes) of starting node
-			set<int> neighbors = this->original.getNeighbors(node1);
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			for (HCSearch::CompressedAdjacency::NeighborIterator it2 = adjacency.neighborsBegin(node1); 
+				it2 != adjacency.neighborsEnd(node1); ++it2)
 			{
 				int node2 = *it2;
 
@@ -383,7 +388,7 @@ namespace MyGraphAlgorithms
 			{
 				ccs[index] = new ConnectedComponent(this);
 
-				if (!HCSearch::Global::settings->CLASSES.classLabelIsBackground(this->original.getLabel(node)))
+				if (!HCSearch::Global::settings->CLASSES.classIndexIsBackground(this->original.getLabel(node)))
 				{
 					numForeground++;
 					foregroundCC = ccs[index];
@@ -412,6 +417,13 @@ namespace MyGraphAlgorithms
 		}
 	}
 
+	ConnectedComponentSet::ConnectedComponentSet(HCSearch::ImgLabeling* labeling)
+	{
+		this->labeling = labeling;
+		this->exactlyOnePositiveCC = false;
+		this->foreground = NULL;
+	}
+
 	ConnectedComponentSet::~ConnectedComponentSet()
 	{
 		for (vector< ConnectedComponent* >::iterator it = connectedComponents.begin(); it != connectedComponents.end(); ++it)
@@ -426,9 +438,9 @@ namespace MyGraphAlgorithms
 		return this->connectedComponents.size();
 	}
 
-	HCSearch::ImgLabeling ConnectedComponentSet::getOriginalLabeling()
+	HCSearch::ImgLabeling& ConnectedComponentSet::getOriginalLabeling()
 	{
-		return this->original;
+		return *this->labeling;
 	}
 
 	vector< ConnectedComponent* > ConnectedComponentSet::getConnectedComponents()
@@ -446,11 +458,13 @@ namespace MyGraphAlgorithms
 	Subgraph::Subgraph()
 	{
 		this->subgraphSet = NULL;
+		this->connectedComponents = NULL;
 	}
 
 	Subgraph::Subgraph(SubgraphSet* subgraphSet)
 	{
 		this->subgraphSet = subgraphSet;
+		this->connectedComponents = NULL;
 	}
 
 	Subgraph::~Subgraph()
@@ -478,7 +492,7 @@ namespace MyGraphAlgorithms
 		this->connectedComponents = new ConnectedComponentSet(this);
 	}
 
-	HCSearch::ImgLabeling Subgraph::getOriginalLabeling()
+	HCSearch::ImgLabeling& Subgraph::getOriginalLabeling()
 	{
 		return this->subgraphSet->getOriginalLabeling();
 	}
@@ -499,14 +513,15 @@ namespace MyGraphAlgorithms
 	{
 	}
 
-	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts)
+	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, const HCSearch::EdgeMask_t& cuts)
 	{
 		constructorHelper(labeling, cuts);
 	}
 
 	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, map< MyPrimitives::Pair<int, int>, bool > cuts)
 	{
-		map< int, set<int> > cutsConverted;
+		const HCSearch::CompressedAdjacency& adjacency = *labeling.graph.adjacency;
+		HCSearch::EdgeMask_t cutsConverted(adjacency.getNumEdges(), false);
 
 		// convert cuts to format
 		for (map< MyPrimitives::Pair<int, int>, bool >::iterator it = cuts.begin(); it != cuts.end(); ++it)
@@ -515,20 +530,24 @@ namespace MyGraphAlgorithms
 			if (!it->second)
 			{
 				MyPrimitives::Pair<int, int> edge = it->first;
-				int node1 = edge.first;
-				int node2 = edge.second;
-
-				if (cutsConverted.count(node1) == 0)
-				{
-					cutsConverted[node1] = set<int>();
-				}
-				cutsConverted[node1].insert(node2);
+				int edgeIndex = adjacency.getEdgeIndex(edge.first, edge.second);
+				if (edgeIndex >= 0)
+					cutsConverted[edgeIndex] = true;
 			}
 		}
 
 		constructorHelper(labeling, cutsConverted);
 	}
 
+	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, const HCSearch::EdgeMask_t& cuts, 
+		DisjointSet& subgraphForest, DisjointSet& componentForest)
+	{
+		this->cuts = cuts;
+		this->original = labeling;
+
+		buildSubgraphs(subgraphForest, componentForest);
+	}
+
 	SubgraphSet::~SubgraphSet()
 	{
 		for (vector< Subgraph* >::iterator it = subgraphs.begin(); it != subgraphs.end(); ++it)
@@ -538,56 +557,115 @@ namespace MyGraphAlgorithms
 		}
 	}
 
-	void SubgraphSet::constructorHelper(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts)
+	void SubgraphSet::constructorHelper(HCSearch::ImgLabeling& labeling, const HCSearch::EdgeMask_t& cuts)
 	{
 		this->cuts = cuts;
 		this->original = labeling;
 
-		// determine subgraphs
-
 		const int numNodes = labeling.getNumNodes();
+		const HCSearch::CompressedAdjacency& adjacency = *labeling.graph.adjacency;
+		const int numRows = min(numNodes, adjacency.getNumNodes());
 
-		// first pass: union-find
-		DisjointSet ds = DisjointSet(numNodes);
-		for (int node1 = 0; node1 < numNodes; node1++)
+		// union-find over uncut edges
+		DisjointSet subgraphForest = DisjointSet(numNodes);
+		for (int node1 = 0; node1 < numRows; node1++)
 		{
-			if (cuts.count(node1) == 0)
-				continue;
-
 			// get neighbors (ending nodes) of starting node
-			set<int> neighbors = cuts[node1];
-			for (set<int>::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (HCSearch::CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node1); 
+				it != adjacency.neighborsEnd(node1); ++it)
 			{
-				int node2 = *it;
-
 				// automatically union-find neighbors
-				ds.Union(node1, node2);
+				if (cuts[adjacency.getEdgeIndex(it)])
+					subgraphForest.Union(node1, *it);
 			}
 		}
 
-		// second pass: write to output labeling, record components
+		DisjointSet componentForest = DisjointSet(numNodes);
+		buildSubgraphs(subgraphForest, componentForest);
+	}
 
-		map< int, Subgraph* > subgraphs; // node index -> subgraph
+	void SubgraphSet::buildSubgraphs(DisjointSet& subgraphForest, DisjointSet& componentForest)
+	{
+		const int numNodes = this->original.getNumNodes();
+
+		// first pass: group nodes into subgraphs, indexed by subgraph root
 
+		vector<int> subgraphRoot(numNodes);
+		vector< Subgraph* > subgraphs(numNodes, static_cast<Subgraph*>(NULL));
 		for (int node = 0; node < numNodes; node++)
 		{
-			int index = ds.FindSet(node);
+			int root = subgraphForest.FindSet(node);
+			subgraphRoot[node] = root;
+
+			if (subgraphs[root] == NULL)
+			{
+				subgraphs[root] = new Subgraph(this);
+				subgraphs[root]->connectedComponents = new ConnectedComponentSet(&this->original);
+			}
+			subgraphs[root]->addNode(node);
+		}
+
+		// second pass: union neighbors in the same subgraph with the same label
+
+		componentForest.reset(numNodes);
+		const HCSearch::CompressedAdjacency& adjacency = *this->original.graph.adjacency;
+		const int numRows = min(numNodes, adjacency.getNumNodes());
+		for (int node1 = 0; node1 < numRows; node1++)
+		{
+			for (HCSearch::CompressedAdjacency::NeighborIterator it2 = adjacency.neighborsBegin(node1); 
+				it2 != adjacency.neighborsEnd(node1); ++it2)
+			{
+				int node2 = *it2;
+				if (subgraphRoot[node1] == subgraphRoot[node2] 
+					&& this->original.getLabel(node1) == this->original.getLabel(node2))
+				{
+					componentForest.Union(node1, node2);
+				}
+			}
+		}
+
+		// third pass: record connected components and foreground counts per subgraph
 
-			// record subgraphs
-			if (subgraphs.count(index) == 0)
+		vector< ConnectedComponent* > ccs(numNodes, static_cast<ConnectedComponent*>(NULL));
+		vector<int> numForeground(numNodes, 0);
+		vector< ConnectedComponent* > foregroundCC(numNodes, static_cast<ConnectedComponent*>(NULL));
+		for (int node = 0; node < numNodes; node++)
+		{
+			int index = componentForest.FindSet(node);
+			if (ccs[index] == NULL)
 			{
-				subgraphs[index] = new Subgraph(this);
+				int root = subgraphRoot[node];
+				ccs[index] = new ConnectedComponent(subgraphs[root]->connectedComponents);
+
+				if (!HCSearch::Global::settings->CLASSES.classIndexIsBackground(this->original.getLabel(node)))
+				{
+					numForeground[root]++;
+					foregroundCC[root] = ccs[index];
+				}
 			}
-			subgraphs[index]->addNode(node);
+			ccs[index]->addNode(node);
+		}
+
+		// add connected components in order of their roots
+		for (int index = 0; index < numNodes; index++)
+		{
+			if (ccs[index] != NULL)
+				subgraphs[subgraphRoot[index]]->connectedComponents->connectedComponents.push_back(ccs[index]);
 		}
 
 		// add to list of subgraphs
 
 		this->subgraphs = vector< Subgraph* >();
-		for (map< int, Subgraph* >::iterator it = subgraphs.begin(); it != subgraphs.end(); ++it)
+		for (int root = 0; root < numNodes; root++)
 		{
-			Subgraph* sub = it->second;
-			sub->processConnectedComponents();
+			Subgraph* sub = subgraphs[root];
+			if (sub == NULL)
+				continue;
+
+			ConnectedComponentSet* ccSet = sub->connectedComponents;
+			ccSet->exactlyOnePositiveCC = numForeground[root] == 1;
+			ccSet->foreground = ccSet->exactlyOnePositiveCC ? foregroundCC[root] : NULL;
+
 			this->subgraphs.push_back(sub);
 
 			if (sub->hasExactlyOnePositiveCC())
@@ -602,7 +680,7 @@ namespace MyGraphAlgorithms
 		return this->subgraphs.size();
 	}
 
-	HCSearch::ImgLabeling SubgraphSet::getOriginalLabeling()
+	HCSearch::ImgLabeling& SubgraphSet::getOriginalLabeling()
 	{
 		return this->original;
 	}
@@ -612,7 +690,7 @@ namespace MyGraphAlgorithms
 		return this->subgraphs;
 	}
 
-	map< int, set<int> > SubgraphSet::getCuts()
+	MyPrimitives::CopyOnWrite< HCSearch::EdgeMask_t > SubgraphSet::getCuts()
 	{
 		return this->cuts;
 	}
@@ -41,6 +41,11 @@ namespace MyGraphAlgorithms
 		 * @brief FindSet finds the parent.
 		 */
 		int FindSet(int i);
+
+		/*!
+		 * @brief Reset to size singletons, reusing the storage if possible.
+		 */
+		void reset(int size);
 	};
 
 	/**************** Connected Components ****************/
@@ -105,10 +110,15 @@ namespace MyGraphAlgorithms
 	 */
 	class ConnectedComponentSet
 	{
+		friend class SubgraphSet;
+
 	private:
 		vector< ConnectedComponent* > connectedComponents;
 		HCSearch::ImgLabeling original;
 
+		// labeling the components refer to: either original or one owned by a subgraph set
+		HCSearch::ImgLabeling* labeling;
+
 		// true if there is only one foreground connected component
 		bool exactlyOnePositiveCC;
 		ConnectedComponent* foreground;
@@ -125,6 +135,11 @@ namespace MyGraphAlgorithms
 		 * @brief Construct a connected component set from a subgraph.
 		 */
 		ConnectedComponentSet(Subgraph* subgraph);
+
+		/*!
+		 * @brief Construct an empty connected component set of a labeling owned elsewhere.
+		 */
+		ConnectedComponentSet(HCSearch::ImgLabeling* labeling);
 		
 		~ConnectedComponentSet();
 
@@ -136,7 +151,7 @@ namespace MyGraphAlgorithms
 		/*!
 		 * @brief Get the original labeling.
 		 */
-		HCSearch::ImgLabeling getOriginalLabeling();
+		HCSearch::ImgLabeling& getOriginalLabeling();
 
 		/*!
 		 * @brief Get connected components.
@@ -156,6 +171,8 @@ namespace MyGraphAlgorithms
 	 */
 	class Subgraph
 	{
+		friend class SubgraphSet;
+
 	private:
 		set<int> nodes;
 		ConnectedComponentSet* connectedComponents;
@@ -191,7 +208,7 @@ namespace MyGraphAlgorithms
 		/*!
 		 * @brief Get the original labeling.
 		 */
-		HCSearch::ImgLabeling getOriginalLabeling();
+		HCSearch::ImgLabeling& getOriginalLabeling();
 
 		/*!
 		 * @brief Get the connected components.
@@ -213,18 +230,36 @@ namespace MyGraphAlgorithms
 	{
 	private:
 		vector< Subgraph* > subgraphs;
-		map< int, set<int> > cuts;
+		MyPrimitives::CopyOnWrite< HCSearch::EdgeMask_t > cuts;
 		HCSearch::ImgLabeling original;
 
 		vector< Subgraph* > exactlyOnePositiveCCSubgraphs;
 
 	public:
 		SubgraphSet();
-		SubgraphSet(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts);
+
+		/*!
+		 * @brief Construct from the uncut edges of the labeling graph, 
+		 * flagged by edge index of its adjacency.
+		 */
+		SubgraphSet(HCSearch::ImgLabeling& labeling, const HCSearch::EdgeMask_t& cuts);
+
+		/*!
+		 * @brief Construct from cut decisions of (node1, node2) pairs (true if cut).
+		 */
 		SubgraphSet(HCSearch::ImgLabeling& labeling, map< MyPrimitives::Pair<int, int>, bool > cuts);
+
+		/*!
+		 * @brief Construct from uncut edges that are already unioned into subgraphForest.
+		 * 
+		 * componentForest is a scratch buffer for the connected components 
+		 * and can be reused across calls.
+		 */
+		SubgraphSet(HCSearch::ImgLabeling& labeling, const HCSearch::EdgeMask_t& cuts, 
+			DisjointSet& subgraphForest, DisjointSet& componentForest);
 		~SubgraphSet();
 
-		void constructorHelper(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts);
+		void constructorHelper(HCSearch::ImgLabeling& labeling, const HCSearch::EdgeMask_t& cuts);
 
 		/*!
 		 * @brief Get the number of subgraphs.
@@ -234,7 +269,7 @@ namespace MyGraphAlgorithms
 		/*!
 		 * @brief Get the original labeling.
 		 */
-		HCSearch::ImgLabeling getOriginalLabeling();
+		HCSearch::ImgLabeling& getOriginalLabeling();
 
 		/*!
 		 * @brief Get the subgraphs.
@@ -242,14 +277,21 @@ namespace MyGraphAlgorithms
 		vector< Subgraph* > getSubgraphs();
 
 		/*!
-		 * @brief Get the stochastic cuts.
+		 * @brief Get the stochastic cuts (uncut edges flagged by edge index).
 		 */
-		map< int, set<int> > getCuts();
+		MyPrimitives::CopyOnWrite< HCSearch::EdgeMask_t > getCuts();
 
 		/*!
 		 * @brief Get the set of subgraphs such that there is exactly one connected component.
 		 */
 		vector< Subgraph* > getExactlyOnePositiveCCSubgraphs();
+
+	private:
+		/*!
+		 * @brief Group nodes into subgraphs and label the connected components 
+		 * of all subgraphs in one pass over the labeling graph.
+		 */
+		void buildSubgraphs(DisjointSet& subgraphForest, DisjointSet& componentForest);
 	};
 }
 
@@ -9,6 +9,7 @@ namespace MyLogger
 	int Logger::numProcesses = 0;
 	ofstream* Logger::logstream = NULL;
 	LogLevel Logger::minLogLevel = INFO;
+	std::mutex Logger::writeLock;
 
 	Logger::Logger()
 	{
@@ -22,6 +23,9 @@ namespace MyLogger
 			if (embellish)
 				os << endl;
 
+			// messages may come from worker threads
+			lock_guard<std::mutex> guard(Logger::writeLock);
+
 			// to file
 			if (Logger::initialized)
 			{
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <string>
 #include <ctime>
+#include <mutex>
 
 using namespace std;
 
@@ -33,6 +34,7 @@ namespace MyLogger
 		static int numProcesses;
 		static ofstream* logstream;
 		static LogLevel minLogLevel;
+		static std::mutex writeLock;
 
 		// For logging
 	protected:
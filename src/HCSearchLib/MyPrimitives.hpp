@@ -3,6 +3,12 @@
 
 #include <map>
 #include <set>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 
@@ -15,6 +21,8 @@ namespace MyPrimitives
 	template <class T, class U> struct Pair;
 	template <class T, class U, class V> struct Triple;
 	template <class T> class Bimap;
+	template <class T> class CopyOnWrite;
+	class ThreadPool;
 
 	/*!
 	 * Pair stores a basic 2-tuple
@@ -152,6 +160,227 @@ namespace MyPrimitives
 		void clear();
 	};
 
+	/*!
+	 * CopyOnWrite stores a reference-counted value that is shared between copies 
+	 * until one of them asks for write access
+	 */
+	template <class T>
+	class CopyOnWrite
+	{
+		shared_ptr<T> data;
+
+	public:
+		CopyOnWrite()
+		{
+			// default values share one empty value until written
+			this->data = emptyValue();
+		}
+
+		CopyOnWrite(const T& value)
+		{
+			this->data = shared_ptr<T>(new T(value));
+		}
+
+		~CopyOnWrite() {}
+
+		/*!
+		 * Replace the shared value with a new (unshared) value
+		 */
+		CopyOnWrite& operator=(const T& value)
+		{
+			this->data = shared_ptr<T>(new T(value));
+			return *this;
+		}
+
+		/*!
+		 * Read-only access to the shared value
+		 */
+		const T& get() const
+		{
+			return *this->data;
+		}
+
+		const T& operator*() const
+		{
+			return *this->data;
+		}
+
+		const T* operator->() const
+		{
+			return this->data.get();
+		}
+
+		/*!
+		 * Write access to the value. 
+		 * Makes a private copy first if the value is shared.
+		 */
+		T& edit()
+		{
+			if (this->data.use_count() > 1)
+				this->data = shared_ptr<T>(new T(*this->data));
+
+			return *this->data;
+		}
+
+		/*!
+		 * Check if the value is shared with another copy
+		 */
+		bool shared() const
+		{
+			return this->data.use_count() > 1;
+		}
+
+	private:
+		/*!
+		 * Empty value shared by all default constructed copies 
+		 * (always shared, so edit() never writes to it)
+		 */
+		static const shared_ptr<T>& emptyValue()
+		{
+			static const shared_ptr<T> empty(new T());
+			return empty;
+		}
+	};
+
+	/*!
+	 * ThreadPool keeps a fixed set of worker threads for running 
+	 * the iterations of a loop in parallel. The calling thread 
+	 * also runs iterations, so a pool of size 1 runs serially.
+	 * A parallelFor called while the pool is busy (nested or from 
+	 * another thread) runs its iterations on the calling thread.
+	 */
+	class ThreadPool
+	{
+		vector<thread> workers;
+		std::mutex lock;
+		condition_variable workAvailable;
+		condition_variable workDone;
+
+		const function<void(int)>* task;
+		int numTasks;
+		int nextTask;
+		int numFinished;
+		int generation;
+		bool stopping;
+
+	public:
+		ThreadPool(int numThreads)
+		{
+			this->task = NULL;
+			this->numTasks = 0;
+			this->nextTask = 0;
+			this->numFinished = 0;
+			this->generation = 0;
+			this->stopping = false;
+
+			for (int i = 1; i < numThreads; i++)
+				this->workers.push_back(thread(&ThreadPool::workerLoop, this));
+		}
+
+		~ThreadPool()
+		{
+			{
+				unique_lock<std::mutex> guard(this->lock);
+				this->stopping = true;
+			}
+			this->workAvailable.notify_all();
+
+			for (vector<thread>::iterator it = this->workers.begin(); it != this->workers.end(); ++it)
+				it->join();
+		}
+
+		/*!
+		 * Number of threads running iterations, including the caller
+		 */
+		int size() const
+		{
+			return static_cast<int>(this->workers.size()) + 1;
+		}
+
+		/*!
+		 * Run task(i) for i = 0, ..., n-1 and return when all are done. 
+		 * Iterations may run in any order, so tasks should write results by index.
+		 */
+		void parallelFor(int n, const function<void(int)>& task)
+		{
+			bool runSerially = this->workers.empty() || n <= 1;
+			if (!runSerially)
+			{
+				unique_lock<std::mutex> guard(this->lock);
+				runSerially = this->task != NULL;
+				if (!runSerially)
+					this->task = &task;
+			}
+
+			if (runSerially)
+			{
+				for (int i = 0; i < n; i++)
+					task(i);
+				return;
+			}
+
+			{
+				unique_lock<std::mutex> guard(this->lock);
+				this->numTasks = n;
+				this->nextTask = 0;
+				this->numFinished = 0;
+				this->generation++;
+			}
+			this->workAvailable.notify_all();
+
+			runTasks();
+
+			unique_lock<std::mutex> guard(this->lock);
+			while (this->numFinished < this->numTasks)
+				this->workDone.wait(guard);
+			this->task = NULL;
+		}
+
+	private:
+		void runTasks()
+		{
+			while (true)
+			{
+				const function<void(int)>* current;
+				int i;
+				{
+					unique_lock<std::mutex> guard(this->lock);
+					if (this->task == NULL || this->nextTask >= this->numTasks)
+						return;
+					current = this->task;
+					i = this->nextTask++;
+				}
+
+				(*current)(i);
+
+				{
+					unique_lock<std::mutex> guard(this->lock);
+					this->numFinished++;
+					if (this->numFinished == this->numTasks)
+						this->workDone.notify_all();
+				}
+			}
+		}
+
+		void workerLoop()
+		{
+			int seenGeneration = 0;
+			while (true)
+			{
+				{
+					unique_lock<std::mutex> guard(this->lock);
+					while (!this->stopping && this->generation == seenGeneration)
+						this->workAvailable.wait(guard);
+					if (this->stopping)
+						return;
+					seenGeneration = this->generation;
+				}
+
+				runTasks();
+			}
+		}
+	};
+
 	template <class T>
 	void Bimap<T>::insert(T X, T Y)
 	{
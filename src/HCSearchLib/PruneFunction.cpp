@@ -6,6 +6,36 @@ namespace HCSearch
 {
 	/**************** Prune Abstract Class ****************/
 
+	vector< ImgCandidate > IPruneFunction::generatePrunedSuccessors(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+		int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc)
+	{
+		vector< ImgCandidate > YCandidates = successorFunction->generateSuccessors(X, Y, timeStep, timeBound);
+		return pruneSuccessors(X, Y, YCandidates, YTruth, lossFunc);
+	}
+
+	vector< ImgCandidateDelta > IPruneFunction::generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+		int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate)
+	{
+		vector< ImgCandidate > YCandidates;
+		CandidateVisitor_t addSuccessor = [&](const ImgCandidateDelta& delta)
+		{
+			YCandidates.push_back(delta.materialize(YTemplate));
+		};
+		successorFunction->streamSuccessors(X, Y, timeStep, timeBound, YTemplate, addSuccessor);
+
+		// survivors only differ from the template at their action nodes
+		vector< ImgCandidate > YPrunedCandidates = pruneSuccessors(X, Y, YCandidates, YTruth, lossFunc);
+		vector< ImgCandidateDelta > deltas(YPrunedCandidates.size());
+		for (int i = 0; i < static_cast<int>(YPrunedCandidates.size()); i++)
+		{
+			deltas[i].action = YPrunedCandidates[i].action;
+			for (set<int>::iterator it = deltas[i].action.begin(); it != deltas[i].action.end(); ++it)
+				deltas[i].labels.push_back(YPrunedCandidates[i].labeling.getLabel(*it));
+		}
+
+		return deltas;
+	}
+
 	IFeatureFunction* IPruneFunction::getFeatureFunction()
 	{
 		return this->featureFunction;
@@ -26,6 +56,12 @@ namespace HCSearch
 		return YCandidates;
 	}
 
+	vector< ImgCandidateDelta > NoPrune::generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+		int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate)
+	{
+		return successorFunction->generateSuccessorDeltas(X, Y, timeStep, timeBound, YTemplate);
+	}
+
 	double NoPrune::getPruneFraction()
 	{
 		return 0.0;
@@ -34,6 +70,7 @@ namespace HCSearch
 	/**************** Ranker Prune ****************/
 
 	const double RankerPrune::DEFAULT_PRUNE_FRACTION = 0.5;
+	const int RankerPrune::RANK_BATCH_SIZE = 256;
 
 	RankerPrune::RankerPrune()
 	{
@@ -71,22 +108,21 @@ namespace HCSearch
 	{
 		vector< ImgCandidate > YPrunedCandidates;
 
-		// get pruning features of candidates
-		vector<RankFeatures> featuresList;
-		for (vector<ImgCandidate>::iterator it = YCandidates.begin(); it != YCandidates.end(); ++it)
+		// get pruning features of candidates, one row per candidate
+		const int numOriginalCandidates = YCandidates.size();
+		MatrixXd featuresMatrix = MatrixXd::Zero(numOriginalCandidates, 0);
+		for (int i = 0; i < numOriginalCandidates; i++)
 		{
-			ImgCandidate YCand = *it;
-			set<int> action = YCand.action;
-			RankFeatures features = this->featureFunction->computeFeatures(X, YCand.labeling, action);
-			featuresList.push_back(features);
+			ImgCandidate& YCand = YCandidates[i];
+			RankFeatures features = this->featureFunction->computeFeatures(X, YCand.labeling, YCand.action);
+			setFeaturesRow(featuresMatrix, i, features.data);
 		}
 
 		// run ranker
 		LOG() << "running pruning ranker..." << endl;
-		vector<double> ranks = this->ranker->rank(featuresList);
+		VectorXd ranks = this->ranker->rankBatch(featuresMatrix);
 
 		// sort by rank
-		const int numOriginalCandidates = YCandidates.size();
 		const int numNewCandidates = static_cast<int>((1-pruneFraction)*numOriginalCandidates);
 
 		LOG() << "adding to running queue..." << endl;
@@ -115,6 +151,138 @@ namespace HCSearch
 		return YPrunedCandidates;
 	}
 
+	vector< ImgCandidate > RankerPrune::generatePrunedSuccessors(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+		int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc)
+	{
+		ImgLabeling YTemplate;
+		vector< ImgCandidateDelta > deltas = generatePrunedSuccessorDeltas(X, Y, successorFunction, timeStep, timeBound, 
+			YTruth, lossFunc, YTemplate);
+
+		// only now build the full labelings of the kept candidates
+		vector< ImgCandidate > YPrunedCandidates;
+		for (vector< ImgCandidateDelta >::iterator it = deltas.begin(); it != deltas.end(); ++it)
+			YPrunedCandidates.push_back(it->materialize(YTemplate));
+
+		return YPrunedCandidates;
+	}
+
+	vector< ImgCandidateDelta > RankerPrune::generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+		int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate)
+	{
+		ImgLabeling YScratch;
+		bool scratchReady = false;
+
+		// every successor relabels a distinct component (at most one per node) 
+		// to a different class, which bounds the number of survivors
+		const int maxCandidates = X.getNumNodes() * max(Global::settings->CLASSES.numClasses() - 1, 0);
+		const int maxNewCandidates = static_cast<int>((1-pruneFraction)*maxCandidates);
+
+		// only the current top candidates are kept, as label changes in reused slots
+		RankKPQ<RankPruneIndex> rankPQ(maxNewCandidates);
+		vector< ImgCandidateDelta > slots;
+		int numOriginalCandidates = 0;
+
+		// features are ranked in fixed size batches as they come in
+		vector< ImgCandidateDelta > batch(RANK_BATCH_SIZE);
+		MatrixXd featuresBatch = MatrixXd::Zero(RANK_BATCH_SIZE, 0);
+		int numBatched = 0;
+		function<void()> rankBatch = [&]()
+		{
+			VectorXd batchRanks = this->ranker->rankBatch(featuresBatch.topRows(numBatched));
+			for (int i = 0; i < numBatched; i++)
+			{
+				RankPruneIndex rankNode;
+				rankNode.rank = batchRanks(i);
+
+				if (!rankPQ.full())
+				{
+					rankNode.index = slots.size();
+					slots.push_back(ImgCandidateDelta());
+				}
+				else if (rankNode.rank <= rankPQ.top().rank)
+				{
+					// evict the worst survivor and take over its slot
+					rankNode.index = rankPQ.top().index;
+					rankPQ.pop();
+				}
+				else
+				{
+					continue;
+				}
+
+				swap(slots[rankNode.index], batch[i]);
+				rankPQ.push(rankNode);
+			}
+			featuresBatch.setZero();
+			numBatched = 0;
+		};
+
+		CandidateVisitor_t scoreCandidate = [&](const ImgCandidateDelta& delta)
+		{
+			if (!scratchReady)
+			{
+				YScratch = YTemplate;
+				scratchReady = true;
+			}
+
+			delta.apply(YScratch);
+			RankFeatures features = this->featureFunction->computeFeatures(X, YScratch, delta.action);
+			delta.revert(YScratch, YTemplate);
+
+			setFeaturesRow(featuresBatch, numBatched, features.data);
+			batch[numBatched] = delta;
+			numBatched++;
+			numOriginalCandidates++;
+
+			if (numBatched == RANK_BATCH_SIZE)
+				rankBatch();
+		};
+
+		LOG() << "running pruning ranker on streamed successors..." << endl;
+		successorFunction->streamSuccessors(X, Y, timeStep, timeBound, YTemplate, scoreCandidate);
+		if (numBatched > 0)
+			rankBatch();
+
+		if (numOriginalCandidates > maxCandidates)
+		{
+			LOG(WARNING) << "more successors than expected (" << numOriginalCandidates 
+				<< " > " << maxCandidates << "); pruning kept the top " << maxNewCandidates << " only";
+		}
+
+		// keep top candidates by rank
+		const int numNewCandidates = static_cast<int>((1-pruneFraction)*numOriginalCandidates);
+		while (rankPQ.size() > numNewCandidates)
+			rankPQ.pop();
+
+		vector< ImgCandidateDelta > prunedDeltas;
+		vector<RankPruneIndex> topK = rankPQ.pop_all();
+		const int topKSize = topK.size();
+		prunedDeltas.reserve(topKSize);
+		for (int i = 0; i < topKSize; i++)
+		{
+			prunedDeltas.push_back(ImgCandidateDelta());
+			swap(prunedDeltas.back(), slots[topK[i].index]);
+		}
+
+		LOG() << "num of successors before pruning=" << numOriginalCandidates << endl;
+		LOG() << "\tnum of successors after pruning=" << prunedDeltas.size() << endl;
+
+		return prunedDeltas;
+	}
+
+	void RankerPrune::setFeaturesRow(MatrixXd& featuresMatrix, int row, const VectorXd& features)
+	{
+		// widen with zero columns if needed
+		const int featureDim = features.size();
+		const int oldDim = featuresMatrix.cols();
+		if (featureDim > oldDim)
+		{
+			featuresMatrix.conservativeResize(Eigen::NoChange, featureDim);
+			featuresMatrix.rightCols(featureDim - oldDim).setZero();
+		}
+		featuresMatrix.row(row).head(featureDim) = features.transpose();
+	}
+
 	double RankerPrune::getPruneFraction()
 	{
 		return this->pruneFraction;
@@ -457,47 +625,4 @@ namespace HCSearch
 	{
 		return this->lossFunction;
 	}
-
-	/**************** RankNodeKPQ ****************/
-
-	void RankNodeKPQ::push(RankPruneNode e)
-	{
-		if (!full())
-		{
-			pq.push(e);
-		}
-		else if (full() && e.rank <= maximum)
-		{
-			pq.pop();
-			pq.push(e);
-		}
-		this->maximum = pq.top().rank;
-	}
-
-	vector<RankPruneNode> RankNodeKPQ::pop_all()
-	{
-		vector<RankPruneNode> list;
-		while (!pq.empty())
-		{
-			list.push_back(pq.top());
-			pq.pop();
-		}
-
-		return list;
-	}
-
-	bool RankNodeKPQ::empty()
-	{
-		return size() == 0;
-	}
-
-	bool RankNodeKPQ::full()
-	{
-		return size() >= this->K;
-	}
-
-	int RankNodeKPQ::size()
-	{
-		return pq.size();
-	}
 }
\ No newline at end of file
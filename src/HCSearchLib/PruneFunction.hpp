@@ -3,6 +3,7 @@
 
 #include <queue>
 #include "FeatureFunction.hpp"
+#include "SuccessorFunction.hpp"
 #include "DataStructures.hpp"
 #include "MyGraphAlgorithms.hpp"
 #include "LossFunction.hpp"
@@ -27,6 +28,22 @@ namespace HCSearch
 		 */
 		virtual vector< ImgCandidate > pruneSuccessors(ImgFeatures& X, ImgLabeling& Y, vector< ImgCandidate >& YCandidates, ImgLabeling* YTruth, ILossFunction* lossFunc)=0;
 
+		/*!
+		 * @brief Generate successors and prune them.
+		 * 
+		 * By default generates all successors and then calls pruneSuccessors.
+		 */
+		virtual vector< ImgCandidate > generatePrunedSuccessors(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+			int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc);
+
+		/*!
+		 * @brief Generate successors and prune them, keeping the survivors as label changes to YTemplate.
+		 * 
+		 * By default generates all successors, calls pruneSuccessors and converts the survivors back.
+		 */
+		virtual vector< ImgCandidateDelta > generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+			int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate);
+
 		IFeatureFunction* getFeatureFunction();
 
 		virtual double getPruneFraction()=0;
@@ -44,6 +61,12 @@ namespace HCSearch
 		~NoPrune();
 		
 		virtual vector< ImgCandidate > pruneSuccessors(ImgFeatures& X, ImgLabeling& Y, vector< ImgCandidate >& YCandidates, ImgLabeling* YTruth, ILossFunction* lossFunc);
+
+		/*!
+		 * @brief Generate all successors as label changes.
+		 */
+		virtual vector< ImgCandidateDelta > generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+			int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate);
 		
 		virtual double getPruneFraction();
 	};
@@ -55,6 +78,12 @@ namespace HCSearch
 		ImgCandidate YCandidate;
 	};
 
+	struct RankPruneIndex
+	{
+		double rank;
+		int index; //!< Index of the candidate in its candidate storage
+	};
+
 	class CompareRankPruneNodes
 	{
 	public:
@@ -76,6 +105,7 @@ namespace HCSearch
 	class RankerPrune : public IPruneFunction
 	{
 		static const double DEFAULT_PRUNE_FRACTION;
+		static const int RANK_BATCH_SIZE; //!< Number of streamed candidates ranked together
 
 		IRankModel* ranker;
 		double pruneFraction; //!< 0 = no pruning, 1 = prune everything
@@ -88,11 +118,31 @@ namespace HCSearch
 		~RankerPrune();
 		
 		virtual vector< ImgCandidate > pruneSuccessors(ImgFeatures& X, ImgLabeling& Y, vector< ImgCandidate >& YCandidates, ImgLabeling* YTruth, ILossFunction* lossFunc);
+
+		/*!
+		 * @brief Generate successors and prune them as they stream in.
+		 * 
+		 * Full labelings are built for the survivors of generatePrunedSuccessorDeltas only.
+		 */
+		virtual vector< ImgCandidate > generatePrunedSuccessors(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+			int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc);
+
+		/*!
+		 * @brief Generate successors and prune them as they stream in.
+		 * 
+		 * Candidates are scored on a single scratch labeling and kept only as 
+		 * label changes to YTemplate.
+		 */
+		virtual vector< ImgCandidateDelta > generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& Y, ISuccessorFunction* successorFunction, 
+			int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate);
 		
 		virtual double getPruneFraction();
 
 		IRankModel* getRanker();
 		void setRanker(IRankModel* ranker);
+
+	private:
+		static void setFeaturesRow(MatrixXd& featuresMatrix, int row, const VectorXd& features);
 	};
 
 	/*!
@@ -169,33 +219,97 @@ namespace HCSearch
 	};
 
 	/*!
-	 * Wrapper for RankNodePQ to compute top nodes
+	 * Bounded priority queue to compute the top (lowest ranked) K nodes. 
+	 * TNode needs a double rank field.
 	 */
-	class RankNodeKPQ
+	template <class TNode>
+	class RankKPQ
 	{
-		RankNodePQInvert pq;
+		class CompareRanksInvert
+		{
+		public:
+			bool operator() (const TNode& lhs, const TNode& rhs) const
+			{
+				return rhs.rank > lhs.rank;
+			}
+		};
+
+		priority_queue<TNode, vector<TNode>, CompareRanksInvert> pq;
 		double maximum;
 		int K;
 
 	public:
-		RankNodeKPQ(int K)
+		RankKPQ(int K)
 		{
-			this->pq = RankNodePQInvert();
 			this->K = K;
 		}
 
-		~RankNodeKPQ() {}
+		~RankKPQ() {}
 
-		void push(RankPruneNode e);
+		void push(const TNode& e)
+		{
+			if (this->K <= 0)
+				return;
+
+			if (!full())
+			{
+				pq.push(e);
+			}
+			else if (full() && e.rank <= maximum)
+			{
+				pq.pop();
+				pq.push(e);
+			}
+			this->maximum = pq.top().rank;
+		}
 
-		vector<RankPruneNode> pop_all();
+		/*!
+		 * Worst (highest ranked) node kept so far.
+		 */
+		const TNode& top()
+		{
+			return pq.top();
+		}
 
-		bool empty();
+		/*!
+		 * Remove the worst (highest ranked) node kept so far.
+		 */
+		void pop()
+		{
+			pq.pop();
+			if (!pq.empty())
+				this->maximum = pq.top().rank;
+		}
 
-		bool full();
+		vector<TNode> pop_all()
+		{
+			vector<TNode> list;
+			while (!pq.empty())
+			{
+				list.push_back(pq.top());
+				pq.pop();
+			}
+
+			return list;
+		}
+
+		bool empty()
+		{
+			return size() == 0;
+		}
+
+		bool full()
+		{
+			return size() >= this->K;
+		}
 
-		int size();
+		int size()
+		{
+			return pq.size();
+		}
 	};
+
+	typedef RankKPQ<RankPruneNode> RankNodeKPQ;
 }
 
 #endif
\ No newline at end of file
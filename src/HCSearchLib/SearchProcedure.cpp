@@ -1,5 +1,7 @@
 #include <iostream>
 #include <ctime>
+#include <new>
+#include <unordered_set>
 #include "SearchProcedure.hpp"
 #include "Globals.hpp"
 
@@ -15,10 +17,10 @@ namespace HCSearch
 		if (fh.is_open())
 		{
 			const int numNodes = YPred.getNumNodes();
-			fh << YPred.getLabel(0);
+			fh << Global::settings->CLASSES.getClassLabel(YPred.getLabel(0));
 			for (int node = 1; node < numNodes; node++)
 			{
-				fh << endl << YPred.getLabel(node);
+				fh << endl << Global::settings->CLASSES.getClassLabel(YPred.getLabel(node));
 			}
 			fh.close();
 		}
@@ -36,19 +38,22 @@ namespace HCSearch
 			return;
 		}
 
-		map< int, set<int> > edgeNeighbors = YPred.stochasticCuts;
+		const CompressedAdjacency& adjacency = *YPred.graph.adjacency;
+		const EdgeMask_t& keptEdges = *YPred.stochasticCuts;
 
 		// write to file
 		ofstream fh(fileName.c_str());
 		if (fh.is_open())
 		{
-			for (map< int, set<int> >::iterator it = edgeNeighbors.begin(); it != edgeNeighbors.end(); ++it)
+			for (int node1 = 0; node1 < adjacency.getNumNodes(); node1++)
 			{
-				int node1 = it->first;
-				set<int> neighbors = it->second;
-				for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+				for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node1); 
+					it != adjacency.neighborsEnd(node1); ++it)
 				{
-					int node2 = *it2;
+					if (!keptEdges[adjacency.getEdgeIndex(it)])
+						continue;
+
+					int node2 = *it;
 
 					fh << node1+1 << " " << node2+1 << " 1" << endl;
 				}
@@ -81,7 +86,7 @@ namespace HCSearch
 				for (int col = 0; col < width; col++)
 				{
 					int segmentID = X.segments(row, col);
-					int label = YPred.getLabel(segmentID);
+					int label = Global::settings->CLASSES.getClassLabel(YPred.getLabel(segmentID));
 					fh << label << " ";
 				}
 				fh << endl;
@@ -115,6 +120,23 @@ namespace HCSearch
 		}
 	}
 
+	void SavePrediction::saveStepTimes(vector<double>& stepTimes, string fileName)
+	{
+		// write to file
+		ofstream fh(fileName.c_str());
+		if (fh.is_open())
+		{
+			for (vector<double>::iterator it = stepTimes.begin(); it != stepTimes.end(); ++it)
+				fh << *it << endl;
+
+			fh.close();
+		}
+		else
+		{
+			LOG(ERROR) << "cannot open file to write step times!";
+		}
+	}
+
 	/**************** Training ****************/
 
 	IRankModel* Training::initializeLearning(RankerType rankerType, SearchType searchType)
@@ -130,6 +152,10 @@ namespace HCSearch
 		{
 			learningModel = new VWRankModel();
 		}
+		else if (rankerType == ONLINE_RANK)
+		{
+			learningModel = new OnlineRankModel();
+		}
 		else
 		{
 			LOG(ERROR) << "unsupported rank learner.";
@@ -177,6 +203,11 @@ namespace HCSearch
 				abort();
 			}
 		}
+		else if (learningModel->rankerType() == ONLINE_RANK)
+		{
+			OnlineRankModel* onlineRankModel = dynamic_cast<OnlineRankModel*>(learningModel);
+			onlineRankModel->startTraining();
+		}
 		else
 		{
 			LOG(ERROR) << "unsupported rank learner.";
@@ -220,6 +251,23 @@ namespace HCSearch
 				abort();
 			}
 		}
+		else if (learningModel->rankerType() == ONLINE_RANK)
+		{
+			OnlineRankModel* onlineRankModel = dynamic_cast<OnlineRankModel*>(learningModel);
+			if (searchType == LEARN_H)
+				onlineRankModel->finishTraining(Global::settings->paths->OUTPUT_HEURISTIC_MODEL_FILE, searchType);
+			else if (searchType == LEARN_C)
+				onlineRankModel->finishTraining(Global::settings->paths->OUTPUT_COST_H_MODEL_FILE, searchType);
+			else if (searchType == LEARN_C_ORACLE_H)
+				onlineRankModel->finishTraining(Global::settings->paths->OUTPUT_COST_ORACLE_H_MODEL_FILE, searchType);
+			else if (searchType == LEARN_PRUNE)
+				onlineRankModel->finishTraining(Global::settings->paths->OUTPUT_PRUNE_MODEL_FILE, searchType);
+			else
+			{
+				LOG(ERROR) << "unknown search type!";
+				abort();
+			}
+		}
 		else
 		{
 			LOG(ERROR) << "unsupported rank learner.";
@@ -230,34 +278,35 @@ namespace HCSearch
 	/**************** Search Procedure ****************/
 
 	ISearchProcedure::SearchNode* ISearchProcedure::createRootNode(SearchType searchType, ImgFeatures& X, ImgLabeling* YTruth, 
-		SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel)
+		SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel, SearchNodeArena* arena, 
+		TranspositionTable* table, const SearchDeadline* deadline)
 	{
 		SearchNode* root = NULL;
 		switch (searchType)
 		{
 			case LL:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new (arena->allocate()) SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, arena, table, deadline);
 				break;
 			case HL:
-				root = new SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType);
+				root = new (arena->allocate()) SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType, arena, table, deadline);
 				break;
 			case LC:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, costModel, searchType);
+				root = new (arena->allocate()) SearchNode(&X, YTruth, searchSpace, NULL, costModel, searchType, arena, table, deadline);
 				break;
 			case HC:
-				root = new SearchNode(&X, NULL, searchSpace, heuristicModel, costModel, searchType);
+				root = new (arena->allocate()) SearchNode(&X, NULL, searchSpace, heuristicModel, costModel, searchType, arena, table, deadline);
 				break;
 			case LEARN_H:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new (arena->allocate()) SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, arena, table, deadline);
 				break;
 			case LEARN_C:
-				root = new SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType);
+				root = new (arena->allocate()) SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType, arena, table, deadline);
 				break;
 			case LEARN_C_ORACLE_H:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new (arena->allocate()) SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, arena, table, deadline);
 				break;
 			case LEARN_PRUNE:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new (arena->allocate()) SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, arena, table, deadline);
 				break;
 			default:
 				LOG(ERROR) << "searchType constant is invalid.";
@@ -265,9 +314,50 @@ namespace HCSearch
 		return root;
 	}
 
+	void ISearchProcedure::releaseNode(SearchNode* state)
+	{
+		state->getArena()->release(state);
+	}
+
+	ISearchProcedure::TranspositionTable* ISearchProcedure::acquireTranspositionTable(SearchType searchType, ImgFeatures& X, 
+		IRankModel* heuristicModel, IRankModel* costModel)
+	{
+		if (Global::settings->TRANSPOSITION_TABLE_SIZE <= 0)
+			return NULL;
+
+		TranspositionTable* table;
+		{
+			lock_guard<std::mutex> guard(this->transpositionLock);
+			TranspositionTable*& slot = this->transpositionTables[this_thread::get_id()];
+			if (slot == NULL)
+				slot = new TranspositionTable(Global::settings->TRANSPOSITION_TABLE_SIZE, Global::settings->TRANSPOSITION_TABLE_FEATURES);
+			table = slot;
+		}
+
+		table->prepare(&X, searchType, heuristicModel, costModel);
+		return table;
+	}
+
+	void ISearchProcedure::logTranspositionTable(TranspositionTable* table)
+	{
+		if (table == NULL)
+			return;
+
+		LOG() << "Transposition table: hits=" << table->getHits() << ", misses=" << table->getMisses() 
+			<< ", size=" << table->size() << endl;
+	}
+
+	ISearchProcedure::~ISearchProcedure()
+	{
+		for (map< thread::id, TranspositionTable* >::iterator it = this->transpositionTables.begin(); 
+			it != this->transpositionTables.end(); ++it)
+			delete it->second;
+	}
+
 	ISearchProcedure::SearchMetadata::SearchMetadata()
 	{
 		this->saveAnytimePredictions = false;
+		this->stepTimes = NULL;
 	}
 
 	void ISearchProcedure::saveAnyTimePrediction(ImgLabeling YPred, int timeBound, SearchMetadata searchMetadata, SearchType searchType)
@@ -285,7 +375,8 @@ namespace HCSearch
 
 			if (!YPred.stochasticCutsAvailable)
 			{
-				YPred.stochasticCuts = YPred.graph.adjList;
+				// no cuts: all edges of the graph are kept
+				YPred.stochasticCuts = EdgeMask_t(YPred.getNumEdges(), true);
 				YPred.stochasticCutsAvailable = true;
 			}
 
@@ -300,6 +391,41 @@ namespace HCSearch
 		}
 	}
 
+	void ISearchProcedure::recordStepTimes(vector<double>& stepTimes, int timeBound, SearchMetadata searchMetadata, SearchType searchType)
+	{
+		if (searchMetadata.stepTimes != NULL)
+			*searchMetadata.stepTimes = stepTimes;
+
+		if (searchMetadata.saveAnytimePredictions)
+		{
+			stringstream ssStepTimes;
+			ssStepTimes << Global::settings->paths->OUTPUT_RESULTS_DIR << "steptimes" 
+				<< "_" << SearchTypeStrings[searchType] 
+				<< "_" << DatasetTypeStrings[searchMetadata.setType] 
+				<< "_time" << timeBound 
+					<< "_fold" << searchMetadata.iter 
+					<< "_" << searchMetadata.exampleName << ".txt";
+			SavePrediction::saveStepTimes(stepTimes, ssStepTimes.str());
+		}
+	}
+
+	ISearchProcedure::SearchDeadline::SearchDeadline(SearchType searchType)
+	{
+		this->start = chrono::steady_clock::now();
+		this->enabled = Global::settings->TIME_BUDGET_MS > 0 
+			&& (searchType == LL || searchType == HL || searchType == LC || searchType == HC);
+	}
+
+	bool ISearchProcedure::SearchDeadline::expired() const
+	{
+		return this->enabled && elapsedMilliseconds(this->start) >= Global::settings->TIME_BUDGET_MS;
+	}
+
+	double ISearchProcedure::elapsedMilliseconds(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
 	void ISearchProcedure::trainRanker(IRankModel* ranker, vector< RankFeatures > bestFeatures, vector< double > bestLosses, 
 			vector< RankFeatures > worstFeatures, vector< double > worstLosses)
 	{
@@ -308,7 +434,7 @@ namespace HCSearch
 		{
 			// train
 			SVMRankModel* svmRankModel = dynamic_cast<SVMRankModel*>(ranker);
-			svmRankModel->addTrainingExamples(bestFeatures, worstFeatures);
+			svmRankModel->addTrainingExamples(bestFeatures, worstFeatures, bestLosses, worstLosses);
 		}
 		else if (ranker->rankerType() == VW_RANK)
 		{
@@ -316,6 +442,12 @@ namespace HCSearch
 			VWRankModel* vwRankModel = dynamic_cast<VWRankModel*>(ranker);
 			vwRankModel->addTrainingExamples(bestFeatures, worstFeatures, bestLosses, worstLosses);
 		}
+		else if (ranker->rankerType() == ONLINE_RANK)
+		{
+			// train
+			OnlineRankModel* onlineRankModel = dynamic_cast<OnlineRankModel*>(ranker);
+			onlineRankModel->addTrainingExamples(bestFeatures, worstFeatures, bestLosses, worstLosses);
+		}
 		else
 		{
 			LOG(ERROR) << "unknown ranker type";
@@ -338,7 +470,6 @@ namespace HCSearch
 			bestFeatures.push_back(state->getCostFeatures());
 			bestLosses.push_back(state->getCost());
 			costSet.pop();
-			delete state;
 		}
 
 		// get worst states
@@ -348,7 +479,6 @@ namespace HCSearch
 			worstFeatures.push_back(state->getCostFeatures());
 			worstLosses.push_back(state->getCost());
 			costSet.pop();
-			delete state;
 		}
 
 		// train depending on ranker
@@ -356,7 +486,7 @@ namespace HCSearch
 		{
 			// train
 			SVMRankModel* svmRankModel = dynamic_cast<SVMRankModel*>(ranker);
-			svmRankModel->addTrainingExamples(bestFeatures, worstFeatures);
+			svmRankModel->addTrainingExamples(bestFeatures, worstFeatures, bestLosses, worstLosses);
 
 		}
 		else if (ranker->rankerType() == VW_RANK)
@@ -365,6 +495,13 @@ namespace HCSearch
 			VWRankModel* vwRankModel = dynamic_cast<VWRankModel*>(ranker);
 			vwRankModel->addTrainingExamples(bestFeatures, worstFeatures, bestLosses, worstLosses);
 
+		}
+		else if (ranker->rankerType() == ONLINE_RANK)
+		{
+			// train
+			OnlineRankModel* onlineRankModel = dynamic_cast<OnlineRankModel*>(ranker);
+			onlineRankModel->addTrainingExamples(bestFeatures, worstFeatures, bestLosses, worstLosses);
+
 		}
 		else
 		{
@@ -373,6 +510,20 @@ namespace HCSearch
 		}
 	}
 
+	void ISearchProcedure::resetVisited(SearchNode* root)
+	{
+		lock_guard<std::mutex> guard(this->visitedLock);
+		VisitedSet_t& visited = this->visitedStates[this_thread::get_id()];
+		visited.clear();
+		visited.insert(root->getFingerprint());
+	}
+
+	bool ISearchProcedure::markVisited(SearchNode* state)
+	{
+		lock_guard<std::mutex> guard(this->visitedLock);
+		return this->visitedStates[this_thread::get_id()].insert(state->getFingerprint()).second;
+	}
+
 	ImgLabeling IBasicSearchProcedure::performSearch(SearchType searchType, ImgFeatures& X, ImgLabeling* YTruth, 
 	int timeBound, SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel, 
 	IRankModel* pruneModel, SearchMetadata searchMetadata)
@@ -385,18 +536,29 @@ namespace HCSearch
 		SearchNodeCostPQ costSet;
 		SearchNodeHeuristicPQ openSet;
 
+		// all nodes of this search live in the arena and are freed with it
+		SearchNodeArena arena;
+
+		// the time budget includes the initial prediction and features of the root
+		SearchDeadline deadline(searchType);
+
 		// push initial state into queue
-		SearchNode* root = createRootNode(searchType, X, YTruth, searchSpace, heuristicModel, costModel);
+		// labelings memoized from earlier steps and iterations on this image
+		TranspositionTable* table = acquireTranspositionTable(searchType, X, heuristicModel, costModel);
+
+		SearchNode* root = createRootNode(searchType, X, YTruth, searchSpace, heuristicModel, costModel, &arena, table, &deadline);
 		openSet.push(root);
 		costSet.push(root);
+		resetVisited(root);
 
-		// while the open set is not empty and the time step is less than the time bound,
-		// perform search...
+		// while the open set is not empty, the time step is less than the time bound 
+		// and the time budget has not run out, perform search...
+		vector<double> stepTimes;
 		int timeStep = 0;
-		while (!openSet.empty() && timeStep < timeBound)
+		while (!openSet.empty() && timeStep < timeBound && !deadline.expired())
 		{
 			LOG() << endl << "Running " << SearchTypeStrings[searchType] << " search with time step " << timeStep+1 << "/" << timeBound << "..." << endl;
-			clock_t ticInside = clock();
+			chrono::steady_clock::time_point stepStart = chrono::steady_clock::now();
 
 			// save current best if anytime prediction enabled
 			saveAnyTimePrediction(costSet.top()->getY(), timeStep, searchMetadata, searchType);
@@ -425,8 +587,8 @@ namespace HCSearch
 
 			/***** done with this search step *****/
 
-			clock_t tocInside = clock();
-			LOG() << "search step " << timeStep << " total time: " << (double)(tocInside - ticInside)/CLOCKS_PER_SEC << endl;
+			stepTimes.push_back(elapsedMilliseconds(stepStart));
+			LOG() << "search step " << timeStep << " total time: " << stepTimes.back()/1000 << endl;
 
 			/***** increment time step *****/
 			timeStep++;
@@ -434,6 +596,10 @@ namespace HCSearch
 
 		/***** search is done, return the lowest cost search node *****/
 
+		if (deadline.expired())
+			LOG() << endl << "Time budget of " << Global::settings->TIME_BUDGET_MS << " ms expired after " << timeStep << " steps." << endl;
+		recordStepTimes(stepTimes, timeBound, searchMetadata, searchType);
+
 		if (costSet.empty())
 		{
 			LOG(ERROR) << "the cost set is empty, which is not possible!";
@@ -444,14 +610,14 @@ namespace HCSearch
 		SearchNode* lowestCost = costSet.top();
 		ImgLabeling prediction = lowestCost->getY();
 		LOG() << endl << "Finished search. Cost=" << lowestCost->getCost() << endl;
+		logTranspositionTable(table);
 		LOG() << "Num of outputs generated=" << costSet.size() << endl << endl;
 
 		// use best/worst cost set candidates as training examples for cost learning (if applicable)
 		if (searchType == LEARN_C || searchType == LEARN_C_ORACLE_H)
 			trainCostRanker(costModel, costSet);
 
-		// clean up cost set
-		//deleteQueueElements(costSet);
+		// clean up cost set (nodes are freed with the arena)
 		vector<double> candidateLosses;
 		while (!costSet.empty())
 		{
@@ -462,7 +628,6 @@ namespace HCSearch
 				ImgLabeling YPred = state->getY();
 				candidateLosses.push_back(searchSpace->computeLoss(YPred, *YTruth));
 			}
-			delete state;
 		}
 		if (YTruth != NULL)
 		{
@@ -522,6 +687,11 @@ namespace HCSearch
 		for (vector< SearchNode* >::iterator it = subsetOpenSet.begin(); it != subsetOpenSet.end(); ++it)
 		{
 			SearchNode* current = *it;
+
+			// the remaining elements stay unexpanded once the time budget runs out
+			if (current->budgetExpired())
+				break;
+
 			LOG() << "Expansion Node: Heuristic=" << current->getHeuristic() << ", Cost=" << current->getCost() << endl;
 
 			vector< SearchNode* > expansionSet;
@@ -536,10 +706,14 @@ namespace HCSearch
 			for (vector< SearchNode* >::iterator it = expansionSet.begin(); it != expansionSet.end(); ++it)
 			{
 				SearchNode* state = *it;
-				if (!Global::settings->CHECK_FOR_DUPLICATES || (!isDuplicate(state, candidateSet) && !isDuplicate(state, costSet)))
+				if (!Global::settings->CHECK_FOR_DUPLICATES || markVisited(state))
 				{
 					candidateSet.push(state);
 				}
+				else
+				{
+					releaseNode(state);
+				}
 			}
 		}
 
@@ -644,6 +818,11 @@ namespace HCSearch
 		for (vector< SearchNode* >::iterator it = subsetOpenSet.begin(); it != subsetOpenSet.end(); ++it)
 		{
 			SearchNode* current = *it;
+
+			// the remaining elements stay unexpanded once the time budget runs out
+			if (current->budgetExpired())
+				break;
+
 			LOG() << "Expansion Node: Heuristic=" << current->getHeuristic() << ", Cost=" << current->getCost() << endl;
 
 			vector< SearchNode* > expansionSet;
@@ -658,20 +837,27 @@ namespace HCSearch
 			for (vector< SearchNode* >::iterator it = expansionSet.begin(); it != expansionSet.end(); ++it)
 			{
 				SearchNode* state = *it;
-				if (!isDuplicate(state, candidateSet) && !isDuplicate(state, costSet))
+				if (markVisited(state))
 				{
 					candidateSet.push(state);
 				}
+				else
+				{
+					releaseNode(state);
+				}
 			}
 		}
 
 		// add remaining openSet to candidate set
+		// open set states were marked visited when generated and are already in the cost set,
+		// so with duplicate checking they all count as duplicates and are ignored
+		// (only dropped here, not released)
 		while (!openSet.empty())
 		{
 			SearchNode* current = openSet.top();
 			openSet.pop();
 
-			if (!Global::settings->CHECK_FOR_DUPLICATES || (!isDuplicate(current, candidateSet) && !isDuplicate(current, costSet)))
+			if (!Global::settings->CHECK_FOR_DUPLICATES)
 			{
 				candidateSet.push(current);
 			}
@@ -703,17 +889,27 @@ namespace HCSearch
 	{
 		clock_t tic = clock();
 
-		// set up cost set list to check for duplicates and for learning if necessary
+		// set up cost set list for learning if necessary
 		// maintain best cost and heuristic node pointers
 		SearchNodeList costSet;
 		SearchNode* bestCostNode;
 		SearchNode* bestHeuristicNode;
 
+		// all nodes of this search live in the arena and are freed with it
+		SearchNodeArena arena;
+
+		// the time budget includes the initial prediction and features of the root
+		SearchDeadline deadline(searchType);
+
 		// push initial state into queue
-		SearchNode* root = createRootNode(searchType, X, YTruth, searchSpace, heuristicModel, costModel);
+		// labelings memoized from earlier steps and iterations on this image
+		TranspositionTable* table = acquireTranspositionTable(searchType, X, heuristicModel, costModel);
+
+		SearchNode* root = createRootNode(searchType, X, YTruth, searchSpace, heuristicModel, costModel, &arena, table, &deadline);
 		bestHeuristicNode = root;
 		bestCostNode = root;
 		costSet.push_back(root);
+		resetVisited(root);
 
 		int numOutputs = 1;
 
@@ -736,13 +932,14 @@ namespace HCSearch
 			learningModel = pruneModel;
 		}
 
-		// while the open set is not empty and the time step is less than the time bound,
-		// perform search...
+		// while the open set is not empty, the time step is less than the time bound 
+		// and the time budget has not run out, perform search...
+		vector<double> stepTimes;
 		int timeStep = 0;
-		while (bestHeuristicNode != NULL && timeStep < timeBound)
+		while (bestHeuristicNode != NULL && timeStep < timeBound && !deadline.expired())
 		{
 			LOG() << endl << "Running " << SearchTypeStrings[searchType] << " search with time step " << timeStep+1 << "/" << timeBound << "..." << endl;
-			clock_t ticInside = clock();
+			chrono::steady_clock::time_point stepStart = chrono::steady_clock::now();
 
 			// save current best if anytime prediction enabled
 			saveAnyTimePrediction(bestCostNode->getY(), timeStep, searchMetadata, searchType);
@@ -765,8 +962,8 @@ namespace HCSearch
 
 			/***** done with this search step *****/
 
-			clock_t tocInside = clock();
-			LOG() << "search step " << timeStep << " total time: " << (double)(tocInside - ticInside)/CLOCKS_PER_SEC << endl;
+			stepTimes.push_back(elapsedMilliseconds(stepStart));
+			LOG() << "search step " << timeStep << " total time: " << stepTimes.back()/1000 << endl;
 
 			/***** train if applicable *****/
 
@@ -791,6 +988,10 @@ namespace HCSearch
 
 		/***** search is done, return the lowest cost search node *****/
 
+		if (deadline.expired())
+			LOG() << endl << "Time budget of " << Global::settings->TIME_BUDGET_MS << " ms expired after " << timeStep << " steps." << endl;
+		recordStepTimes(stepTimes, timeBound, searchMetadata, searchType);
+
 		if (bestCostNode == NULL)
 		{
 			LOG(ERROR) << "the cost set is empty, which is not possible!";
@@ -801,6 +1002,7 @@ namespace HCSearch
 		SearchNode* lowestCost = bestCostNode;
 		ImgLabeling prediction = lowestCost->getY();
 		LOG() << endl << "Finished search. Cost=" << lowestCost->getCost() << endl;
+		logTranspositionTable(table);
 		LOG() << "Num of outputs generated=" << numOutputs << endl << endl;
 
 		// use best/worst cost set candidates as training examples for cost learning (if applicable)
@@ -814,7 +1016,7 @@ namespace HCSearch
 			trainRanker(costModel, bestFeatures, bestLosses, worstFeatures, worstLosses);
 		}
 
-		// clean up cost set
+		// clean up cost set (nodes are freed with the arena)
 		vector<double> candidateLosses;
 		while (!costSet.empty())
 		{
@@ -825,7 +1027,6 @@ namespace HCSearch
 				ImgLabeling YPred = state->getY();
 				candidateLosses.push_back(searchSpace->computeLoss(YPred, *YTruth));
 			}
-			delete state;
 		}
 		if (YTruth != NULL)
 		{
@@ -868,9 +1069,9 @@ namespace HCSearch
 		for (vector< SearchNode* >::iterator it = expansionSet.begin(); it != expansionSet.end(); ++it)
 		{
 			SearchNode* state = *it;
-			if (!Global::settings->CHECK_FOR_DUPLICATES || !isDuplicate(state, costSet))
+			if (!Global::settings->CHECK_FOR_DUPLICATES || markVisited(state))
 			{
-				// store to cost set in order to check for duplicates
+				// store to cost set for clean up and learning
 				if (Global::settings->CHECK_FOR_DUPLICATES || searchType == LEARN_C || searchType == LEARN_C_ORACLE_H)
 					costSet.push_back(state);
 
@@ -888,6 +1089,10 @@ namespace HCSearch
 
 				numOutputs++;
 			}
+			else
+			{
+				releaseNode(state);
+			}
 		}
 
 		if (Global::settings->CHECK_FOR_DUPLICATES)
@@ -976,20 +1181,6 @@ namespace HCSearch
 		}
 	}
 
-	bool GreedySearchProcedure::isDuplicate(SearchNode* state, SearchNodeList& list)
-	{
-		for (SearchNodeList::iterator it = list.begin(); it != list.end(); ++it)
-		{
-			SearchNode* current = *it;
-			if (current->getY().graph.nodesData == state->getY().graph.nodesData)
-			{
-				return true;
-			}
-		}
-
-		return false;
-	}
-
 	/**************** Search Node ****************/
 
 	ISearchProcedure::SearchNode::SearchNode()
@@ -997,15 +1188,19 @@ namespace HCSearch
 	}
 
 	ISearchProcedure::SearchNode::SearchNode(ImgFeatures* X, ImgLabeling* YTruth, SearchSpace* searchSpace, 
-			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType)
+			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType, SearchNodeArena* arena, 
+			TranspositionTable* table, const SearchDeadline* deadline)
 	{
-		if (X == NULL || searchSpace == NULL)
+		if (X == NULL || searchSpace == NULL || arena == NULL)
 		{
 			LOG(ERROR) << "invalid parameters for search node initialization.";
 			abort();
 		}
 
 		this->parent = NULL;
+		this->arena = arena;
+		this->table = table;
+		this->deadline = deadline;
 		this->searchSpace = searchSpace;
 		this->searchType = searchType;
 		this->X = X;
@@ -1015,7 +1210,7 @@ namespace HCSearch
 
 		this->YPred = this->searchSpace->getInitialPrediction(*this->X);
 
-		constructorHelper();
+		constructorHelper(true);
 	}
 
 	ISearchProcedure::SearchNode::SearchNode(SearchNode* parent, ImgLabeling YPred)
@@ -1027,6 +1222,9 @@ namespace HCSearch
 		}
 
 		this->parent = parent;
+		this->arena = this->parent->arena;
+		this->table = this->parent->table;
+		this->deadline = this->parent->deadline;
 		this->searchSpace = this->parent->searchSpace;
 		this->searchType = this->parent->searchType;
 		this->X = this->parent->X;
@@ -1036,17 +1234,94 @@ namespace HCSearch
 
 		this->YPred = YPred;
 
-		constructorHelper();
+		constructorHelper(true);
+	}
+
+	ISearchProcedure::SearchNode::SearchNode(SearchNode* parent, ImgCandidate YCandidate, bool rankNow)
+	{
+		if (parent == NULL)
+		{
+			LOG(ERROR) << "invalid parameters for search node generation.";
+			abort();
+		}
+
+		this->parent = parent;
+		this->arena = this->parent->arena;
+		this->table = this->parent->table;
+		this->deadline = this->parent->deadline;
+		this->searchSpace = this->parent->searchSpace;
+		this->searchType = this->parent->searchType;
+		this->X = this->parent->X;
+		this->YTruth = this->parent->YTruth;
+		this->heuristicModel = this->parent->heuristicModel;
+		this->costModel = this->parent->costModel;
+
+		this->YPred = YCandidate.labeling;
+		this->action = YCandidate.action;
+
+		constructorHelper(rankNow);
+	}
+
+	ISearchProcedure::SearchNode::SearchNode(SearchNode* parent, const ImgLabeling& YTemplate, ImgCandidateDelta& delta, SearchNodeStorage& storage)
+	{
+		if (parent == NULL)
+		{
+			LOG(ERROR) << "invalid parameters for search node generation.";
+			abort();
+		}
+
+		this->parent = parent;
+		this->arena = this->parent->arena;
+		this->table = this->parent->table;
+		this->deadline = this->parent->deadline;
+		this->searchSpace = this->parent->searchSpace;
+		this->searchType = this->parent->searchType;
+		this->X = this->parent->X;
+		this->YTruth = this->parent->YTruth;
+		this->heuristicModel = this->parent->heuristicModel;
+		this->costModel = this->parent->costModel;
+
+		// vectors of the right size are overwritten in place below
+		this->YPred.graph.nodesData.swap(storage.labels);
+		this->heuristicFeatures.data.swap(storage.heuristicFeatures);
+		this->costFeatures.data.swap(storage.costFeatures);
+
+		this->YPred = YTemplate;
+		delta.apply(this->YPred);
+		this->action.swap(delta.action);
+
+		constructorHelper(false);
 	}
 
-	void ISearchProcedure::SearchNode::constructorHelper()
+	void ISearchProcedure::SearchNode::constructorHelper(bool rankNow)
 	{
+		this->fingerprint = computeFingerprint();
+		this->fromTable = false;
+
+		// reuse what is known of a labeling reached before
+		TranspositionTable::Entry entry;
+		const bool found = this->table != NULL && this->table->lookup(this->fingerprint, entry);
+		const bool featuresFound = found && entry.hasFeatures;
+		if (featuresFound)
+		{
+			this->heuristicFeatures = entry.heuristicFeatures;
+			this->costFeatures = entry.costFeatures;
+		}
+		if (found && entry.hasValues)
+		{
+			this->heuristic = entry.heuristic;
+			this->cost = entry.cost;
+			this->fromTable = true;
+			return;
+		}
+
 		double loss;
 		if (this->YTruth != NULL)
 		{
 			loss = this->searchSpace->computeLoss(this->YPred, *this->YTruth);
 		}
 
+		// heuristic and cost from the models are filled in after the switch
 		switch (this->searchType)
 		{
 			case LL:
@@ -1057,44 +1332,55 @@ namespace HCSearch
 			}
 			case HL:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
-				this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
+				if (!featuresFound)
+					computeHeuristicFeatures();
 				this->cost = loss;
 				break;
 			}
 			case LC:
 			{
 				this->heuristic = loss;
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
-				this->cost = this->costModel->rank(this->costFeatures);
+				if (!featuresFound)
+					computeCostFeatures();
 				break;
 			}
 			case HC:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
-				this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
-				this->cost = this->costModel->rank(this->costFeatures);
+				if (!featuresFound)
+				{
+					computeHeuristicFeatures();
+					if (this->searchSpace->sharesFeatures())
+						this->costFeatures = this->heuristicFeatures;
+					else
+						computeCostFeatures();
+				}
 				break;
 			}
 			case LEARN_H:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
+				if (!featuresFound)
+					computeHeuristicFeatures();
 				this->heuristic = loss;
 				this->cost = loss;
 				break;
 			}
 			case LEARN_C:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
-				this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
+				if (!featuresFound)
+				{
+					computeHeuristicFeatures();
+					if (this->searchSpace->sharesFeatures())
+						this->costFeatures = this->heuristicFeatures;
+					else
+						computeCostFeatures();
+				}
 				this->cost = loss;
 				break;
 			}
 			case LEARN_C_ORACLE_H:
 			{
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
+				if (!featuresFound)
+					computeCostFeatures();
 				this->heuristic = loss;
 				this->cost = loss;
 				break;
@@ -1108,28 +1394,216 @@ namespace HCSearch
 			default:
 				LOG(ERROR) << "searchType constant is invalid.";
 		}
+
+		if (rankNow)
+		{
+			if (usesHeuristicModel())
+				this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
+			if (usesCostModel())
+				this->cost = this->costModel->rank(this->costFeatures);
+			storeInTable();
+		}
+	}
+
+	bool ISearchProcedure::SearchNode::usesHeuristicModel()
+	{
+		return this->searchType == HL || this->searchType == HC || this->searchType == LEARN_C;
+	}
+
+	bool ISearchProcedure::SearchNode::usesCostModel()
+	{
+		return this->searchType == LC || this->searchType == HC;
+	}
+
+	bool ISearchProcedure::SearchNode::hasFixedValues()
+	{
+		// models only change while learning
+		return this->searchType == LL || this->searchType == HL || this->searchType == LC || this->searchType == HC;
+	}
+
+	void ISearchProcedure::SearchNode::storeInTable()
+	{
+		if (this->table == NULL)
+			return;
+
+		TranspositionTable::Entry entry;
+		entry.hasValues = hasFixedValues();
+		entry.heuristic = this->heuristic;
+		entry.cost = this->cost;
+		entry.hasFeatures = this->table->storesFeatures();
+		if (!entry.hasValues && !entry.hasFeatures)
+			return;
+
+		if (entry.hasFeatures)
+		{
+			entry.heuristicFeatures = this->heuristicFeatures;
+			entry.costFeatures = this->costFeatures;
+		}
+		this->table->insert(this->fingerprint, entry);
+	}
+
+	void ISearchProcedure::SearchNode::rankNodes(vector< SearchNode* >& nodes)
+	{
+		// nodes taken from the transposition table are already ranked
+		vector< SearchNode* > pending;
+		pending.reserve(nodes.size());
+		for (vector< SearchNode* >::iterator it = nodes.begin(); it != nodes.end(); ++it)
+		{
+			if (!(*it)->fromTable)
+				pending.push_back(*it);
+		}
+
+		const int numNodes = pending.size();
+		if (numNodes == 0)
+			return;
+
+		// stack the features of all nodes so each model runs a single matrix-vector product; 
+		// shared heuristic and cost features are stacked once for both models
+		SearchNode* first = pending[0];
+		const bool shared = first->usesHeuristicModel() && first->usesCostModel() && first->searchSpace->sharesFeatures();
+		if (first->usesHeuristicModel())
+		{
+			vector<RankFeatures> featuresList;
+			featuresList.reserve(numNodes);
+			for (int i = 0; i < numNodes; i++)
+				featuresList.push_back(pending[i]->heuristicFeatures);
+
+			MatrixXd featuresMatrix = IRankModel::stackFeatures(featuresList);
+			VectorXd heuristics = first->heuristicModel->rankBatch(featuresMatrix);
+			for (int i = 0; i < numNodes; i++)
+				pending[i]->heuristic = heuristics(i);
+
+			if (shared)
+			{
+				VectorXd costs = first->costModel->rankBatch(featuresMatrix);
+				for (int i = 0; i < numNodes; i++)
+					pending[i]->cost = costs(i);
+			}
+		}
+		if (first->usesCostModel() && !shared)
+		{
+			vector<RankFeatures> featuresList;
+			featuresList.reserve(numNodes);
+			for (int i = 0; i < numNodes; i++)
+				featuresList.push_back(pending[i]->costFeatures);
+
+			VectorXd costs = first->costModel->rankBatch(IRankModel::stackFeatures(featuresList));
+			for (int i = 0; i < numNodes; i++)
+				pending[i]->cost = costs(i);
+		}
+
+		for (int i = 0; i < numNodes; i++)
+			pending[i]->storeInTable();
+	}
+
+	void ISearchProcedure::SearchNode::computeHeuristicFeatures()
+	{
+		// update from parent features when only the action nodes changed 
+		// (the parent may have come from the transposition table without features)
+		if (this->parent != NULL && !this->action.empty() && this->parent->heuristicFeatures.data.size() > 0)
+			this->searchSpace->computeHeuristicFeatures(*this->X, this->parent->YPred, 
+				this->parent->heuristicFeatures, this->YPred, this->action, this->heuristicFeatures);
+		else
+			this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
+	}
+
+	void ISearchProcedure::SearchNode::computeCostFeatures()
+	{
+		// update from parent features when only the action nodes changed
+		if (this->parent != NULL && !this->action.empty() && this->parent->costFeatures.data.size() > 0)
+			this->searchSpace->computeCostFeatures(*this->X, this->parent->YPred, 
+				this->parent->costFeatures, this->YPred, this->action, this->costFeatures);
+		else
+			this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
+	}
+
+	Fingerprint_t ISearchProcedure::SearchNode::computeFingerprint()
+	{
+		// update from parent fingerprint when only the action nodes changed
+		if (this->parent != NULL && !this->action.empty())
+		{
+			Fingerprint_t fingerprint = this->parent->fingerprint;
+			for (set<int>::iterator it = this->action.begin(); it != this->action.end(); ++it)
+			{
+				int node = *it;
+				fingerprint ^= ImgLabeling::nodeFingerprint(node, this->parent->YPred.getLabel(node));
+				fingerprint ^= ImgLabeling::nodeFingerprint(node, this->YPred.getLabel(node));
+			}
+			return fingerprint;
+		}
+
+		return this->YPred.getFingerprint();
 	}
 
 	vector< ISearchProcedure::SearchNode* > ISearchProcedure::SearchNode::generateSuccessorNodes(bool prune, int timeStep, int timeBound, ImgLabeling* YTruth)
 	{
 		vector< SearchNode* > successors;
 
-		// generate successors
-		vector< ImgCandidate > YPredSet = this->searchSpace->generateSuccessors(*this->X, this->YPred, timeStep, timeBound);
-
-		// prune successors
-		LOG() << "pruning successors..." << endl;
+		// generate successors as label changes, pruning them while they are generated; 
+		// full labelings are only built in the successor nodes
+		ImgLabeling YTemplate;
+		vector< ImgCandidateDelta > deltas;
 		if (prune)
-			YPredSet = this->searchSpace->pruneSuccessors(*this->X, this->YPred, YPredSet, YTruth, this->searchSpace->getLossFunction());
-		LOG() << "successors pruned." << endl;
+		{
+			LOG() << "pruning successors..." << endl;
+			deltas = this->searchSpace->generatePrunedSuccessorDeltas(*this->X, this->YPred, timeStep, timeBound, 
+				YTruth, this->searchSpace->getLossFunction(), YTemplate);
+			LOG() << "successors pruned." << endl;
+		}
+		else
+		{
+			deltas = this->searchSpace->generateSuccessorDeltas(*this->X, this->YPred, timeStep, timeBound, YTemplate);
+		}
 
-		for (vector< ImgCandidate >::iterator it = YPredSet.begin(); it != YPredSet.end(); it++)
+		// no time left to compute features of the candidates
+		if (budgetExpired())
+			return successors;
+
+		// compute features of the successors in parallel;
+		// each slot is filled by index so the order does not depend on threads
+		const int numCandidates = deltas.size();
+		vector< void* > slots(numCandidates);
+		vector< SearchNodeStorage > storage(numCandidates);
+		for (int i = 0; i < numCandidates; i++)
 		{
-			ImgCandidate YCandidate = *it;
-			ImgLabeling YCandPred = YCandidate.labeling;
-			SearchNode* successor = new SearchNode(this, YCandPred);
-			successors.push_back(successor);
+			slots[i] = this->arena->allocate();
+			this->arena->acquireStorage(storage[i]);
 		}
+
+		successors.resize(numCandidates, NULL);
+		function<void(int)> createSuccessor = [&](int i)
+		{
+			// candidates not reached before the time budget runs out are dropped
+			if (budgetExpired())
+				return;
+
+			successors[i] = new (slots[i]) SearchNode(this, YTemplate, deltas[i], storage[i]);
+		};
+		if (Global::threadPool != NULL)
+			Global::threadPool->parallelFor(numCandidates, createSuccessor);
+		else
+			for (int i = 0; i < numCandidates; i++)
+				createSuccessor(i);
+
+		// give back the slots of dropped candidates
+		int numCreated = 0;
+		for (int i = 0; i < numCandidates; i++)
+		{
+			if (successors[i] != NULL)
+			{
+				successors[numCreated++] = successors[i];
+			}
+			else
+			{
+				this->arena->deallocate(slots[i]);
+				this->arena->recycleStorage(storage[i]);
+			}
+		}
+		successors.resize(numCreated);
+
+		// score all successors in one batch per model
+		rankNodes(successors);
+
 		return successors;
 	}
 
@@ -1272,7 +1746,7 @@ namespace HCSearch
 			if (learningModel->rankerType() == SVM_RANK)
 			{
 				SVMRankModel* svmModel = dynamic_cast<SVMRankModel*>(learningModel);
-				svmModel->addTrainingExamples(goodFeatures, badFeatures);
+				svmModel->addTrainingExamples(goodFeatures, badFeatures, goodLosses, badLosses);
 
 			}
 			else if (learningModel->rankerType() == VW_RANK)
@@ -1280,6 +1754,12 @@ namespace HCSearch
 				VWRankModel* vwModel = dynamic_cast<VWRankModel*>(learningModel);
 				vwModel->addTrainingExamples(goodFeatures, badFeatures, goodLosses, badLosses);
 
+			}
+			else if (learningModel->rankerType() == ONLINE_RANK)
+			{
+				OnlineRankModel* onlineModel = dynamic_cast<OnlineRankModel*>(learningModel);
+				onlineModel->addTrainingExamples(goodFeatures, badFeatures, goodLosses, badLosses);
+
 			}
 			else
 			{
@@ -1297,7 +1777,7 @@ namespace HCSearch
 		if (goodExists)
 		{
 			ImgLabeling bestCandidate = bestGoodCandidate.YCandidate.labeling;
-			SearchNode* successor = new SearchNode(this, bestCandidate);
+			SearchNode* successor = new (this->arena->allocate()) SearchNode(this, bestCandidate);
 			successors.push_back(successor);
 		}
 
@@ -1343,6 +1823,15 @@ namespace HCSearch
 				else
 					vwModel->addTrainingExample(prevPruneFeatures, pruneFeatures, prevLoss, candLoss);
 
+			}
+			else if (learningModel->rankerType() == ONLINE_RANK)
+			{
+				OnlineRankModel* onlineModel = dynamic_cast<OnlineRankModel*>(learningModel);
+				if (candLoss <= prevLoss)
+					onlineModel->addTrainingExample(pruneFeatures, prevPruneFeatures);
+				else
+					onlineModel->addTrainingExample(prevPruneFeatures, pruneFeatures);
+
 			}
 			else
 			{
@@ -1351,7 +1840,7 @@ namespace HCSearch
 			}
 
 			// generate examples
-			SearchNode* successor = new SearchNode(this, YCandPred);
+			SearchNode* successor = new (this->arena->allocate()) SearchNode(this, YCandPred);
 			successors.push_back(successor);
 		}
 		return successors;
@@ -1394,6 +1883,28 @@ namespace HCSearch
 		return this->YPred;
 	}
 
+	Fingerprint_t ISearchProcedure::SearchNode::getFingerprint()
+	{
+		return this->fingerprint;
+	}
+
+	ISearchProcedure::SearchNodeArena* ISearchProcedure::SearchNode::getArena()
+	{
+		return this->arena;
+	}
+
+	bool ISearchProcedure::SearchNode::budgetExpired()
+	{
+		return this->deadline != NULL && this->deadline->expired();
+	}
+
+	void ISearchProcedure::SearchNode::releaseStorage(SearchNodeStorage& storage)
+	{
+		storage.labels.swap(this->YPred.graph.nodesData);
+		storage.heuristicFeatures.swap(this->heuristicFeatures.data);
+		storage.costFeatures.swap(this->costFeatures.data);
+	}
+
 	SearchType ISearchProcedure::SearchNode::getType()
 	{
 		return this->searchType;
@@ -1410,4 +1921,180 @@ namespace HCSearch
 	{
 		return lhs->getCost() > rhs->getCost();
 	}
+
+	/**************** Search Node Arena ****************/
+
+	const int ISearchProcedure::SearchNodeArena::BLOCK_SIZE = 256;
+
+	ISearchProcedure::SearchNodeArena::SearchNodeArena()
+	{
+		this->numSlotsUsed = 0;
+	}
+
+	ISearchProcedure::SearchNodeArena::~SearchNodeArena()
+	{
+		// destroy every node that was not already released
+		unordered_set< SearchNode* > released(this->freeSlots.begin(), this->freeSlots.end());
+		for (int i = 0; i < this->numSlotsUsed; i++)
+		{
+			SearchNode* node = this->blocks[i / BLOCK_SIZE] + (i % BLOCK_SIZE);
+			if (released.count(node) == 0)
+				node->~SearchNode();
+		}
+
+		for (vector< SearchNode* >::iterator it = this->blocks.begin(); it != this->blocks.end(); ++it)
+			::operator delete(*it);
+	}
+
+	void* ISearchProcedure::SearchNodeArena::allocate()
+	{
+		if (!this->freeSlots.empty())
+		{
+			SearchNode* slot = this->freeSlots.back();
+			this->freeSlots.pop_back();
+			return slot;
+		}
+
+		if (this->numSlotsUsed == static_cast<int>(this->blocks.size()) * BLOCK_SIZE)
+			this->blocks.push_back(static_cast<SearchNode*>(::operator new(BLOCK_SIZE * sizeof(SearchNode))));
+
+		SearchNode* slot = this->blocks.back() + (this->numSlotsUsed % BLOCK_SIZE);
+		this->numSlotsUsed++;
+		return slot;
+	}
+
+	void ISearchProcedure::SearchNodeArena::release(SearchNode* node)
+	{
+		SearchNodeStorage storage;
+		node->releaseStorage(storage);
+		node->~SearchNode();
+		this->freeSlots.push_back(node);
+		recycleStorage(storage);
+	}
+
+	void ISearchProcedure::SearchNodeArena::deallocate(void* slot)
+	{
+		this->freeSlots.push_back(static_cast<SearchNode*>(slot));
+	}
+
+	void ISearchProcedure::SearchNodeArena::acquireStorage(SearchNodeStorage& storage)
+	{
+		if (this->freeStorage.empty())
+			return;
+
+		SearchNodeStorage& last = this->freeStorage.back();
+		storage.labels.swap(last.labels);
+		storage.heuristicFeatures.swap(last.heuristicFeatures);
+		storage.costFeatures.swap(last.costFeatures);
+		this->freeStorage.pop_back();
+	}
+
+	void ISearchProcedure::SearchNodeArena::recycleStorage(SearchNodeStorage& storage)
+	{
+		if (storage.labels.size() == 0 && storage.heuristicFeatures.size() == 0 && storage.costFeatures.size() == 0)
+			return;
+
+		this->freeStorage.push_back(SearchNodeStorage());
+		SearchNodeStorage& last = this->freeStorage.back();
+		last.labels.swap(storage.labels);
+		last.heuristicFeatures.swap(storage.heuristicFeatures);
+		last.costFeatures.swap(storage.costFeatures);
+	}
+
+	int ISearchProcedure::SearchNodeArena::storageSize()
+	{
+		return this->freeStorage.size();
+	}
+
+	int ISearchProcedure::SearchNodeArena::size()
+	{
+		return this->numSlotsUsed - this->freeSlots.size();
+	}
+
+	/**************** Transposition Table ****************/
+
+	ISearchProcedure::TranspositionTable::TranspositionTable(int capacity, bool storeFeatures)
+	{
+		this->capacity = capacity;
+		this->storeFeatures = storeFeatures;
+		this->X = NULL;
+		this->heuristicModel = NULL;
+		this->costModel = NULL;
+		this->hits = 0;
+		this->misses = 0;
+	}
+
+	void ISearchProcedure::TranspositionTable::prepare(ImgFeatures* X, SearchType searchType, IRankModel* heuristicModel, IRankModel* costModel)
+	{
+		lock_guard<std::mutex> guard(this->lock);
+		if (X != this->X || searchType != this->searchType || heuristicModel != this->heuristicModel || costModel != this->costModel)
+		{
+			this->entries.clear();
+			this->index.clear();
+			this->X = X;
+			this->searchType = searchType;
+			this->heuristicModel = heuristicModel;
+			this->costModel = costModel;
+		}
+		this->hits = 0;
+		this->misses = 0;
+	}
+
+	bool ISearchProcedure::TranspositionTable::lookup(Fingerprint_t fingerprint, Entry& entry)
+	{
+		lock_guard<std::mutex> guard(this->lock);
+		unordered_map< Fingerprint_t, EntryList_t::iterator >::iterator it = this->index.find(fingerprint);
+		if (it == this->index.end())
+		{
+			this->misses++;
+			return false;
+		}
+
+		this->hits++;
+		this->entries.splice(this->entries.begin(), this->entries, it->second);
+		entry = it->second->second;
+		return true;
+	}
+
+	void ISearchProcedure::TranspositionTable::insert(Fingerprint_t fingerprint, const Entry& entry)
+	{
+		lock_guard<std::mutex> guard(this->lock);
+		unordered_map< Fingerprint_t, EntryList_t::iterator >::iterator it = this->index.find(fingerprint);
+		if (it != this->index.end())
+		{
+			it->second->second = entry;
+			this->entries.splice(this->entries.begin(), this->entries, it->second);
+			return;
+		}
+
+		if (static_cast<int>(this->index.size()) >= this->capacity)
+		{
+			this->index.erase(this->entries.back().first);
+			this->entries.pop_back();
+		}
+
+		this->entries.push_front(make_pair(fingerprint, entry));
+		this->index[fingerprint] = this->entries.begin();
+	}
+
+	bool ISearchProcedure::TranspositionTable::storesFeatures()
+	{
+		return this->storeFeatures;
+	}
+
+	long long ISearchProcedure::TranspositionTable::getHits()
+	{
+		return this->hits;
+	}
+
+	long long ISearchProcedure::TranspositionTable::getMisses()
+	{
+		return this->misses;
+	}
+
+	int ISearchProcedure::TranspositionTable::size()
+	{
+		lock_guard<std::mutex> guard(this->lock);
+		return this->index.size();
+	}
 }
\ No newline at end of file
@@ -2,6 +2,12 @@
 #define SEARCHPROCEDURE_HPP
 
 #include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <chrono>
 #include "DataStructures.hpp"
 #include "SearchSpace.hpp"
 
@@ -31,6 +37,11 @@ namespace HCSearch
 		static void saveLabelMask(ImgFeatures& X, ImgLabeling& YPred, string fileName);
 
 		static void saveCandidateLosses(vector<double>& losses, string fileName);
+
+		/*!
+		 * Save the wall-clock milliseconds of each search step.
+		 */
+		static void saveStepTimes(vector<double>& stepTimes, string fileName);
 	};
 
 	class Training
@@ -73,20 +84,56 @@ namespace HCSearch
 			// stochastic iteration
 			int iter;
 
+			// wall-clock milliseconds of each search step are stored here if not NULL
+			vector<double>* stepTimes;
+
 		public:
 			SearchMetadata();
 		};
+
+		/*!
+		 * @brief Wall-clock budget (Settings::TIME_BUDGET_MS) of one search. 
+		 * 
+		 * Only inference searches (LL, HL, LC, HC) are budgeted, 
+		 * so that learning does not depend on timing.
+		 */
+		class SearchDeadline
+		{
+			chrono::steady_clock::time_point start; //!< Time the search started
+			bool enabled; //!< False for learning searches or without a budget
+
+		public:
+			/*!
+			 * Start the clock of a search.
+			 */
+			SearchDeadline(SearchType searchType);
+
+			/*!
+			 * @brief Returns true if the budget has run out.
+			 */
+			bool expired() const;
+		};
 	
 	protected:
 		class SearchNode;
+		class SearchNodeStorage;
+		class SearchNodeArena;
+		class TranspositionTable;
 		class CompareByHeuristic;
 		class CompareByCost;
 
 		typedef priority_queue<SearchNode*, vector<SearchNode*>, CompareByHeuristic> SearchNodeHeuristicPQ;
 		typedef priority_queue<SearchNode*, vector<SearchNode*>, CompareByCost> SearchNodeCostPQ;
+		typedef unordered_set< Fingerprint_t > VisitedSet_t;
+
+		map< thread::id, VisitedSet_t > visitedStates; //!< Fingerprints of states generated in the current search of each thread
+		std::mutex visitedLock; //!< Guards visitedStates
+
+		map< thread::id, TranspositionTable* > transpositionTables; //!< Memoized labelings of the image searched by each thread
+		std::mutex transpositionLock; //!< Guards transpositionTables
 
 	public:
-		virtual ~ISearchProcedure() {}
+		virtual ~ISearchProcedure();
 
 		/*!
 		 * @brief Search procedure implemented by extending class.
@@ -102,12 +149,56 @@ namespace HCSearch
 		 * @brief Create the root node of the search tree.
 		 */
 		SearchNode* createRootNode(SearchType searchType, ImgFeatures& X, ImgLabeling* YTruth, 
-			SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel);
+			SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel, SearchNodeArena* arena, 
+			TranspositionTable* table, const SearchDeadline* deadline);
+
+		/*!
+		 * @brief Get the transposition table of the calling thread for a search. 
+		 * It is kept while the same image is searched with the same models 
+		 * (e.g. over stochastic iterations) and cleared otherwise.
+		 * @return Returns NULL if Settings::TRANSPOSITION_TABLE_SIZE is 0
+		 */
+		TranspositionTable* acquireTranspositionTable(SearchType searchType, ImgFeatures& X, 
+			IRankModel* heuristicModel, IRankModel* costModel);
+
+		/*!
+		 * @brief Log the hits and misses of the transposition table during a search.
+		 */
+		static void logTranspositionTable(TranspositionTable* table);
+
+		/*!
+		 * @brief Destroy a node before the end of the search (e.g. a duplicate). 
+		 * Its slot in the arena is reused.
+		 */
+		static void releaseNode(SearchNode* state);
 
 		void saveAnyTimePrediction(ImgLabeling YPred, int timeBound, SearchMetadata searchMetadata, SearchType searchType);
+
+		/*!
+		 * @brief Hand the step times of a finished search to the meta data 
+		 * and save them with the anytime predictions if enabled.
+		 */
+		void recordStepTimes(vector<double>& stepTimes, int timeBound, SearchMetadata searchMetadata, SearchType searchType);
+
+		/*!
+		 * @brief Wall-clock milliseconds elapsed since the given time.
+		 */
+		static double elapsedMilliseconds(chrono::steady_clock::time_point start);
+
 		void trainRanker(IRankModel* ranker, vector< RankFeatures > bestFeatures, vector< double > bestLosses, 
 			vector< RankFeatures > worstFeatures, vector< double > worstLosses);
 		void trainCostRanker(IRankModel* ranker, SearchNodeCostPQ& costSet);
+
+		/*!
+		 * @brief Clear the visited states of the calling thread and mark the root as visited.
+		 */
+		void resetVisited(SearchNode* root);
+
+		/*!
+		 * @brief Mark the state as visited.
+		 * @return Returns false if the state was already visited (duplicate)
+		 */
+		bool markVisited(SearchNode* state);
 	};
 
 	/*!
@@ -130,7 +221,7 @@ namespace HCSearch
 		/*!
 		 * @brief Stub for expanding the elements.
 		 * 
-		 * openSet may be modified. costSet is used for duplicate checking.
+		 * openSet may be modified. Duplicate states are checked against the visited states and deleted.
 		 */
 		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet,
 			IRankModel* pruneModel, ImgLabeling* YTruth, SearchType searchType, int timeStep, int timeBound)=0;
@@ -145,12 +236,6 @@ namespace HCSearch
 		virtual void chooseSuccessors(SearchType searchType, SearchNodeHeuristicPQ& candidateSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet, 
 			vector< RankFeatures >& bestSet, vector< double >& bestLosses, vector< RankFeatures >& worstSet, vector< double >& worstLosses)=0;
 
-		/*!
-		 * @brief Checks if the state is duplicate among the states in the priority queue.
-		 */
-		template <class T>
-		bool isDuplicate(SearchNode* state, T& pq);
-
 		/*!
 		 * @brief Empty priority queue and delete all elements.
 		 */
@@ -203,6 +288,13 @@ namespace HCSearch
 		~BestFirstBeamSearchProcedure();
 
 		virtual vector< SearchNode* > selectSubsetOpenSet(SearchNodeHeuristicPQ& openSet);
+
+		/*!
+		 * @brief Expand the elements and add the rest of the open set to the candidates.
+		 * 
+		 * With Settings::CHECK_FOR_DUPLICATES, the rest of the open set is ignored: 
+		 * those states were visited when generated and are already in the cost set.
+		 */
 		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet, 
 			IRankModel* pruneModel, ImgLabeling* YTruth, SearchType searchType, int timeStep, int timeBound);
 	};
@@ -229,7 +321,7 @@ namespace HCSearch
 		/*!
 		 * @brief Stub for expanding the element. 
 		 * 
-		 * (costSet used for checking duplicates.)
+		 * (Duplicate states are checked against the visited states and deleted.)
 		 * 
 		 * @post bestHeuristicNode and bestCostNode updated with the best node, 
 		 */
@@ -243,11 +335,6 @@ namespace HCSearch
 		 */
 		void sortNodes(SearchType searchType, SearchNodeList& candidateSet, 
 			vector< RankFeatures >& bestSet, vector< double >& bestLosses, vector< RankFeatures >& worstSet, vector< double >& worstLosses);
-
-		/*!
-		 * @brief Checks if the state is duplicate among the states in the priority queue.
-		 */
-		bool isDuplicate(SearchNode* state, SearchNodeList& list);
 	};
 
 	/*! @} */
@@ -260,12 +347,18 @@ namespace HCSearch
 	{
 	protected:
 		SearchNode* parent; //!< Pointer to parent node
+		SearchNodeArena* arena; //!< Storage of the nodes of the search
+		TranspositionTable* table; //!< Memoized values and features of labelings (NULL if disabled)
+		const SearchDeadline* deadline; //!< Time budget of the search
+		bool fromTable; //!< True if heuristic and cost were taken from the table
 		SearchSpace* searchSpace; //!< Pointer to search space
 		SearchType searchType; //!< Search type
 
 		ImgFeatures* X; //!< Structured features of node
 		ImgLabeling YPred; //<! Structured labeling of node
 		ImgLabeling* YTruth; //!< Pointer to groundtruth labeling
+		set<int> action; //!< Nodes changed from parent labeling
+		Fingerprint_t fingerprint; //!< Fingerprint of labeling
 
 		RankFeatures heuristicFeatures; //!< Heuristic features
 		IRankModel* heuristicModel; //!< Heuristic model
@@ -282,7 +375,8 @@ namespace HCSearch
 		 * Node initialization constructor.
 		 */
 		SearchNode(ImgFeatures* X, ImgLabeling* YTruth, SearchSpace* searchSpace, 
-			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType);
+			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType, SearchNodeArena* arena, 
+			TranspositionTable* table, const SearchDeadline* deadline);
 
 		/*!
 		 * Node generation constructor.
@@ -290,7 +384,24 @@ namespace HCSearch
 		SearchNode(SearchNode* parent, ImgLabeling YPred);
 
 		/*!
-		 * Generate successor nodes.
+		 * Node generation constructor from a candidate. 
+		 * Features are updated from the parent using the candidate action.
+		 * If rankNow is false, the heuristic/cost models are not run 
+		 * and the caller ranks the node in a batch.
+		 */
+		SearchNode(SearchNode* parent, ImgCandidate YCandidate, bool rankNow);
+
+		/*!
+		 * Node generation constructor from a candidate delta. 
+		 * The labeling is built from the template in the vectors of the given storage 
+		 * and the action is taken over from the delta. Features are updated from the parent. 
+		 * The heuristic/cost models are not run; the caller ranks the node in a batch.
+		 */
+		SearchNode(SearchNode* parent, const ImgLabeling& YTemplate, ImgCandidateDelta& delta, SearchNodeStorage& storage);
+
+		/*!
+		 * Generate successor nodes. 
+		 * Once the time budget runs out, the remaining candidates are dropped.
 		 */
 		vector< SearchNode* > generateSuccessorNodes(bool prune, int timeStep, int timeBound, ImgLabeling* YTruth);
 
@@ -329,6 +440,26 @@ namespace HCSearch
 		 */
 		ImgLabeling getY();
 
+		/*!
+		 * Get the fingerprint of the labeling of the node.
+		 */
+		Fingerprint_t getFingerprint();
+
+		/*!
+		 * Get the arena the node was allocated in.
+		 */
+		SearchNodeArena* getArena();
+
+		/*!
+		 * Returns true if the time budget of the search has run out.
+		 */
+		bool budgetExpired();
+
+		/*!
+		 * Hand the label and feature vectors of the node over to storage before it is destroyed.
+		 */
+		void releaseStorage(SearchNodeStorage& storage);
+
 	protected:
 		/*!
 		 * Return type of search node.
@@ -336,7 +467,15 @@ namespace HCSearch
 		SearchType getType();
 
 	private:
-		void constructorHelper();
+		void constructorHelper(bool rankNow);
+		bool usesHeuristicModel();
+		bool usesCostModel();
+		bool hasFixedValues();
+		void storeInTable();
+		static void rankNodes(vector< SearchNode* >& nodes);
+		void computeHeuristicFeatures();
+		void computeCostFeatures();
+		Fingerprint_t computeFingerprint();
 	};
 
 	/**************** Compare Search Node ****************/
@@ -353,34 +492,161 @@ namespace HCSearch
 		bool operator() (SearchNode*& lhs, SearchNode*& rhs) const;
 	};
 
-	/**************** Template definitions ****************/
+	/**************** Search Node Arena ****************/
 
-	template <class T>
-	bool IBasicSearchProcedure::isDuplicate(SearchNode* state, T& pq)
+	/*!
+	 * @brief Label and feature vectors of a search node, 
+	 * passed from released nodes to new nodes by swapping.
+	 */
+	class ISearchProcedure::SearchNodeStorage
 	{
-		int size = pq.size();
-		bool isDuplicate = false;
+	public:
+		VectorXi labels; //!< Labels of the labeling
+		VectorXd heuristicFeatures; //!< Heuristic features
+		VectorXd costFeatures; //!< Cost features
+	};
 
-		T temp;
+	/*!
+	 * @brief Storage for the search nodes of one search.
+	 * 
+	 * Nodes are constructed in place in fixed size blocks 
+	 * and all destroyed at once when the arena goes out of scope. 
+	 * Nodes released earlier are destroyed and their slots reused, 
+	 * and so are their label and feature vectors, which successors 
+	 * are built in instead of allocating new ones. 
+	 * Nodes alive until the end of the search keep their own vectors, 
+	 * which are freed with the node.
+	 * Allocation and release are not thread safe.
+	 */
+	class ISearchProcedure::SearchNodeArena
+	{
+		static const int BLOCK_SIZE;
+
+		vector< SearchNode* > blocks; //!< Blocks of BLOCK_SIZE node slots
+		vector< SearchNode* > freeSlots; //!< Slots of released nodes
+		int numSlotsUsed; //!< Number of slots handed out from the blocks
+		vector< SearchNodeStorage > freeStorage; //!< Vectors of released nodes
+
+	public:
+		SearchNodeArena();
+		~SearchNodeArena();
+
+		/*!
+		 * Get uninitialized storage for one node, to be constructed with placement new.
+		 */
+		void* allocate();
+
+		/*!
+		 * Destroy a node and keep its slot for reuse.
+		 */
+		void release(SearchNode* node);
+
+		/*!
+		 * Return storage from allocate() on which no node was constructed.
+		 */
+		void deallocate(void* slot);
+
+		/*!
+		 * Hand out the vectors of a released node for a new node 
+		 * (storage is left unchanged if there are none).
+		 */
+		void acquireStorage(SearchNodeStorage& storage);
+
+		/*!
+		 * Keep vectors for later nodes. The storage is left empty.
+		 */
+		void recycleStorage(SearchNodeStorage& storage);
+
+		/*!
+		 * Number of vector sets kept for reuse.
+		 */
+		int storageSize();
+
+		/*!
+		 * Number of nodes currently alive in the arena.
+		 */
+		int size();
 
-		for (int i = 0; i < size; i++)
+	private:
+		SearchNodeArena(const SearchNodeArena&); // do not copy
+		SearchNodeArena& operator=(const SearchNodeArena&); // do not copy
+	};
+
+	/**************** Transposition Table ****************/
+
+	/*!
+	 * @brief Bounded memo of labelings generated while searching one image, keyed by fingerprint.
+	 * 
+	 * Stores heuristic and cost values (only for search types with fixed models) 
+	 * and optionally the feature vectors, so that labelings reached again 
+	 * by another path, step or iteration are not recomputed. 
+	 * The least recently used entries are evicted first. Thread safe.
+	 */
+	class ISearchProcedure::TranspositionTable
+	{
+	public:
+		struct Entry
 		{
-			SearchNode* current = pq.top();
-			pq.pop();
+			bool hasValues; //!< True if heuristic and cost are stored
+			double heuristic; //!< Heuristic value
+			double cost; //!< Cost value
+			bool hasFeatures; //!< True if features are stored
+			RankFeatures heuristicFeatures; //!< Heuristic features
+			RankFeatures costFeatures; //!< Cost features
+		};
 
-			if (!isDuplicate && current->getY().graph.nodesData == state->getY().graph.nodesData)
-			{
-				isDuplicate = true;
-			}
+	private:
+		typedef list< pair< Fingerprint_t, Entry > > EntryList_t;
 
-			temp.push(current);
-		}
+		EntryList_t entries; //!< Entries, most recently used first
+		unordered_map< Fingerprint_t, EntryList_t::iterator > index; //!< Entries by fingerprint
+		int capacity; //!< Maximum number of entries
+		bool storeFeatures; //!< Store feature vectors too
 
-		// reset priority queue passed as argument
-		pq = temp;
+		ImgFeatures* X; //!< Image the entries belong to
+		SearchType searchType; //!< Search type the entries belong to
+		IRankModel* heuristicModel; //!< Heuristic model the values belong to
+		IRankModel* costModel; //!< Cost model the values belong to
 
-		return isDuplicate;
-	}
+		long long hits; //!< Lookups found since the counters were reset
+		long long misses; //!< Lookups not found since the counters were reset
+		std::mutex lock; //!< Guards the table
+
+	public:
+		TranspositionTable(int capacity, bool storeFeatures);
+
+		/*!
+		 * Prepare for a search. Entries are cleared unless they belong to the same 
+		 * image, search type and models. Counters are always reset.
+		 */
+		void prepare(ImgFeatures* X, SearchType searchType, IRankModel* heuristicModel, IRankModel* costModel);
+
+		/*!
+		 * Look up a labeling.
+		 * @return Returns false if not stored
+		 */
+		bool lookup(Fingerprint_t fingerprint, Entry& entry);
+
+		/*!
+		 * Store a labeling, evicting the least recently used one if full.
+		 */
+		void insert(Fingerprint_t fingerprint, const Entry& entry);
+
+		/*!
+		 * True if feature vectors are stored.
+		 */
+		bool storesFeatures();
+
+		long long getHits();
+		long long getMisses();
+		int size();
+
+	private:
+		TranspositionTable(const TranspositionTable&); // do not copy
+		TranspositionTable& operator=(const TranspositionTable&); // do not copy
+	};
+
+	/**************** Template definitions ****************/
 
 	template <class T>
 	void IBasicSearchProcedure::deleteQueueElements(T& queue)
@@ -389,7 +655,7 @@ namespace HCSearch
 		{
 			SearchNode* state = queue.top();
 			queue.pop();
-			delete state;
+			releaseNode(state);
 		}
 	}
 }
@@ -11,6 +11,7 @@ namespace HCSearch
 	{
 		this->heuristicFeatureFunction = NULL;
 		this->costFeatureFunction = NULL;
+		this->sharedFeatureFunction = false;
 		this->initialPredictionFunction = NULL;
 		this->successorFunction = NULL;
 		this->pruneFunction = NULL;
@@ -27,13 +28,17 @@ namespace HCSearch
 		this->successorFunction = successorFunction;
 		this->pruneFunction = pruneFunction;
 		this->lossFunction = lossFunction;
+
+		this->sharedFeatureFunction = heuristicFeatureFunction != NULL && costFeatureFunction != NULL 
+			&& (heuristicFeatureFunction == costFeatureFunction || heuristicFeatureFunction->sameFeatures(*costFeatureFunction));
 	}
 
 	SearchSpace::~SearchSpace()
 	{
 		delete this->pruneFunction;
 		delete this->heuristicFeatureFunction;
-		delete this->costFeatureFunction;
+		if (this->costFeatureFunction != this->heuristicFeatureFunction)
+			delete this->costFeatureFunction;
 		delete this->initialPredictionFunction;
 		delete this->successorFunction;
 		delete this->lossFunction;
@@ -63,6 +68,30 @@ namespace HCSearch
 		return this->costFeatureFunction->computeFeatures(X, Y, action);
 	}
 
+	void SearchSpace::computeHeuristicFeatures(ImgFeatures& X, ImgLabeling& YParent, 
+		RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features)
+	{
+		if (this->heuristicFeatureFunction == NULL)
+		{
+			LOG(ERROR) << "heuristic feature function is null";
+			abort();
+		}
+
+		this->heuristicFeatureFunction->computeFeaturesIncremental(X, YParent, parentFeatures, Y, action, features);
+	}
+
+	void SearchSpace::computeCostFeatures(ImgFeatures& X, ImgLabeling& YParent, 
+		RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features)
+	{
+		if (this->costFeatureFunction == NULL)
+		{
+			LOG(ERROR) << "cost feature function is null";
+			abort();
+		}
+
+		this->costFeatureFunction->computeFeaturesIncremental(X, YParent, parentFeatures, Y, action, features);
+	}
+
 	RankFeatures SearchSpace::computePruneFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
 		if (this->pruneFunction->getFeatureFunction() == NULL)
@@ -109,6 +138,57 @@ namespace HCSearch
 		}
 	}
 
+	vector< ImgCandidate > SearchSpace::generatePrunedSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc)
+	{
+		if (this->successorFunction == NULL)
+		{
+			LOG(ERROR) << "successor function is null";
+			abort();
+		}
+
+		if (this->pruneFunction == NULL)
+		{
+			LOG(DEBUG) << "prune function is null; no pruning done";
+			return this->successorFunction->generateSuccessors(X, YPred, timeStep, timeBound);
+		}
+		else
+		{
+			return this->pruneFunction->generatePrunedSuccessors(X, YPred, this->successorFunction, timeStep, timeBound, YTruth, lossFunc);
+		}
+	}
+
+	vector< ImgCandidateDelta > SearchSpace::generateSuccessorDeltas(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, ImgLabeling& YTemplate)
+	{
+		if (this->successorFunction == NULL)
+		{
+			LOG(ERROR) << "successor function is null";
+			abort();
+		}
+
+		return this->successorFunction->generateSuccessorDeltas(X, YPred, timeStep, timeBound, YTemplate);
+	}
+
+	vector< ImgCandidateDelta > SearchSpace::generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate)
+	{
+		if (this->successorFunction == NULL)
+		{
+			LOG(ERROR) << "successor function is null";
+			abort();
+		}
+
+		if (this->pruneFunction == NULL)
+		{
+			LOG(DEBUG) << "prune function is null; no pruning done";
+			return this->successorFunction->generateSuccessorDeltas(X, YPred, timeStep, timeBound, YTemplate);
+		}
+		else
+		{
+			return this->pruneFunction->generatePrunedSuccessorDeltas(X, YPred, this->successorFunction, timeStep, timeBound, 
+				YTruth, lossFunc, YTemplate);
+		}
+	}
+
 	double SearchSpace::computeLoss(ImgLabeling& YPred, const ImgLabeling& YTruth)
 	{
 		if (this->lossFunction == NULL)
@@ -120,6 +200,11 @@ namespace HCSearch
 		return this->lossFunction->computeLoss(YPred, YTruth);
 	}
 
+	bool SearchSpace::sharesFeatures()
+	{
+		return this->sharedFeatureFunction;
+	}
+
 	IPruneFunction* SearchSpace::getPruneFunction()
 	{
 		return this->pruneFunction;
@@ -42,6 +42,11 @@ namespace HCSearch
 		 */
 		IFeatureFunction* costFeatureFunction;
 
+		/*!
+		 * True if the heuristic and cost feature functions compute the same features.
+		 */
+		bool sharedFeatureFunction;
+
 		/*!
 		 * Initial prediction function.
 		 */
@@ -69,6 +74,7 @@ namespace HCSearch
 		 * @brief Construct a SearchSpace from already defined functions. Only use this constructor.
 		 *
 		 * Note that the destructor will destroy the objects passed into this constructor!
+		 * The same feature function may be passed for heuristic and cost.
 		 *
 		 * @param[in] heuristicFeatureFunction Heuristic feature function
 		 * @param[in] costFeatureFunction Cost feature function
@@ -101,6 +107,30 @@ namespace HCSearch
 		 */
 		RankFeatures computeCostFeatures(ImgFeatures& X, ImgLabeling& Y);
 
+		/*!
+		 * @brief Compute heuristic features of a successor from the heuristic features of its parent.
+		 * @param[in] X Structured image features
+		 * @param[in] YParent Parent structured output labeling
+		 * @param[in] parentFeatures Heuristic features of parent labeling
+		 * @param[in] Y Successor structured output labeling
+		 * @param[in] action Nodes changed from parent to successor
+		 * @param[out] features Heuristic features for ranking (storage of the right size is reused)
+		 */
+		void computeHeuristicFeatures(ImgFeatures& X, ImgLabeling& YParent, 
+			RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features);
+
+		/*!
+		 * @brief Compute cost features of a successor from the cost features of its parent.
+		 * @param[in] X Structured image features
+		 * @param[in] YParent Parent structured output labeling
+		 * @param[in] parentFeatures Cost features of parent labeling
+		 * @param[in] Y Successor structured output labeling
+		 * @param[in] action Nodes changed from parent to successor
+		 * @param[out] features Cost features for ranking (storage of the right size is reused)
+		 */
+		void computeCostFeatures(ImgFeatures& X, ImgLabeling& YParent, 
+			RankFeatures& parentFeatures, ImgLabeling& Y, set<int> action, RankFeatures& features);
+
 		/*!
 		 * @brief Compute prune features from image features and current labeling.
 		 * @param[in] X Structured image features
@@ -132,6 +162,35 @@ namespace HCSearch
 		 */
 		vector< ImgCandidate > pruneSuccessors(ImgFeatures& X, ImgLabeling& YPred, vector< ImgCandidate >& YCandidates, ImgLabeling* YTruth, ILossFunction* lossFunc);
 
+		/*!
+		 * @brief Generate the pruned list of successors from a current labeling.
+		 * 
+		 * Lets the prune function score successors while they are generated.
+		 * @param[in] X Structured image features
+		 * @param[in] YPred Current structured output labeling
+		 * @return List of successors that survived pruning
+		 */
+		vector< ImgCandidate > generatePrunedSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, ImgLabeling* YTruth, ILossFunction* lossFunc);
+
+		/*!
+		 * @brief Generate successors from a current labeling as label changes to a template labeling.
+		 * @param[in] X Structured image features
+		 * @param[in] YPred Current structured output labeling
+		 * @param[out] YTemplate Labeling the successors are changes to
+		 * @return List of successors
+		 */
+		vector< ImgCandidateDelta > generateSuccessorDeltas(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, ImgLabeling& YTemplate);
+
+		/*!
+		 * @brief Generate the pruned successors from a current labeling as label changes to a template labeling.
+		 * @param[in] X Structured image features
+		 * @param[in] YPred Current structured output labeling
+		 * @param[out] YTemplate Labeling the successors are changes to
+		 * @return List of successors that survived pruning
+		 */
+		vector< ImgCandidateDelta > generatePrunedSuccessorDeltas(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling* YTruth, ILossFunction* lossFunc, ImgLabeling& YTemplate);
+
 		/*!
 		 * @brief Compute the loss between a predicted labeling and its groundtruth labeling.
 		 * @param[in] YPred Predicted structured output labeling
@@ -140,6 +199,12 @@ namespace HCSearch
 		 */
 		double computeLoss(ImgLabeling& YPred, const ImgLabeling& YTruth);
 
+		/*!
+		 * @brief Check if heuristic and cost features are the same, 
+		 * so they can be computed once and scored by both models.
+		 */
+		bool sharesFeatures();
+
 		IPruneFunction* getPruneFunction();
 		IInitialPredictionFunction* getInitialPredictionFunction();
 		ILossFunction* getLossFunction();
@@ -8,8 +8,9 @@ namespace HCSearch
 {
 	/**************** Constants ****************/
 
-	const string RankerTypeStrings[] = {"svm-rank", "vw"};
-	const bool RankerTypeSaveable[] = {true, true};
+	const string RankerTypeStrings[] = {"svm-rank", "vw", "online"};
+	const bool RankerTypeSaveable[] = {true, true, false};
+	const string RankPairSamplingStrings[] = {"all", "hardest", "random"};
 
 	/**************** Class Map ****************/
 
@@ -46,18 +47,18 @@ namespace HCSearch
 
 	int ClassMap::getClassLabel(int classIndex)
 	{
-		if (!this->allClasses.exists(classIndex))
+		if (classIndex < 0 || classIndex >= static_cast<int>(this->classLabels.size()))
 		{
 			LOG(ERROR) << "class index does not exist in mapping: " << classIndex;
 			exit(1);
 		}
 
-		return this->allClasses.lookup(classIndex);
+		return this->classLabels[classIndex];
 	}
 
 	bool ClassMap::classIndexIsBackground(int classIndex)
 	{
-		return this->backgroundClasses[getClassLabel(classIndex)];
+		return this->backgroundFlags[classIndex];
 	}
 
 	bool ClassMap::classLabelIsBackground(int classLabel)
@@ -96,6 +97,21 @@ namespace HCSearch
 		return foregrounds;
 	}
 
+	const vector<int>& ClassMap::getClassIndices()
+	{
+		return this->classIndices;
+	}
+
+	const vector<int>& ClassMap::getBackgroundClassIndices()
+	{
+		return this->backgroundClassIndices;
+	}
+
+	const vector<int>& ClassMap::getForegroundClassIndices()
+	{
+		return this->foregroundClassIndices;
+	}
+
 	bool ClassMap::backgroundClassExists()
 	{
 		return this->backgroundExists;
@@ -115,6 +131,11 @@ namespace HCSearch
 		}
 	}
 
+	int ClassMap::getBackgroundClassIndex()
+	{
+		return getClassIndex(getBackgroundLabel());
+	}
+
 	void ClassMap::addClass(int classIndex, int classLabel, bool isBackground)
 	{
 		if (!this->allClasses.exists(classIndex) && !this->allClasses.iexists(classLabel))
@@ -125,6 +146,7 @@ namespace HCSearch
 			{
 				this->numBackground++;
 			}
+			buildClassTables();
 		}
 		else
 		{
@@ -138,6 +160,32 @@ namespace HCSearch
 		this->backgroundExists = true;
 	}
 
+	void ClassMap::buildClassTables()
+	{
+		set<int> indices = this->allClasses.keyset();
+		const int size = indices.empty() ? 0 : *indices.rbegin()+1;
+
+		this->classLabels.assign(size, 0);
+		this->backgroundFlags.assign(size, false);
+		this->classIndices.clear();
+		this->backgroundClassIndices.clear();
+		this->foregroundClassIndices.clear();
+		for (set<int>::iterator it = indices.begin(); it != indices.end(); ++it)
+		{
+			int classIndex = *it;
+			int classLabel = this->allClasses.lookup(classIndex);
+			bool isBackground = this->backgroundClasses[classLabel];
+
+			this->classLabels[classIndex] = classLabel;
+			this->backgroundFlags[classIndex] = isBackground;
+			this->classIndices.push_back(classIndex);
+			if (isBackground)
+				this->backgroundClassIndices.push_back(classIndex);
+			else
+				this->foregroundClassIndices.push_back(classIndex);
+		}
+	}
+
 	/**************** Run-time Statistics ****************/
 
 	RunTimeStats::RunTimeStats()
@@ -291,6 +339,7 @@ namespace HCSearch
 		this->paths->INPUT_SEGMENTS_DIR = this->paths->INPUT_DIR + "segments" + this->paths->DIR_SEP;
 		this->paths->INPUT_SPLITS_DIR = this->paths->INPUT_DIR + this->paths->INPUT_SPLITS_FOLDER_NAME + this->paths->DIR_SEP;
 		this->paths->INPUT_INITIAL_STATES_DIR = this->paths->INPUT_DIR + "initstate" + this->paths->DIR_SEP;
+		this->paths->INPUT_BINARY_DIR = this->paths->INPUT_DIR + "binary" + this->paths->DIR_SEP;
 
 		this->paths->INPUT_SPLITS_TRAIN_FILE = this->paths->INPUT_SPLITS_DIR + this->paths->INPUT_SPLITS_TRAIN_FILE_BASE;
 		this->paths->INPUT_SPLITS_VALIDATION_FILE = this->paths->INPUT_SPLITS_DIR + this->paths->INPUT_SPLITS_VALIDATION_FILE_BASE;
@@ -405,7 +454,16 @@ namespace HCSearch
 
 		USE_DAGGER = false;
 		CHECK_FOR_DUPLICATES = false;
+		TIME_BUDGET_MS = 0;
+		TRANSPOSITION_TABLE_SIZE = 0;
+		TRANSPOSITION_TABLE_FEATURES = true;
 		USE_EDGE_WEIGHTS = false;
+		DATASET_CACHE_MB = 0;
+		NUM_THREADS = 1;
+		PARALLEL_IMAGES = false;
+		DYNAMIC_SCHEDULING = false;
+		RANK_PAIR_SAMPLING = ALL_PAIRS;
+		RANK_PAIRS_PER_POSITIVE = 0;
 
 		/**************** Experiment Settings ****************/
 
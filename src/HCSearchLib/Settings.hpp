@@ -18,20 +18,31 @@ namespace HCSearch
 {
 	/**************** Constants ****************/
 
-	enum RankerType { SVM_RANK, VW_RANK };
+	enum RankerType { SVM_RANK, VW_RANK, ONLINE_RANK };
 	const extern string RankerTypeStrings[];
 	const extern bool RankerTypeSaveable[];
 
+	enum RankPairSampling { ALL_PAIRS, HARDEST_PAIRS, RANDOM_PAIRS };
+	const extern string RankPairSamplingStrings[];
+
 	/**************** Class Map ****************/
 
 	// Stores class labels
 	// Also stores mapping to class index, as used by confidences
+	// Labelings hold class indices 0..numClasses-1; class labels are only 
+	// translated when reading images and writing predictions
 	class ClassMap
 	{
 	protected:
 		MyPrimitives::Bimap<int> allClasses; // class index <-> class label
 		map<int, bool> backgroundClasses; // label -> is background? true/false
 
+		vector<int> classLabels; // class index -> class label (flat)
+		vector<bool> backgroundFlags; // class index -> is background? (flat)
+		vector<int> classIndices; // all class indices in order
+		vector<int> backgroundClassIndices; // background class indices in order
+		vector<int> foregroundClassIndices; // foreground class indices in order
+
 		int numBackground; // num of background classes (cached)
 		int backgroundLabel; // background label
 		bool backgroundExists; // if background class even exists
@@ -53,11 +64,19 @@ namespace HCSearch
 		set<int> getBackgroundLabels();
 		set<int> getForegroundLabels();
 
+		const vector<int>& getClassIndices();
+		const vector<int>& getBackgroundClassIndices();
+		const vector<int>& getForegroundClassIndices();
+
 		bool backgroundClassExists();
 		int getBackgroundLabel();
+		int getBackgroundClassIndex();
 
 		void addClass(int classIndex, int classLabel, bool isBackground);
 		void setBackgroundLabel(int classLabel);
+
+	protected:
+		void buildClassTables();
 	};
 
 	/**************** Run-time Statistics ****************/
@@ -120,6 +139,7 @@ namespace HCSearch
 		string INPUT_EDGES_FOLDER_NAME;
 		string INPUT_EDGE_FEATURES_FOLDER_NAME;
 		string INPUT_INITIAL_STATES_DIR;
+		string INPUT_BINARY_DIR;
 
 		string INPUT_SPLITS_TRAIN_FILE;
 		string INPUT_SPLITS_VALIDATION_FILE;
@@ -235,11 +255,69 @@ namespace HCSearch
 		 */
 		bool CHECK_FOR_DUPLICATES;
 
+		/*!
+		 * @brief Wall-clock budget in milliseconds for each inference search (LL, HL, LC, HC). 
+		 * If positive, search stops expanding once it runs out (or at the time bound) 
+		 * and returns the lowest cost output found so far. If 0, only the time bound applies. 
+		 * Learning searches always run to the time bound.
+		 */
+		int TIME_BUDGET_MS;
+
+		/*!
+		 * @brief Maximum number of labelings memoized per image and thread during search. 
+		 * Labelings reached again (by another path, search step or stochastic iteration) 
+		 * reuse their heuristic and cost. If 0, nothing is memoized.
+		 */
+		int TRANSPOSITION_TABLE_SIZE;
+
+		/*!
+		 * @brief Memoize the feature vectors of labelings too. 
+		 * Needed for learning and for computing successor features incrementally from a memoized labeling.
+		 */
+		bool TRANSPOSITION_TABLE_FEATURES;
+
 		/*!
 		 * @brief Use edge weights from external file.
 		 */
 		bool USE_EDGE_WEIGHTS;
 
+		/*!
+		 * @brief Memory budget in MB for loaded images. 
+		 * If positive, images are loaded on first use and evicted least recently used first. 
+		 * If 0, the whole dataset is loaded up front.
+		 */
+		int DATASET_CACHE_MB;
+
+		/*!
+		 * @brief Number of worker threads. 
+		 * They evaluate the successors of a search step, or whole images if PARALLEL_IMAGES is set.
+		 */
+		int NUM_THREADS;
+
+		/*!
+		 * @brief Spread images over the threads instead of the successors of a search step.
+		 */
+		bool PARALLEL_IMAGES;
+
+		/*!
+		 * @brief Hand out images to processes on request (largest first) instead of fixed ranges.
+		 * Rank 0 only hands out images when there is more than one process.
+		 */
+		bool DYNAMIC_SCHEDULING;
+
+		/*!
+		 * @brief Which (better, worse) pairs become ranking training examples. 
+		 * HARDEST_PAIRS keeps the RANK_PAIRS_PER_POSITIVE worse examples with the lowest loss, 
+		 * RANDOM_PAIRS draws that many for each better example.
+		 */
+		RankPairSampling RANK_PAIR_SAMPLING;
+
+		/*!
+		 * @brief Number of worse examples paired with each better example when sampling pairs. 
+		 * If 0, all pairs are used.
+		 */
+		int RANK_PAIRS_PER_POSITIVE;
+
 		/**************** Experiment Settings ****************/
 
 		/*!
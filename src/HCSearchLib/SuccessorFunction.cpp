@@ -3,6 +3,34 @@
 
 namespace HCSearch
 {
+	/**************** Successor Function Interface ****************/
+
+	vector< ImgCandidate > ISuccessorFunction::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	{
+		vector< ImgCandidate > successors;
+		ImgLabeling YTemplate;
+		CandidateVisitor_t addSuccessor = [&](const ImgCandidateDelta& delta)
+		{
+			successors.push_back(delta.materialize(YTemplate));
+		};
+		streamSuccessors(X, YPred, timeStep, timeBound, YTemplate, addSuccessor);
+
+		return successors;
+	}
+
+	vector< ImgCandidateDelta > ISuccessorFunction::generateSuccessorDeltas(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate)
+	{
+		vector< ImgCandidateDelta > deltas;
+		CandidateVisitor_t addSuccessor = [&](const ImgCandidateDelta& delta)
+		{
+			deltas.push_back(delta);
+		};
+		streamSuccessors(X, YPred, timeStep, timeBound, YTemplate, addSuccessor);
+
+		return deltas;
+	}
+
 	/**************** Successor Functions ****************/
 
 	/**************** Flipbit Successor Function ****************/
@@ -19,60 +47,55 @@ namespace HCSearch
 	{
 	}
 	
-	vector< ImgCandidate > FlipbitSuccessor::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	int FlipbitSuccessor::streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate, CandidateVisitor_t visitor)
 	{
 		clock_t tic = clock();
 
-		vector<ImgCandidate> successors;
+		// successors only differ from the current labeling at the flipped node
+		YTemplate = ImgLabeling();
+		YTemplate.confidences = YPred.confidences;
+		YTemplate.confidencesAvailable = YPred.confidencesAvailable;
+		YTemplate.graph = YPred.graph;
+
+		int numSuccessors = 0;
+		ImgCandidateDelta delta;
+
+		// flip to any possible class
+		const vector<int>& candidateLabels = Global::settings->CLASSES.getClassIndices();
 
 		// for all nodes
 		const int numNodes = YPred.getNumNodes();
 		for (int node = 0; node < numNodes; node++)
 		{
-			// set up candidate label set
-			set<int> candidateLabelsSet;
 			int nodeLabel = YPred.getLabel(node);
-			candidateLabelsSet.insert(nodeLabel);
-
-			// flip to any possible class
-			candidateLabelsSet = Global::settings->CLASSES.getLabels();
-
-			candidateLabelsSet.erase(nodeLabel); // do not flip to same label
 
 			// for each candidate label, add to successors list for returning
-			for (set<int>::iterator it2 = candidateLabelsSet.begin(); it2 != candidateLabelsSet.end(); ++it2)
+			for (vector<int>::const_iterator it2 = candidateLabels.begin(); it2 != candidateLabels.end(); ++it2)
 			{
 				int candidateLabel = *it2;
+				if (candidateLabel == nodeLabel)
+					continue; // do not flip to same label
 
 				// form successor object
-				LabelGraph graphNew;
-				graphNew.nodesData = YPred.graph.nodesData;
-				graphNew.nodesData(node) = candidateLabel; // flip bit node
-				graphNew.adjList = YPred.graph.adjList;
-
-				ImgLabeling YNew;
-				YNew.confidences = YPred.confidences;
-				YNew.confidencesAvailable = YPred.confidencesAvailable;
-				YNew.graph = graphNew;
-
-				ImgCandidate YCandidate;
-				YCandidate.labeling = YNew;
-				YCandidate.action = set<int>();
-				YCandidate.action.insert(node);
-
-				// add candidate to successors
-				successors.push_back(YCandidate);
+				delta.action.clear();
+				delta.action.insert(node);
+				delta.labels.assign(1, candidateLabel); // flip bit node
+
+				// pass candidate on
+				visitor(delta);
+				numSuccessors++;
 			}
 		}
 
-		LOG() << "num successors generated=" << successors.size() << endl;
+		LOG() << "num successors generated=" << numSuccessors << endl;
 
-		Global::settings->stats->addSuccessorCount(successors.size());
+		Global::settings->stats->addSuccessorCount(numSuccessors);
 
 		clock_t toc = clock();
 		LOG() << "successor total time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	/**************** Flipbit Neighbor Successor Function ****************/
@@ -85,11 +108,19 @@ namespace HCSearch
 	{
 	}
 	
-	vector< ImgCandidate > FlipbitNeighborSuccessor::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	int FlipbitNeighborSuccessor::streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate, CandidateVisitor_t visitor)
 	{
 		clock_t tic = clock();
 
-		vector<ImgCandidate> successors;
+		// successors only differ from the current labeling at the flipped node
+		YTemplate = ImgLabeling();
+		YTemplate.confidences = YPred.confidences;
+		YTemplate.confidencesAvailable = YPred.confidencesAvailable;
+		YTemplate.graph = YPred.graph;
+
+		int numSuccessors = 0;
+		ImgCandidateDelta delta;
 
 		// for all nodes
 		const int numNodes = YPred.getNumNodes();
@@ -113,7 +144,8 @@ namespace HCSearch
 			else
 			{
 				// if node is isolated without neighbors, then flip to any possible class
-				candidateLabelsSet = Global::settings->CLASSES.getLabels();
+				const vector<int>& classIndices = Global::settings->CLASSES.getClassIndices();
+				candidateLabelsSet = set<int>(classIndices.begin(), classIndices.end());
 			}
 
 			candidateLabelsSet.erase(nodeLabel); // do not flip to same label
@@ -124,34 +156,24 @@ namespace HCSearch
 				int candidateLabel = *it2;
 
 				// form successor object
-				LabelGraph graphNew;
-				graphNew.nodesData = YPred.graph.nodesData;
-				graphNew.nodesData(node) = candidateLabel; // flip bit node
-				graphNew.adjList = YPred.graph.adjList;
-
-				ImgLabeling YNew;
-				YNew.confidences = YPred.confidences;
-				YNew.confidencesAvailable = YPred.confidencesAvailable;
-				YNew.graph = graphNew;
-
-				ImgCandidate YCandidate;
-				YCandidate.labeling = YNew;
-				YCandidate.action = set<int>();
-				YCandidate.action.insert(node);
-
-				// add candidate to successors
-				successors.push_back(YCandidate);
+				delta.action.clear();
+				delta.action.insert(node);
+				delta.labels.assign(1, candidateLabel); // flip bit node
+
+				// pass candidate on
+				visitor(delta);
+				numSuccessors++;
 			}
 		}
 
-		LOG() << "num successors generated=" << successors.size() << endl;
+		LOG() << "num successors generated=" << numSuccessors << endl;
 
-		Global::settings->stats->addSuccessorCount(successors.size());
+		Global::settings->stats->addSuccessorCount(numSuccessors);
 
 		clock_t toc = clock();
 		LOG() << "successor total time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	/**************** Flipbit Confidences Neighbor Successor Function ****************/
@@ -164,11 +186,19 @@ namespace HCSearch
 	{
 	}
 	
-	vector< ImgCandidate > FlipbitConfidencesNeighborSuccessor::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	int FlipbitConfidencesNeighborSuccessor::streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate, CandidateVisitor_t visitor)
 	{
 		clock_t tic = clock();
 
-		vector<ImgCandidate> successors;
+		// successors only differ from the current labeling at the flipped node
+		YTemplate = ImgLabeling();
+		YTemplate.confidences = YPred.confidences;
+		YTemplate.confidencesAvailable = YPred.confidencesAvailable;
+		YTemplate.graph = YPred.graph;
+
+		int numSuccessors = 0;
+		ImgCandidateDelta delta;
 
 		// for all nodes
 		const int numNodes = YPred.getNumNodes();
@@ -196,7 +226,8 @@ namespace HCSearch
 			else
 			{
 				// if node is isolated without neighbors, then flip to any possible class
-				candidateLabelsSet = Global::settings->CLASSES.getLabels();
+				const vector<int>& classIndices = Global::settings->CLASSES.getClassIndices();
+				candidateLabelsSet = set<int>(classIndices.begin(), classIndices.end());
 			}
 
 			candidateLabelsSet.erase(nodeLabel); // do not flip to same label
@@ -207,34 +238,24 @@ namespace HCSearch
 				int candidateLabel = *it2;
 
 				// form successor object
-				LabelGraph graphNew;
-				graphNew.nodesData = YPred.graph.nodesData;
-				graphNew.nodesData(node) = candidateLabel; // flip bit node
-				graphNew.adjList = YPred.graph.adjList;
-
-				ImgLabeling YNew;
-				YNew.confidences = YPred.confidences;
-				YNew.confidencesAvailable = YPred.confidencesAvailable;
-				YNew.graph = graphNew;
-
-				ImgCandidate YCandidate;
-				YCandidate.labeling = YNew;
-				YCandidate.action = set<int>();
-				YCandidate.action.insert(node);
-
-				// add candidate to successors
-				successors.push_back(YCandidate);
+				delta.action.clear();
+				delta.action.insert(node);
+				delta.labels.assign(1, candidateLabel); // flip bit node
+
+				// pass candidate on
+				visitor(delta);
+				numSuccessors++;
 			}
 		}
 
-		LOG() << "num successors generated=" << successors.size() << endl;
+		LOG() << "num successors generated=" << numSuccessors << endl;
 
-		Global::settings->stats->addSuccessorCount(successors.size());
+		Global::settings->stats->addSuccessorCount(numSuccessors);
 
 		clock_t toc = clock();
 		LOG() << "successor total time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	/**************** Stochastic Successor Function ****************/
@@ -271,7 +292,8 @@ namespace HCSearch
 	{
 	}
 	
-	vector< ImgCandidate > StochasticSuccessor::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	int StochasticSuccessor::streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate, CandidateVisitor_t visitor)
 	{
 		clock_t tic = clock();
 
@@ -290,120 +312,67 @@ namespace HCSearch
 		LOG() << "generating stochastic successors..." << endl;
 
 		// generate candidates
-		vector< ImgCandidate > successors = createCandidates(YPred, subgraphs);
+		int numSuccessors = createCandidates(YPred, subgraphs, YTemplate, visitor);
 
-		LOG() << "num successors generated=" << successors.size() << endl;
+		LOG() << "num successors generated=" << numSuccessors << endl;
 
-		Global::settings->stats->addSuccessorCount(successors.size());
+		Global::settings->stats->addSuccessorCount(numSuccessors);
 
 		delete subgraphs;
 
 		clock_t toc = clock();
 		LOG() << "successor total time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	MyGraphAlgorithms::SubgraphSet* StochasticSuccessor::cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T)
 	{
 		const int numNodes = X.getNumNodes();
-		map< int, set<int> > edges = YPred.graph.adjList;
-
-		// store new cut edges
-		map< int, set<int> > cutEdges;
-
-		// convert to format storing (node1, node2) pairs
-		vector< MyPrimitives::Pair< int, int > > edgeNodes;
+		const int numRows = X.graph.adjacency->getNumNodes();
 
 		// edge weights using KL divergence measure
-		vector<double> edgeWeights;
-
-		// iterate over all edges to store
-		if (X.edgeWeightsAvailable)
-		{
-			for (map< MyPrimitives::Pair<int, int>, double >::iterator it = X.edgeWeights.begin(); it != X.edgeWeights.end(); ++it)
-			{
-				// get weights
-				double weight = it->second;
-				edgeWeights.push_back(weight);
+		const VectorXd cutWeights = X.edgeWeightsAvailable ? VectorXd() : X.getCutWeights(T);
 
-				// add
-				MyPrimitives::Pair<int, int> key = it->first;
-				edgeNodes.push_back(key);
-			}
-		}
-		else
-		{
-			LOG() << "Computing edge weights from nodes..." << endl;
-
-			for (map< int, set<int> >::iterator it = edges.begin();
-				it != edges.end(); ++it)
-			{
-				int node1 = it->first;
-				set<int> neighbors = it->second;
-		
-				// loop over neighbors
-				for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
-				{
-					int node2 = *it2;
-
-					// get features and labels
-					VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-					VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
+		// flag uncut edges by edge index
+		EdgeMask_t cutEdges(X.graph.adjacency->getNumEdges(), false);
 
-					// compute weights already
-					double weight = exp( -(computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1))*T/2 );
-					edgeWeights.push_back(weight);
-
-					// add
-					MyPrimitives::Pair< int, int> nodePair = MyPrimitives::Pair< int, int >(node1, node2);
-					edgeNodes.push_back(nodePair);
-				}
-			}
-		}
+		// union uncut edges into subgraphs as they are decided
+		CutForests& forests = getCutForests();
+		forests.subgraphs.reset(numNodes);
 
 		// given the edge weights, do the actual cutting!
-		const int numEdges = edgeNodes.size();
-		for (int i = 0; i < numEdges; i++)
+		for (int node1 = 0; node1 < numRows; node1++)
 		{
-			MyPrimitives::Pair< int, int > nodePair = edgeNodes[i];
-			int node1 = nodePair.first;
-			int node2 = nodePair.second;
-
-			bool decideToCut;
-			//if (YPred.getLabel(node1) != YPred.getLabel(node2))
-			//{
-			//	// different node labels: always cut
-			//	decideToCut = true;
-			//}
-			//else if (!cutEdgesIndependently)
-			if (!cutEdgesIndependently)
+			for (CompressedAdjacency::NeighborIterator it = X.graph.adjacency->neighborsBegin(node1); 
+				it != X.graph.adjacency->neighborsEnd(node1); ++it)
 			{
-				// uniform state
-				//decideToCut = edgeWeights[i] <= threshold;
-				decideToCut =  threshold <= edgeWeights[i];
-			}
-			else
-			{
-				// bernoulli independent
-				double biasedCoin = Rand::unifDist(); // ~ Uniform(0, 1)
-				//decideToCut = biasedCoin <= 1-edgeWeights[i];
-				decideToCut = biasedCoin <= edgeWeights[i];
-			}
+				int node2 = *it;
+				int edgeIndex = X.graph.adjacency->getEdgeIndex(it);
+				double weight = X.edgeWeightsAvailable ? X.graph.adjacency->getEdgeWeight(edgeIndex) : cutWeights(edgeIndex);
 
-			if (!decideToCut)
-			{
-				// keep these uncut edges
-				if (cutEdges.count(node1) == 0)
+				bool decideToCut;
+				if (!cutEdgesIndependently)
 				{
-					cutEdges[node1] = set<int>();
+					// uniform state
+					decideToCut =  threshold <= weight;
 				}
-				if (cutEdges.count(node2) == 0)
+				else
 				{
-					cutEdges[node2] = set<int>();
+					// bernoulli independent
+					double biasedCoin = Rand::unifDist(); // ~ Uniform(0, 1)
+					decideToCut = biasedCoin <= weight;
+				}
+
+				if (!decideToCut)
+				{
+					// keep these uncut edges (in both directions)
+					cutEdges[edgeIndex] = true;
+					int reverseIndex = X.graph.adjacency->getEdgeIndex(node2, node1);
+					if (reverseIndex >= 0)
+						cutEdges[reverseIndex] = true;
+					forests.subgraphs.Union(node1, node2);
 				}
-				cutEdges[node1].insert(node2);
-				cutEdges[node2].insert(node1);
 			}
 		}
 
@@ -415,23 +384,42 @@ namespace HCSearch
 
 		LOG() << "Getting subgraphs..." << endl;
 
-		MyGraphAlgorithms::SubgraphSet* subgraphs = new MyGraphAlgorithms::SubgraphSet(Ycopy, cutEdges);
+		MyGraphAlgorithms::SubgraphSet* subgraphs = new MyGraphAlgorithms::SubgraphSet(Ycopy, cutEdges, 
+			forests.subgraphs, forests.components);
 
 		return subgraphs;
 	}
 
-	vector< ImgCandidate > StochasticSuccessor::createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs)
+	StochasticSuccessor::CutForests& StochasticSuccessor::getCutForests()
+	{
+		lock_guard<std::mutex> guard(this->cutForestsLock);
+		return this->cutForests[this_thread::get_id()];
+	}
+
+	int StochasticSuccessor::createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs, 
+		ImgLabeling& YTemplate, CandidateVisitor_t& visitor)
 	{
 		using namespace MyGraphAlgorithms;
 
 		vector< Subgraph* > subgraphset = subgraphs->getSubgraphs();
 
+		// cuts are the same for all candidates, so share them
+		MyPrimitives::CopyOnWrite< EdgeMask_t > stochasticCuts = subgraphs->getCuts();
+
 		// shuffle
 		std::random_shuffle(subgraphset.begin(), subgraphset.end());
 		LOG() << "num subgraphs=" << subgraphset.size() << endl;
 
-		// successors set
-		vector< ImgCandidate > successors;
+		// successors only differ from the current labeling at the flipped component
+		YTemplate = ImgLabeling();
+		YTemplate.confidences = YPred.confidences;
+		YTemplate.confidencesAvailable = YPred.confidencesAvailable;
+		YTemplate.stochasticCuts = stochasticCuts;
+		YTemplate.stochasticCutsAvailable = true;
+		YTemplate.graph = YPred.graph;
+
+		int numSuccessors = 0;
+		ImgCandidateDelta delta;
 
 		// loop over each sub graph
 		int cumSumLabels = 0;
@@ -475,28 +463,19 @@ namespace HCSearch
 					int label = *it3;
 
 					// form successor object
-					ImgLabeling YNew;
-					YNew.confidences = YPred.confidences;
-					YNew.confidencesAvailable = YPred.confidencesAvailable;
-					YNew.stochasticCuts = subgraphs->getCuts();
-					YNew.stochasticCutsAvailable = true;
-					YNew.graph = YPred.graph;
-
-					// make changes
 					set<int> component = cc->getNodes();
-					set<int> action;
+					delta.action.clear();
+					delta.labels.clear();
 					for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
 					{
 						int node = *it4;
-						YNew.graph.nodesData(node) = label;
-						action.insert(node);
+						delta.labels.push_back(label);
+						delta.action.insert(node);
 					}
 
-					ImgCandidate YCandidate;
-					YCandidate.labeling = YNew;
-					YCandidate.action = action;
-
-					successors.push_back(YCandidate);
+					// pass candidate on
+					visitor(delta);
+					numSuccessors++;
 				}
 			}
 		}
@@ -506,7 +485,7 @@ namespace HCSearch
 		if (numSumLabels > 0)
 			LOG() << "average num labels=" << (1.0*cumSumLabels/numSumLabels) << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	void StochasticSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
@@ -517,7 +496,8 @@ namespace HCSearch
 	void StochasticSuccessor::getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		// flip to any possible class
-		candidateLabelsSet = Global::settings->CLASSES.getLabels();
+		const vector<int>& classIndices = Global::settings->CLASSES.getClassIndices();
+		candidateLabelsSet = set<int>(classIndices.begin(), classIndices.end());
 	}
 
 	void StochasticSuccessor::getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
@@ -531,7 +511,8 @@ namespace HCSearch
 		else
 		{
 			// if connected component is isolated without neighboring connected components, then flip to any possible class
-			candidateLabelsSet = Global::settings->CLASSES.getLabels();
+			const vector<int>& classIndices = Global::settings->CLASSES.getClassIndices();
+			candidateLabelsSet = set<int>(classIndices.begin(), classIndices.end());
 		}
 	}
 
@@ -547,36 +528,6 @@ namespace HCSearch
 		}
 	}
 
-	double StochasticSuccessor::computeKL(const VectorXd& p, const VectorXd& q)
-	{
-		if (p.size() != q.size())
-		{
-			LOG(WARNING) << "dimensions of p and q are not the same!" << endl;
-		}
-
-		double KL = 0;
-
-		VectorXd pn = p.normalized();
-		VectorXd qn = q.normalized();
-
-		for (int i = 0; i < p.size(); i++)
-		{
-			if (p(i) != 0)
-			{
-				if (q(i) == 0) // && p(i) != 0
-				{
-					// warning: q(i) = 0 does not imply p(i) = 0
-				}
-				else
-				{
-					KL += p(i) * log(p(i) / q(i));
-				}
-			}
-		}
-
-		return KL;
-	}
-
 	/**************** Stochastic Neighbor Successor Function ****************/
 
 	StochasticNeighborSuccessor::StochasticNeighborSuccessor()
@@ -669,7 +620,8 @@ namespace HCSearch
 	{
 	}
 	
-	vector< ImgCandidate > CutScheduleSuccessor::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	int CutScheduleSuccessor::streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate, CandidateVisitor_t visitor)
 	{
 		clock_t tic = clock();
 
@@ -681,18 +633,18 @@ namespace HCSearch
 		LOG() << "generating cut schedule successors..." << endl;
 
 		// generate candidates
-		vector< ImgCandidate > successors = createCandidates(YPred, subgraphs);
+		int numSuccessors = createCandidates(YPred, subgraphs, YTemplate, visitor);
 
-		LOG() << "num successors generated=" << successors.size() << endl;
+		LOG() << "num successors generated=" << numSuccessors << endl;
 
-		Global::settings->stats->addSuccessorCount(successors.size());
+		Global::settings->stats->addSuccessorCount(numSuccessors);
 
 		delete subgraphs;
 
 		clock_t toc = clock();
 		LOG() << "successor total time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	MyGraphAlgorithms::SubgraphSet* CutScheduleSuccessor::cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T)
@@ -700,32 +652,26 @@ namespace HCSearch
 		MyGraphAlgorithms::SubgraphSet* subgraphs = NULL;
 
 		const int numNodes = X.getNumNodes();
-		map< int, set<int> > edges = YPred.graph.adjList;
+		const int numRows = X.graph.adjacency->getNumNodes();
 
 		// convert to format storing (node1, node2) pairs
 		vector< MyPrimitives::Pair< int, int > > edgeNodes;
 
 		// edge weights using KL divergence measure
 		vector<double> edgeWeights;
+		const VectorXd cutWeights = X.getCutWeights(T);
 
 		// iterate over all edges to store
-		for (map< int, set<int> >::iterator it = edges.begin();
-			it != edges.end(); ++it)
+		for (int node1 = 0; node1 < numRows; node1++)
 		{
-			int node1 = it->first;
-			set<int> neighbors = it->second;
-		
 			// loop over neighbors
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			for (CompressedAdjacency::NeighborIterator it2 = X.graph.adjacency->neighborsBegin(node1); 
+				it2 != X.graph.adjacency->neighborsEnd(node1); ++it2)
 			{
 				int node2 = *it2;
 
-				// get features and labels
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-
-				// compute weights already
-				double weight = exp( -(computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1))*T/2 );
+				// get weights
+				double weight = cutWeights(X.graph.adjacency->getEdgeIndex(it2));
 				edgeWeights.push_back(weight);
 
 				// add
@@ -737,8 +683,8 @@ namespace HCSearch
 		// increase threshold until good cuts; also cut by state
 		for (double thresholdAttempt = threshold; thresholdAttempt <= 1.0; thresholdAttempt += THRESHOLD_INCREMENT)
 		{
-			// store new cut edges
-			map< int, set<int> > cutEdges;
+			// flag uncut edges by edge index (edges are stored in edge index order)
+			EdgeMask_t cutEdges(edgeNodes.size(), false);
 
 			LOG() << "Attempting threshold=" << thresholdAttempt << endl;
 			// given the edge weights, do the actual cutting!
@@ -764,17 +710,11 @@ namespace HCSearch
 
 				if (!decideToCut)
 				{
-					// keep these uncut edges
-					if (cutEdges.count(node1) == 0)
-					{
-						cutEdges[node1] = set<int>();
-					}
-					if (cutEdges.count(node2) == 0)
-					{
-						cutEdges[node2] = set<int>();
-					}
-					cutEdges[node1].insert(node2);
-					cutEdges[node2].insert(node1);
+					// keep these uncut edges (in both directions)
+					cutEdges[i] = true;
+					int reverseIndex = X.graph.adjacency->getEdgeIndex(node2, node1);
+					if (reverseIndex >= 0)
+						cutEdges[reverseIndex] = true;
 				}
 			}
 
@@ -903,7 +843,8 @@ namespace HCSearch
 	{
 	}
 	
-	vector< ImgCandidate > StochasticScheduleSuccessor::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	int StochasticScheduleSuccessor::streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate, CandidateVisitor_t visitor)
 	{
 		clock_t tic = clock();
 
@@ -917,56 +858,50 @@ namespace HCSearch
 		LOG() << "generating stochastic schedule successors..." << endl;
 
 		// generate candidates
-		vector< ImgCandidate > successors = createCandidates(YPred, subgraphs);
+		int numSuccessors = createCandidates(YPred, subgraphs, YTemplate, visitor);
 
-		LOG() << "num successors generated=" << successors.size() << endl;
+		LOG() << "num successors generated=" << numSuccessors << endl;
 
-		Global::settings->stats->addSuccessorCount(successors.size());
+		Global::settings->stats->addSuccessorCount(numSuccessors);
 
 		delete subgraphs;
 
 		clock_t toc = clock();
 		LOG() << "successor total time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	MyGraphAlgorithms::SubgraphSet* StochasticScheduleSuccessor::cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T, int timeStep, int timeBound)
 	{
 		const int numNodes = X.getNumNodes();
-		map< int, set<int> > edges = YPred.graph.adjList;
+		const int numRows = X.graph.adjacency->getNumNodes();
 
-		// store new cut edges
-		map< int, set<int> > cutEdges;
+		// flag uncut edges by edge index (edges are stored in edge index order)
+		EdgeMask_t cutEdges(X.graph.adjacency->getNumEdges(), false);
 
 		// convert to format storing (node1, node2) pairs
 		vector< MyPrimitives::Pair< int, int > > edgeNodes;
 
 		// edge weights using KL divergence measure
 		vector<double> edgeWeights;
+		const VectorXd cutWeights = X.getCutWeights(T);
 
 		// keep track of which edges to clamp
 		vector<bool> positiveEdgeClamps;
 		vector<bool> negativeEdgeClamps;
 
 		// iterate over all edges to store
-		for (map< int, set<int> >::iterator it = edges.begin();
-			it != edges.end(); ++it)
+		for (int node1 = 0; node1 < numRows; node1++)
 		{
-			int node1 = it->first;
-			set<int> neighbors = it->second;
-		
 			// loop over neighbors
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			for (CompressedAdjacency::NeighborIterator it2 = X.graph.adjacency->neighborsBegin(node1); 
+				it2 != X.graph.adjacency->neighborsEnd(node1); ++it2)
 			{
 				int node2 = *it2;
 
-				// get features and labels
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-
-				// compute weights already
-				double weight = exp( -(computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1))*T/2 );
+				// get weights
+				double weight = cutWeights(X.graph.adjacency->getEdgeIndex(it2));
 				edgeWeights.push_back(weight);
 
 				// for now do not clamp
@@ -1030,17 +965,11 @@ namespace HCSearch
 
 			if (!willCut)
 			{
-				// keep these uncut edges
-				if (cutEdges.count(node1) == 0)
-				{
-					cutEdges[node1] = set<int>();
-				}
-				if (cutEdges.count(node2) == 0)
-				{
-					cutEdges[node2] = set<int>();
-				}
-				cutEdges[node1].insert(node2);
-				cutEdges[node2].insert(node1);
+				// keep these uncut edges (in both directions)
+				cutEdges[i] = true;
+				int reverseIndex = X.graph.adjacency->getEdgeIndex(node2, node1);
+				if (reverseIndex >= 0)
+					cutEdges[reverseIndex] = true;
 			}
 		}
 
@@ -1057,12 +986,16 @@ namespace HCSearch
 		return subgraphs;
 	}
 
-	vector< ImgCandidate > StochasticScheduleSuccessor::createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs)
+	int StochasticScheduleSuccessor::createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs, 
+		ImgLabeling& YTemplate, CandidateVisitor_t& visitor)
 	{
 		using namespace MyGraphAlgorithms;
 
 		vector< Subgraph* > subgraphset = subgraphs->getSubgraphs();
 
+		// cuts are the same for all candidates, so share them
+		MyPrimitives::CopyOnWrite< EdgeMask_t > stochasticCuts = subgraphs->getCuts();
+
 		// node clamp decisions
 		vector<bool> nodeClampDecisions;
 		int numNodeClamp = 0;
@@ -1089,8 +1022,16 @@ namespace HCSearch
 				numNodeClamp++;
 		}
 
-		// successors set
-		vector< ImgCandidate > successors;
+		// successors only differ from the current labeling at the flipped component
+		YTemplate = ImgLabeling();
+		YTemplate.confidences = YPred.confidences;
+		YTemplate.confidencesAvailable = YPred.confidencesAvailable;
+		YTemplate.stochasticCuts = stochasticCuts;
+		YTemplate.stochasticCutsAvailable = true;
+		YTemplate.graph = YPred.graph;
+
+		int numSuccessors = 0;
+		ImgCandidateDelta delta;
 
 		// loop over each sub graph
 		int cumSumLabels = 0;
@@ -1123,31 +1064,22 @@ namespace HCSearch
 					int label = *it3;
 
 					// form successor object
-					ImgLabeling YNew;
-					YNew.confidences = YPred.confidences;
-					YNew.confidencesAvailable = YPred.confidencesAvailable;
-					YNew.stochasticCuts = subgraphs->getCuts();
-					YNew.stochasticCutsAvailable = true;
-					YNew.graph = YPred.graph;
-
-					// make changes
 					set<int> component = cc->getNodes();
-					set<int> action;
+					delta.action.clear();
+					delta.labels.clear();
 					for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
 					{
 						int node = *it4;
 						if (this->clampNodes && nodeClampDecisions[node])
-							YNew.graph.nodesData(node) = YPred.getMostConfidentLabel(node);
+							delta.labels.push_back(YPred.getMostConfidentLabel(node));
 						else
-							YNew.graph.nodesData(node) = label;
-						action.insert(node);
+							delta.labels.push_back(label);
+						delta.action.insert(node);
 					}
 
-					ImgCandidate YCandidate;
-					YCandidate.labeling = YNew;
-					YCandidate.action = action;
-
-					successors.push_back(YCandidate);
+					// pass candidate on
+					visitor(delta);
+					numSuccessors++;
 				}
 			}
 		}
@@ -1157,7 +1089,7 @@ namespace HCSearch
 
 		LOG() << "num nodes clamped=" << numNodeClamp << " out of " << YPred.getNumNodes() << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	void StochasticScheduleSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
@@ -1168,7 +1100,8 @@ namespace HCSearch
 	void StochasticScheduleSuccessor::getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		// flip to any possible class
-		candidateLabelsSet = Global::settings->CLASSES.getLabels();
+		const vector<int>& classIndices = Global::settings->CLASSES.getClassIndices();
+		candidateLabelsSet = set<int>(classIndices.begin(), classIndices.end());
 	}
 
 	void StochasticScheduleSuccessor::getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
@@ -1182,7 +1115,8 @@ namespace HCSearch
 		else
 		{
 			// if connected component is isolated without neighboring connected components, then flip to any possible class
-			candidateLabelsSet = Global::settings->CLASSES.getLabels();
+			const vector<int>& classIndices = Global::settings->CLASSES.getClassIndices();
+			candidateLabelsSet = set<int>(classIndices.begin(), classIndices.end());
 		}
 	}
 
@@ -1198,36 +1132,6 @@ namespace HCSearch
 		}
 	}
 
-	double StochasticScheduleSuccessor::computeKL(const VectorXd& p, const VectorXd& q)
-	{
-		if (p.size() != q.size())
-		{
-			LOG(WARNING) << "dimensions of p and q are not the same!" << endl;
-		}
-
-		double KL = 0;
-
-		VectorXd pn = p.normalized();
-		VectorXd qn = q.normalized();
-
-		for (int i = 0; i < p.size(); i++)
-		{
-			if (p(i) != 0)
-			{
-				if (q(i) == 0) // && p(i) != 0
-				{
-					// warning: q(i) = 0 does not imply p(i) = 0
-				}
-				else
-				{
-					KL += p(i) * log(p(i) / q(i));
-				}
-			}
-		}
-
-		return KL;
-	}
-
 	/**************** Stochastic Neighbor Successor Function ****************/
 
 	StochasticScheduleNeighborSuccessor::StochasticScheduleNeighborSuccessor()
@@ -1353,7 +1257,8 @@ namespace HCSearch
 	{
 	}
 	
-	vector< ImgCandidate > StochasticConstrainedSuccessor::generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+	int StochasticConstrainedSuccessor::streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+		ImgLabeling& YTemplate, CandidateVisitor_t visitor)
 	{
 		using namespace MyPrimitives;
 
@@ -1406,32 +1311,36 @@ namespace HCSearch
 		const int numEdges = X.getNumEdges();
 		int numPositiveClampedEdges = 0;
 		int numNegativeClampedEdges = 0;
-		for (map< Pair<int, int>, double >::iterator it = X.edgeWeights.begin(); it != X.edgeWeights.end(); ++it)
+		for (int node1 = 0; node1 < X.graph.adjacency->getNumNodes(); node1++)
 		{
-			Pair<int, int> key = it->first;
-			double edgeWeight = it->second;
-
-			if (!useConstraints || !this->clampEdges)
-			{
-				edgesClamped[key] = false;
-			}
-			else
+			for (CompressedAdjacency::NeighborIterator it = X.graph.adjacency->neighborsBegin(node1); 
+				it != X.graph.adjacency->neighborsEnd(node1); ++it)
 			{
-				if (edgeWeight >= this->edgeClampPositiveThreshold)
-				{
-					edgesClamped[key] = true;
-					edgesCut[key] = false;
-					numPositiveClampedEdges++;
-				}
-				else if (edgeWeight <= this->edgeClampNegativeThreshold)
+				Pair<int, int> key = Pair<int, int>(node1, *it);
+				double edgeWeight = X.graph.adjacency->getEdgeWeight(X.graph.adjacency->getEdgeIndex(it));
+
+				if (!useConstraints || !this->clampEdges)
 				{
-					edgesClamped[key] = true;
-					edgesCut[key] = true;
-					numNegativeClampedEdges++;
+					edgesClamped[key] = false;
 				}
 				else
 				{
-					edgesClamped[key] = false;
+					if (edgeWeight >= this->edgeClampPositiveThreshold)
+					{
+						edgesClamped[key] = true;
+						edgesCut[key] = false;
+						numPositiveClampedEdges++;
+					}
+					else if (edgeWeight <= this->edgeClampNegativeThreshold)
+					{
+						edgesClamped[key] = true;
+						edgesCut[key] = true;
+						numNegativeClampedEdges++;
+					}
+					else
+					{
+						edgesClamped[key] = false;
+					}
 				}
 			}
 		}
@@ -1468,7 +1377,7 @@ namespace HCSearch
 			if (!isClamped)
 			{
 				Pair<int, int> edge = it->first;
-				double edgeWeight = X.edgeWeights[edge];
+				double edgeWeight = X.graph.adjacency->getEdgeWeight(X.graph.adjacency->getEdgeIndex(edge.first, edge.second));
 
 				// perform cutting based on stochastic threshold
 				double indepThreshold = Rand::unifDist(); // ~ Uniform(0, 1)
@@ -1491,29 +1400,41 @@ namespace HCSearch
 		MyGraphAlgorithms::SubgraphSet* subgraphs = new MyGraphAlgorithms::SubgraphSet(Ycopy, edgesCut);
 
 		// constraint propagation 2: generate successors and propose labels that satisfy must-not-link edges
-		vector< ImgCandidate > successors = createCandidates(YPredConstrained, subgraphs, nodesClamped, edgesClamped, edgesCut);
+		int numSuccessors = createCandidates(YPredConstrained, subgraphs, nodesClamped, edgesClamped, edgesCut, YTemplate, visitor);
 
-		LOG() << "num successors generated=" << successors.size() << endl;
+		LOG() << "num successors generated=" << numSuccessors << endl;
 
-		Global::settings->stats->addSuccessorCount(successors.size());
+		Global::settings->stats->addSuccessorCount(numSuccessors);
 
 		delete subgraphs;
 
 		clock_t toc = clock();
 		LOG() << "successor total time: " << (double)(toc - tic)/CLOCKS_PER_SEC << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
-	vector< ImgCandidate > StochasticConstrainedSuccessor::createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs, 
-		vector< bool > nodesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesCut)
+	int StochasticConstrainedSuccessor::createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs, 
+		vector< bool > nodesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesCut, 
+		ImgLabeling& YTemplate, CandidateVisitor_t& visitor)
 	{
 		using namespace MyGraphAlgorithms;
 
 		vector< Subgraph* > subgraphset = subgraphs->getSubgraphs();
 
-		// successors set
-		vector< ImgCandidate > successors;
+		// cuts are the same for all candidates, so share them
+		MyPrimitives::CopyOnWrite< EdgeMask_t > stochasticCuts = subgraphs->getCuts();
+
+		// successors only differ from the current labeling at the flipped component
+		YTemplate = ImgLabeling();
+		YTemplate.confidences = YPred.confidences;
+		YTemplate.confidencesAvailable = YPred.confidencesAvailable;
+		YTemplate.stochasticCuts = stochasticCuts;
+		YTemplate.stochasticCutsAvailable = true;
+		YTemplate.graph = YPred.graph;
+
+		int numSuccessors = 0;
+		ImgCandidateDelta delta;
 
 		// loop over each sub graph
 		int cumSumLabels = 0;
@@ -1550,8 +1471,8 @@ namespace HCSearch
 				for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
 				{
 					int node1 = *it4;
-					set<int> neighbors = YPred.graph.adjList[node1];
-					for (set<int>::iterator it5 = neighbors.begin(); it5 != neighbors.end(); ++it5)
+					for (CompressedAdjacency::NeighborIterator it5 = YPred.graph.adjacency->neighborsBegin(node1); 
+						it5 != YPred.graph.adjacency->neighborsEnd(node1); ++it5)
 					{
 						int node2 = *it5;
 						MyPrimitives::Pair<int, int> edge = MyPrimitives::Pair<int, int>(node1, node2);
@@ -1577,32 +1498,23 @@ namespace HCSearch
 					int label = *it3;
 
 					// form successor object
-					ImgLabeling YNew;
-					YNew.confidences = YPred.confidences;
-					YNew.confidencesAvailable = YPred.confidencesAvailable;
-					YNew.stochasticCuts = subgraphs->getCuts();
-					YNew.stochasticCutsAvailable = true;
-					YNew.graph = YPred.graph;
-
-					// make changes
 					set<int> component = cc->getNodes();
-					set<int> action;
+					delta.action.clear();
+					delta.labels.clear();
 					for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
 					{
 						int node = *it4;
 						// clamp node otherwise flip it
 						if (nodesClamped[node])
-							YNew.graph.nodesData(node) = YPred.getLabel(node);
+							delta.labels.push_back(YPred.getLabel(node));
 						else
-							YNew.graph.nodesData(node) = label;
-						action.insert(node);
+							delta.labels.push_back(label);
+						delta.action.insert(node);
 					}
 
-					ImgCandidate YCandidate;
-					YCandidate.labeling = YNew;
-					YCandidate.action = action;
-
-					successors.push_back(YCandidate);
+					// pass candidate on
+					visitor(delta);
+					numSuccessors++;
 				}
 			}
 		}
@@ -1612,7 +1524,7 @@ namespace HCSearch
 
 		LOG() << "num negative edge constraint enforcements=" << numEdgeConstraintEnforcement << endl;
 
-		return successors;
+		return numSuccessors;
 	}
 
 	AdjList_t StochasticConstrainedSuccessor::transitiveClosurePositiveEdges(map< MyPrimitives::Pair<int, int>, bool > edgesClamped, 
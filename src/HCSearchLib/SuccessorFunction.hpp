@@ -1,6 +1,7 @@
 #ifndef SUCCESSORFUNCTION_HPP
 #define SUCCESSORFUNCTION_HPP
 
+#include <functional>
 #include "DataStructures.hpp"
 #include "MyGraphAlgorithms.hpp"
 
@@ -8,6 +9,11 @@ namespace HCSearch
 {
 	/**************** Search Space Function Abstract Definitions ****************/
 
+	/*!
+	 * Callback receiving each successor candidate as it is generated.
+	 */
+	typedef function<void(const ImgCandidateDelta&)> CandidateVisitor_t;
+
 	/*!
 	 * @brief Successor function interface
 	 */
@@ -18,8 +24,28 @@ namespace HCSearch
 		
 		/*!
 		 * @brief Generate successors.
+		 * 
+		 * Materializes every candidate from streamSuccessors.
+		 */
+		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+
+		/*!
+		 * @brief Generate successors as label changes to a template labeling.
+		 * 
+		 * Collects every candidate from streamSuccessors without materializing it.
+		 */
+		vector< ImgCandidateDelta > generateSuccessorDeltas(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate);
+
+		/*!
+		 * @brief Generate successors lazily.
+		 * 
+		 * Sets YTemplate to the labeling the successors share (before the first visit), 
+		 * then passes each successor to the visitor as its changes to YTemplate.
+		 * @return Returns the number of successors generated
 		 */
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)=0;
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor)=0;
 	};
 
 	/**************** Successor Functions ****************/
@@ -40,7 +66,8 @@ namespace HCSearch
 		FlipbitSuccessor();
 		~FlipbitSuccessor();
 		
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor);
 	};
 
 	/*!
@@ -54,7 +81,8 @@ namespace HCSearch
 		FlipbitNeighborSuccessor();
 		~FlipbitNeighborSuccessor();
 		
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor);
 	};
 
 	/*!
@@ -68,7 +96,8 @@ namespace HCSearch
 		FlipbitConfidencesNeighborSuccessor();
 		~FlipbitConfidencesNeighborSuccessor();
 		
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor);
 	};
 
 	/*!
@@ -95,18 +124,36 @@ namespace HCSearch
 		StochasticSuccessor(bool cutEdgesIndependently, double cutParam, double maxThreshold, double minThreshold);
 		~StochasticSuccessor();
 
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor);
 
 	protected:
 		virtual MyGraphAlgorithms::SubgraphSet* cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T);
-		virtual vector< ImgCandidate > createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs);
+		virtual int createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs, 
+			ImgLabeling& YTemplate, CandidateVisitor_t& visitor);
 		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 
 		void getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 		void getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 		void getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 
-		static double computeKL(const VectorXd& p, const VectorXd& q);
+		/*!
+		 * Union-find buffers reused by the cuts of one thread.
+		 */
+		struct CutForests
+		{
+			MyGraphAlgorithms::DisjointSet subgraphs;
+			MyGraphAlgorithms::DisjointSet components;
+		};
+
+		/*!
+		 * Get the union-find buffers of the calling thread.
+		 */
+		CutForests& getCutForests();
+
+	private:
+		map< thread::id, CutForests > cutForests; //!< Union-find buffers of each thread
+		std::mutex cutForestsLock; //!< Guards cutForests
 	};
 
 	/*!
@@ -163,7 +210,8 @@ namespace HCSearch
 		CutScheduleSuccessor(double cutParam);
 		~CutScheduleSuccessor();
 
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor);
 
 	protected:
 		virtual MyGraphAlgorithms::SubgraphSet* cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T);
@@ -236,18 +284,18 @@ namespace HCSearch
 			bool clampNodes, bool clampEdges, double nodeClampThreshold, double edgeClampPositiveThreshold, double edgeClampNegativeThreshold);
 		~StochasticScheduleSuccessor();
 
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor);
 
 	protected:
 		virtual MyGraphAlgorithms::SubgraphSet* cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T, int timeStep, int timeBound);
-		virtual vector< ImgCandidate > createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs);
+		virtual int createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs, 
+			ImgLabeling& YTemplate, CandidateVisitor_t& visitor);
 		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 
 		void getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 		void getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 		void getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
-
-		static double computeKL(const VectorXd& p, const VectorXd& q);
 	};
 
 	/*!
@@ -319,11 +367,13 @@ namespace HCSearch
 			bool clampNodes, bool clampEdges, double nodeClampThreshold, double edgeClampPositiveThreshold, double edgeClampNegativeThreshold);
 		~StochasticConstrainedSuccessor();
 
-		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound);
+		virtual int streamSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound, 
+			ImgLabeling& YTemplate, CandidateVisitor_t visitor);
 
 	protected:
-		virtual vector< ImgCandidate > createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs,
-			vector< bool > nodesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesCut);
+		virtual int createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs,
+			vector< bool > nodesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesClamped, map< MyPrimitives::Pair<int, int>, bool > edgesCut, 
+			ImgLabeling& YTemplate, CandidateVisitor_t& visitor);
 
 		AdjList_t transitiveClosurePositiveEdges(map< MyPrimitives::Pair<int, int>, bool > edgesClamped, 
 			map< MyPrimitives::Pair<int, int>, bool > edgesCut, int numNodes);
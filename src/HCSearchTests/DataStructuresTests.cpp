@@ -0,0 +1,419 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "HCSearch.hpp"
+#include "MyFileSystem.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace HCSearch;
+
+namespace Testing
+{
+	TEST_CLASS(DataStructuresTests)
+	{
+	public:
+
+		TEST_METHOD(CompressedAdjacencyTest)
+		{
+			Global::settings = new Settings();
+
+			// 0 - 1 - 2 chain and 3 - 1, node 4 isolated
+			AdjList_t edges;
+			edges[0].insert(1);
+			edges[1].insert(3);
+			edges[1].insert(0);
+			edges[1].insert(2);
+			edges[2].insert(1);
+			edges[3].insert(1);
+
+			CompressedAdjacency adjacency = CompressedAdjacency(edges, 5);
+			Assert::AreEqual(adjacency.getNumNodes(), 5);
+			Assert::AreEqual(adjacency.getNumEdges(), 6);
+
+			// offsets
+			const int expectedOffsets[6] = { 0, 1, 4, 5, 6, 6 };
+			for (int node = 0; node < 5; node++)
+			{
+				Assert::AreEqual(static_cast<int>(adjacency.neighborsBegin(node) - adjacency.neighborsBegin(0)), expectedOffsets[node]);
+				Assert::AreEqual(adjacency.getNumNeighbors(node), expectedOffsets[node+1] - expectedOffsets[node]);
+			}
+
+			// neighbors in increasing order, edge indices in storage order
+			const int expectedNeighbors[6] = { 1, 0, 2, 3, 1, 1 };
+			for (int node = 0; node < 5; node++)
+			{
+				for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node); 
+					it != adjacency.neighborsEnd(node); ++it)
+				{
+					int edgeIndex = adjacency.getEdgeIndex(it);
+					Assert::AreEqual(*it, expectedNeighbors[edgeIndex]);
+					Assert::AreEqual(adjacency.getEdgeIndex(node, *it), edgeIndex);
+					Assert::AreEqual(adjacency.getEdgeWeight(edgeIndex), 1.0);
+				}
+			}
+
+			Assert::IsTrue(adjacency.hasEdge(3, 1));
+			Assert::IsFalse(adjacency.hasEdge(0, 2));
+			Assert::IsFalse(adjacency.hasEdge(4, 0));
+			Assert::AreEqual(adjacency.getEdgeIndex(4, 0), -1);
+
+			// labelings read the neighbors from the shared adjacency
+			ImgLabeling Y;
+			Y.graph.adjacency = adjacency;
+			Y.graph.nodesData = VectorXi::Zero(5);
+			Y.graph.nodesData << 0, 1, 2, 0, 1;
+			Assert::AreEqual(Y.getNumEdges(), 6);
+			Assert::IsTrue(Y.hasNeighbors(0));
+			Assert::IsFalse(Y.hasNeighbors(4));
+			Assert::AreEqual(static_cast<int>(Y.getNeighbors(1).size()), 3);
+			Assert::AreEqual(static_cast<int>(Y.getNeighborLabels(1).count(2)), 1);
+			Assert::AreEqual(static_cast<int>(Y.getNeighborLabels(1).count(1)), 0);
+		}
+
+		TEST_METHOD(BinaryImageRoundTripTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			const string IMAGE_FILE = "binary_image_test.bin";
+			const int numNodes = 4;
+
+			// 2x2 grid with distinct edge weights
+			AdjList_t edges;
+			edges[0].insert(1);
+			edges[0].insert(2);
+			edges[1].insert(0);
+			edges[1].insert(3);
+			edges[2].insert(0);
+			edges[2].insert(3);
+			edges[3].insert(1);
+			edges[3].insert(2);
+			CompressedAdjacency adjacency(edges, numNodes);
+			for (int edgeIndex = 0; edgeIndex < adjacency.getNumEdges(); edgeIndex++)
+				adjacency.setEdgeWeight(edgeIndex, 0.1*(edgeIndex+1));
+
+			ImgFeatures X;
+			X.graph.adjacency = adjacency;
+			X.graph.nodesData = MatrixXd(numNodes, 3);
+			X.graph.nodesData << 0.2, 0.3, 0.5, 
+								0.6, 0.1, 0.3, 
+								0.4, 0.4, 0.2, 
+								0.1, 0.8, 0.1;
+			X.nodeLocationsAvailable = true;
+			X.nodeLocations = MatrixXd(numNodes, 2);
+			X.nodeLocations << 0.25, 0.25, 0.75, 0.25, 0.25, 0.75, 0.75, 0.75;
+			X.segmentsAvailable = true;
+			X.segments = MatrixXi(2, 3);
+			X.segments << 0, 0, 1, 2, 3, 3;
+			X.edgeWeightsAvailable = false;
+			X.edgeFeaturesAvailable = false;
+			X.computeEdgeDivergences();
+
+			ImgLabeling Y;
+			Y.graph.adjacency = X.graph.adjacency;
+			Y.graph.nodesData = VectorXi(numNodes);
+			Y.graph.nodesData << 0, 2, 1, 2;
+			Y.nodeWeightsAvailable = true;
+			Y.nodeWeights = VectorXd(numNodes);
+			Y.nodeWeights << 1.0, 0.5, 2.0, 0.25;
+
+			Dataset::writeBinaryImage(IMAGE_FILE, X, Y);
+
+			{
+				ImgFeatures XRead;
+				ImgLabeling YRead;
+				Dataset::readBinaryImage(IMAGE_FILE, "image", XRead, YRead, true);
+
+				// features are read in place from the file
+				Assert::IsTrue(XRead.graph.nodesData.isView());
+				Assert::IsTrue(XRead.graph.nodesData == X.graph.nodesData);
+				Assert::IsTrue(XRead.getFileName() == "image");
+				Assert::IsTrue(XRead.nodeLocations == X.nodeLocations);
+				Assert::IsTrue(XRead.segments == X.segments);
+				Assert::IsTrue(XRead.edgeDivergencesAvailable);
+				Assert::IsTrue(XRead.edgeDivergences == X.edgeDivergences);
+				Assert::IsTrue(YRead.graph.nodesData == Y.graph.nodesData);
+				Assert::IsTrue(YRead.nodeWeights == Y.nodeWeights);
+
+				// same adjacency and edge weights, shared with the labeling
+				const CompressedAdjacency& readAdjacency = *XRead.graph.adjacency;
+				Assert::AreEqual(readAdjacency.getNumNodes(), numNodes);
+				Assert::AreEqual(readAdjacency.getNumEdges(), adjacency.getNumEdges());
+				for (int node = 0; node < numNodes; node++)
+				{
+					Assert::AreEqual(readAdjacency.getNumNeighbors(node), adjacency.getNumNeighbors(node));
+					for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node); it != adjacency.neighborsEnd(node); ++it)
+					{
+						int edgeIndex = readAdjacency.getEdgeIndex(node, *it);
+						Assert::AreEqual(edgeIndex, adjacency.getEdgeIndex(it));
+						Assert::AreEqual(readAdjacency.getEdgeWeight(edgeIndex), adjacency.getEdgeWeight(edgeIndex));
+					}
+				}
+				Assert::IsTrue(&*YRead.graph.adjacency == &readAdjacency);
+
+				// copies share the view, which outlives the image it was read into
+				ImgFeatures XCopy = XRead;
+				XRead.graph = FeatureGraph();
+				Assert::IsTrue(XCopy.graph.nodesData.isView());
+				Assert::IsTrue(XCopy.graph.nodesData == X.graph.nodesData);
+
+				// assigning a matrix copies it
+				XCopy.graph.nodesData = MatrixXd(XCopy.graph.nodesData);
+				Assert::IsFalse(XCopy.graph.nodesData.isView());
+				Assert::IsTrue(XCopy.graph.nodesData == X.graph.nodesData);
+			}
+
+			MyFileSystem::FileSystem::deleteFile(IMAGE_FILE);
+		}
+
+		TEST_METHOD(RankingExampleLogRoundTripTest)
+		{
+			Global::settings = new Settings();
+
+			const string LOG_FILE = "ranking_example_log_test.bin";
+			const string SVMRANK_FILE = "ranking_example_log_test.svmrank.txt";
+			const string VW_FILE = "ranking_example_log_test.vw.txt";
+
+			VectorXd features1 = VectorXd::Zero(4);
+			features1 << 0.5, 0, -2, 0;
+			VectorXd features2 = VectorXd::Zero(4);
+
+			RankingExampleLog* log = new RankingExampleLog(LOG_FILE, false);
+			log->addExample(features1, 1, 3, 0.25);
+			log->addExample(features2, 2, 3, 1.5);
+			Assert::AreEqual(log->getNumExamples(), 2);
+			delete log;
+
+			// read back
+			ifstream fh(LOG_FILE.c_str(), ios_base::in | ios_base::binary);
+			RankingExample example;
+
+			Assert::IsTrue(RankingExampleLog::readExample(fh, example));
+			Assert::AreEqual(example.target, 1);
+			Assert::AreEqual(example.qid, 3);
+			Assert::AreEqual(example.loss, 0.25);
+			Assert::AreEqual(example.featureDim, 4);
+			Assert::AreEqual(static_cast<int>(example.indices.size()), 2);
+			Assert::AreEqual(example.indices[0], 0);
+			Assert::AreEqual(example.indices[1], 2);
+			Assert::AreEqual(example.values[0], 0.5f);
+			Assert::AreEqual(example.values[1], -2.0f);
+
+			Assert::IsTrue(RankingExampleLog::readExample(fh, example));
+			Assert::AreEqual(example.target, 2);
+			Assert::AreEqual(example.loss, 1.5);
+			Assert::AreEqual(static_cast<int>(example.indices.size()), 0);
+
+			Assert::IsFalse(RankingExampleLog::readExample(fh, example));
+			fh.close();
+
+			// export to text formats (1-based feature indices)
+			RankingExampleLog::exportSVMRank(LOG_FILE, SVMRANK_FILE);
+			RankingExampleLog::exportVW(LOG_FILE, VW_FILE);
+
+			ifstream svmRank(SVMRANK_FILE.c_str());
+			stringstream svmRankText;
+			svmRankText << svmRank.rdbuf();
+			svmRank.close();
+			Assert::AreEqual(svmRankText.str(), string("1 qid:3 1:0.5 3:-2 \n2 qid:3 \n"));
+
+			ifstream vw(VW_FILE.c_str());
+			stringstream vwText;
+			vwText << vw.rdbuf();
+			vw.close();
+			Assert::AreEqual(vwText.str(), string("1 0.25 | 1:0.5 3:-2 \n2 1.5 | \n"));
+
+			MyFileSystem::FileSystem::deleteFile(LOG_FILE);
+			MyFileSystem::FileSystem::deleteFile(SVMRANK_FILE);
+			MyFileSystem::FileSystem::deleteFile(VW_FILE);
+		}
+
+		TEST_METHOD(RankingExampleLogCorruptTest)
+		{
+			Global::settings = new Settings();
+
+			const string LOG_FILE = "ranking_example_log_corrupt.bin";
+
+			// records: { featureDim, numNonZero, index }
+			const int numCases = 3;
+			int records[numCases][3] = { {4, -1, 0}, {4, 5, 0}, {4, 1, 4} };
+
+			for (int c = 0; c < numCases; c++)
+			{
+				int target = 1;
+				int qid = 1;
+				double loss = 0;
+				float value = 1;
+
+				ofstream ofh(LOG_FILE.c_str(), ios_base::out | ios_base::binary);
+				ofh.write(reinterpret_cast<char*>(&target), sizeof(int));
+				ofh.write(reinterpret_cast<char*>(&qid), sizeof(int));
+				ofh.write(reinterpret_cast<char*>(&loss), sizeof(double));
+				ofh.write(reinterpret_cast<char*>(&records[c][0]), sizeof(int));
+				ofh.write(reinterpret_cast<char*>(&records[c][1]), sizeof(int));
+				ofh.write(reinterpret_cast<char*>(&records[c][2]), sizeof(int));
+				ofh.write(reinterpret_cast<char*>(&value), sizeof(float));
+				ofh.close();
+
+				ifstream fh(LOG_FILE.c_str(), ios_base::in | ios_base::binary);
+				RankingExample example;
+				Assert::IsFalse(RankingExampleLog::readExample(fh, example));
+				fh.close();
+			}
+
+			MyFileSystem::FileSystem::deleteFile(LOG_FILE);
+		}
+
+		TEST_METHOD(SampleRankingPairsAllTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->RANK_PAIR_SAMPLING = ALL_PAIRS;
+			Global::settings->RANK_PAIRS_PER_POSITIVE = 2;
+
+			vector<double> betterLosses(2, 0.0);
+			double worse[] = {0.9, 0.2, 0.5, 0.1};
+			vector<double> worseLosses(worse, worse + 4);
+
+			// full cross product
+			vector< vector<int> > pairs = IRankModel::sampleRankingPairs(betterLosses, worseLosses);
+			Assert::AreEqual(static_cast<int>(pairs.size()), 2);
+			for (int i = 0; i < 2; i++)
+			{
+				Assert::AreEqual(static_cast<int>(pairs[i].size()), 4);
+				for (int j = 0; j < 4; j++)
+					Assert::AreEqual(pairs[i][j], j);
+			}
+
+			// other samplings fall back to all pairs if there are not more than k worse examples
+			Global::settings->RANK_PAIR_SAMPLING = HARDEST_PAIRS;
+			Global::settings->RANK_PAIRS_PER_POSITIVE = 4;
+			pairs = IRankModel::sampleRankingPairs(betterLosses, worseLosses);
+			Assert::AreEqual(static_cast<int>(pairs[0].size()), 4);
+
+			Global::settings->RANK_PAIRS_PER_POSITIVE = 0;
+			pairs = IRankModel::sampleRankingPairs(betterLosses, worseLosses);
+			Assert::AreEqual(static_cast<int>(pairs[0].size()), 4);
+		}
+
+		TEST_METHOD(SampleRankingPairsHardestTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->RANK_PAIR_SAMPLING = HARDEST_PAIRS;
+			Global::settings->RANK_PAIRS_PER_POSITIVE = 2;
+
+			vector<double> betterLosses(3, 0.0);
+			double worse[] = {0.9, 0.2, 0.5, 0.1};
+			vector<double> worseLosses(worse, worse + 4);
+
+			// the worse examples with the lowest loss, in index order
+			vector< vector<int> > pairs = IRankModel::sampleRankingPairs(betterLosses, worseLosses);
+			Assert::AreEqual(static_cast<int>(pairs.size()), 3);
+			for (int i = 0; i < 3; i++)
+			{
+				Assert::AreEqual(static_cast<int>(pairs[i].size()), 2);
+				Assert::AreEqual(pairs[i][0], 1);
+				Assert::AreEqual(pairs[i][1], 3);
+			}
+		}
+
+		TEST_METHOD(SampleRankingPairsRandomTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->RANK_PAIR_SAMPLING = RANDOM_PAIRS;
+			Global::settings->RANK_PAIRS_PER_POSITIVE = 3;
+
+			const int numBetter = 20;
+			const int numWorse = 7;
+			vector<double> betterLosses(numBetter, 0.0);
+			vector<double> worseLosses(numWorse, 1.0);
+
+			// k distinct worse examples for each better example, in index order
+			vector< vector<int> > pairs = IRankModel::sampleRankingPairs(betterLosses, worseLosses);
+			Assert::AreEqual(static_cast<int>(pairs.size()), numBetter);
+			set<int> drawn;
+			for (int i = 0; i < numBetter; i++)
+			{
+				Assert::AreEqual(static_cast<int>(pairs[i].size()), 3);
+				for (int j = 0; j < 3; j++)
+				{
+					Assert::IsTrue(pairs[i][j] >= 0 && pairs[i][j] < numWorse);
+					if (j > 0)
+						Assert::IsTrue(pairs[i][j-1] < pairs[i][j]);
+					drawn.insert(pairs[i][j]);
+				}
+			}
+
+			// draws are not all the same worse examples
+			Assert::IsTrue(static_cast<int>(drawn.size()) > 3);
+		}
+
+		TEST_METHOD(OnlineRankModelAverageTest)
+		{
+			Global::settings = new Settings();
+
+			double EPSILON = 0.0001;
+
+			// shorter weights are padded, empty weights are skipped
+			vector< VectorXd > weightsList(3);
+			weightsList[0] = VectorXd(2);
+			weightsList[0] << 1, 2;
+			weightsList[2] = VectorXd(1);
+			weightsList[2] << 3;
+
+			VectorXd average = OnlineRankModel::averageWeights(weightsList);
+			Assert::AreEqual(static_cast<int>(average.size()), 2);
+			Assert::AreEqual(average(0), 2.0, EPSILON);
+			Assert::AreEqual(average(1), 1.0, EPSILON);
+
+			// no model had training data
+			vector< VectorXd > emptyList(2);
+			Assert::AreEqual(static_cast<int>(OnlineRankModel::averageWeights(emptyList).size()), 0);
+		}
+
+		TEST_METHOD(OnlineRankModelLoadTest)
+		{
+			Global::settings = new Settings();
+
+			const string MODEL_FILE = "online_model_test.txt";
+			const string SAVED_MODEL_FILE = "online_model_test_saved.txt";
+
+			double EPSILON = 0.0001;
+
+			VectorXd features(3);
+			features << 1, 0, 1;
+
+			ofstream ofh(MODEL_FILE.c_str());
+			ofh << "header" << endl << "1:2 3:1 " << endl;
+			ofh.close();
+
+			OnlineRankModel model(MODEL_FILE);
+			Assert::AreEqual(model.rank(RankFeatures(features)), 3.0, EPSILON);
+
+			// save and load again
+			model.save(SAVED_MODEL_FILE);
+			OnlineRankModel savedModel(SAVED_MODEL_FILE);
+			Assert::AreEqual(savedModel.rank(RankFeatures(features)), 3.0, EPSILON);
+
+			// a model file without weights (e.g. merged from zero models) leaves the model uninitialized
+			ofh.open(MODEL_FILE.c_str());
+			ofh << "header" << endl << endl;
+			ofh.close();
+
+			OnlineRankModel emptyModel(MODEL_FILE);
+			Assert::AreEqual(emptyModel.rank(RankFeatures(features)), 0.0, EPSILON);
+
+			// and is ignored like a missing file by a model that has weights
+			model.load(MODEL_FILE);
+			Assert::AreEqual(model.rank(RankFeatures(features)), 3.0, EPSILON);
+
+			MyFileSystem::FileSystem::deleteFile(MODEL_FILE);
+			MyFileSystem::FileSystem::deleteFile(SAVED_MODEL_FILE);
+		}
+	};
+}
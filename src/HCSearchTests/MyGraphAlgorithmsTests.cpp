@@ -14,46 +14,48 @@ namespace Testing
 	{
 	private:
 		ImgLabeling Y;
-		map< int, set<int> > cuts;
+		EdgeMask_t cuts;
 
 		static ImgLabeling setupImgLabelingHelper()
 		{
 			LabelGraph graph;
 			graph.nodesData = VectorXi::Zero(9);
 			graph.nodesData << 1, 1, 0, 1, 0, 1, 0, 1, 1;
-			graph.adjList[0].insert(1);
-			graph.adjList[0].insert(3);
-			graph.adjList[1].insert(0);
-			graph.adjList[1].insert(2);
-			graph.adjList[1].insert(4);
-			graph.adjList[2].insert(1);
-			graph.adjList[2].insert(5);
-			graph.adjList[3].insert(0);
-			graph.adjList[3].insert(4);
-			graph.adjList[3].insert(6);
-			graph.adjList[4].insert(1);
-			graph.adjList[4].insert(3);
-			graph.adjList[4].insert(7);
-			graph.adjList[4].insert(5);
-			graph.adjList[5].insert(2);
-			graph.adjList[5].insert(4);
-			graph.adjList[5].insert(8);
-			graph.adjList[6].insert(3);
-			graph.adjList[6].insert(7);
-			graph.adjList[7].insert(4);
-			graph.adjList[7].insert(6);
-			graph.adjList[7].insert(8);
-			graph.adjList[8].insert(5);
-			graph.adjList[8].insert(7);
+			AdjList_t edges;
+			edges[0].insert(1);
+			edges[0].insert(3);
+			edges[1].insert(0);
+			edges[1].insert(2);
+			edges[1].insert(4);
+			edges[2].insert(1);
+			edges[2].insert(5);
+			edges[3].insert(0);
+			edges[3].insert(4);
+			edges[3].insert(6);
+			edges[4].insert(1);
+			edges[4].insert(3);
+			edges[4].insert(7);
+			edges[4].insert(5);
+			edges[5].insert(2);
+			edges[5].insert(4);
+			edges[5].insert(8);
+			edges[6].insert(3);
+			edges[6].insert(7);
+			edges[7].insert(4);
+			edges[7].insert(6);
+			edges[7].insert(8);
+			edges[8].insert(5);
+			edges[8].insert(7);
+			graph.adjacency = CompressedAdjacency(edges, 9);
 			
 			ImgLabeling Y;
 			Y.graph = graph;
 			return Y;
 		}
 
-		static map< int, set<int> > setupCutsHelper()
+		static EdgeMask_t setupCutsHelper(ImgLabeling& Y)
 		{
-			map< int, set<int> > cuts;
+			AdjList_t cuts;
 			cuts[0].insert(3);
 			cuts[1].insert(2);
 			cuts[1].insert(4);
@@ -70,7 +72,14 @@ namespace Testing
 			cuts[6].insert(7);
 			cuts[7].insert(6);
 			cuts[8].insert(5);
-			return cuts;
+
+			// flag uncut edges by edge index
+			const CompressedAdjacency& adjacency = *Y.graph.adjacency;
+			EdgeMask_t mask(adjacency.getNumEdges(), false);
+			for (AdjList_t::iterator it = cuts.begin(); it != cuts.end(); ++it)
+				for (set<int>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2)
+					mask[adjacency.getEdgeIndex(it->first, *it2)] = true;
+			return mask;
 		}
 
 	public:
@@ -79,10 +88,12 @@ namespace Testing
 		{
 			Settings* settings = new Settings();
 			settings->refresh("input", "output", "");
+			settings->CLASSES.addClass(0, 0, false);
+			settings->CLASSES.addClass(1, 1, false);
 			Global::settings = settings;
 
 			this->Y = setupImgLabelingHelper();	
-			this->cuts = setupCutsHelper();
+			this->cuts = setupCutsHelper(this->Y);
 		}
 
 		TEST_METHOD_CLEANUP(SubgraphSetTeardown)
@@ -137,6 +148,64 @@ namespace Testing
 			Assert::AreEqual(ds.FindSet(1), ds.FindSet(2));
 			Assert::AreEqual(ds.FindSet(2), ds.FindSet(3));
 			Assert::AreEqual(ds.FindSet(1), ds.FindSet(3));
+
+			// reset back to singletons
+			ds.reset(10);
+			Assert::AreNotEqual(ds.FindSet(1), ds.FindSet(2));
+			Assert::AreNotEqual(ds.FindSet(2), ds.FindSet(3));
+		}
+
+		TEST_METHOD(SubgraphSetFromForestsTest)
+		{
+			// union uncut edges beforehand
+			const CompressedAdjacency& adjacency = *Y.graph.adjacency;
+			MyGraphAlgorithms::DisjointSet subgraphForest(Y.getNumNodes());
+			for (int node1 = 0; node1 < Y.getNumNodes(); node1++)
+				for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node1); it != adjacency.neighborsEnd(node1); ++it)
+					if (cuts[adjacency.getEdgeIndex(it)])
+						subgraphForest.Union(node1, *it);
+
+			// component buffer is dirty from a previous use
+			MyGraphAlgorithms::DisjointSet componentForest(Y.getNumNodes());
+			componentForest.Union(0, 8);
+
+			MyGraphAlgorithms::SubgraphSet subgraphset(Y, cuts, subgraphForest, componentForest);
+			MyGraphAlgorithms::SubgraphSet expected(Y, cuts);
+			Assert::AreEqual(subgraphset.size(), expected.size());
+
+			vector< MyGraphAlgorithms::Subgraph* > subs = subgraphset.getSubgraphs();
+			vector< MyGraphAlgorithms::Subgraph* > expectedSubs = expected.getSubgraphs();
+			for (int i = 0; i < static_cast<int>(subs.size()); i++)
+			{
+				Assert::IsTrue(subs[i]->getNodes() == expectedSubs[i]->getNodes());
+				Assert::IsTrue(subs[i]->getConnectedComponents().size() == expectedSubs[i]->getConnectedComponents().size());
+			}
+		}
+
+		TEST_METHOD(SubgraphSetCutMaskTest)
+		{
+			const CompressedAdjacency& adjacency = *Y.graph.adjacency;
+
+			// same cuts given as (node1, node2) cut decisions
+			map< MyPrimitives::Pair<int, int>, bool > cutDecisions;
+			for (int node1 = 0; node1 < Y.getNumNodes(); node1++)
+				for (CompressedAdjacency::NeighborIterator it = adjacency.neighborsBegin(node1); it != adjacency.neighborsEnd(node1); ++it)
+					cutDecisions[MyPrimitives::Pair<int, int>(node1, *it)] = !cuts[adjacency.getEdgeIndex(it)];
+
+			MyGraphAlgorithms::SubgraphSet subgraphset(Y, cutDecisions);
+			MyGraphAlgorithms::SubgraphSet expected(Y, cuts);
+			Assert::AreEqual(subgraphset.size(), expected.size());
+
+			// kept edges are flagged by edge index
+			EdgeMask_t kept = subgraphset.getCuts().get();
+			Assert::AreEqual(static_cast<int>(kept.size()), adjacency.getNumEdges());
+			Assert::IsTrue(kept == cuts);
+			Assert::IsTrue(kept[adjacency.getEdgeIndex(0, 3)]);
+			Assert::IsFalse(kept[adjacency.getEdgeIndex(0, 1)]);
+
+			// all edges kept gives one subgraph
+			MyGraphAlgorithms::SubgraphSet uncut(Y, EdgeMask_t(adjacency.getNumEdges(), true));
+			Assert::AreEqual(uncut.size(), 1);
 		}
 	};
 }
\ No newline at end of file
@@ -68,5 +68,44 @@ namespace Testing
 			Assert::AreEqual(static_cast<int>(test.count(Pair<int, int>(1, -1))), 1);
 			Assert::AreEqual(static_cast<int>(test.size()), 4);
 		}
+
+		TEST_METHOD(CopyOnWriteSharing)
+		{
+			// construct
+			set<int> values;
+			values.insert(1);
+			CopyOnWrite< set<int> > original = values;
+			Assert::AreEqual(original.shared(), false);
+
+			// copies share until written
+			CopyOnWrite< set<int> > copy = original;
+			Assert::AreEqual(original.shared(), true);
+			Assert::AreEqual(copy.shared(), true);
+
+			// write to copy
+			copy.edit().insert(2);
+			Assert::AreEqual(original.shared(), false);
+			Assert::AreEqual(copy.shared(), false);
+			Assert::AreEqual(static_cast<int>(original->size()), 1);
+			Assert::AreEqual(static_cast<int>(copy->size()), 2);
+		}
+
+		TEST_METHOD(CopyOnWriteDefault)
+		{
+			// default values share one empty value
+			CopyOnWrite< set<int> > first;
+			CopyOnWrite< set<int> > second;
+			Assert::AreEqual(first.shared(), true);
+			Assert::AreEqual(static_cast<int>(first->size()), 0);
+
+			// writing to one leaves the others empty
+			first.edit().insert(1);
+			Assert::AreEqual(first.shared(), false);
+			Assert::AreEqual(static_cast<int>(first->size()), 1);
+			Assert::AreEqual(static_cast<int>(second->size()), 0);
+
+			CopyOnWrite< set<int> > third;
+			Assert::AreEqual(static_cast<int>(third->size()), 0);
+		}
 	};
 }
\ No newline at end of file
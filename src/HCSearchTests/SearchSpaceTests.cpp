@@ -2,13 +2,186 @@
 #include "CppUnitTest.h"
 
 #include <iostream>
+#include <fstream>
+#include <chrono>
+#include <thread>
 #include "HCSearch.hpp"
+#include "MyFileSystem.hpp"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace HCSearch;
 
 namespace Testing
 {		
+	// labels every node with the first class
+	class ZeroInit : public IInitialPredictionFunction
+	{
+	public:
+		virtual ImgLabeling getInitialPrediction(ImgFeatures& X)
+		{
+			ImgLabeling Y;
+			Y.graph.adjacency = X.graph.adjacency;
+			Y.graph.nodesData = VectorXi::Zero(X.getNumNodes());
+			return Y;
+		}
+	};
+
+	// ranks features by a fixed linear function
+	class LinearRanker : public IRankModel
+	{
+		VectorXd weights;
+
+	public:
+		LinearRanker(const VectorXd& weights)
+		{
+			this->weights = weights;
+			this->initialized = true;
+		}
+
+		virtual double rank(RankFeatures features)
+		{
+			return vectorDot(features.data, this->weights);
+		}
+
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList)
+		{
+			VectorXd ranks = rankBatch(stackFeatures(featuresList));
+			return vector<double>(ranks.data(), ranks.data() + ranks.size());
+		}
+
+		virtual VectorXd rankBatch(const MatrixXd& featuresMatrix)
+		{
+			return matrixVectorDot(featuresMatrix, this->weights);
+		}
+
+		virtual RankerType rankerType()
+		{
+			return ONLINE_RANK;
+		}
+
+		virtual void load(string fileName) {}
+		virtual void save(string fileName) {}
+	};
+
+	// changed nodes and full labeling of a candidate
+	typedef pair< set<int>, vector<int> > CandidateKey_t;
+
+	CandidateKey_t candidateKey(const ImgCandidate& YCandidate)
+	{
+		const VectorXi& labels = YCandidate.labeling.graph.nodesData;
+		return CandidateKey_t(YCandidate.action, vector<int>(labels.data(), labels.data() + labels.size()));
+	}
+
+	vector< CandidateKey_t > sortedCandidateKeys(const vector< ImgCandidate >& YCandidates)
+	{
+		vector< CandidateKey_t > keys;
+		for (vector< ImgCandidate >::const_iterator it = YCandidates.begin(); it != YCandidates.end(); ++it)
+			keys.push_back(candidateKey(*it));
+		sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	// chain of nodes with positive features, labeled in blocks of 4 nodes of the same class
+	void setupChainHelper(ImgFeatures& X, ImgLabeling& Y, int numNodes, int numClasses)
+	{
+		AdjList_t edges;
+		FeatureGraph graph2;
+		graph2.nodesData = MatrixXd(numNodes, 2);
+		for (int node = 0; node < numNodes; node++)
+		{
+			graph2.nodesData(node, 0) = 1.5 + sin(1.3*node);
+			graph2.nodesData(node, 1) = 1.5 + cos(0.7*node);
+		}
+		for (int node = 0; node < numNodes-1; node++)
+		{
+			edges[node].insert(node+1);
+			edges[node+1].insert(node);
+		}
+
+		graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+		X.graph = graph2;
+		X.edgeWeightsAvailable = false;
+		X.computeEdgeDivergences();
+
+		LabelGraph graph1;
+		graph1.adjacency = graph2.adjacency;
+		graph1.nodesData = VectorXi::Zero(numNodes);
+		for (int node = 0; node < numNodes; node++)
+			graph1.nodesData(node) = (node/4) % numClasses;
+
+		Y.graph = graph1;
+	}
+
+	// relabels each block of nodes to every other class
+	vector< CandidateKey_t > expectedCandidateKeys(ImgLabeling& Y, int blockSize, int numClasses)
+	{
+		const int numNodes = Y.getNumNodes();
+		vector< CandidateKey_t > keys;
+		for (int first = 0; first < numNodes; first += blockSize)
+		{
+			int nodeLabel = Y.getLabel(first);
+			for (int label = 0; label < numClasses; label++)
+			{
+				if (label == nodeLabel)
+					continue;
+
+				CandidateKey_t key;
+				key.second = vector<int>(Y.graph.nodesData.data(), Y.graph.nodesData.data() + numNodes);
+				for (int node = first; node < min(first + blockSize, numNodes); node++)
+				{
+					key.first.insert(node);
+					key.second[node] = label;
+				}
+				keys.push_back(key);
+			}
+		}
+		sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	// exposes the search nodes, node arena and transposition table of the search procedures
+	class ArenaSearchProcedure : public BreadthFirstBeamSearchProcedure
+	{
+	public:
+		typedef SearchNodeArena Arena;
+		typedef SearchNode Node;
+		typedef TranspositionTable Table;
+
+		Node* createRoot(ImgFeatures& X, ImgLabeling* YTruth, SearchSpace* searchSpace, Arena* arena)
+		{
+			return createRootNode(LL, X, YTruth, searchSpace, NULL, NULL, arena, NULL, NULL);
+		}
+
+		Node* createRoot(SearchType searchType, ImgFeatures& X, ImgLabeling* YTruth, SearchSpace* searchSpace, 
+			IRankModel* heuristicModel, IRankModel* costModel, Arena* arena, Table* table)
+		{
+			return createRootNode(searchType, X, YTruth, searchSpace, heuristicModel, costModel, arena, table, NULL);
+		}
+	};
+
+	// exposes the expansion step of best-first beam search
+	class ExpandingSearchProcedure : public BestFirstBeamSearchProcedure
+	{
+	public:
+		typedef SearchNode Node;
+		typedef SearchNodeArena Arena;
+		typedef SearchNodeHeuristicPQ HeuristicPQ;
+		typedef SearchNodeCostPQ CostPQ;
+
+		Node* createRoot(ImgFeatures& X, ImgLabeling* YTruth, SearchSpace* searchSpace, Arena* arena)
+		{
+			Node* root = createRootNode(LL, X, YTruth, searchSpace, NULL, NULL, arena, NULL, NULL);
+			resetVisited(root);
+			return root;
+		}
+
+		HeuristicPQ expand(vector< Node* > subsetOpenSet, HeuristicPQ& openSet, CostPQ& costSet, ImgLabeling* YTruth)
+		{
+			return expandElements(subsetOpenSet, openSet, costSet, NULL, YTruth, LL, 0, 1);
+		}
+	};
+
 	TEST_CLASS(SearchSpaceTests)
 	{
 	public:
@@ -107,8 +280,8 @@ namespace Testing
 
 			LabelGraph graph1;
 			graph1.nodesData = VectorXi::Zero(4);
-			graph1.nodesData << 0, 1, 1, 0;
-			graph1.adjList = edgeNeighbors;
+			graph1.nodesData << 1, 0, 0, 1;
+			graph1.adjacency = CompressedAdjacency(edgeNeighbors, 4);
 
 			ImgLabeling YPred;
 			YPred.graph = graph1;
@@ -119,10 +292,11 @@ namespace Testing
 					0.2, 0.4, 0.6,
 					1.5, 3.0, 4.5,
 					3.1, 4.5, 9.2;
-			graph2.adjList = edgeNeighbors;
+			graph2.adjacency = graph1.adjacency;
 
 			ImgFeatures X;
 			X.graph = graph2;
+			X.computeEdgeDivergences();
 
 			IFeatureFunction* featureFunctionTest = new StandardAltFeatures();
 			set<int> action;
@@ -163,5 +337,1022 @@ namespace Testing
 			bool pairwiseOkay = pairwiseDiff.cwiseAbs().sum() < EPSILON;
 			Assert::AreEqual(pairwiseOkay, true);
 		}
+
+		TEST_METHOD(FastDenseCRFFeaturesTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			// nodes on a grid so that some pairs are within the kernel bandwidth and most are not
+			const int gridSize = 12;
+			const int numNodes = gridSize*gridSize;
+
+			LabelGraph graph1;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(numNodes, 3);
+
+			ImgFeatures X;
+			X.nodeLocations = MatrixXd(numNodes, 2);
+			X.nodeLocationsAvailable = true;
+
+			for (int node = 0; node < numNodes; node++)
+			{
+				int row = node / gridSize;
+				int col = node % gridSize;
+				X.nodeLocations(node, 0) = (col + 0.5 + 0.3*sin(1.0*node))/gridSize;
+				X.nodeLocations(node, 1) = (row + 0.5 + 0.3*cos(1.0*node))/gridSize;
+				graph2.nodesData(node, 0) = 0.01*sin(0.7*node);
+				graph2.nodesData(node, 1) = 0.01*cos(1.3*node);
+				graph2.nodesData(node, 2) = 0.005*row;
+				graph1.nodesData(node) = (row < gridSize/2) ? 0 : ((col < gridSize/3) ? 1 : 2);
+			}
+			X.graph = graph2;
+
+			ImgLabeling YPred;
+			YPred.graph = graph1;
+			YPred.confidences = MatrixXd::Constant(numNodes, 3, 1.0/3);
+			YPred.confidencesAvailable = true;
+
+			IFeatureFunction* exactFeatures = new DenseCRFFeatures();
+			IFeatureFunction* fastFeatures = new FastDenseCRFFeatures();
+			set<int> action;
+			RankFeatures phiExact = exactFeatures->computeFeatures(X, YPred, action);
+			RankFeatures phiFast = fastFeatures->computeFeatures(X, YPred, action);
+
+			// check feature size
+			Assert::AreEqual(phiFast.data.size(), phiExact.data.size());
+
+			// check features relative to the exact pairwise sums
+			VectorXd diff = phiFast.data - phiExact.data;
+			bool okay = diff.cwiseAbs().sum() < EPSILON*phiExact.data.cwiseAbs().sum();
+			Assert::AreEqual(okay, true);
+
+			delete exactFeatures;
+			delete fastFeatures;
+		}
+
+		TEST_METHOD(IncrementalFeaturesTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			// 3x3 grid
+			const int gridSize = 3;
+			const int numNodes = gridSize*gridSize;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(numNodes, 2);
+			for (int node = 0; node < numNodes; node++)
+			{
+				int row = node / gridSize;
+				int col = node % gridSize;
+				graph2.nodesData(node, 0) = 0.3*sin(1.0*node);
+				graph2.nodesData(node, 1) = 0.2*cos(2.0*node);
+				if (col+1 < gridSize)
+				{
+					edges[node].insert(node+1);
+					edges[node+1].insert(node);
+				}
+				if (row+1 < gridSize)
+				{
+					edges[node].insert(node+gridSize);
+					edges[node+gridSize].insert(node);
+				}
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			LabelGraph graph1;
+			graph1.adjacency = graph2.adjacency;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			graph1.nodesData << 0, 0, 1, 2, 0, 1, 2, 2, 0;
+
+			ImgLabeling YParent;
+			YParent.graph = graph1;
+
+			IFeatureFunction* featureFunction = new StandardFeatures();
+			RankFeatures parentFeatures = featureFunction->computeFeatures(X, YParent, set<int>());
+
+			// case 0: multiple nodes, not adjacent
+			// case 1: adjacent nodes that both change (neighbor changed branch)
+			// case 2: no-op relabel together with a real change
+			const int numCases = 3;
+			int actionNodes[numCases][2] = { {0, 8}, {1, 4}, {4, 5} };
+			int actionLabels[numCases][2] = { {2, 1}, {2, 1}, {0, 2} };
+
+			RankFeatures incremental;
+			for (int c = 0; c < numCases; c++)
+			{
+				ImgLabeling Y = YParent;
+				set<int> action;
+				for (int i = 0; i < 2; i++)
+				{
+					Y.graph.nodesData(actionNodes[c][i]) = actionLabels[c][i];
+					action.insert(actionNodes[c][i]);
+				}
+
+				// the result storage is reused across cases
+				RankFeatures scratch = featureFunction->computeFeatures(X, Y, action);
+				featureFunction->computeFeaturesIncremental(X, YParent, parentFeatures, Y, action, incremental);
+
+				Assert::AreEqual(incremental.data.size(), scratch.data.size());
+				bool okay = (incremental.data - scratch.data).cwiseAbs().sum() < EPSILON;
+				Assert::AreEqual(okay, true);
+			}
+
+			delete featureFunction;
+		}
+
+		TEST_METHOD(MutexTermTest)
+		{
+			Global::settings = new Settings();
+			const int numClasses = 6;
+			const int classLabels[numClasses] = { 0, 1, 3, 4, 5, 7 };
+			for (int c = 0; c < numClasses; c++)
+				Global::settings->CLASSES.addClass(c, classLabels[c], c == 0);
+			Global::settings->CLASSES.setBackgroundLabel(0);
+
+			// chain of nodes at pseudo-random locations
+			const int numNodes = 16;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd::Zero(numNodes, 1);
+			for (int node = 0; node < numNodes-1; node++)
+			{
+				edges[node].insert(node+1);
+				edges[node+1].insert(node);
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+			X.nodeLocations = MatrixXd(numNodes, 2);
+			X.nodeLocationsAvailable = true;
+
+			LabelGraph graph1;
+			graph1.adjacency = graph2.adjacency;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			for (int node = 0; node < numNodes; node++)
+			{
+				X.nodeLocations(node, 0) = 0.5 + 0.5*sin(1.7*node);
+				X.nodeLocations(node, 1) = 0.5 + 0.5*cos(2.3*node);
+				graph1.nodesData(node) = (node*5) % numClasses;
+			}
+
+			ImgLabeling Y;
+			Y.graph = graph1;
+
+			IFeatureFunction* featureFunction = new StandardPruneFeatures();
+
+			// each node as a single node action, then all nodes at once
+			for (int start = 0; start <= numNodes; start++)
+			{
+				set<int> action;
+				if (start < numNodes)
+					action.insert(start);
+				else
+					for (int node = 0; node < numNodes; node++)
+						action.insert(node);
+
+				VectorXd phi = featureFunction->computeFeatures(X, Y, action).data;
+
+				// pairwise scan over all other nodes with the manual Stanford constraints
+				VectorXd mutexTruth = VectorXd::Zero(8);
+				for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
+				{
+					int node1 = *it;
+					int label1 = Global::settings->CLASSES.getClassLabel(Y.getLabel(node1));
+					double y1 = X.getNodeLocationY(node1);
+					for (int node2 = 0; node2 < numNodes; node2++)
+					{
+						if (node1 == node2)
+							continue;
+
+						int label2 = Global::settings->CLASSES.getClassLabel(Y.getLabel(node2));
+						double y2 = X.getNodeLocationY(node2);
+						if (label1 == 1 && label2 == 3 && y1 > y2)
+							mutexTruth(0) = 1;
+						if (label1 == 3 && label2 == 1 && y1 < y2)
+							mutexTruth(1) = 1;
+						if (label1 == 1 && label2 == 4 && y1 > y2)
+							mutexTruth(2) = 1;
+						if (label1 == 4 && label2 == 1 && y1 < y2)
+							mutexTruth(3) = 1;
+						if (label1 == 1 && label2 == 5 && y1 > y2)
+							mutexTruth(4) = 1;
+						if (label1 == 5 && label2 == 1 && y1 < y2)
+							mutexTruth(5) = 1;
+						if (label1 == 1 && label2 == 7 && y1 > y2)
+							mutexTruth(6) = 1;
+						if (label1 == 7 && label2 == 1 && y1 < y2)
+							mutexTruth(7) = 1;
+					}
+				}
+
+				bool okay = phi.segment(1, 8) == mutexTruth;
+				Assert::AreEqual(okay, true);
+			}
+
+			delete featureFunction;
+		}
+
+		TEST_METHOD(SearchDeadlineTest)
+		{
+			Global::settings = new Settings();
+
+			// no budget never expires
+			Global::settings->TIME_BUDGET_MS = 0;
+			ISearchProcedure::SearchDeadline unlimited(HC);
+			this_thread::sleep_for(chrono::milliseconds(5));
+			Assert::IsFalse(unlimited.expired());
+
+			// budget applies to inference searches only
+			Global::settings->TIME_BUDGET_MS = 1;
+			ISearchProcedure::SearchDeadline inference(HC);
+			ISearchProcedure::SearchDeadline learning(LEARN_H);
+			this_thread::sleep_for(chrono::milliseconds(5));
+			Assert::IsTrue(inference.expired());
+			Assert::IsFalse(learning.expired());
+		}
+
+		TEST_METHOD(SearchTimeBudgetTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+			Global::settings->TIME_BUDGET_MS = 50;
+
+			// 30x30 grid, far too many steps to finish without the budget
+			const int gridSize = 30;
+			const int numNodes = gridSize*gridSize;
+			const int timeBound = 100000;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(numNodes, 2);
+			for (int node = 0; node < numNodes; node++)
+			{
+				int row = node / gridSize;
+				int col = node % gridSize;
+				graph2.nodesData(node, 0) = 0.3*sin(1.0*node);
+				graph2.nodesData(node, 1) = 0.2*cos(2.0*node);
+				if (col+1 < gridSize)
+				{
+					edges[node].insert(node+1);
+					edges[node+1].insert(node);
+				}
+				if (row+1 < gridSize)
+				{
+					edges[node].insert(node+gridSize);
+					edges[node+gridSize].insert(node);
+				}
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			LabelGraph graph1;
+			graph1.adjacency = graph2.adjacency;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			for (int node = 0; node < numNodes; node++)
+				graph1.nodesData(node) = node % 3;
+
+			ImgLabeling YTruth;
+			YTruth.graph = graph1;
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new ZeroInit(), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+			// a wide beam makes a single step take much longer than the budget
+			ISearchProcedure* searchProcedure = new BreadthFirstBeamSearchProcedure(100);
+
+			ISearchProcedure::SearchMetadata searchMetadata;
+			searchMetadata.setType = TEST;
+			searchMetadata.exampleName = "budget";
+			searchMetadata.iter = 0;
+			vector<double> stepTimes;
+			searchMetadata.stepTimes = &stepTimes;
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			ImgLabeling YPred = searchProcedure->performSearch(LL, X, &YTruth, timeBound, 
+				searchSpace, NULL, NULL, NULL, searchMetadata);
+			double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			Assert::IsTrue(elapsed < 1000);
+			Assert::AreEqual(static_cast<int>(YPred.getNumNodes()), numNodes);
+
+			// stopped at the deadline long before the time bound, with one time per finished step
+			Assert::IsTrue(static_cast<int>(stepTimes.size()) < timeBound);
+			double totalStepTime = 0;
+			for (vector<double>::iterator it = stepTimes.begin(); it != stepTimes.end(); ++it)
+			{
+				Assert::IsTrue(*it >= 0);
+				totalStepTime += *it;
+			}
+			Assert::IsTrue(totalStepTime <= elapsed);
+
+			delete searchProcedure;
+			delete searchSpace;
+		}
+
+		TEST_METHOD(SearchStepTimesTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+			Global::settings->TIME_BUDGET_MS = 60000;
+
+			// chain of 4 nodes
+			const int numNodes = 4;
+			const int timeBound = 3;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(numNodes, 2);
+			for (int node = 0; node < numNodes; node++)
+			{
+				graph2.nodesData(node, 0) = 0.1*node;
+				graph2.nodesData(node, 1) = -0.2*node;
+				if (node+1 < numNodes)
+				{
+					edges[node].insert(node+1);
+					edges[node+1].insert(node);
+				}
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			LabelGraph graph1;
+			graph1.adjacency = graph2.adjacency;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			for (int node = 0; node < numNodes; node++)
+				graph1.nodesData(node) = node % 2;
+
+			ImgLabeling YTruth;
+			YTruth.graph = graph1;
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new ZeroInit(), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+
+			ISearchProcedure::SearchMetadata searchMetadata;
+			searchMetadata.setType = TEST;
+			searchMetadata.exampleName = "steptimes";
+			searchMetadata.iter = 0;
+			vector<double> stepTimes;
+			searchMetadata.stepTimes = &stepTimes;
+
+			// the step times are handed back for both search procedures, without anytime predictions
+			ISearchProcedure* searchProcedures[2] = { new BreadthFirstBeamSearchProcedure(2), new BestFirstBeamSearchProcedure(2) };
+			for (int i = 0; i < 2; i++)
+			{
+				stepTimes.clear();
+				searchProcedures[i]->performSearch(LL, X, &YTruth, timeBound, 
+					searchSpace, NULL, NULL, NULL, searchMetadata);
+
+				Assert::AreEqual(static_cast<int>(stepTimes.size()), timeBound);
+				for (int step = 0; step < timeBound; step++)
+					Assert::IsTrue(stepTimes[step] >= 0);
+
+				delete searchProcedures[i];
+			}
+
+			delete searchSpace;
+		}
+
+		TEST_METHOD(SearchNodeArenaTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			// chain of 4 nodes
+			const int numNodes = 4;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd::Ones(numNodes, 2);
+			for (int node = 0; node < numNodes-1; node++)
+			{
+				edges[node].insert(node+1);
+				edges[node+1].insert(node);
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			LabelGraph graph1;
+			graph1.adjacency = graph2.adjacency;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			graph1.nodesData << 0, 1, 2, 1;
+
+			ImgLabeling YTruth;
+			YTruth.graph = graph1;
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new ZeroInit(), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+			ArenaSearchProcedure* searchProcedure = new ArenaSearchProcedure();
+
+			{
+				ArenaSearchProcedure::Arena arena;
+				Assert::AreEqual(arena.size(), 0);
+
+				// unused storage goes back to the free list and is handed out again
+				void* slot = arena.allocate();
+				Assert::AreEqual(arena.size(), 1);
+				arena.deallocate(slot);
+				Assert::AreEqual(arena.size(), 0);
+				Assert::IsTrue(arena.allocate() == slot);
+				arena.deallocate(slot);
+
+				// a released node is destroyed and its slot reused
+				ArenaSearchProcedure::Node* root = searchProcedure->createRoot(X, &YTruth, searchSpace, &arena);
+				Assert::IsTrue(static_cast<void*>(root) == slot);
+				Assert::AreEqual(arena.size(), 1);
+				arena.release(root);
+				Assert::AreEqual(arena.size(), 0);
+				Assert::IsTrue(arena.allocate() == slot);
+				arena.deallocate(slot);
+
+				// slots beyond the first block are distinct
+				const int numSlots = 300;
+				set<void*> slots;
+				for (int i = 0; i < numSlots; i++)
+					slots.insert(arena.allocate());
+				Assert::AreEqual(static_cast<int>(slots.size()), numSlots);
+				Assert::AreEqual(arena.size(), numSlots);
+				for (set<void*>::iterator it = slots.begin(); it != slots.end(); ++it)
+					arena.deallocate(*it);
+
+				// nodes still alive are destroyed with the arena
+				searchProcedure->createRoot(X, &YTruth, searchSpace, &arena);
+				searchProcedure->createRoot(X, &YTruth, searchSpace, &arena);
+				Assert::AreEqual(arena.size(), 2);
+			}
+
+			delete searchProcedure;
+			delete searchSpace;
+		}
+
+		TEST_METHOD(SearchNodeStorageTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			// chain of 4 nodes
+			const int numNodes = 4;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(numNodes, 2);
+			graph2.nodesData << 0.1, 0.5, -0.3, 0.2, 0.7, -0.1, 0.4, 0.4;
+			for (int node = 0; node < numNodes-1; node++)
+			{
+				edges[node].insert(node+1);
+				edges[node+1].insert(node);
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			LabelGraph graph1;
+			graph1.adjacency = graph2.adjacency;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			graph1.nodesData << 0, 1, 2, 1;
+
+			ImgLabeling YTruth;
+			YTruth.graph = graph1;
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new ZeroInit(), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+			ArenaSearchProcedure* searchProcedure = new ArenaSearchProcedure();
+
+			{
+				// cost features without models
+				ArenaSearchProcedure::Arena arena;
+				ArenaSearchProcedure::Node* root = searchProcedure->createRoot(LEARN_C_ORACLE_H, X, &YTruth, searchSpace, 
+					NULL, NULL, &arena, NULL);
+
+				// successors built in new vectors
+				vector< ArenaSearchProcedure::Node* > successors = root->generateSuccessorNodes(false, 0, 1, NULL);
+				const int numSuccessors = successors.size();
+				Assert::AreEqual(numSuccessors, numNodes*2);
+
+				vector< VectorXi > labels;
+				vector< VectorXd > costFeatures;
+				vector< double > costs;
+				for (int i = 0; i < numSuccessors; i++)
+				{
+					labels.push_back(successors[i]->getY().graph.nodesData);
+					costFeatures.push_back(successors[i]->getCostFeatures().data);
+					costs.push_back(successors[i]->getCost());
+					arena.release(successors[i]);
+				}
+				Assert::AreEqual(arena.storageSize(), numSuccessors);
+
+				// successors built in the vectors of the released nodes
+				successors = root->generateSuccessorNodes(false, 0, 1, NULL);
+				Assert::AreEqual(static_cast<int>(successors.size()), numSuccessors);
+				Assert::AreEqual(arena.storageSize(), 0);
+				for (int i = 0; i < numSuccessors; i++)
+				{
+					ImgLabeling Y = successors[i]->getY();
+					Assert::IsTrue(Y.graph.nodesData == labels[i]);
+					Assert::IsTrue(successors[i]->getCostFeatures().data == costFeatures[i]);
+					Assert::AreEqual(successors[i]->getCost(), costs[i]);
+
+					// and the same as computing them from scratch
+					RankFeatures scratch = searchSpace->computeCostFeatures(X, Y);
+					Assert::IsTrue((scratch.data - costFeatures[i]).cwiseAbs().sum() < EPSILON);
+				}
+			}
+
+			delete searchProcedure;
+			delete searchSpace;
+		}
+
+		TEST_METHOD(TranspositionTableEvictionTest)
+		{
+			Global::settings = new Settings();
+
+			ImgFeatures X;
+			ArenaSearchProcedure::Table table(2, false);
+			table.prepare(&X, HC, NULL, NULL);
+
+			ArenaSearchProcedure::Table::Entry entry;
+			entry.hasValues = true;
+			entry.hasFeatures = false;
+			for (int i = 1; i <= 2; i++)
+			{
+				entry.heuristic = i;
+				entry.cost = 10*i;
+				table.insert(i, entry);
+			}
+
+			// touching 1 makes 2 the least recently used
+			Assert::IsTrue(table.lookup(1, entry));
+			Assert::AreEqual(entry.heuristic, 1.0);
+
+			entry.heuristic = 3;
+			entry.cost = 30;
+			table.insert(3, entry);
+			Assert::AreEqual(table.size(), 2);
+			Assert::IsFalse(table.lookup(2, entry));
+			Assert::IsTrue(table.lookup(1, entry));
+			Assert::IsTrue(table.lookup(3, entry));
+			Assert::AreEqual(entry.cost, 30.0);
+
+			Assert::AreEqual(static_cast<int>(table.getHits()), 3);
+			Assert::AreEqual(static_cast<int>(table.getMisses()), 1);
+		}
+
+		TEST_METHOD(TranspositionTablePrepareTest)
+		{
+			Global::settings = new Settings();
+
+			ImgFeatures X1;
+			ImgFeatures X2;
+			OnlineRankModel model1;
+			OnlineRankModel model2;
+			ArenaSearchProcedure::Table table(10, false);
+
+			ArenaSearchProcedure::Table::Entry entry;
+			entry.hasValues = true;
+			entry.hasFeatures = false;
+			entry.heuristic = 1;
+			entry.cost = 1;
+
+			// same image, type and models keep the entries but reset the counters
+			table.prepare(&X1, HC, &model1, &model1);
+			table.insert(1, entry);
+			table.lookup(1, entry);
+			table.prepare(&X1, HC, &model1, &model1);
+			Assert::AreEqual(table.size(), 1);
+			Assert::AreEqual(static_cast<int>(table.getHits()), 0);
+
+			// another image clears them
+			table.prepare(&X2, HC, &model1, &model1);
+			Assert::AreEqual(table.size(), 0);
+
+			// another heuristic or cost model clears them
+			table.insert(1, entry);
+			table.prepare(&X2, HC, &model2, &model1);
+			Assert::AreEqual(table.size(), 0);
+
+			table.insert(1, entry);
+			table.prepare(&X2, HC, &model2, &model2);
+			Assert::AreEqual(table.size(), 0);
+
+			// another search type clears them
+			table.insert(1, entry);
+			table.prepare(&X2, HL, &model2, &model2);
+			Assert::AreEqual(table.size(), 0);
+		}
+
+		TEST_METHOD(TranspositionTableHitTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			// 3x3 grid
+			const int gridSize = 3;
+			const int numNodes = gridSize*gridSize;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(numNodes, 2);
+			for (int node = 0; node < numNodes; node++)
+			{
+				int row = node / gridSize;
+				int col = node % gridSize;
+				graph2.nodesData(node, 0) = 0.3*sin(1.0*node);
+				graph2.nodesData(node, 1) = 0.2*cos(2.0*node);
+				if (col+1 < gridSize)
+				{
+					edges[node].insert(node+1);
+					edges[node+1].insert(node);
+				}
+				if (row+1 < gridSize)
+				{
+					edges[node].insert(node+gridSize);
+					edges[node+gridSize].insert(node);
+				}
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new ZeroInit(), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+
+			// models with arbitrary fixed weights
+			const string MODEL_FILE = "transposition_model_test.txt";
+			ImgLabeling YInit = searchSpace->getInitialPrediction(X);
+			int featureDim = searchSpace->computeHeuristicFeatures(X, YInit).data.size();
+			ofstream ofh(MODEL_FILE.c_str());
+			ofh << "header" << endl;
+			for (int i = 0; i < featureDim; i++)
+				ofh << i+1 << ":" << 0.1*((i*37)%11 - 5) << " ";
+			ofh << endl;
+			ofh.close();
+			OnlineRankModel heuristicModel(MODEL_FILE);
+			OnlineRankModel costModel(MODEL_FILE);
+			MyFileSystem::FileSystem::deleteFile(MODEL_FILE);
+
+			ArenaSearchProcedure* searchProcedure = new ArenaSearchProcedure();
+			ArenaSearchProcedure::Arena arena;
+			ArenaSearchProcedure::Table table(1000, true);
+			table.prepare(&X, HC, &heuristicModel, &costModel);
+
+			// fresh nodes without a table
+			ArenaSearchProcedure::Node* fresh = searchProcedure->createRoot(HC, X, NULL, searchSpace, 
+				&heuristicModel, &costModel, &arena, NULL);
+			vector< ArenaSearchProcedure::Node* > freshSuccessors = fresh->generateSuccessorNodes(false, 0, 1, NULL);
+
+			// first pass fills the table, second pass only hits it
+			for (int pass = 0; pass < 2; pass++)
+			{
+				ArenaSearchProcedure::Node* root = searchProcedure->createRoot(HC, X, NULL, searchSpace, 
+					&heuristicModel, &costModel, &arena, &table);
+				vector< ArenaSearchProcedure::Node* > successors = root->generateSuccessorNodes(false, 0, 1, NULL);
+
+				Assert::AreEqual(root->getHeuristic(), fresh->getHeuristic());
+				Assert::AreEqual(root->getCost(), fresh->getCost());
+				Assert::AreEqual(successors.size(), freshSuccessors.size());
+				for (int i = 0; i < static_cast<int>(successors.size()); i++)
+				{
+					Assert::AreEqual(successors[i]->getHeuristic(), freshSuccessors[i]->getHeuristic());
+					Assert::AreEqual(successors[i]->getCost(), freshSuccessors[i]->getCost());
+				}
+
+				const int numLookups = 1 + successors.size();
+				Assert::AreEqual(static_cast<int>(table.getHits()), pass*numLookups);
+			}
+
+			delete searchProcedure;
+			delete searchSpace;
+		}
+
+		TEST_METHOD(ClassAggregationTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			const int numClasses = 3;
+			const int numNodes = 5;
+			const int featureDim = 2;
+
+			LabelGraph graph1;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			graph1.nodesData << 0, 2, 0, 1, 2;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(numNodes, featureDim);
+			graph2.nodesData << 0.1, 2.0,
+								0.4, 1.0,
+								0.2, 3.0,
+								0.9, 0.5,
+								0.3, 4.0;
+			for (int node = 0; node < numNodes-1; node++)
+			{
+				edges[node].insert(node+1);
+				edges[node+1].insert(node);
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			ImgLabeling YPred;
+			YPred.graph = graph1;
+
+			const VectorXi& classIndices = ClassAggregation::computeClassIndices(YPred);
+
+			// unary sums equal one-hot(classes)^T * [1, features]
+			MatrixXd oneHot = MatrixXd::Zero(numNodes, numClasses);
+			MatrixXd biasedFeatures(numNodes, 1+featureDim);
+			for (int node = 0; node < numNodes; node++)
+			{
+				oneHot(node, classIndices(node)) = 1;
+				biasedFeatures(node, 0) = 1;
+				biasedFeatures.row(node).tail(featureDim) = graph2.nodesData.row(node);
+			}
+			MatrixXd unaryTruth = (oneHot.transpose() * biasedFeatures).transpose();
+
+			VectorXd unarySums = ClassAggregation::computeUnarySums(X, classIndices, numClasses);
+			VectorXd unaryDiff = unarySums - Map<VectorXd>(unaryTruth.data(), unaryTruth.size());
+			bool unaryOkay = unaryDiff.cwiseAbs().sum() < EPSILON;
+			Assert::AreEqual(unaryOkay, true);
+
+			// every directed edge is counted once in its class pair
+			MatrixXi classPairSlots = ClassAggregation::computeClassPairSlots(numClasses);
+			VectorXd pairCounts = ClassAggregation::computePairwiseCounts(X, classIndices, classPairSlots, (numClasses*(numClasses+1))/2);
+			Assert::AreEqual(static_cast<int>(pairCounts.sum()), X.getNumEdges());
+			Assert::AreEqual(pairCounts(classPairSlots(classIndices(0), classIndices(1))), 4.0);
+			Assert::AreEqual(pairCounts(classPairSlots(classIndices(2), classIndices(2))), 0.0);
+
+			// pairwise sums equal the contrast sensitive edge features summed per class pair
+			const int numSlots = (numClasses*(numClasses+1))/2;
+			VectorXd pairwiseTruth = VectorXd::Zero(numSlots*featureDim);
+			for (int node1 = 0; node1 < numNodes; node1++)
+			{
+				for (CompressedAdjacency::NeighborIterator it = X.graph.adjacency->neighborsBegin(node1); it != X.graph.adjacency->neighborsEnd(node1); ++it)
+				{
+					int node2 = *it;
+					VectorXd edgeFeatures = (-(graph2.nodesData.row(node1) - graph2.nodesData.row(node2)).array().square()).exp().transpose();
+					if (classIndices(node1) == classIndices(node2))
+						edgeFeatures = 1 - edgeFeatures.array();
+					pairwiseTruth.segment(classPairSlots(classIndices(node1), classIndices(node2))*featureDim, featureDim) += edgeFeatures;
+				}
+			}
+
+			VectorXd pairwiseSums = ClassAggregation::computePairwiseSums(X, classIndices, classPairSlots, numSlots);
+			bool pairwiseOkay = (pairwiseSums - pairwiseTruth).cwiseAbs().sum() < EPSILON;
+			Assert::AreEqual(pairwiseOkay, true);
+
+			// class indices are the labeling's own
+			Assert::IsTrue(classIndices.data() == YPred.graph.nodesData.data());
+		}
+
+		TEST_METHOD(SuccessorCandidatesTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			const int numClasses = 3;
+			const int numNodes = 30;
+
+			ImgFeatures X;
+			ImgLabeling Y;
+			setupChainHelper(X, Y, numNodes, numClasses);
+
+			// every node flipped to every other class
+			vector< CandidateKey_t > flipbitKeys = expectedCandidateKeys(Y, 1, numClasses);
+			Assert::AreEqual(static_cast<int>(flipbitKeys.size()), numNodes*(numClasses-1));
+
+			FlipbitSuccessor flipbit;
+			vector< ImgCandidate > YCandidates = flipbit.generateSuccessors(X, Y, 0, 1);
+			Assert::IsTrue(sortedCandidateKeys(YCandidates) == flipbitKeys);
+
+			// no edges cut: every block of same class nodes flipped to every other class
+			StochasticSuccessor keepAll(false, 1.0, 1.1, 1.1);
+			YCandidates = keepAll.generateSuccessors(X, Y, 0, 1);
+			Assert::IsTrue(sortedCandidateKeys(YCandidates) == expectedCandidateKeys(Y, 4, numClasses));
+
+			// all edges cut: same as flipbit
+			StochasticSuccessor cutAll(false, 1.0, 0, 0);
+			YCandidates = cutAll.generateSuccessors(X, Y, 0, 1);
+			Assert::IsTrue(sortedCandidateKeys(YCandidates) == flipbitKeys);
+		}
+
+		TEST_METHOD(StreamedPruneTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			const int numClasses = 3;
+
+			// enough flipbit successors to span several rank batches
+			const int numNodes = 150;
+
+			ImgFeatures X;
+			ImgLabeling Y;
+			setupChainHelper(X, Y, numNodes, numClasses);
+
+			VectorXd weights(64);
+			for (int i = 0; i < weights.size(); i++)
+				weights(i) = sin(2.3*i + 0.5);
+			LinearRanker ranker(weights);
+
+			RankerPrune prune(0.5, new StandardFeatures());
+			prune.setRanker(&ranker);
+
+			vector< ISuccessorFunction* > successorFunctions;
+			successorFunctions.push_back(new FlipbitSuccessor());
+			successorFunctions.push_back(new StochasticSuccessor(false, 1.0, 1.1, 1.1));
+			for (vector< ISuccessorFunction* >::iterator it = successorFunctions.begin(); it != successorFunctions.end(); ++it)
+			{
+				ISuccessorFunction* successorFunction = *it;
+
+				// generate then prune
+				vector< ImgCandidate > YCandidates = successorFunction->generateSuccessors(X, Y, 0, 1);
+				vector< ImgCandidate > YPruned = prune.pruneSuccessors(X, Y, YCandidates, NULL, NULL);
+				Assert::AreEqual(static_cast<int>(YPruned.size()), static_cast<int>(0.5*YCandidates.size()));
+
+				// prune while streaming keeps the same survivors in the same order
+				ImgLabeling YTemplate;
+				vector< ImgCandidateDelta > deltas = prune.generatePrunedSuccessorDeltas(X, Y, successorFunction, 0, 1, 
+					NULL, NULL, YTemplate);
+				Assert::AreEqual(static_cast<int>(deltas.size()), static_cast<int>(YPruned.size()));
+				for (int i = 0; i < static_cast<int>(deltas.size()); i++)
+				{
+					Assert::IsTrue(candidateKey(deltas[i].materialize(YTemplate)) == candidateKey(YPruned[i]));
+				}
+
+				delete successorFunction;
+			}
+
+			delete prune.getFeatureFunction();
+		}
+
+		TEST_METHOD(BestFirstOpenSetDuplicatesTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			// chain of 4 nodes
+			const int numNodes = 4;
+
+			AdjList_t edges;
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd::Ones(numNodes, 2);
+			for (int node = 0; node < numNodes-1; node++)
+			{
+				edges[node].insert(node+1);
+				edges[node+1].insert(node);
+			}
+
+			graph2.adjacency = CompressedAdjacency(edges, numNodes);
+
+			ImgFeatures X;
+			X.graph = graph2;
+			X.computeEdgeDivergences();
+
+			LabelGraph graph1;
+			graph1.adjacency = graph2.adjacency;
+			graph1.nodesData = VectorXi::Zero(numNodes);
+			graph1.nodesData << 0, 1, 2, 1;
+
+			ImgLabeling YTruth;
+			YTruth.graph = graph1;
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new ZeroInit(), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+			ExpandingSearchProcedure* searchProcedure = new ExpandingSearchProcedure();
+
+			const bool checkForDuplicates[] = {true, false};
+			for (int i = 0; i < 2; i++)
+			{
+				Global::settings->CHECK_FOR_DUPLICATES = checkForDuplicates[i];
+
+				ExpandingSearchProcedure::Arena arena;
+				ExpandingSearchProcedure::HeuristicPQ openSet;
+				ExpandingSearchProcedure::CostPQ costSet;
+				ExpandingSearchProcedure::Node* root = searchProcedure->createRoot(X, &YTruth, searchSpace, &arena);
+				costSet.push(root);
+
+				// expand the root: every node flipped to the 2 other classes
+				vector< ExpandingSearchProcedure::Node* > subsetOpenSet(1, root);
+				ExpandingSearchProcedure::HeuristicPQ candidateSet = searchProcedure->expand(subsetOpenSet, openSet, costSet, &YTruth);
+				Assert::AreEqual(static_cast<int>(candidateSet.size()), numNodes*2);
+
+				set< ExpandingSearchProcedure::Node* > openNodes;
+				while (!candidateSet.empty())
+				{
+					openNodes.insert(candidateSet.top());
+					openSet.push(candidateSet.top());
+					costSet.push(candidateSet.top());
+					candidateSet.pop();
+				}
+
+				// expand the best open state: flipping its node back or to the 
+				// third class gives visited states, which are always rejected
+				subsetOpenSet = searchProcedure->selectSubsetOpenSet(openSet);
+				Assert::AreEqual(static_cast<int>(subsetOpenSet.size()), 1);
+				candidateSet = searchProcedure->expand(subsetOpenSet, openSet, costSet, &YTruth);
+				Assert::IsTrue(openSet.empty());
+
+				const int numNewStates = (numNodes-1)*2;
+				const int numOpenStates = numNodes*2 - 1;
+				int numFromOpenSet = 0;
+				const int numCandidates = candidateSet.size();
+				while (!candidateSet.empty())
+				{
+					numFromOpenSet += openNodes.count(candidateSet.top());
+					candidateSet.pop();
+				}
+
+				if (checkForDuplicates[i])
+				{
+					// the rest of the open set is ignored as duplicates
+					Assert::AreEqual(numCandidates, numNewStates);
+					Assert::AreEqual(numFromOpenSet, 0);
+				}
+				else
+				{
+					// the rest of the open set stays a candidate
+					Assert::AreEqual(numCandidates, numNewStates + numOpenStates);
+					Assert::AreEqual(numFromOpenSet, numOpenStates);
+				}
+			}
+
+			delete searchProcedure;
+			delete searchSpace;
+		}
 	};
-}
\ No newline at end of file
+}